@@ -46,6 +46,35 @@ int bake_client_init(margo_instance_id mid, bake_client_t* client);
  */
 int bake_client_finalize(bake_client_t client);
 
+/**
+ * Sets a tracing parameter of the client: "trace_rate" is the fraction of
+ * its requests to sample (0, the default, samples none) and
+ * "trace_ring_size" the number of spans kept per execution stream.  The
+ * sampling decision travels with each request, so that providers trace
+ * the requests the client samples.
+ *
+ * @param[in] client BAKE client
+ * @param[in] key parameter name
+ * @param[in] value parameter value
+ *
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_client_set_conf(bake_client_t client,
+                         const char*   key,
+                         const char*   value);
+
+/**
+ * Writes the spans of the requests sampled by the client to a file, in the
+ * Chrome trace event format (see bake_provider_dump_trace for the provider
+ * side of the requests).
+ *
+ * @param[in] client BAKE client
+ * @param[in] filename output file
+ *
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_client_dump_trace(bake_client_t client, const char* filename);
+
 /**
  * Creates a provider handle to point to a particular BAKE provider.
  *
@@ -111,6 +140,82 @@ int bake_provider_handle_get_eager_limit(bake_provider_handle_t handle,
 int bake_provider_handle_set_eager_limit(bake_provider_handle_t handle,
                                          uint64_t               limit);
 
+/**
+ * Get the QoS class that the provider handle tags its writes and reads
+ * with (one of the BAKE_QOS_CLASS_* values of bake.h).
+ *
+ * @param[in] handle provider handle
+ * @param[out] qos_class QoS class
+ *
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_provider_handle_get_qos_class(bake_provider_handle_t handle,
+                                       uint8_t*               qos_class);
+
+/**
+ * Set the QoS class that the provider handle tags its writes and reads
+ * with, overriding the class the provider would give them from their size
+ * (BAKE_QOS_CLASS_DEFAULT, the default, lets the provider decide).  The
+ * class only matters to providers that enable their scheduler.
+ *
+ * @param[in] handle provider handle
+ * @param[in] qos_class QoS class
+ *
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_provider_handle_set_qos_class(bake_provider_handle_t handle,
+                                       uint8_t                qos_class);
+
+/**
+ * Get the credits of the provider handle: the number of operations and
+ * bytes it may have in flight with the provider at once (0 for unlimited).
+ * Writes, reads and create-write-persist operations beyond them are queued
+ * locally until earlier ones complete; an operation is always let through
+ * if nothing else is in flight.  Credits are granted by the provider, which
+ * splits its own credits evenly among the handles that asked for some
+ * recently; the handle asks before its first data operation and again once
+ * the grant expires.  Providers that do not grant credits leave the handle
+ * unlimited.
+ *
+ * @param[in] handle provider handle
+ * @param[out] ops operation credits
+ * @param[out] bytes byte credits
+ *
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_provider_handle_get_credits(bake_provider_handle_t handle,
+                                     uint64_t*              ops,
+                                     uint64_t*              bytes);
+
+/**
+ * Set the credits of the provider handle, overriding (from then on) those
+ * granted by the provider.
+ *
+ * @param[in] handle provider handle
+ * @param[in] ops operation credits (0 for unlimited)
+ * @param[in] bytes byte credits (0 for unlimited)
+ *
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_provider_handle_set_credits(bake_provider_handle_t handle,
+                                     uint64_t               ops,
+                                     uint64_t               bytes);
+
+/**
+ * Get flow control counters of the provider handle: the number of
+ * operations that had to be queued for lack of credits and the total time
+ * they spent queued, in seconds.
+ *
+ * @param[in] handle provider handle
+ * @param[out] queued number of queued operations
+ * @param[out] queued_time time spent queued
+ *
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_provider_handle_get_flow_stats(bake_provider_handle_t handle,
+                                        uint64_t*              queued,
+                                        double*                queued_time);
+
 /**
  * Decrement the reference counter of the provider handle,
  * effectively freeing the provider handle when the reference count
@@ -420,6 +525,17 @@ int bake_shutdown_service(bake_client_t client, hg_addr_t addr);
  */
 int bake_noop(bake_provider_handle_t provider);
 
+/**
+ * Retrieves the settings and statistics of a provider, as a string of
+ * "key = value" lines (see bake_provider_get_stats).  The resulting string
+ * must be freed by the caller using free().
+ *
+ * @param [in] provider provider handle
+ * @param [out] stats resulting statistics
+ * @return BAKE_SUCCESS or corresponding error code.
+ */
+int bake_get_stats(bake_provider_handle_t provider, char** stats);
+
 /**
  * Removes a previously persisted BAKE region and frees its associated memory.
  *
@@ -24,7 +24,8 @@ extern "C" {
 #define BAKE_PROVIDER_ID_DEFAULT 0
 #define BAKE_PROVIDER_IGNORE     NULL
 
-typedef struct bake_provider* bake_provider_t;
+typedef struct bake_provider*     bake_provider_t;
+typedef struct bake_elastic_pool* bake_elastic_pool_t;
 
 /**
  * Creates a BAKE pool to use for backend PMEM storage.
@@ -54,6 +55,35 @@ int bake_provider_register(margo_instance_id mid,
                            ABT_pool          pool,
                            bake_provider_t*  provider);
 
+/**
+ * Creates an elastic pool on which to run the RPC handlers of providers.
+ * The pool is served by between min_xstreams and max_xstreams execution
+ * streams: streams are added when ULTs queue up in the pool or wait too long
+ * before running, and retired when the pool stays empty, so that idle cores
+ * are released.  The pool is destroyed when margo is finalized, and must be
+ * created before the providers that use it.
+ *
+ * @param[in] mid Margo instance identifier
+ * @param[in] min_xstreams minimum number of execution streams
+ * @param[in] max_xstreams maximum number of execution streams
+ * @param[out] epool resulting elastic pool
+ * @returns 0 on success, other error codes on failure
+ */
+int bake_elastic_pool_create(margo_instance_id    mid,
+                             unsigned             min_xstreams,
+                             unsigned             max_xstreams,
+                             bake_elastic_pool_t* epool);
+
+/**
+ * Returns the Argobots pool of an elastic pool, to be passed to
+ * bake_provider_register.  Providers registered on it accept "elastic_*"
+ * configuration parameters and report the pool's statistics.
+ *
+ * @param[in] epool elastic pool
+ * @returns the Argobots pool
+ */
+ABT_pool bake_elastic_pool_get_abt_pool(bake_elastic_pool_t epool);
+
 /**
  * @brief Deregisters and destroys the provider.
  *
@@ -142,6 +172,33 @@ int bake_provider_set_conf(bake_provider_t provider,
                            const char*     key,
                            const char*     value);
 
+/**
+ * @brief Retrieve provider-wide settings and statistics (such as those of
+ * automatic tiering, and the counters and latency and size histograms of
+ * every RPC and backend call), as a string of "key = value" lines.  The
+ * statistics of each target (see bake_target_get_stats) follow, with keys
+ * prefixed by "target.<target id>.".  The resulting string must be freed
+ * by the caller using free().
+ *
+ * @param provider Bake provider
+ * @param stats Resulting statistics
+ *
+ * @return 0 on success, other error codes on failure
+ */
+int bake_provider_get_stats(bake_provider_t provider, char** stats);
+
+/**
+ * @brief Write the spans of the requests sampled by the provider (see the
+ * "trace_rate" setting) to a file, in the Chrome trace event format.  Only
+ * the most recent spans of each execution stream are kept.
+ *
+ * @param provider Bake provider
+ * @param filename Output file
+ *
+ * @return 0 on success, other error codes on failure
+ */
+int bake_provider_dump_trace(bake_provider_t provider, const char* filename);
+
 /**
  * @brief Set configuration parameters for a target.
  *
@@ -150,13 +207,30 @@ int bake_provider_set_conf(bake_provider_t provider,
  * @param key Configuration key
  * @param value Configuration value
  *
- * @return 0 on success, -1 on failure
+ * @return 0 on success, BAKE_ERR_OP_UNSUPPORTED if the target's backend has
+ * no such parameter, other error codes on failure
  */
 int bake_target_set_conf(bake_provider_t  provider,
                          bake_target_id_t tid,
                          const char*      key,
                          const char*      value);
 
+/**
+ * @brief Retrieve backend-specific statistics for a target, as a
+ * string of "key = value" lines.  The resulting string must be freed
+ * by the caller using free().
+ *
+ * @param provider Bake provider
+ * @param tid Bake target id
+ * @param stats Resulting statistics
+ *
+ * @return 0 on success, BAKE_ERR_OP_UNSUPPORTED if the target's backend
+ * does not report statistics, other error codes on failure
+ */
+int bake_target_get_stats(bake_provider_t  provider,
+                          bake_target_id_t tid,
+                          char**           stats);
+
 //#ifdef USE_SYMBIOMON
 /* Set symbiomon_provider_t instance for metrics reporting*/
 int bake_provider_set_symbiomon(bake_provider_t provider, symbiomon_provider_t metric_provider);
@@ -6,6 +6,7 @@
 #ifndef __BAKE_SERVER_HPP
 #define __BAKE_SERVER_HPP
 
+#include <cstdlib>
 #include <string>
 #include <vector>
 #include <bake.hpp>
@@ -176,6 +177,24 @@ class provider {
         int ret = bake_provider_set_conf(m_provider, key.c_str(), value.c_str());
         _CHECK_RET(ret);
     }
+
+    void set_target_config(const target& t, const std::string& key, const std::string& value) {
+        int ret = bake_target_set_conf(m_provider, t.m_tid, key.c_str(), value.c_str());
+        _CHECK_RET(ret);
+    }
+
+    /**
+     * @brief Returns backend-specific statistics for a target
+     * as "key = value" lines.
+     */
+    std::string get_target_stats(const target& t) const {
+        char* stats = nullptr;
+        int ret = bake_target_get_stats(m_provider, t.m_tid, &stats);
+        _CHECK_RET(ret);
+        std::string result(stats);
+        free(stats);
+        return result;
+    }
 };
 
 }
@@ -47,6 +47,15 @@ typedef struct {
 #define BAKE_ERR_IO             (-14) /* Back-end I/O error */
 #define BAKE_ERR_END            (-15) /* End of valid bake error codes */
 
+/* QoS classes of provider operations, from the most to the least urgent; a
+ * client may tag its writes and reads with one of them (see
+ * bake_provider_handle_set_qos_class) */
+#define BAKE_QOS_CLASS_DEFAULT    0 /* let the provider classify it */
+#define BAKE_QOS_CLASS_METADATA   1 /* create, persist, get_size, remove... */
+#define BAKE_QOS_CLASS_SMALL      2 /* small writes and reads */
+#define BAKE_QOS_CLASS_BULK       3 /* large writes and reads */
+#define BAKE_QOS_CLASS_BACKGROUND 4 /* migrations */
+
 /**
  * Print bake errors in human-friendly form
  *
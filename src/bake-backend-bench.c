@@ -0,0 +1,587 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <margo.h>
+
+#include "bake-server.h"
+#include "bake-provider.h"
+#include "bake-metrics.h"
+
+/* in-process microbenchmark of a storage backend: attaches a target to a
+ * local provider, then calls the functions of its backend directly from
+ * several ULTs (no RPC, no bulk transfer) and prints the rate, bandwidth and
+ * latency percentiles of each of them */
+
+#define MAX_CONF 32
+
+enum {
+    PHASE_CREATE,
+    PHASE_WRITE,
+    PHASE_PERSIST,
+    PHASE_READ,
+    PHASE_CREATE_WRITE_PERSIST,
+    PHASE_REMOVE,
+    NUM_PHASES
+};
+
+static const char* g_phase_names[NUM_PHASES] = {
+    "create",
+    "write_raw",
+    "persist",
+    "read_raw",
+    "create_write_persist_raw",
+    "remove",
+};
+
+struct options {
+    char*    target;
+    char*    protocol;
+    size_t   min_size;
+    size_t   max_size;
+    unsigned count;
+    unsigned ults;
+    unsigned xstreams;
+    int      random;
+    int      phases; /* bitmask of the phases to report */
+    int      histograms;
+    char*    conf[MAX_CONF];
+    unsigned num_conf;
+};
+
+typedef struct {
+    uint64_t ops;
+    uint64_t errors;
+    uint64_t bytes;
+    uint64_t latency_ns;
+    uint64_t max_latency_ns;
+    uint64_t latency_histogram[BAKE_METRICS_BUCKETS];
+} phase_stats_t;
+
+/* regions and counters of one ULT */
+typedef struct {
+    bake_target_t*    target;
+    int               phase;
+    unsigned          count;
+    size_t*           sizes;
+    unsigned*         order; /* order in which the regions are accessed */
+    bake_region_id_t* rids;
+    bake_region_id_t* cwp_rids;
+    char*             exists;
+    char*             cwp_exists;
+    char*             buffer;
+    phase_stats_t     stats;
+} worker_t;
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: bake-backend-bench [-s size[:max]] [-n count] [-u ults] "
+            "[-x xstreams] [-r] [-o phases] [-c key=value] [-H] "
+            "[-p protocol] <target>\n");
+    fprintf(stderr,
+            "       target is the path to an existing target (prepend pmem:, "
+            "file:, mmap:, mem: or tier: to specify the backend)\n");
+    fprintf(stderr,
+            "       [-s size[:max]] region size, or range of sizes drawn "
+            "uniformly (K, M, G suffixes allowed, default 4K)\n");
+    fprintf(stderr,
+            "       [-n count] number of regions per ULT (default 1000)\n");
+    fprintf(stderr, "       [-u ults] number of ULTs (default 1)\n");
+    fprintf(stderr,
+            "       [-x xstreams] number of execution streams running the "
+            "ULTs (default 1)\n");
+    fprintf(stderr,
+            "       [-r] access the regions in random rather than creation "
+            "order\n");
+    fprintf(stderr,
+            "       [-o phases] comma-separated list of the calls to report, "
+            "among create, write_raw, persist, read_raw, "
+            "create_write_persist_raw and remove (default all)\n");
+    fprintf(stderr,
+            "       [-c key=value] target configuration (see "
+            "bake_target_set_conf), may be repeated\n");
+    fprintf(stderr, "       [-H] also print the latency histograms\n");
+    fprintf(stderr,
+            "       [-p protocol] protocol used to initialize margo "
+            "(default na+sm)\n");
+    fprintf(stderr,
+            "Example: ./bake-backend-bench -s 4K:1M -n 10000 -u 8 -x 4 "
+            "file:/dev/shm/foo.dat\n");
+}
+
+static int parse_size(const char* str, size_t* size_out)
+{
+    const char* suffixes[] = {"B", "K", "M", "G", "T", "P"};
+    size_t      size_mults[]
+        = {1ULL, 1ULL << 10, 1ULL << 20, 1ULL << 30, 1ULL << 40, 1ULL << 50};
+    size_t size;
+    char   suff[2] = {0};
+    int    i;
+    int    ret;
+
+    ret = sscanf(str, "%zu%1s", &size, suff);
+    if (ret == 1) {
+        *size_out = size;
+        return (0);
+    } else if (ret == 2) {
+        for (i = 0; i < 6; i++) {
+            if (strcmp(suffixes[i], suff) == 0) {
+                *size_out = (size * size_mults[i]);
+                return (0);
+            }
+        }
+    }
+    return (-1);
+}
+
+static int parse_phases(char* str, int* phases)
+{
+    char* tok;
+    char* save = NULL;
+    int   i;
+
+    *phases = 0;
+    for (tok = strtok_r(str, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        for (i = 0; i < NUM_PHASES; i++)
+            if (strcmp(tok, g_phase_names[i]) == 0) break;
+        if (i == NUM_PHASES) return (-1);
+        *phases |= 1 << i;
+    }
+    return (0);
+}
+
+static void parse_args(int argc, char* argv[], struct options* opts)
+{
+    int   opt;
+    char* colon;
+
+    memset(opts, 0, sizeof(*opts));
+    opts->protocol = "na+sm";
+    opts->min_size = opts->max_size = 4096;
+    opts->count                     = 1000;
+    opts->ults                      = 1;
+    opts->xstreams                  = 1;
+    opts->phases                    = (1 << NUM_PHASES) - 1;
+
+    while ((opt = getopt(argc, argv, "s:n:u:x:ro:c:Hp:")) != -1) {
+        switch (opt) {
+        case 's':
+            colon = strchr(optarg, ':');
+            if (colon) *colon = '\0';
+            if (parse_size(optarg, &opts->min_size) < 0
+                || parse_size(colon ? colon + 1 : optarg, &opts->max_size) < 0
+                || opts->min_size == 0 || opts->max_size < opts->min_size) {
+                fprintf(stderr, "Error: invalid size.\n");
+                usage();
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'n':
+            opts->count = atoi(optarg);
+            break;
+        case 'u':
+            opts->ults = atoi(optarg);
+            break;
+        case 'x':
+            opts->xstreams = atoi(optarg);
+            break;
+        case 'r':
+            opts->random = 1;
+            break;
+        case 'o':
+            if (parse_phases(optarg, &opts->phases) < 0) {
+                fprintf(stderr, "Error: invalid list of calls.\n");
+                usage();
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'c':
+            if (opts->num_conf == MAX_CONF || !strchr(optarg, '=')) {
+                usage();
+                exit(EXIT_FAILURE);
+            }
+            opts->conf[opts->num_conf++] = optarg;
+            break;
+        case 'H':
+            opts->histograms = 1;
+            break;
+        case 'p':
+            opts->protocol = optarg;
+            break;
+        default:
+            usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (optind != argc - 1 || opts->count == 0 || opts->ults == 0
+        || opts->xstreams == 0) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+    opts->target = argv[optind];
+}
+
+static void account(phase_stats_t* s, uint64_t start, uint64_t bytes, int ret)
+{
+    uint64_t t = bake_metrics_now() - start;
+
+    s->ops++;
+    if (ret != 0) s->errors++;
+    s->bytes += bytes;
+    s->latency_ns += t;
+    if (t > s->max_latency_ns) s->max_latency_ns = t;
+    s->latency_histogram[bake_metrics_bucket(t)]++;
+}
+
+/* _create_write_persist_raw, or the create, write and persist calls the
+ * server issues instead if the backend does not provide it */
+static int create_write_persist(bake_backend_t    backend,
+                                backend_context_t ctx,
+                                const void*       data,
+                                size_t            size,
+                                bake_region_id_t* rid)
+{
+    int ret;
+
+    if (backend->_create_write_persist_raw)
+        return backend->_create_write_persist_raw(ctx, data, size, rid);
+
+    ret = backend->_create(ctx, size, rid);
+    if (ret != 0) return ret;
+    ret = backend->_write_raw(ctx, *rid, 0, size, data);
+    if (ret == 0) ret = backend->_persist(ctx, *rid, 0, size);
+    if (ret != 0) backend->_remove(ctx, *rid);
+    return ret;
+}
+
+static void worker_ult(void* arg)
+{
+    worker_t*         w       = arg;
+    bake_backend_t    backend = w->target->backend;
+    backend_context_t ctx     = w->target->context;
+    void*             data;
+    uint64_t          bytes;
+    free_fn           free_data;
+    uint64_t          start;
+    unsigned          k, i;
+    int               ret;
+
+    for (k = 0; k < w->count; k++) {
+        i = w->order[k];
+        switch (w->phase) {
+        case PHASE_CREATE:
+            start = bake_metrics_now();
+            ret   = backend->_create(ctx, w->sizes[i], &w->rids[i]);
+            account(&w->stats, start, 0, ret);
+            w->exists[i] = ret == 0;
+            break;
+        case PHASE_WRITE:
+            if (!w->exists[i]) continue;
+            start = bake_metrics_now();
+            ret   = backend->_write_raw(ctx, w->rids[i], 0, w->sizes[i],
+                                      w->buffer);
+            account(&w->stats, start, w->sizes[i], ret);
+            break;
+        case PHASE_PERSIST:
+            if (!w->exists[i]) continue;
+            start = bake_metrics_now();
+            ret   = backend->_persist(ctx, w->rids[i], 0, w->sizes[i]);
+            account(&w->stats, start, w->sizes[i], ret);
+            break;
+        case PHASE_READ:
+            if (!w->exists[i]) continue;
+            data      = NULL;
+            bytes     = 0;
+            free_data = NULL;
+            start     = bake_metrics_now();
+            ret = backend->_read_raw(ctx, w->rids[i], 0, w->sizes[i], &data,
+                                     &bytes, &free_data);
+            if (ret == 0 && free_data) free_data(data);
+            account(&w->stats, start, ret == 0 ? bytes : 0, ret);
+            break;
+        case PHASE_CREATE_WRITE_PERSIST:
+            start = bake_metrics_now();
+            ret   = create_write_persist(backend, ctx, w->buffer, w->sizes[i],
+                                       &w->cwp_rids[i]);
+            account(&w->stats, start, w->sizes[i], ret);
+            w->cwp_exists[i] = ret == 0;
+            break;
+        case PHASE_REMOVE:
+            if (w->exists[i]) {
+                start = bake_metrics_now();
+                ret   = backend->_remove(ctx, w->rids[i]);
+                account(&w->stats, start, 0, ret);
+                w->exists[i] = 0;
+            }
+            if (w->cwp_exists[i]) {
+                start = bake_metrics_now();
+                ret   = backend->_remove(ctx, w->cwp_rids[i]);
+                account(&w->stats, start, 0, ret);
+                w->cwp_exists[i] = 0;
+            }
+            break;
+        }
+    }
+}
+
+/* upper bound of the bucket holding the given fraction of the calls */
+static double percentile_us(const uint64_t histogram[], uint64_t total, double p)
+{
+    uint64_t rank = (uint64_t)(p * total + 0.999999);
+    uint64_t seen = 0;
+    unsigned b;
+
+    if (rank == 0) rank = 1;
+    for (b = 0; b < BAKE_METRICS_BUCKETS; b++) {
+        seen += histogram[b];
+        if (seen >= rank) return bake_metrics_bucket_upper(b) / 1e3;
+    }
+    return 0.0;
+}
+
+static void report(int phase, const phase_stats_t* s, double elapsed, int histograms)
+{
+    unsigned b;
+
+    if (s->ops == 0) return;
+    if (elapsed <= 0.0) elapsed = 1e-9;
+    printf("%-40s %10.1f %10.2f %8" PRIu64
+           " %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           g_phase_names[phase], s->ops / elapsed,
+           s->bytes / elapsed / (1024.0 * 1024.0), s->errors,
+           s->latency_ns / 1e3 / s->ops,
+           percentile_us(s->latency_histogram, s->ops, 0.5),
+           percentile_us(s->latency_histogram, s->ops, 0.99),
+           percentile_us(s->latency_histogram, s->ops, 0.999),
+           s->max_latency_ns / 1e3);
+    if (histograms) {
+        printf("#   %s.latency_ns =", g_phase_names[phase]);
+        for (b = 0; b < BAKE_METRICS_BUCKETS; b++)
+            if (s->latency_histogram[b])
+                printf(" %" PRIu64 ":%" PRIu64, bake_metrics_bucket_lower(b),
+                       s->latency_histogram[b]);
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+/* runs one call on all the regions from all the ULTs and merges their
+ * counters */
+static int run_phase(margo_instance_id mid,
+                     worker_t*         workers,
+                     unsigned          ults,
+                     int               phase,
+                     phase_stats_t*    stats,
+                     double*           elapsed)
+{
+    ABT_pool    pool;
+    ABT_thread* threads;
+    uint64_t    start;
+    unsigned    i, b;
+    int         ret = BAKE_SUCCESS;
+
+    threads = calloc(ults, sizeof(*threads));
+    if (!threads) return BAKE_ERR_ALLOCATION;
+    margo_get_handler_pool(mid, &pool);
+
+    start = bake_metrics_now();
+    for (i = 0; i < ults; i++) {
+        workers[i].phase = phase;
+        memset(&workers[i].stats, 0, sizeof(workers[i].stats));
+        if (ABT_thread_create(pool, worker_ult, &workers[i],
+                              ABT_THREAD_ATTR_NULL, &threads[i])
+            != ABT_SUCCESS) {
+            ret = BAKE_ERR_ARGOBOTS;
+            break;
+        }
+    }
+    ults = i;
+    for (i = 0; i < ults; i++) {
+        ABT_thread_join(threads[i]);
+        ABT_thread_free(&threads[i]);
+    }
+    *elapsed = (bake_metrics_now() - start) / 1e9;
+    free(threads);
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < ults; i++) {
+        phase_stats_t* s = &workers[i].stats;
+
+        stats->ops += s->ops;
+        stats->errors += s->errors;
+        stats->bytes += s->bytes;
+        stats->latency_ns += s->latency_ns;
+        if (s->max_latency_ns > stats->max_latency_ns)
+            stats->max_latency_ns = s->max_latency_ns;
+        for (b = 0; b < BAKE_METRICS_BUCKETS; b++)
+            stats->latency_histogram[b] += s->latency_histogram[b];
+    }
+    return ret;
+}
+
+static int setup_worker(worker_t*             w,
+                        bake_target_t*        target,
+                        const struct options* opts,
+                        unsigned              seed)
+{
+    unsigned i, j, tmp;
+
+    memset(w, 0, sizeof(*w));
+    w->target     = target;
+    w->count      = opts->count;
+    w->sizes      = calloc(opts->count, sizeof(*w->sizes));
+    w->order      = calloc(opts->count, sizeof(*w->order));
+    w->rids       = calloc(opts->count, sizeof(*w->rids));
+    w->cwp_rids   = calloc(opts->count, sizeof(*w->cwp_rids));
+    w->exists     = calloc(opts->count, 1);
+    w->cwp_exists = calloc(opts->count, 1);
+    w->buffer     = malloc(opts->max_size);
+    if (!w->sizes || !w->order || !w->rids || !w->cwp_rids || !w->exists
+        || !w->cwp_exists || !w->buffer)
+        return BAKE_ERR_ALLOCATION;
+
+    for (i = 0; i < opts->max_size; i++) w->buffer[i] = 'a' + (i % 26);
+    for (i = 0; i < opts->count; i++) {
+        w->sizes[i] = opts->min_size
+                    + rand_r(&seed) % (opts->max_size - opts->min_size + 1);
+        w->order[i] = i;
+    }
+    if (opts->random) {
+        for (i = opts->count - 1; i > 0; i--) {
+            j           = rand_r(&seed) % (i + 1);
+            tmp         = w->order[i];
+            w->order[i] = w->order[j];
+            w->order[j] = tmp;
+        }
+    }
+    return BAKE_SUCCESS;
+}
+
+static void free_worker(worker_t* w)
+{
+    free(w->sizes);
+    free(w->order);
+    free(w->rids);
+    free(w->cwp_rids);
+    free(w->exists);
+    free(w->cwp_exists);
+    free(w->buffer);
+}
+
+int main(int argc, char** argv)
+{
+    struct options    opts;
+    margo_instance_id mid;
+    bake_provider_t   provider;
+    bake_target_id_t  tid;
+    bake_target_t*    target = NULL;
+    worker_t*         workers;
+    phase_stats_t     stats;
+    double            elapsed;
+    char*             value;
+    unsigned          i;
+    int               phase;
+    int               errors = 0;
+    int               ret;
+
+    parse_args(argc, argv, &opts);
+
+    /* margo only hosts the provider and the execution streams running the
+     * ULTs; no RPC is sent */
+    mid = margo_init(opts.protocol, MARGO_SERVER_MODE, 0, opts.xstreams);
+    if (mid == MARGO_INSTANCE_NULL) {
+        fprintf(stderr, "Error: margo_init()\n");
+        return (-1);
+    }
+
+    ret = bake_provider_register(mid, 1, BAKE_ABT_POOL_DEFAULT, &provider);
+    if (ret != 0) {
+        bake_perror("Error: bake_provider_register()", ret);
+        margo_finalize(mid);
+        return (-1);
+    }
+
+    ret = bake_provider_add_storage_target(provider, opts.target, &tid);
+    if (ret != 0) {
+        bake_perror("Error: bake_provider_add_storage_target()", ret);
+        margo_finalize(mid);
+        return (-1);
+    }
+    for (i = 0; i < opts.num_conf; i++) {
+        value  = strchr(opts.conf[i], '=');
+        *value = '\0';
+        ret    = bake_target_set_conf(provider, tid, opts.conf[i], value + 1);
+        if (ret != 0) {
+            bake_perror("Error: bake_target_set_conf()", ret);
+            margo_finalize(mid);
+            return (-1);
+        }
+    }
+    HASH_FIND(hh, provider->targets, &tid, sizeof(bake_target_id_t), target);
+    if (!target) {
+        fprintf(stderr, "Error: target not found in the provider\n");
+        margo_finalize(mid);
+        return (-1);
+    }
+
+    workers = calloc(opts.ults, sizeof(*workers));
+    if (!workers) {
+        ret = BAKE_ERR_ALLOCATION;
+        bake_perror("Error: bake-backend-bench", ret);
+        margo_finalize(mid);
+        return (-1);
+    }
+    for (i = 0; i < opts.ults; i++) {
+        ret = setup_worker(&workers[i], target, &opts, i + 1);
+        if (ret != 0) {
+            bake_perror("Error: bake-backend-bench", ret);
+            goto finish;
+        }
+    }
+
+    printf("# backend %s, %u ULTs on %u xstreams, %u regions of %zu to %zu "
+           "bytes per ULT, %s order\n",
+           target->backend->name, opts.ults, opts.xstreams, opts.count,
+           opts.min_size, opts.max_size, opts.random ? "random" : "creation");
+    if (!target->backend->_create_write_persist_raw)
+        printf("# create_write_persist_raw is not provided by the backend, "
+               "create + write_raw + persist measured instead\n");
+    printf("%-40s %10s %10s %8s %10s %10s %10s %10s %10s\n", "# call",
+           "ops/s", "MiB/s", "errors", "mean_us", "p50_us", "p99_us",
+           "p99.9_us", "max_us");
+
+    /* regions are always created and removed; the other calls only run if
+     * they are reported */
+    for (phase = 0; phase < NUM_PHASES; phase++) {
+        if (phase != PHASE_CREATE && phase != PHASE_REMOVE
+            && !(opts.phases & (1 << phase)))
+            continue;
+        ret = run_phase(mid, workers, opts.ults, phase, &stats, &elapsed);
+        if (ret != 0) {
+            bake_perror("Error: bake-backend-bench", ret);
+            goto finish;
+        }
+        if (opts.phases & (1 << phase))
+            report(phase, &stats, elapsed, opts.histograms);
+        if (stats.errors) errors = 1;
+    }
+
+finish:
+    for (i = 0; i < opts.ults; i++) free_worker(&workers[i]);
+    free(workers);
+    margo_finalize(mid);
+
+    return (ret == 0 && !errors) ? 0 : -1;
+}
@@ -1,6 +1,7 @@
 #ifndef __BAKE_BACKEND_H
 #define __BAKE_BACKEND_H
 
+#include <stdio.h>
 #include "bake-server.h"
 #include "bake.h"
 
@@ -96,6 +97,8 @@ typedef int (*bake_set_conf_fn)(backend_context_t context,
                                 const char*       key,
                                 const char*       value);
 
+typedef int (*bake_get_stats_fn)(backend_context_t context, FILE* out);
+
 typedef struct bake_backend {
     const char*                       name;
     bake_backend_initialize_fn        _initialize;
@@ -115,9 +118,13 @@ typedef struct bake_backend {
 #ifdef USE_REMI
     bake_create_fileset_fn _create_fileset;
 #endif
-    bake_set_conf_fn _set_conf;
+    bake_set_conf_fn  _set_conf;
+    bake_get_stats_fn _get_stats;
 } bake_backend;
 
 typedef bake_backend* bake_backend_t;
 
+/* returns the backend of the given name ("pmem", "file", ...), or NULL */
+bake_backend_t bake_backend_lookup(const char* type);
+
 #endif
@@ -7,6 +7,8 @@
 #include <map>
 #include <functional>
 #include <memory>
+#include <tuple>
+#include <iterator>
 #include <mpi.h>
 #include <json/json.h>
 #include <bake-client.hpp>
@@ -47,6 +49,10 @@ class AbstractBenchmark {
     bake::client&         m_client;  // bake client
     bake::provider_handle m_bake_ph; // provider handle
     bake::target          m_target;  // bake target
+    std::vector<double>   m_latencies; // latency (sec) of each recorded operation
+    size_t                m_bytes = 0; // bytes moved by the recorded operations
+    std::vector<int>      m_kinds;     // kind of each recorded operation
+    std::vector<uint64_t> m_kind_bytes; // bytes moved by the operations of each kind
 
     template<typename T>
     friend class BenchmarkRegistration;
@@ -63,6 +69,30 @@ class AbstractBenchmark {
     bake::target& target() { return m_target; }
     MPI_Comm comm() const { return m_comm; }
 
+    /**
+     * @brief Records an operation that took the given time (in seconds)
+     * and wrote, read or persisted the given number of bytes. Benchmarks
+     * issuing several kinds of operations (see operation_kinds()) also
+     * pass the index of its kind.
+     */
+    void record(double latency, size_t bytes, int kind = 0) {
+        m_latencies.push_back(latency);
+        m_bytes += bytes;
+        m_kinds.push_back(kind);
+        if(m_kind_bytes.size() <= (size_t)kind) m_kind_bytes.resize(kind+1, 0);
+        m_kind_bytes[kind] += bytes;
+    }
+
+    /**
+     * @brief Runs an operation and records its latency.
+     */
+    template<typename F>
+    void timed(size_t bytes, F&& op) {
+        double t_start = ABT_get_wtime();
+        op();
+        record(ABT_get_wtime() - t_start, bytes);
+    }
+
     public:
 
     AbstractBenchmark(MPI_Comm c, margo_instance_id mid, bake::client& client, const bake::provider_handle& ph, const bake::target& tgt)
@@ -77,6 +107,50 @@ class AbstractBenchmark {
     virtual void execute()  = 0;
     virtual void teardown() = 0;
 
+    /**
+     * @brief Number of operations issued by each execute() call, used to
+     * report a throughput (0 if not applicable).
+     */
+    virtual size_t operations() const { return 0; }
+
+    /**
+     * @brief Names of the kinds of operations the benchmark issues, for
+     * which latencies are also reported separately (empty if it issues a
+     * single kind).
+     */
+    virtual std::vector<std::string> operation_kinds() const { return {}; }
+
+    /**
+     * @brief Latencies of the operations recorded since the last call
+     * to clear_samples().
+     */
+    const std::vector<double>& latencies() const { return m_latencies; }
+
+    /**
+     * @brief Bytes moved by the operations recorded since the last call
+     * to clear_samples().
+     */
+    size_t bytes() const { return m_bytes; }
+
+    /**
+     * @brief Kind of each operation returned by latencies().
+     */
+    const std::vector<int>& kinds() const { return m_kinds; }
+
+    /**
+     * @brief Bytes moved by the operations of the given kind.
+     */
+    uint64_t kind_bytes(int kind) const {
+        return (size_t)kind < m_kind_bytes.size() ? m_kind_bytes[kind] : 0;
+    }
+
+    void clear_samples() {
+        m_latencies.clear();
+        m_bytes = 0;
+        m_kinds.clear();
+        m_kind_bytes.clear();
+    }
+
     /**
      * @brief Factory function used to create benchmark instances.
      */
@@ -174,7 +248,9 @@ class CreateBenchmark : public AbstractAccessBenchmark {
         auto& _tgt = target();
         auto& _ph = ph();
         for(unsigned i=0; i < m_num_entries; i++) {
-            m_region_ids[i] = _clt.create(_ph, _tgt, m_region_sizes[i]);
+            timed(0, [&]() {
+                m_region_ids[i] = _clt.create(_ph, _tgt, m_region_sizes[i]);
+            });
         }
     }
 
@@ -193,6 +269,101 @@ class CreateBenchmark : public AbstractAccessBenchmark {
 };
 REGISTER_BENCHMARK("create", CreateBenchmark);
 
+/**
+ * CreateThroughputBenchmark executes the same operations as CreateBenchmark
+ * (or as an eager create-write-persist if write-data is set), but issues
+ * them from several concurrent ULTs so that a single client can keep
+ * many server handler execution streams busy.
+ */
+class CreateThroughputBenchmark : public CreateBenchmark {
+
+    protected:
+
+    unsigned          m_concurrency;
+    bool              m_write_data;
+    std::vector<char> m_data;
+
+    struct ult_args {
+        CreateThroughputBenchmark* self;
+        unsigned                   rank;
+        std::vector<std::pair<double, size_t>> samples; // latency and bytes of each operation
+    };
+
+    static void create_ult(void* a) {
+        auto args = static_cast<ult_args*>(a);
+        auto self = args->self;
+        auto& _clt = self->client();
+        auto& _tgt = self->target();
+        auto& _ph = self->ph();
+        try {
+            for(unsigned i=args->rank; i < self->m_num_entries; i += self->m_concurrency) {
+                double t_start = ABT_get_wtime();
+                size_t bytes = 0;
+                if(self->m_write_data) {
+                    self->m_region_ids[i] = _clt.create_write_persist(_ph, _tgt, self->m_data.data(), self->m_region_sizes[i]);
+                    bytes = self->m_region_sizes[i];
+                } else {
+                    self->m_region_ids[i] = _clt.create(_ph, _tgt, self->m_region_sizes[i]);
+                }
+                args->samples.emplace_back(ABT_get_wtime() - t_start, bytes);
+            }
+        } catch(const bake::exception& ex) {
+            std::cerr << "create-throughput: " << ex.what() << std::endl;
+        }
+    }
+
+    public:
+
+    template<typename ... T>
+    CreateThroughputBenchmark(Json::Value& config, T&& ... args)
+    : CreateBenchmark(config, std::forward<T>(args)...) {
+        m_concurrency = getConfigInt(config, "concurrency", 16);
+        if(m_concurrency == 0) throw std::range_error("invalid concurrency");
+        m_write_data = getConfigBool(config, "write-data", false);
+    }
+
+    virtual void setup() override {
+        CreateBenchmark::setup();
+        if(m_write_data) {
+            m_data.resize(*std::max_element(m_region_sizes.begin(), m_region_sizes.end()));
+            for(unsigned i=0; i < m_data.size(); i++) {
+                m_data[i] = 'a' + (i%26);
+            }
+        }
+    }
+
+    virtual void execute() override {
+        ABT_pool pool;
+        margo_get_handler_pool(mid(), &pool);
+        std::vector<ult_args>   args(m_concurrency);
+        std::vector<ABT_thread> ults(m_concurrency);
+        for(unsigned i=0; i < m_concurrency; i++) {
+            args[i].self = this;
+            args[i].rank = i;
+            ABT_thread_create(pool, create_ult, &args[i], ABT_THREAD_ATTR_NULL, &ults[i]);
+        }
+        for(unsigned i=0; i < m_concurrency; i++) {
+            ABT_thread_join(ults[i]);
+            ABT_thread_free(&ults[i]);
+        }
+        // merge the samples of the ULTs once they are all done
+        for(auto& a : args) {
+            for(auto& sample : a.samples)
+                record(sample.first, sample.second);
+        }
+    }
+
+    virtual void teardown() override {
+        CreateBenchmark::teardown();
+        m_data.resize(0); m_data.shrink_to_fit();
+    }
+
+    virtual size_t operations() const override {
+        return m_num_entries;
+    }
+};
+REGISTER_BENCHMARK("create-throughput", CreateThroughputBenchmark);
+
 /**
  * CreateWritePersistBenchmark executes a series of bake_create_write_persist
  * operations and measures their duration.
@@ -246,11 +417,13 @@ class CreateWritePersistBenchmark : public AbstractAccessBenchmark {
         size_t offset = 0;
         for(unsigned i=0; i < m_num_entries; i++) {
             size_t size = m_region_sizes[i];
-            if(m_preregister_bulk) {
-                m_region_ids[i] = _clt.create_write_persist(_ph, _tgt, m_bulk, offset, "",  m_region_sizes[i]);
-            } else {
-                m_region_ids[i] = _clt.create_write_persist(_ph, _tgt, m_data.data()+offset, m_region_sizes[i]);
-            }
+            timed(size, [&]() {
+                if(m_preregister_bulk) {
+                    m_region_ids[i] = _clt.create_write_persist(_ph, _tgt, m_bulk, offset, "",  m_region_sizes[i]);
+                } else {
+                    m_region_ids[i] = _clt.create_write_persist(_ph, _tgt, m_data.data()+offset, m_region_sizes[i]);
+                }
+            });
             if(!m_reuse_buffer) offset += size;
         }
     }
@@ -338,12 +511,14 @@ class WriteBenchmark : public AbstractAccessBenchmark {
         size_t region_offset = 0;
         for(unsigned i=0; i < m_num_entries; i++) {
             size_t size = m_access_sizes[i];
-            if(m_preregister_bulk) {
-                _clt.write(_ph, _tgt, m_region_id, region_offset, m_bulk, data_offset, "",  size);
-            } else {
-                char* data = m_data.data() + data_offset;
-                _clt.write(_ph, _tgt, m_region_id, region_offset, (void*)data, size);
-            }
+            timed(size, [&]() {
+                if(m_preregister_bulk) {
+                    _clt.write(_ph, _tgt, m_region_id, region_offset, m_bulk, data_offset, "",  size);
+                } else {
+                    char* data = m_data.data() + data_offset;
+                    _clt.write(_ph, _tgt, m_region_id, region_offset, (void*)data, size);
+                }
+            });
             if(!m_reuse_buffer) data_offset += size;
             if(!m_reuse_region) region_offset += size;
         }
@@ -430,12 +605,14 @@ class ReadBenchmark : public AbstractAccessBenchmark {
         size_t region_offset = 0;
         for(unsigned i=0; i < m_num_entries; i++) {
             size_t size = m_access_sizes[i];
-            if(m_preregister_bulk) {
-                _clt.read(_ph, _tgt, m_region_id, region_offset, m_bulk, data_offset, "",  size);
-            } else {
-                char* data = m_read_data.data() + data_offset;
-                _clt.read(_ph, _tgt, m_region_id, region_offset, (void*)data, size);
-            }
+            timed(size, [&]() {
+                if(m_preregister_bulk) {
+                    _clt.read(_ph, _tgt, m_region_id, region_offset, m_bulk, data_offset, "",  size);
+                } else {
+                    char* data = m_read_data.data() + data_offset;
+                    _clt.read(_ph, _tgt, m_region_id, region_offset, (void*)data, size);
+                }
+            });
             if(!m_reuse_buffer) data_offset += size;
             if(!m_reuse_region) region_offset += size;
         }
@@ -501,7 +678,9 @@ class PersistBenchmark : public AbstractAccessBenchmark {
         auto& _ph = ph();
         for(unsigned i=0; i < m_num_entries; i++) {
             size_t size = m_access_sizes[i];
-            _clt.persist(_ph, _tgt, m_region_ids[i], 0, size);
+            timed(size, [&]() {
+                _clt.persist(_ph, _tgt, m_region_ids[i], 0, size);
+            });
         }
     }
 
@@ -520,6 +699,445 @@ class PersistBenchmark : public AbstractAccessBenchmark {
 };
 REGISTER_BENCHMARK("persist", PersistBenchmark);
 
+/**
+ * OpenLoopBenchmark issues operations at a fixed offered rate instead of
+ * one after the other. The send time of each operation is drawn in setup()
+ * (exponential inter-arrival times for Poisson arrivals, or evenly spaced
+ * for constant arrivals), and a pool of ULTs issues them when their time
+ * comes. The latency of an operation is measured from its intended send
+ * time, so that operations delayed because all the ULTs were busy account
+ * for their queueing (avoiding coordinated omission).
+ */
+class OpenLoopBenchmark : public AbstractAccessBenchmark {
+
+    protected:
+
+    enum class Operation { CREATE, CREATE_WRITE_PERSIST, WRITE, READ };
+
+    Operation                 m_operation;
+    double                    m_rate;
+    bool                      m_poisson;
+    unsigned                  m_concurrency;
+    size_t                    m_max_size = 0;
+    std::vector<size_t>       m_region_sizes;
+    std::vector<double>       m_send_times;  // intended send times, relative to m_start
+    std::vector<bake::region> m_region_ids;  // regions created by the operations
+    bake::region              m_region_id;   // region accessed by write and read
+    std::vector<char>         m_data;        // one buffer of m_max_size bytes per ULT
+    double                    m_start = 0.0;
+    uint64_t                  m_next  = 0;   // next operation to issue
+
+    struct ult_args {
+        OpenLoopBenchmark* self;
+        unsigned           rank;
+        std::vector<std::pair<double, size_t>> samples; // latency and bytes of each operation
+    };
+
+    static void issue_ult(void* a) {
+        auto args = static_cast<ult_args*>(a);
+        auto self = args->self;
+        auto& _clt = self->client();
+        auto& _tgt = self->target();
+        auto& _ph = self->ph();
+        char* data = self->m_data.data() + args->rank * self->m_max_size;
+        try {
+            while(true) {
+                uint64_t i = __atomic_fetch_add(&self->m_next, 1, __ATOMIC_RELAXED);
+                if(i >= self->m_num_entries) break;
+                double intended = self->m_start + self->m_send_times[i];
+                double now = ABT_get_wtime();
+                if(intended > now)
+                    margo_thread_sleep(self->mid(), (intended - now) * 1000.0);
+                size_t size = self->m_region_sizes[i];
+                switch(self->m_operation) {
+                case Operation::CREATE:
+                    self->m_region_ids[i] = _clt.create(_ph, _tgt, size);
+                    size = 0;
+                    break;
+                case Operation::CREATE_WRITE_PERSIST:
+                    self->m_region_ids[i] = _clt.create_write_persist(_ph, _tgt, data, size);
+                    break;
+                case Operation::WRITE:
+                    _clt.write(_ph, _tgt, self->m_region_id, 0, data, size);
+                    break;
+                case Operation::READ:
+                    _clt.read(_ph, _tgt, self->m_region_id, 0, data, size);
+                    break;
+                }
+                args->samples.emplace_back(ABT_get_wtime() - intended, size);
+            }
+        } catch(const bake::exception& ex) {
+            std::cerr << "open-loop: " << ex.what() << std::endl;
+        }
+    }
+
+    public:
+
+    template<typename ... T>
+    OpenLoopBenchmark(Json::Value& config, T&& ... args)
+    : AbstractAccessBenchmark(config, std::forward<T>(args)...) {
+        if(!config["operation"]) config["operation"] = "create";
+        std::string operation = config["operation"].asString();
+        if(operation == "create")                    m_operation = Operation::CREATE;
+        else if(operation == "create-write-persist") m_operation = Operation::CREATE_WRITE_PERSIST;
+        else if(operation == "write")                m_operation = Operation::WRITE;
+        else if(operation == "read")                 m_operation = Operation::READ;
+        else throw std::invalid_argument("invalid open-loop operation " + operation);
+        if(!config["rate"]) config["rate"] = 1000.0;
+        m_rate = config["rate"].asDouble();
+        if(m_rate <= 0.0) throw std::range_error("invalid rate");
+        if(!config["arrival"]) config["arrival"] = "poisson";
+        std::string arrival = config["arrival"].asString();
+        if(arrival != "poisson" && arrival != "constant")
+            throw std::invalid_argument("invalid arrival " + arrival);
+        m_poisson = arrival == "poisson";
+        m_concurrency = getConfigInt(config, "concurrency", 64);
+        if(m_concurrency == 0) throw std::range_error("invalid concurrency");
+    }
+
+    virtual void setup() override {
+        m_region_sizes.resize(m_num_entries);
+        m_send_times.resize(m_num_entries);
+        m_region_ids.resize(m_num_entries);
+        m_max_size = 0;
+        double t = 0.0;
+        for(unsigned i=0; i < m_num_entries; i++) {
+            size_t size = m_region_size_range.first + (rand() % (m_region_size_range.second - m_region_size_range.first));
+            m_region_sizes[i] = size;
+            m_max_size = std::max(size, m_max_size);
+            m_send_times[i] = t;
+            if(m_poisson) {
+                double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+                t += -std::log(u) / m_rate;
+            } else {
+                t += 1.0 / m_rate;
+            }
+        }
+        m_data.resize(m_max_size * m_concurrency);
+        for(unsigned i=0; i < m_data.size(); i++) {
+            m_data[i] = 'a' + (i%26);
+        }
+        if(m_operation == Operation::WRITE || m_operation == Operation::READ)
+            m_region_id = client().create_write_persist(ph(), target(), m_data.data(), m_max_size);
+        m_next = 0;
+    }
+
+    virtual void execute() override {
+        ABT_pool pool;
+        margo_get_handler_pool(mid(), &pool);
+        std::vector<ult_args>   args(m_concurrency);
+        std::vector<ABT_thread> ults(m_concurrency);
+        m_start = ABT_get_wtime();
+        for(unsigned i=0; i < m_concurrency; i++) {
+            args[i].self = this;
+            args[i].rank = i;
+            ABT_thread_create(pool, issue_ult, &args[i], ABT_THREAD_ATTR_NULL, &ults[i]);
+        }
+        for(unsigned i=0; i < m_concurrency; i++) {
+            ABT_thread_join(ults[i]);
+            ABT_thread_free(&ults[i]);
+        }
+        for(auto& a : args) {
+            for(auto& sample : a.samples)
+                record(sample.first, sample.second);
+        }
+    }
+
+    virtual void teardown() override {
+        if(m_erase_on_teardown) {
+            auto& _clt = client();
+            auto& _tgt = target();
+            auto& _ph = ph();
+            if(m_operation == Operation::WRITE || m_operation == Operation::READ) {
+                _clt.remove(_ph, _tgt, m_region_id);
+            } else {
+                for(unsigned i=0; i < m_num_entries; i++) {
+                    _clt.remove(_ph, _tgt, m_region_ids[i]);
+                }
+            }
+        }
+        m_region_sizes.resize(0); m_region_sizes.shrink_to_fit();
+        m_send_times.resize(0);   m_send_times.shrink_to_fit();
+        m_region_ids.resize(0);   m_region_ids.shrink_to_fit();
+        m_data.resize(0);         m_data.shrink_to_fit();
+    }
+
+    virtual size_t operations() const override {
+        return m_num_entries;
+    }
+};
+REGISTER_BENCHMARK("open-loop", OpenLoopBenchmark);
+
+/**
+ * MixedBenchmark preloads a working set of regions and then issues a mix of
+ * reads, writes, persists, create-write-persists and removes on them from
+ * several concurrent ULTs, reporting the latency of each kind of operation.
+ * Regions are picked uniformly or following a Zipfian distribution. A
+ * create-write-persist replaces the region it picked (the replaced region
+ * is removed at teardown); the other operations move on to the next region
+ * if the one they picked was removed or is in use by another ULT.
+ */
+class MixedBenchmark : public AbstractAccessBenchmark {
+
+    protected:
+
+    enum Operation { READ, WRITE, PERSIST, CREATE_WRITE_PERSIST, REMOVE, NUM_OPERATIONS };
+
+    struct slot {
+        bake::region region;
+        size_t       size   = 0;
+        bool         exists = false;
+        int          busy   = 0;
+    };
+
+    unsigned                  m_working_set;
+    unsigned                  m_concurrency;
+    bool                      m_zipfian;
+    double                    m_zipf_theta;
+    double                    m_zipf_zetan, m_zipf_alpha, m_zipf_eta; // Zipfian generator constants
+    bool                      m_log_uniform_sizes;
+    std::vector<double>       m_mix;       // cumulative weights of the operations
+    std::vector<slot>         m_slots;
+    std::vector<bake::region> m_replaced;  // regions replaced by create-write-persist
+    std::vector<char>         m_data;      // one buffer of the largest region size per ULT
+    size_t                    m_max_size = 0;
+    uint64_t                  m_next     = 0; // next operation to issue
+
+    struct ult_args {
+        MixedBenchmark* self;
+        unsigned        rank;
+        std::vector<std::tuple<double, size_t, int>> samples; // latency, bytes and kind of each operation
+    };
+
+    static const char* operation_name(int op) {
+        static const char* names[] = { "read", "write", "persist", "create-write-persist", "remove" };
+        return names[op];
+    }
+
+    size_t draw_size() {
+        size_t lo = m_region_size_range.first;
+        size_t hi = m_region_size_range.second;
+        if(m_log_uniform_sizes && hi - lo > 1) {
+            double l = std::log((double)std::max<size_t>(lo, 1));
+            double h = std::log((double)hi);
+            size_t size = (size_t)std::exp(l + (h - l) * (rand() / (RAND_MAX + 1.0)));
+            return std::min(std::max(size, lo), hi - 1);
+        }
+        return lo + (rand() % (hi - lo));
+    }
+
+    /**
+     * Draws a slot index, following the Zipfian generator of YCSB
+     * (Gray et al., "Quickly generating billion-record synthetic databases")
+     * if zipfian popularity is set.
+     */
+    unsigned draw_slot() {
+        if(!m_zipfian) return rand() % m_working_set;
+        double u  = rand() / (RAND_MAX + 1.0);
+        double uz = u * m_zipf_zetan;
+        if(uz < 1.0) return 0;
+        if(uz < 1.0 + std::pow(0.5, m_zipf_theta)) return 1 % m_working_set;
+        unsigned i = (unsigned)(m_working_set * std::pow(m_zipf_eta * u - m_zipf_eta + 1.0, m_zipf_alpha));
+        return std::min(i, m_working_set - 1);
+    }
+
+    /**
+     * Finds, from the drawn slot on, a slot that is not in use and holds a
+     * region (or any slot not in use, for create-write-persist), and marks
+     * it in use. Returns -1 if there is none.
+     */
+    int acquire_slot(int op) {
+        unsigned first = draw_slot();
+        for(unsigned k = 0; k < m_working_set; k++) {
+            auto& s = m_slots[(first + k) % m_working_set];
+            if(!s.exists && op != CREATE_WRITE_PERSIST) continue;
+            if(__atomic_exchange_n(&s.busy, 1, __ATOMIC_ACQUIRE)) continue;
+            if(!s.exists && op != CREATE_WRITE_PERSIST) {
+                __atomic_store_n(&s.busy, 0, __ATOMIC_RELEASE);
+                continue;
+            }
+            return (first + k) % m_working_set;
+        }
+        return -1;
+    }
+
+    static void mixed_ult(void* a) {
+        auto args = static_cast<ult_args*>(a);
+        auto self = args->self;
+        auto& _clt = self->client();
+        auto& _tgt = self->target();
+        auto& _ph = self->ph();
+        char* data = self->m_data.data() + args->rank * self->m_max_size;
+        while(__atomic_fetch_add(&self->m_next, 1, __ATOMIC_RELAXED) < self->m_num_entries) {
+            double x = rand() / (RAND_MAX + 1.0) * self->m_mix.back();
+            int op = std::upper_bound(self->m_mix.begin(), self->m_mix.end(), x) - self->m_mix.begin();
+            // with no region left, reads, writes, persists and removes
+            // become create-write-persists
+            int i = self->acquire_slot(op);
+            if(i < 0) {
+                op = CREATE_WRITE_PERSIST;
+                i  = self->acquire_slot(op);
+                if(i < 0) continue;
+            }
+            auto& s = self->m_slots[i];
+            size_t bytes = s.size;
+            double t_start = ABT_get_wtime();
+            try {
+                switch(op) {
+                case READ:
+                    _clt.read(_ph, _tgt, s.region, 0, data, s.size);
+                    break;
+                case WRITE:
+                    _clt.write(_ph, _tgt, s.region, 0, data, s.size);
+                    break;
+                case PERSIST:
+                    _clt.persist(_ph, _tgt, s.region, 0, s.size);
+                    break;
+                case CREATE_WRITE_PERSIST:
+                    bytes = self->draw_size();
+                    if(s.exists) self->m_replaced.push_back(s.region);
+                    s.exists = false;
+                    s.region = _clt.create_write_persist(_ph, _tgt, data, bytes);
+                    s.size   = bytes;
+                    s.exists = true;
+                    break;
+                case REMOVE:
+                    _clt.remove(_ph, _tgt, s.region);
+                    s.exists = false;
+                    bytes    = 0;
+                    break;
+                }
+                args->samples.emplace_back(ABT_get_wtime() - t_start, bytes, op);
+            } catch(const bake::exception& ex) {
+                std::cerr << "mixed: " << operation_name(op) << ": " << ex.what() << std::endl;
+            }
+            __atomic_store_n(&s.busy, 0, __ATOMIC_RELEASE);
+        }
+    }
+
+    public:
+
+    template<typename ... T>
+    MixedBenchmark(Json::Value& config, T&& ... args)
+    : AbstractAccessBenchmark(config, std::forward<T>(args)...) {
+        m_working_set = getConfigInt(config, "working-set", 1000);
+        if(m_working_set == 0) throw std::range_error("invalid working-set");
+        m_concurrency = getConfigInt(config, "concurrency", 1);
+        if(m_concurrency == 0) throw std::range_error("invalid concurrency");
+        // operation mix, as relative weights
+        if(!config["mix"]) {
+            config["mix"]["read"] = 50;
+            config["mix"]["create-write-persist"] = 30;
+            config["mix"]["write"] = 10;
+            config["mix"]["remove"] = 10;
+        }
+        std::vector<double> weights(NUM_OPERATIONS, 0.0);
+        for(auto it = config["mix"].begin(); it != config["mix"].end(); it++) {
+            std::string name = it.key().asString();
+            int op = 0;
+            while(op < NUM_OPERATIONS && name != operation_name(op)) op++;
+            if(op == NUM_OPERATIONS) throw std::invalid_argument("invalid operation " + name + " in mix");
+            weights[op] = it->asDouble();
+            if(weights[op] < 0.0) throw std::range_error("invalid weight for " + name);
+        }
+        std::partial_sum(weights.begin(), weights.end(), std::back_inserter(m_mix));
+        if(m_mix.back() <= 0.0) throw std::range_error("empty operation mix");
+        // region popularity
+        if(!config["popularity"]) config["popularity"] = "uniform";
+        std::string popularity = config["popularity"].asString();
+        if(popularity != "uniform" && popularity != "zipfian")
+            throw std::invalid_argument("invalid popularity " + popularity);
+        m_zipfian = popularity == "zipfian";
+        if(!config["zipf-theta"]) config["zipf-theta"] = 0.99;
+        m_zipf_theta = config["zipf-theta"].asDouble();
+        if(m_zipfian) {
+            if(m_zipf_theta <= 0.0 || m_zipf_theta == 1.0)
+                throw std::range_error("invalid zipf-theta");
+            double zeta2 = 1.0 + std::pow(0.5, m_zipf_theta);
+            m_zipf_zetan = 0.0;
+            for(unsigned i = 1; i <= m_working_set; i++)
+                m_zipf_zetan += 1.0 / std::pow((double)i, m_zipf_theta);
+            m_zipf_alpha = 1.0 / (1.0 - m_zipf_theta);
+            m_zipf_eta   = (1.0 - std::pow(2.0 / m_working_set, 1.0 - m_zipf_theta))
+                         / (1.0 - zeta2 / m_zipf_zetan);
+        }
+        // region sizes, drawn from the region-sizes range
+        if(!config["size-distribution"]) config["size-distribution"] = "uniform";
+        std::string size_distribution = config["size-distribution"].asString();
+        if(size_distribution != "uniform" && size_distribution != "log-uniform")
+            throw std::invalid_argument("invalid size-distribution " + size_distribution);
+        m_log_uniform_sizes = size_distribution == "log-uniform";
+    }
+
+    virtual void setup() override {
+        auto& _clt = client();
+        auto& _tgt = target();
+        auto& _ph = ph();
+        m_max_size = m_region_size_range.second;
+        m_data.resize(m_max_size * m_concurrency);
+        for(unsigned i=0; i < m_data.size(); i++) {
+            m_data[i] = 'a' + (i%26);
+        }
+        // preload the working set
+        m_slots.resize(m_working_set);
+        for(auto& s : m_slots) {
+            s.size   = draw_size();
+            s.region = _clt.create_write_persist(_ph, _tgt, m_data.data(), s.size);
+            s.exists = true;
+        }
+        m_next = 0;
+    }
+
+    virtual void execute() override {
+        ABT_pool pool;
+        margo_get_handler_pool(mid(), &pool);
+        std::vector<ult_args>   args(m_concurrency);
+        std::vector<ABT_thread> ults(m_concurrency);
+        for(unsigned i=0; i < m_concurrency; i++) {
+            args[i].self = this;
+            args[i].rank = i;
+            ABT_thread_create(pool, mixed_ult, &args[i], ABT_THREAD_ATTR_NULL, &ults[i]);
+        }
+        for(unsigned i=0; i < m_concurrency; i++) {
+            ABT_thread_join(ults[i]);
+            ABT_thread_free(&ults[i]);
+        }
+        for(auto& a : args) {
+            for(auto& sample : a.samples)
+                record(std::get<0>(sample), std::get<1>(sample), std::get<2>(sample));
+        }
+    }
+
+    virtual void teardown() override {
+        if(m_erase_on_teardown) {
+            auto& _clt = client();
+            auto& _tgt = target();
+            auto& _ph = ph();
+            for(auto& s : m_slots) {
+                if(s.exists) _clt.remove(_ph, _tgt, s.region);
+            }
+            for(auto& r : m_replaced) {
+                _clt.remove(_ph, _tgt, r);
+            }
+        }
+        m_slots.resize(0);    m_slots.shrink_to_fit();
+        m_replaced.resize(0); m_replaced.shrink_to_fit();
+        m_data.resize(0);     m_data.shrink_to_fit();
+    }
+
+    virtual size_t operations() const override {
+        return m_num_entries;
+    }
+
+    virtual std::vector<std::string> operation_kinds() const override {
+        std::vector<std::string> kinds;
+        for(int op = 0; op < NUM_OPERATIONS; op++)
+            kinds.push_back(operation_name(op));
+        return kinds;
+    }
+};
+REGISTER_BENCHMARK("mixed", MixedBenchmark);
+
 static void run_server(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config);
 static void run_client(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config);
 
@@ -604,19 +1222,44 @@ static void run_server(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config)
     MPI_Bcast(&buf_size, sizeof(hg_size_t), MPI_BYTE, 0, global_comm);
     MPI_Bcast(server_addr_str.data(), buf_size, MPI_BYTE, 0, global_comm);
 
-    // initialize sdskv provider
-    auto provider = bake::provider::create(mid);
-    // initialize database
-    auto& target_config = server_config["target"];
-    std::string tgt_path = target_config["path"].asString();
-    auto& target2_config = server_config["target2"];
-    std::string tgt2_path = target2_config["path"].asString();
-    provider->add_storage_target(tgt_path);
-    provider->add_storage_target(tgt2_path);
-    for(auto it = provider_config.begin(); it != provider_config.end(); it++) {
-        std::string key = it.key().asString();
-        std::string value = provider_config[key].asString();
-        provider->set_config(key.c_str(), value.c_str());
+    // initialize the bake providers (ids 0 to num-providers-1)
+    int num_providers = getConfigInt(server_config, "num-providers", 1);
+    if(num_providers < 1) num_providers = 1;
+    std::vector<bake::provider*> providers;
+    for(int i = 0; i < num_providers; i++)
+        providers.push_back(bake::provider::create(mid, i));
+    // initialize the targets, either from the "targets" array or
+    // from "target" and "target2", attaching them round-robin to the providers
+    std::vector<std::string> tgt_paths;
+    if(server_config["targets"].isArray()) {
+        for(auto& t : server_config["targets"])
+            tgt_paths.push_back(t["path"].asString());
+    } else {
+        tgt_paths.push_back(server_config["target"]["path"].asString());
+        std::string tgt2_path = server_config["target2"]["path"].asString();
+        if(!tgt2_path.empty())
+            tgt_paths.push_back(tgt2_path);
+    }
+    std::vector<std::pair<bake::provider*, bake::target>> targets;
+    for(unsigned i = 0; i < tgt_paths.size(); i++) {
+        auto provider = providers[i % num_providers];
+        targets.emplace_back(provider, provider->add_storage_target(tgt_paths[i]));
+    }
+    for(auto provider : providers) {
+        for(auto it = provider_config.begin(); it != provider_config.end(); it++) {
+            std::string key = it.key().asString();
+            std::string value = provider_config[key].asString();
+            provider->set_config(key.c_str(), value.c_str());
+        }
+    }
+    // apply backend-specific settings to the targets
+    auto& tgt_settings = server_config["target-config"];
+    for(auto& t : targets) {
+        for(auto it = tgt_settings.begin(); it != tgt_settings.end(); it++) {
+            std::string key = it.key().asString();
+            std::string value = tgt_settings[key].asString();
+            t.first->set_target_config(t.second, key, value);
+        }
     }
 
     /* initialize SYMBIOMON */
@@ -627,10 +1270,12 @@ static void run_server(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config)
     int ret = symbiomon_provider_register(mid, 42, &args, &metric_provider);
     if(ret != 0)
         fprintf(stderr, "Error: symbiomon_provider_register() failed. Continuing on.\n");
-           
-    ret = provider->set_symbiomon_provider(metric_provider);
-    if(ret != 0)
-        fprintf(stderr, "Error: sdskv_provider_set_symbiomon() failed. Contuinuing on.\n");
+
+    for(auto provider : providers) {
+        ret = provider->set_symbiomon_provider(metric_provider);
+        if(ret != 0)
+            fprintf(stderr, "Error: sdskv_provider_set_symbiomon() failed. Contuinuing on.\n");
+    }
 
     fprintf(stderr, "Benchmark: Successfully set the SYMBIOMON provider\n");
     // notify clients that the database is ready
@@ -641,6 +1286,67 @@ static void run_server(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config)
     margo_wait_for_finalize(mid);
 }
 
+/**
+ * @brief Returns the value below which the given fraction of the sorted
+ * samples fall (nearest rank).
+ */
+static double percentile(const std::vector<double>& sorted, double p) {
+    if(sorted.empty()) return 0.0;
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    if(rank == 0) rank = 1;
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+/**
+ * @brief Operations issued by a group of clients (all the clients, the
+ * clients of a target, or a single client) during a benchmark.
+ */
+struct OperationStats {
+
+    unsigned            clients = 0;
+    uint64_t            bytes   = 0;
+    std::vector<double> latencies;
+
+    /**
+     * @brief Summarizes the operations as a JSON object, computing the
+     * rates over the given time (in seconds).
+     */
+    Json::Value summarize(double time) {
+        Json::Value v;
+        size_t n = latencies.size();
+        std::sort(latencies.begin(), latencies.end());
+        v["clients"]       = clients;
+        v["operations"]    = (Json::UInt64)n;
+        v["bytes"]         = (Json::UInt64)bytes;
+        v["time"]          = time;
+        v["ops_per_sec"]   = time > 0 ? n / time : 0.0;
+        v["bytes_per_sec"] = time > 0 ? bytes / time : 0.0;
+        v["latency"]["mean"]  = n ? std::accumulate(latencies.begin(), latencies.end(), 0.0) / n : 0.0;
+        v["latency"]["p50"]   = percentile(latencies, 0.5);
+        v["latency"]["p99"]   = percentile(latencies, 0.99);
+        v["latency"]["p99.9"] = percentile(latencies, 0.999);
+        v["latency"]["max"]   = n ? latencies[n-1] : 0.0;
+        return v;
+    }
+};
+
+static void print_operation_stats(const std::string& label, const Json::Value& v) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-24s %10llu %12.1f %12.2f %10.1f %10.1f %10.1f %10.1f",
+             label.c_str(), (unsigned long long)v["operations"].asUInt64(),
+             v["ops_per_sec"].asDouble(), v["bytes_per_sec"].asDouble() / (1024.0 * 1024.0),
+             v["latency"]["p50"].asDouble() * 1e6, v["latency"]["p99"].asDouble() * 1e6,
+             v["latency"]["p99.9"].asDouble() * 1e6, v["latency"]["max"].asDouble() * 1e6);
+    std::cout << line << std::endl;
+}
+
+static void print_operation_header(const std::string& label) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-24s %10s %12s %12s %10s %10s %10s %10s",
+             label.c_str(), "ops", "ops/s", "MiB/s", "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+    std::cout << line << std::endl;
+}
+
 static void run_client(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config) {
     // get info from communicator
     int rank, num_clients;
@@ -668,31 +1374,79 @@ static void run_client(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config)
     {
         // open remote database
         bake::client client(mid);
-        bake::provider_handle ph(client, server_addr);
-        std::vector<bake::target> targets = client.probe(ph);
-        //bake::target target = targets[rank%2];
-        bake::target target = targets[0];
+        // probe the targets of every provider; all the clients list them
+        // in the same order
+        int num_providers = getConfigInt(config["server"], "num-providers", 1);
+        std::vector<bake::provider_handle> phs;
+        std::vector<std::pair<unsigned, bake::target>> placements; // provider handle index, target
+        std::vector<std::string> placement_names;
+        phs.reserve(num_providers);
+        for(int p = 0; p < num_providers; p++) {
+            phs.emplace_back(client, server_addr, p);
+            std::vector<bake::target> targets = client.probe(phs[p]);
+            for(unsigned t = 0; t < targets.size(); t++) {
+                placements.emplace_back(p, targets[t]);
+                placement_names.push_back("provider " + std::to_string(p) + " target " + std::to_string(t));
+            }
+        }
+        if(placements.empty()) {
+            std::cerr << "No target found on the server" << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+        // "first" puts all the clients on the first target of the first
+        // provider, "spread" assigns them round-robin to all the targets
+        std::string placement_policy = config["target-placement"].asString();
+        unsigned placement = 0;
+        if(placement_policy == "spread") {
+            placement = rank % placements.size();
+        } else if(!placement_policy.empty() && placement_policy != "first") {
+            std::cerr << "Invalid target-placement " << placement_policy << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+        auto& ph = phs[placements[placement].first];
+        auto& target = placements[placement].second;
         // initialize the RNG seed
         int seed = config["seed"].asInt();
-        // initialize benchmark instances
+        // initialize benchmark instances; a benchmark with a "rates" array
+        // is instantiated once per rate, forming a sweep
         std::vector<std::unique_ptr<AbstractBenchmark>> benchmarks;
         std::vector<unsigned> repetitions;
         std::vector<std::string> types;
-        benchmarks.reserve(config["benchmarks"].size());
-        repetitions.reserve(config["benchmarks"].size());
-        types.reserve(config["benchmarks"].size());
+        std::vector<Json::Value> bench_configs;
+        std::vector<int> sweeps; // index of the sweep of each benchmark, or -1
+        int num_sweeps = 0;
         for(auto& bench_config : config["benchmarks"]) {
-            std::string type = bench_config["type"].asString();
-            types.push_back(type);
-            benchmarks.push_back(AbstractBenchmark::create(type, bench_config, comm, mid, client, ph, target));
-            repetitions.push_back(bench_config["repetitions"].asUInt());
+            std::vector<Json::Value> instances;
+            if(bench_config["rates"].isArray()) {
+                for(auto& rate : bench_config["rates"]) {
+                    Json::Value instance = bench_config;
+                    instance.removeMember("rates");
+                    instance["rate"] = rate;
+                    instances.push_back(instance);
+                }
+            } else {
+                instances.push_back(bench_config);
+            }
+            for(auto& instance : instances) {
+                std::string type = instance["type"].asString();
+                types.push_back(type);
+                bench_configs.push_back(instance);
+                benchmarks.push_back(AbstractBenchmark::create(type, bench_configs.back(), comm, mid, client, ph, target));
+                repetitions.push_back(instance["repetitions"].asUInt());
+                sweeps.push_back(bench_config["rates"].isArray() ? num_sweeps : -1);
+            }
+            if(bench_config["rates"].isArray()) num_sweeps += 1;
         }
+        // results written to the json-output file, if any
+        std::string json_output = config["json-output"].asString();
+        Json::Value results(Json::arrayValue);
         // main execution loop
         for(unsigned i = 0; i < benchmarks.size(); i++) {
             auto& bench  = benchmarks[i];
             unsigned rep = repetitions[i];
             // reset the RNG
             srand(seed + rank*1789);
+            bench->clear_samples();
             std::vector<double> local_timings(rep);
             for(unsigned j = 0; j < rep; j++) {
                 MPI_Barrier(comm);
@@ -716,19 +1470,63 @@ static void run_client(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config)
             } else {
                 std::copy(local_timings.begin(), local_timings.end(), global_timings.begin());
             }
+            // exchange the placement, byte count and operation latencies
+            const auto& local_latencies = bench->latencies();
+            double local_counts[3] = { (double)placement, (double)local_latencies.size(), (double)bench->bytes() };
+            std::vector<double> global_counts(3*num_clients);
+            MPI_Gather(local_counts, 3, MPI_DOUBLE, global_counts.data(), 3, MPI_DOUBLE, 0, comm);
+            std::vector<int> recv_counts(num_clients), displs(num_clients);
+            size_t total_ops = 0;
+            for(int c = 0; c < num_clients; c++) {
+                recv_counts[c] = (int)global_counts[3*c+1];
+                displs[c]      = (int)total_ops;
+                total_ops     += recv_counts[c];
+            }
+            std::vector<double> global_latencies(rank == 0 ? total_ops : 0);
+            MPI_Gatherv(local_latencies.data(), local_latencies.size(), MPI_DOUBLE,
+                        global_latencies.data(), recv_counts.data(), displs.data(), MPI_DOUBLE, 0, comm);
+            // exchange the kind of each operation and the bytes of each kind
+            std::vector<std::string> kinds = bench->operation_kinds();
+            std::vector<int> global_kinds;
+            std::vector<double> local_kind_bytes(kinds.size()), global_kind_bytes;
+            if(!kinds.empty()) {
+                global_kinds.resize(rank == 0 ? total_ops : 0);
+                MPI_Gatherv(bench->kinds().data(), bench->kinds().size(), MPI_INT,
+                            global_kinds.data(), recv_counts.data(), displs.data(), MPI_INT, 0, comm);
+                for(unsigned k = 0; k < kinds.size(); k++)
+                    local_kind_bytes[k] = (double)bench->kind_bytes(k);
+                global_kind_bytes.resize(kinds.size()*num_clients);
+                MPI_Gather(local_kind_bytes.data(), kinds.size(), MPI_DOUBLE,
+                           global_kind_bytes.data(), kinds.size(), MPI_DOUBLE, 0, comm);
+            }
+            bench->clear_samples();
             // print report
             if(rank == 0) {
                 size_t n = global_timings.size();
                 std::cout << "================ " << types[i] << " ================" << std::endl;
-                writer->write(config["benchmarks"][i], &std::cout);
+                writer->write(bench_configs[i], &std::cout);
                 std::cout << std::endl;
                 std::cout << "-----------------" << std::string(types[i].size(),'-') << "-----------------" << std::endl;
+                // the clients run each repetition together, so the time
+                // available to all of them is the sum of the slowest
+                // execution of every repetition
+                double wall_time = 0.0;
+                for(unsigned j = 0; j < rep; j++) {
+                    double slowest = 0.0;
+                    for(int c = 0; c < num_clients; c++)
+                        slowest = std::max(slowest, global_timings[c*rep + j]);
+                    wall_time += slowest;
+                }
                 double average  = std::accumulate(global_timings.begin(), global_timings.end(), 0.0) / n;
                 double variance = std::accumulate(global_timings.begin(), global_timings.end(), 0.0, [average](double acc, double x) {
                         return acc + std::pow((x - average),2);
                     });
                 variance /= n;
                 double stddev = std::sqrt(variance);
+                // per-client execution times, before sorting the timings
+                std::vector<double> client_times(num_clients, 0.0);
+                for(int c = 0; c < num_clients; c++)
+                    client_times[c] = std::accumulate(global_timings.begin() + c*rep, global_timings.begin() + (c+1)*rep, 0.0);
                 std::sort(global_timings.begin(), global_timings.end());
                 double min = global_timings[0];
                 double max = global_timings[global_timings.size()-1];
@@ -745,8 +1543,118 @@ static void run_client(MPI_Comm comm, MPI_Comm global_comm, Json::Value& config)
                 std::cout << "Median(sec)     : " << median << std::endl;
                 std::cout << "Q3(sec)         : " << q3 << std::endl;
                 std::cout << "Maximum(sec)    : " << max << std::endl;
+                size_t ops = bench->operations();
+                if(ops != 0) {
+                    std::cout << "Throughput(op/s): " << (ops * num_clients) / average << std::endl;
+                }
+                // group the operations of all the clients, of each target
+                // and of each client
+                OperationStats all;
+                std::vector<OperationStats> per_target(placements.size());
+                std::vector<OperationStats> per_client(num_clients);
+                for(int c = 0; c < num_clients; c++) {
+                    unsigned p = (unsigned)global_counts[3*c];
+                    uint64_t bytes = (uint64_t)global_counts[3*c+2];
+                    auto first = global_latencies.begin() + displs[c];
+                    auto last  = first + recv_counts[c];
+                    for(OperationStats* s : { &all, &per_target[p], &per_client[c] }) {
+                        s->clients += 1;
+                        s->bytes   += bytes;
+                        s->latencies.insert(s->latencies.end(), first, last);
+                    }
+                }
+                std::vector<OperationStats> per_kind(kinds.size());
+                for(int c = 0; c < num_clients; c++) {
+                    std::vector<bool> seen(kinds.size(), false);
+                    for(int j = displs[c]; j < displs[c] + recv_counts[c]; j++) {
+                        int k = global_kinds[j];
+                        per_kind[k].latencies.push_back(global_latencies[j]);
+                        seen[k] = true;
+                    }
+                    for(unsigned k = 0; k < kinds.size(); k++) {
+                        per_kind[k].bytes   += (uint64_t)global_kind_bytes[c*kinds.size() + k];
+                        per_kind[k].clients += seen[k] ? 1 : 0;
+                    }
+                }
+                Json::Value result;
+                result["type"]   = types[i];
+                result["config"] = bench_configs[i];
+                if(bench_configs[i]["rate"])
+                    result["offered_rate"] = bench_configs[i]["rate"].asDouble() * num_clients;
+                if(sweeps[i] >= 0)
+                    result["sweep"] = sweeps[i];
+                result["timings"]["samples"]  = (Json::UInt64)n;
+                result["timings"]["average"]  = average;
+                result["timings"]["variance"] = variance;
+                result["timings"]["stddev"]   = stddev;
+                result["timings"]["min"]      = min;
+                result["timings"]["q1"]       = q1;
+                result["timings"]["median"]   = median;
+                result["timings"]["q3"]       = q3;
+                result["timings"]["max"]      = max;
+                result["operations"] = all.summarize(wall_time);
+                result["targets"]    = Json::Value(Json::arrayValue);
+                result["clients"]    = Json::Value(Json::arrayValue);
+                std::cout << "-----------------" << std::string(types[i].size(),'-') << "-----------------" << std::endl;
+                print_operation_header("# operations");
+                print_operation_stats("all clients", result["operations"]);
+                if(!kinds.empty())
+                    result["kinds"] = Json::Value(Json::objectValue);
+                for(unsigned k = 0; k < kinds.size(); k++) {
+                    if(per_kind[k].latencies.empty()) continue;
+                    Json::Value v = per_kind[k].summarize(wall_time);
+                    print_operation_stats(kinds[k], v);
+                    result["kinds"][kinds[k]] = v;
+                }
+                for(unsigned p = 0; p < placements.size(); p++) {
+                    if(per_target[p].clients == 0) continue;
+                    Json::Value v = per_target[p].summarize(wall_time);
+                    v["provider"] = placements[p].first;
+                    v["target"]   = (std::string)placements[p].second;
+                    print_operation_stats(placement_names[p], v);
+                    result["targets"].append(v);
+                }
+                for(int c = 0; c < num_clients; c++) {
+                    Json::Value v = per_client[c].summarize(client_times[c]);
+                    v["rank"]     = c;
+                    v["provider"] = placements[(unsigned)global_counts[3*c]].first;
+                    v["target"]   = (std::string)placements[(unsigned)global_counts[3*c]].second;
+                    print_operation_stats("client " + std::to_string(c), v);
+                    result["clients"].append(v);
+                }
+                results.append(result);
+                // print the throughput-latency curve at the end of a sweep
+                if(sweeps[i] >= 0 && (i+1 == benchmarks.size() || sweeps[i+1] != sweeps[i])) {
+                    unsigned first = i;
+                    while(first > 0 && sweeps[first-1] == sweeps[i]) first--;
+                    char line[256];
+                    std::cout << "================ " << types[i] << " sweep ================" << std::endl;
+                    snprintf(line, sizeof(line), "%12s %12s %10s %10s %10s %10s",
+                             "offered/s", "achieved/s", "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+                    std::cout << line << std::endl;
+                    for(unsigned k = first; k <= i; k++) {
+                        auto& r = results[k];
+                        snprintf(line, sizeof(line), "%12.1f %12.1f %10.1f %10.1f %10.1f %10.1f",
+                                 r["offered_rate"].asDouble(), r["operations"]["ops_per_sec"].asDouble(),
+                                 r["operations"]["latency"]["p50"].asDouble() * 1e6,
+                                 r["operations"]["latency"]["p99"].asDouble() * 1e6,
+                                 r["operations"]["latency"]["p99.9"].asDouble() * 1e6,
+                                 r["operations"]["latency"]["max"].asDouble() * 1e6);
+                        std::cout << line << std::endl;
+                    }
+                }
             }
         }
+        // write the machine-readable results
+        if(rank == 0 && !json_output.empty()) {
+            Json::Value output;
+            output["benchmarks"] = results;
+            std::ofstream json_file(json_output);
+            writer->write(output, &json_file);
+            json_file << std::endl;
+            if(!json_file.good())
+                std::cerr << "Could not write " << json_output << std::endl;
+        }
         // wait for all the clients to be done with their tasks
         MPI_Barrier(comm);
         // shutdown server and finalize margo
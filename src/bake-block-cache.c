@@ -0,0 +1,743 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "uthash.h"
+#include "bake-provider.h"
+#include "bake-block-cache.h"
+
+#define CACHE_ALIGN_DOWN(x, a) ((off_t)(x) & ~((off_t)(a)-1))
+#define CACHE_ALIGN_UP(x, a)   CACHE_ALIGN_DOWN((off_t)(x) + (a)-1, a)
+
+#define CACHE_COUNT(x, n) __atomic_add_fetch(&(x), (n), __ATOMIC_RELAXED)
+#define CACHE_READ(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+/* number of sequential streams tracked for readahead */
+#define CACHE_NUM_STREAMS 8
+/* maximum number of readahead ULTs in flight */
+#define CACHE_MAX_READAHEAD_ULTS 4
+
+enum
+{
+    CACHE_T1 = 0, /* resident, referenced once */
+    CACHE_T2,     /* resident, referenced more than once */
+    CACHE_B1,     /* ghost, recently evicted from T1 */
+    CACHE_B2,     /* ghost, recently evicted from T2 */
+    CACHE_NUM_LISTS
+};
+
+/* Block contents are reference counted separately from the block
+ * metadata, so that readers can copy out of a block without holding the
+ * cache lock while the block gets evicted or overwritten.
+ */
+typedef struct {
+    int   refs;
+    void* data;
+} cache_buf_t;
+
+typedef struct cache_block {
+    off_t               offset;     /* offset of the block on the device */
+    cache_buf_t*        buf;        /* NULL for ghost blocks */
+    int                 list;       /* CACHE_T1, CACHE_T2, ... */
+    int                 prefetched; /* populated by readahead, not read yet */
+    struct cache_block* prev;
+    struct cache_block* next;
+    UT_hash_handle      hh;
+} cache_block_t;
+
+typedef struct {
+    cache_block_t* mru;
+    cache_block_t* lru;
+    size_t         len;
+} cache_list_t;
+
+typedef struct {
+    off_t  next;   /* offset at which we expect the next read */
+    off_t  ra_end; /* end of the range already prefetched */
+    size_t window; /* current readahead window */
+} cache_stream_t;
+
+struct bake_block_cache {
+    bake_provider_t          provider;
+    size_t                   alignment;
+    bake_block_cache_read_fn read_fn;
+    void*                    arg;
+
+    ABT_mutex mutex; /* protects everything below */
+    size_t    block_size;
+    size_t    capacity; /* c in ARC terms, in blocks */
+    size_t    p;        /* ARC target size for T1, in blocks */
+    cache_list_t   lists[CACHE_NUM_LISTS];
+    cache_block_t* table;
+    uint64_t       epoch; /* bumped by writes and invalidations */
+    size_t         readahead_max;
+    cache_stream_t streams[CACHE_NUM_STREAMS];
+    unsigned       next_stream;
+    int            readahead_ults;
+
+    /* statistics (updated atomically) */
+    uint64_t hits;              /* blocks found in the cache */
+    uint64_t misses;            /* blocks read from the device */
+    uint64_t bytes_saved;       /* bytes served without device reads */
+    uint64_t fill_bytes;        /* bytes read from the device on misses */
+    uint64_t fills_discarded;   /* fills dropped due to concurrent writes */
+    uint64_t write_bytes;       /* bytes reported by writes */
+    uint64_t evictions;         /* blocks moved to a ghost list */
+    uint64_t invalidations;     /* blocks dropped by invalidation */
+    uint64_t readahead_bytes;   /* bytes requested by readahead */
+    uint64_t readahead_hits;    /* prefetched blocks that were later read */
+};
+
+typedef struct {
+    struct bake_block_cache* cache;
+    off_t                    offset;
+    size_t                   size;
+    uint64_t                 epoch;
+} readahead_args_t;
+
+static cache_buf_t* cache_buf_new(struct bake_block_cache* cache)
+{
+    cache_buf_t* buf = malloc(sizeof(*buf));
+    if (!buf) return NULL;
+    if (posix_memalign(&buf->data, cache->alignment, cache->block_size)
+        != 0) {
+        free(buf);
+        return NULL;
+    }
+    buf->refs = 1;
+    return buf;
+}
+
+static void cache_buf_release(cache_buf_t* buf)
+{
+    if (__atomic_sub_fetch(&buf->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(buf->data);
+        free(buf);
+    }
+}
+
+static void cache_list_remove(struct bake_block_cache* cache,
+                              cache_block_t*           blk)
+{
+    cache_list_t* l = &cache->lists[blk->list];
+    if (blk->prev)
+        blk->prev->next = blk->next;
+    else
+        l->mru = blk->next;
+    if (blk->next)
+        blk->next->prev = blk->prev;
+    else
+        l->lru = blk->prev;
+    blk->prev = blk->next = NULL;
+    l->len--;
+}
+
+static void
+cache_list_push(struct bake_block_cache* cache, cache_block_t* blk, int list)
+{
+    cache_list_t* l = &cache->lists[list];
+    blk->list       = list;
+    blk->prev       = NULL;
+    blk->next       = l->mru;
+    if (l->mru)
+        l->mru->prev = blk;
+    else
+        l->lru = blk;
+    l->mru = blk;
+    l->len++;
+}
+
+static void cache_list_move(struct bake_block_cache* cache,
+                            cache_block_t*           blk,
+                            int                      list)
+{
+    cache_list_remove(cache, blk);
+    cache_list_push(cache, blk, list);
+}
+
+static void cache_block_delete(struct bake_block_cache* cache,
+                               cache_block_t*           blk)
+{
+    cache_list_remove(cache, blk);
+    HASH_DEL(cache->table, blk);
+    if (blk->buf) cache_buf_release(blk->buf);
+    free(blk);
+}
+
+static size_t cache_resident(struct bake_block_cache* cache)
+{
+    return cache->lists[CACHE_T1].len + cache->lists[CACHE_T2].len;
+}
+
+/* ARC's REPLACE: demote the LRU block of T1 or T2 to the matching ghost
+ * list, depending on how T1 compares to its target size
+ */
+static void cache_replace(struct bake_block_cache* cache, int in_b2)
+{
+    size_t         t1 = cache->lists[CACHE_T1].len;
+    cache_block_t* victim;
+    int            ghost;
+
+    if (t1 > 0
+        && (t1 > cache->p || (in_b2 && t1 == cache->p)
+            || cache->lists[CACHE_T2].len == 0)) {
+        victim = cache->lists[CACHE_T1].lru;
+        ghost  = CACHE_B1;
+    } else {
+        victim = cache->lists[CACHE_T2].lru;
+        ghost  = CACHE_B2;
+    }
+    if (!victim) return;
+
+    cache_buf_release(victim->buf);
+    victim->buf        = NULL;
+    victim->prefetched = 0;
+    cache_list_move(cache, victim, ghost);
+    CACHE_COUNT(cache->evictions, 1);
+}
+
+/* evicts resident and ghost blocks until the lists fit the capacity */
+static void cache_shrink(struct bake_block_cache* cache)
+{
+    size_t c = cache->capacity;
+
+    while (cache_resident(cache) > c) {
+        if (c == 0) {
+            /* nothing to adapt to anymore; drop blocks entirely */
+            if (cache->lists[CACHE_T1].lru)
+                cache_block_delete(cache, cache->lists[CACHE_T1].lru);
+            else
+                cache_block_delete(cache, cache->lists[CACHE_T2].lru);
+        } else
+            cache_replace(cache, 0);
+    }
+    while (cache->lists[CACHE_T1].len + cache->lists[CACHE_B1].len > c
+           && cache->lists[CACHE_B1].lru)
+        cache_block_delete(cache, cache->lists[CACHE_B1].lru);
+    while (cache_resident(cache) + cache->lists[CACHE_B1].len
+               + cache->lists[CACHE_B2].len
+           > 2 * c)
+        cache_block_delete(cache, cache->lists[CACHE_B2].lru
+                                      ? cache->lists[CACHE_B2].lru
+                                      : cache->lists[CACHE_B1].lru);
+    if (cache->p > c) cache->p = c;
+}
+
+/* Inserts data for the block at offset, handing the reference held on buf
+ * over to the cache.  Must be called with the cache lock held and a
+ * non-zero capacity.
+ */
+static void cache_insert(struct bake_block_cache* cache,
+                         off_t                    offset,
+                         cache_buf_t*             buf,
+                         int                      prefetched)
+{
+    cache_block_t* blk = NULL;
+    size_t         c   = cache->capacity;
+    size_t         b1, b2, delta;
+
+    HASH_FIND(hh, cache->table, &offset, sizeof(offset), blk);
+
+    if (blk && (blk->list == CACHE_T1 || blk->list == CACHE_T2)) {
+        /* already resident (concurrent fill or overwrite): just replace
+         * the contents, this isn't a new reference
+         */
+        cache_buf_release(blk->buf);
+        blk->buf = buf;
+        return;
+    }
+
+    b1 = cache->lists[CACHE_B1].len;
+    b2 = cache->lists[CACHE_B2].len;
+
+    if (blk && blk->list == CACHE_B1) {
+        /* ghost hit in B1: T1 was too small */
+        delta    = b2 > b1 ? b2 / b1 : 1;
+        cache->p = cache->p + delta < c ? cache->p + delta : c;
+        if (cache_resident(cache) >= c) cache_replace(cache, 0);
+        blk->buf        = buf;
+        blk->prefetched = prefetched;
+        cache_list_move(cache, blk, CACHE_T2);
+        return;
+    }
+    if (blk && blk->list == CACHE_B2) {
+        /* ghost hit in B2: T2 was too small */
+        delta    = b1 > b2 ? b1 / b2 : 1;
+        cache->p = cache->p > delta ? cache->p - delta : 0;
+        if (cache_resident(cache) >= c) cache_replace(cache, 1);
+        blk->buf        = buf;
+        blk->prefetched = prefetched;
+        cache_list_move(cache, blk, CACHE_T2);
+        return;
+    }
+
+    /* complete miss */
+    if (cache->lists[CACHE_T1].len + b1 >= c) {
+        if (cache->lists[CACHE_T1].len < c) {
+            cache_block_delete(cache, cache->lists[CACHE_B1].lru);
+            if (cache_resident(cache) >= c) cache_replace(cache, 0);
+        } else {
+            cache_block_delete(cache, cache->lists[CACHE_T1].lru);
+            CACHE_COUNT(cache->evictions, 1);
+        }
+    } else if (cache_resident(cache) + b1 + b2 >= c) {
+        if (cache_resident(cache) + b1 + b2 >= 2 * c && b2 > 0)
+            cache_block_delete(cache, cache->lists[CACHE_B2].lru);
+        if (cache_resident(cache) >= c) cache_replace(cache, 0);
+    }
+
+    blk = calloc(1, sizeof(*blk));
+    if (!blk) {
+        cache_buf_release(buf);
+        return;
+    }
+    blk->offset     = offset;
+    blk->buf        = buf;
+    blk->prefetched = prefetched;
+    HASH_ADD(hh, cache->table, offset, sizeof(blk->offset), blk);
+    cache_list_push(cache, blk, CACHE_T1);
+}
+
+/* Looks up a block and returns a reference to its contents, or NULL.  Must
+ * be called with the cache lock held.
+ */
+static cache_buf_t* cache_lookup(struct bake_block_cache* cache, off_t offset)
+{
+    cache_block_t* blk = NULL;
+
+    HASH_FIND(hh, cache->table, &offset, sizeof(offset), blk);
+    if (!blk || !blk->buf) {
+        CACHE_COUNT(cache->misses, 1);
+        return NULL;
+    }
+
+    if (blk->prefetched) {
+        /* first actual reference to a prefetched block */
+        blk->prefetched = 0;
+        cache_list_move(cache, blk, CACHE_T1);
+        CACHE_COUNT(cache->readahead_hits, 1);
+    } else
+        cache_list_move(cache, blk, CACHE_T2);
+
+    CACHE_COUNT(cache->hits, 1);
+    __atomic_add_fetch(&blk->buf->refs, 1, __ATOMIC_ACQ_REL);
+    return blk->buf;
+}
+
+/* Reads [run_offset, run_offset + run_size) from the device, copies the
+ * part overlapping [dst_offset, dst_offset + dst_size) into dst (if any)
+ * and populates the cache with the blocks read, unless the cache has seen
+ * writes or invalidations since the given epoch.
+ */
+static int cache_fill(struct bake_block_cache* cache,
+                      char*                    dst,
+                      size_t                   dst_size,
+                      off_t                    dst_offset,
+                      off_t                    run_offset,
+                      size_t                   run_size,
+                      uint64_t                 epoch,
+                      int                      prefetch)
+{
+    size_t        bs  = cache->block_size;
+    char*         tmp = NULL;
+    char*         src;
+    ssize_t       ret;
+    off_t         copy_start, copy_end;
+    size_t        nfull, i;
+    cache_buf_t** bufs;
+
+    if (dst && run_offset >= dst_offset
+        && run_offset + run_size <= dst_offset + dst_size) {
+        /* read directly into the caller's buffer */
+        src = dst + (run_offset - dst_offset);
+    } else {
+        if (posix_memalign((void**)&tmp, cache->alignment, run_size) != 0)
+            return -1;
+        src = tmp;
+    }
+
+    ret = cache->read_fn(cache->arg, src, run_size, run_offset);
+    if (ret < 0) {
+        free(tmp);
+        return -1;
+    }
+    CACHE_COUNT(cache->fill_bytes, ret);
+
+    if (dst) {
+        copy_start = run_offset > dst_offset ? run_offset : dst_offset;
+        copy_end   = run_offset + run_size < dst_offset + dst_size
+                       ? run_offset + run_size
+                       : dst_offset + dst_size;
+        if (run_offset + ret < copy_end) {
+            /* short read within the requested range */
+            free(tmp);
+            return -1;
+        }
+        if (tmp)
+            memcpy(dst + (copy_start - dst_offset),
+                   tmp + (copy_start - run_offset), copy_end - copy_start);
+    }
+
+    /* populate the cache with the blocks that were read completely; the
+     * copies are made before taking the lock
+     */
+    nfull = ret / bs;
+    bufs  = calloc(nfull, sizeof(*bufs));
+    for (i = 0; bufs && i < nfull; i++) {
+        bufs[i] = cache_buf_new(cache);
+        if (!bufs[i]) break;
+        memcpy(bufs[i]->data, src + i * bs, bs);
+    }
+    nfull = bufs ? i : 0;
+
+    ABT_mutex_lock(cache->mutex);
+    if (cache->epoch == epoch && cache->capacity > 0) {
+        for (i = 0; i < nfull; i++)
+            cache_insert(cache, run_offset + i * bs, bufs[i], prefetch);
+    } else {
+        for (i = 0; i < nfull; i++) cache_buf_release(bufs[i]);
+        CACHE_COUNT(cache->fills_discarded, 1);
+    }
+    ABT_mutex_unlock(cache->mutex);
+
+    free(bufs);
+    free(tmp);
+    return 0;
+}
+
+static void readahead_ult(void* _args)
+{
+    readahead_args_t*        args  = _args;
+    struct bake_block_cache* cache = args->cache;
+
+    cache_fill(cache, NULL, 0, 0, args->offset, args->size, args->epoch, 1);
+
+    ABT_mutex_lock(cache->mutex);
+    cache->readahead_ults--;
+    ABT_mutex_unlock(cache->mutex);
+    free(args);
+}
+
+/* detects sequential streams and prefetches ahead of them */
+static void cache_readahead(struct bake_block_cache* cache,
+                            size_t                   size,
+                            off_t                    offset)
+{
+    size_t            bs     = cache->block_size;
+    cache_stream_t*   stream = NULL;
+    cache_block_t*    blk;
+    readahead_args_t* args;
+    off_t             start, stop;
+    unsigned          i;
+    int               ret;
+
+    ABT_mutex_lock(cache->mutex);
+    if (cache->readahead_max == 0) goto finish;
+
+    for (i = 0; i < CACHE_NUM_STREAMS; i++) {
+        if (cache->streams[i].next == offset && offset != 0) {
+            stream = &cache->streams[i];
+            break;
+        }
+    }
+    if (!stream) {
+        /* not part of a known stream; start tracking it */
+        stream = &cache->streams[cache->next_stream++ % CACHE_NUM_STREAMS];
+        stream->next   = offset + size;
+        stream->ra_end = 0;
+        stream->window = 0;
+        goto finish;
+    }
+
+    /* sequential: grow the window up to the configured maximum */
+    stream->next   = offset + size;
+    stream->window = stream->window ? 2 * stream->window
+                                    : CACHE_ALIGN_UP(size, bs);
+    if (stream->window > cache->readahead_max)
+        stream->window = cache->readahead_max;
+
+    start = CACHE_ALIGN_UP(offset + size, bs);
+    if (start < stream->ra_end) start = stream->ra_end;
+    stop = CACHE_ALIGN_UP(offset + size + stream->window, bs);
+
+    /* skip what is already there */
+    while (start < stop) {
+        blk = NULL;
+        HASH_FIND(hh, cache->table, &start, sizeof(start), blk);
+        if (!blk || !blk->buf) break;
+        start += bs;
+    }
+    if (start >= stop || cache->readahead_ults >= CACHE_MAX_READAHEAD_ULTS)
+        goto finish;
+
+    args = malloc(sizeof(*args));
+    if (!args) goto finish;
+    args->cache  = cache;
+    args->offset = start;
+    args->size   = stop - start;
+    args->epoch  = cache->epoch;
+
+    ret = ABT_thread_create(cache->provider->handler_pool, readahead_ult, args,
+                            ABT_THREAD_ATTR_NULL, NULL);
+    if (ret != ABT_SUCCESS) {
+        free(args);
+        goto finish;
+    }
+    cache->readahead_ults++;
+    stream->ra_end = stop;
+    CACHE_COUNT(cache->readahead_bytes, stop - start);
+
+finish:
+    ABT_mutex_unlock(cache->mutex);
+}
+
+bake_block_cache_t bake_block_cache_create(bake_provider_t          provider,
+                                           size_t                   alignment,
+                                           bake_block_cache_read_fn read_fn,
+                                           void*                    arg)
+{
+    struct bake_block_cache* cache = calloc(1, sizeof(*cache));
+    if (!cache) return NULL;
+
+    cache->provider      = provider;
+    cache->alignment     = alignment;
+    cache->read_fn       = read_fn;
+    cache->arg           = arg;
+    cache->block_size    = BAKE_BLOCK_CACHE_DEFAULT_BLOCK_SIZE;
+    cache->readahead_max = BAKE_BLOCK_CACHE_DEFAULT_READAHEAD;
+    if (cache->block_size < alignment) cache->block_size = alignment;
+    ABT_mutex_create(&cache->mutex);
+
+    return cache;
+}
+
+void bake_block_cache_destroy(bake_block_cache_t cache)
+{
+    cache_block_t *blk, *tmp;
+
+    if (!cache) return;
+
+    /* wait for readahead ULTs to drain */
+    ABT_mutex_lock(cache->mutex);
+    while (cache->readahead_ults) {
+        ABT_mutex_unlock(cache->mutex);
+        ABT_thread_yield();
+        ABT_mutex_lock(cache->mutex);
+    }
+    HASH_ITER(hh, cache->table, blk, tmp) { cache_block_delete(cache, blk); }
+    ABT_mutex_unlock(cache->mutex);
+
+    ABT_mutex_free(&cache->mutex);
+    free(cache);
+}
+
+int bake_block_cache_enabled(bake_block_cache_t cache)
+{
+    return __atomic_load_n(&cache->capacity, __ATOMIC_RELAXED) != 0;
+}
+
+int bake_block_cache_set_conf(bake_block_cache_t cache,
+                              const char*        key,
+                              const char*        value)
+{
+    size_t val;
+    int    ret = BAKE_SUCCESS;
+
+    if (strcmp(key, "cache_size") != 0 && strcmp(key, "cache_block_size") != 0
+        && strcmp(key, "cache_readahead") != 0)
+        return BAKE_ERR_OP_UNSUPPORTED;
+    if (sscanf(value, "%zu", &val) != 1) return BAKE_ERR_INVALID_ARG;
+
+    ABT_mutex_lock(cache->mutex);
+    if (strcmp(key, "cache_size") == 0) {
+        __atomic_store_n(&cache->capacity, val / cache->block_size,
+                         __ATOMIC_RELAXED);
+        cache->epoch++;
+        cache_shrink(cache);
+    } else if (strcmp(key, "cache_block_size") == 0) {
+        if (val == 0 || val % cache->alignment != 0 || cache->capacity != 0)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            cache->block_size = val;
+    } else if (strcmp(key, "cache_readahead") == 0) {
+        cache->readahead_max = val;
+    } else
+        ret = BAKE_ERR_INVALID_ARG;
+    ABT_mutex_unlock(cache->mutex);
+
+    return ret;
+}
+
+ssize_t bake_block_cache_read(bake_block_cache_t cache,
+                              void*              buf,
+                              size_t             size,
+                              off_t              offset)
+{
+    size_t        bs = cache->block_size;
+    off_t         first, blk_offset, copy_start, copy_end;
+    size_t        nblocks, i, j;
+    cache_buf_t** bufs;
+    uint64_t      epoch;
+    int           ret = 0;
+
+    if (!bake_block_cache_enabled(cache))
+        return cache->read_fn(cache->arg, buf, size, offset);
+
+    first   = CACHE_ALIGN_DOWN(offset, bs);
+    nblocks = (CACHE_ALIGN_UP(offset + size, bs) - first) / bs;
+    bufs    = calloc(nblocks, sizeof(*bufs));
+    if (!bufs) return cache->read_fn(cache->arg, buf, size, offset);
+
+    ABT_mutex_lock(cache->mutex);
+    epoch = cache->epoch;
+    for (i = 0; i < nblocks; i++) bufs[i] = cache_lookup(cache, first + i * bs);
+    ABT_mutex_unlock(cache->mutex);
+
+    for (i = 0; i < nblocks;) {
+        blk_offset = first + i * bs;
+        if (bufs[i]) {
+            copy_start = blk_offset > offset ? blk_offset : offset;
+            copy_end   = blk_offset + bs < offset + size ? blk_offset + bs
+                                                         : offset + size;
+            memcpy((char*)buf + (copy_start - offset),
+                   (char*)bufs[i]->data + (copy_start - blk_offset),
+                   copy_end - copy_start);
+            CACHE_COUNT(cache->bytes_saved, copy_end - copy_start);
+            cache_buf_release(bufs[i]);
+            i++;
+            continue;
+        }
+        /* coalesce consecutive misses into one device read */
+        for (j = i; j < nblocks && !bufs[j]; j++)
+            ;
+        if (ret == 0)
+            ret = cache_fill(cache, buf, size, offset, blk_offset,
+                             (j - i) * bs, epoch, 0);
+        i = j;
+    }
+    free(bufs);
+
+    if (ret != 0) return -1;
+
+    cache_readahead(cache, size, offset);
+    return size;
+}
+
+void bake_block_cache_write(bake_block_cache_t cache,
+                            const void*        buf,
+                            size_t             size,
+                            off_t              offset)
+{
+    size_t         bs = cache->block_size;
+    off_t          blk_offset, start, end;
+    cache_block_t* blk;
+    cache_buf_t*   nbuf;
+
+    if (!bake_block_cache_enabled(cache)) return;
+
+    ABT_mutex_lock(cache->mutex);
+    /* fills that started before this write may carry stale data */
+    cache->epoch++;
+    for (blk_offset = CACHE_ALIGN_DOWN(offset, bs);
+         blk_offset < offset + (off_t)size && cache->capacity > 0;
+         blk_offset += bs) {
+        start = blk_offset > offset ? blk_offset : offset;
+        end   = blk_offset + bs < offset + size ? blk_offset + bs
+                                                : offset + size;
+        blk   = NULL;
+        HASH_FIND(hh, cache->table, &blk_offset, sizeof(blk_offset), blk);
+        if (!(start == blk_offset && end == blk_offset + bs)
+            && !(blk && blk->buf))
+            continue; /* partial block that isn't cached */
+
+        /* copy-on-write, since readers may be copying out of the old
+         * contents without holding the lock
+         */
+        nbuf = cache_buf_new(cache);
+        if (!nbuf) {
+            if (blk) cache_block_delete(cache, blk);
+            continue;
+        }
+        if (blk && blk->buf && (start != blk_offset || end != blk_offset + bs))
+            memcpy(nbuf->data, blk->buf->data, bs);
+        memcpy((char*)nbuf->data + (start - blk_offset),
+               (const char*)buf + (start - offset), end - start);
+        cache_insert(cache, blk_offset, nbuf, 0);
+    }
+    ABT_mutex_unlock(cache->mutex);
+
+    CACHE_COUNT(cache->write_bytes, size);
+}
+
+void bake_block_cache_invalidate(bake_block_cache_t cache,
+                                 size_t             size,
+                                 off_t              offset)
+{
+    size_t         bs = cache->block_size;
+    off_t          blk_offset;
+    cache_block_t* blk;
+
+    ABT_mutex_lock(cache->mutex);
+    cache->epoch++;
+    for (blk_offset = CACHE_ALIGN_DOWN(offset, bs);
+         blk_offset < offset + (off_t)size && cache->table; blk_offset += bs) {
+        blk = NULL;
+        HASH_FIND(hh, cache->table, &blk_offset, sizeof(blk_offset), blk);
+        if (!blk) continue;
+        cache_block_delete(cache, blk);
+        CACHE_COUNT(cache->invalidations, 1);
+    }
+    ABT_mutex_unlock(cache->mutex);
+}
+
+void bake_block_cache_print_stats(bake_block_cache_t cache,
+                                  const char*        prefix,
+                                  FILE*              out)
+{
+    uint64_t hits, misses;
+    size_t   bs, capacity, resident, p;
+
+    ABT_mutex_lock(cache->mutex);
+    bs       = cache->block_size;
+    capacity = cache->capacity;
+    resident = cache_resident(cache);
+    p        = cache->p;
+    ABT_mutex_unlock(cache->mutex);
+
+    hits   = CACHE_READ(cache->hits);
+    misses = CACHE_READ(cache->misses);
+
+    fprintf(out, "%scache_block_size = %zu\n", prefix, bs);
+    fprintf(out, "%scache_size = %zu\n", prefix, capacity * bs);
+    fprintf(out, "%scache_resident_bytes = %zu\n", prefix, resident * bs);
+    fprintf(out, "%scache_arc_t1_target_bytes = %zu\n", prefix, p * bs);
+    fprintf(out, "%scache_hits = %" PRIu64 "\n", prefix, hits);
+    fprintf(out, "%scache_misses = %" PRIu64 "\n", prefix, misses);
+    fprintf(out, "%scache_hit_ratio = %.4f\n", prefix,
+            hits + misses ? (double)hits / (hits + misses) : 0.0);
+    fprintf(out, "%scache_bytes_saved = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->bytes_saved));
+    fprintf(out, "%scache_fill_bytes = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->fill_bytes));
+    fprintf(out, "%scache_fills_discarded = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->fills_discarded));
+    fprintf(out, "%scache_write_bytes = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->write_bytes));
+    fprintf(out, "%scache_evictions = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->evictions));
+    fprintf(out, "%scache_invalidations = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->invalidations));
+    fprintf(out, "%scache_readahead_bytes = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->readahead_bytes));
+    fprintf(out, "%scache_readahead_hits = %" PRIu64 "\n", prefix,
+            CACHE_READ(cache->readahead_hits));
+}
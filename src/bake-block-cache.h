@@ -0,0 +1,107 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_BLOCK_CACHE_H
+#define __BAKE_BLOCK_CACHE_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "bake-backend.h"
+
+/* bake-block-cache
+ *
+ * DRAM cache of fixed-size blocks of a backing device (e.g. the log of a
+ * file target, which is otherwise accessed with directio and never cached
+ * by the OS).  Replacement follows ARC (Megiddo and Modha, FAST'03): the
+ * cache keeps resident lists of blocks seen once (T1) and seen more than
+ * once (T2), plus "ghost" lists of recently evicted ones (B1 and B2) used
+ * to adapt the share of the cache given to each.  The number of resident
+ * bytes never exceeds the configured capacity.
+ *
+ * Reads that miss are served by the read function given at creation time,
+ * always with buffers, offsets and sizes aligned to the cache's alignment.
+ * Sequential read streams trigger asynchronous readahead.  Writes must be
+ * reported through bake_block_cache_write() so that cached blocks are kept
+ * up to date, and ranges that are deallocated must be invalidated.
+ */
+
+#define BAKE_BLOCK_CACHE_DEFAULT_BLOCK_SIZE (64 * 1024)
+#define BAKE_BLOCK_CACHE_DEFAULT_READAHEAD  (1024 * 1024)
+
+typedef struct bake_block_cache* bake_block_cache_t;
+
+/* reads size bytes at offset into buf; returns bytes read or -1 */
+typedef ssize_t (*bake_block_cache_read_fn)(void*  arg,
+                                            void*  buf,
+                                            size_t size,
+                                            off_t  offset);
+
+/**
+ * Creates a block cache.  The cache starts with a capacity of zero, i.e.
+ * disabled: reads go straight to read_fn.  Readahead ULTs are spawned in
+ * the provider's handler pool.
+ */
+bake_block_cache_t bake_block_cache_create(bake_provider_t          provider,
+                                           size_t                   alignment,
+                                           bake_block_cache_read_fn read_fn,
+                                           void*                    arg);
+
+/**
+ * Waits for outstanding readahead and frees all cached blocks.
+ */
+void bake_block_cache_destroy(bake_block_cache_t cache);
+
+/**
+ * Returns non-zero if the cache has a non-zero capacity.
+ */
+int bake_block_cache_enabled(bake_block_cache_t cache);
+
+/**
+ * Sets a configuration parameter.  Recognized keys are "cache_size" (bytes,
+ * 0 disables the cache), "cache_block_size" (bytes, a multiple of the
+ * alignment; can only be changed while the cache is disabled) and
+ * "cache_readahead" (maximum readahead window in bytes, 0 disables
+ * readahead).
+ */
+int bake_block_cache_set_conf(bake_block_cache_t cache,
+                              const char*        key,
+                              const char*        value);
+
+/**
+ * Reads size bytes at offset into buf, from the cache when possible and
+ * from read_fn otherwise.  buf, size and offset must be aligned to the
+ * alignment given at creation.  Returns size on success, -1 on error.
+ */
+ssize_t bake_block_cache_read(bake_block_cache_t cache,
+                              void*              buf,
+                              size_t             size,
+                              off_t              offset);
+
+/**
+ * Notifies the cache that size bytes from buf have been written at
+ * offset.  Cached blocks overlapping the range are updated and blocks
+ * entirely covered by it are populated.
+ */
+void bake_block_cache_write(bake_block_cache_t cache,
+                            const void*        buf,
+                            size_t             size,
+                            off_t              offset);
+
+/**
+ * Drops any cached block overlapping the given range.
+ */
+void bake_block_cache_invalidate(bake_block_cache_t cache,
+                                 size_t             size,
+                                 off_t              offset);
+
+/**
+ * Prints hit ratio, bytes saved and other counters, one "key = value"
+ * pair per line, each key prefixed by the given prefix.
+ */
+void bake_block_cache_print_stats(bake_block_cache_t cache,
+                                  const char*        prefix,
+                                  FILE*              out);
+
+#endif
@@ -0,0 +1,369 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "bake-provider.h"
+#include "bake-buffer-arena.h"
+#include "bake-numa.h"
+
+/* Every buffer handed out by the arena is preceded by one alignment unit,
+ * the end of which holds a header.  This lets bake_buffer_arena_free() work
+ * from the buffer pointer alone, which is all that a backend's free_fn
+ * receives.
+ */
+typedef enum
+{
+    ARENA_BUF_SLAB    = 1,
+    ARENA_BUF_POOLSET = 2,
+    ARENA_BUF_HEAP    = 3
+} arena_buf_kind_t;
+
+typedef struct arena_cache arena_cache_t;
+
+typedef struct {
+    struct bake_buffer_arena* arena;
+    arena_cache_t*            cache;     /* owning cache (slab buffers) */
+    hg_bulk_t                 bulk;      /* poolset buffer, if any */
+    uint32_t                  class_idx; /* size class (slab buffers) */
+    uint32_t                  slot;      /* index in slab (slab buffers) */
+    arena_buf_kind_t          kind;
+} arena_buf_header_t;
+
+/* Lock-free stack of slot indices.  The head packs a modification tag in
+ * its upper 32 bits and (slot + 1) of the top element in its lower 32 bits
+ * (0 meaning empty).  The tag is incremented on every update to avoid ABA
+ * problems between concurrent pops and pushes.
+ */
+typedef struct {
+    uint64_t  head;
+    uint32_t* next; /* next[slot] = (slot + 1) of the element below, or 0 */
+    char*     slab; /* num_buffers contiguous (header + buffer) strides */
+    size_t    slab_len; /* mapped length */
+    size_t    stride;
+} arena_stack_t;
+
+struct arena_cache {
+    arena_stack_t stacks[BAKE_BUFFER_ARENA_NCLASSES];
+    unsigned      num_buffers;
+};
+
+typedef struct {
+    uint64_t allocs;   /* buffers requested in this class */
+    uint64_t hits;     /* requests served from an execution stream cache */
+    uint64_t in_use;   /* cache buffers currently handed out */
+    uint64_t poolsets; /* requests that fell back to the pipeline poolset */
+    uint64_t heaps;    /* requests that fell back to the heap */
+} arena_class_stats_t;
+
+struct bake_buffer_arena {
+    bake_provider_t     provider;
+    size_t              alignment;
+    unsigned            num_buffers;
+    int                 numa_node; /* node the caches are bound to, or -1 */
+    int                 huge_pages;
+    size_t              class_size[BAKE_BUFFER_ARENA_NCLASSES];
+    arena_cache_t*      caches[BAKE_BUFFER_ARENA_MAX_XSTREAMS];
+    arena_class_stats_t stats[BAKE_BUFFER_ARENA_NCLASSES + 1]; /* last entry
+                                                   counts oversized requests */
+    uint64_t            caches_populated;
+    uint64_t            cache_bytes; /* memory held by populated caches */
+    uint64_t            cache_slabs[3]; /* by BAKE_NUMA_PAGES_* backing */
+};
+
+#define ARENA_HEADER(arena, base) \
+    ((arena_buf_header_t*)((char*)(base) + (arena)->alignment \
+                           - sizeof(arena_buf_header_t)))
+
+#define ARENA_COUNT(x, n) __atomic_add_fetch(&(x), (n), __ATOMIC_RELAXED)
+#define ARENA_READ(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+static int arena_stack_pop(arena_stack_t* s, uint32_t* slot)
+{
+    uint64_t old_head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    uint32_t top;
+
+    do {
+        top = (uint32_t)old_head;
+        if (top == 0) return -1;
+        new_head = (((old_head >> 32) + 1) << 32)
+                 | __atomic_load_n(&s->next[top - 1], __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&s->head, &old_head, new_head, 1,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    *slot = top - 1;
+    return 0;
+}
+
+static void arena_stack_push(arena_stack_t* s, uint32_t slot)
+{
+    uint64_t old_head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+
+    do {
+        __atomic_store_n(&s->next[slot], (uint32_t)old_head, __ATOMIC_RELAXED);
+        new_head = (((old_head >> 32) + 1) << 32) | (slot + 1);
+    } while (!__atomic_compare_exchange_n(&s->head, &old_head, new_head, 1,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+}
+
+static void arena_cache_free(arena_cache_t* cache)
+{
+    int c;
+    if (!cache) return;
+    for (c = 0; c < BAKE_BUFFER_ARENA_NCLASSES; c++) {
+        if (cache->stacks[c].slab)
+            bake_numa_unmap(cache->stacks[c].slab, cache->stacks[c].slab_len);
+        free(cache->stacks[c].next);
+    }
+    free(cache);
+}
+
+static arena_cache_t* arena_cache_create(struct bake_buffer_arena* arena)
+{
+    arena_cache_t* cache = calloc(1, sizeof(*cache));
+    unsigned       n     = arena->num_buffers;
+    size_t         unit;
+    uint32_t       i;
+    int            c, pages;
+
+    if (!cache) return NULL;
+    cache->num_buffers = n;
+
+    for (c = 0; c < BAKE_BUFFER_ARENA_NCLASSES; c++) {
+        arena_stack_t* s = &cache->stacks[c];
+        s->stride        = arena->alignment + arena->class_size[c];
+        s->next          = calloc(n, sizeof(*s->next));
+        /* mappings are page aligned, which covers the arena's alignment */
+        unit        = arena->huge_pages ? BAKE_HUGE_PAGE_SIZE : 4096;
+        s->slab_len = (n * s->stride + unit - 1) / unit * unit;
+        s->slab     = bake_numa_map(s->slab_len, arena->numa_node,
+                                arena->huge_pages, &pages);
+        if (!s->next || !s->slab) {
+            arena_cache_free(cache);
+            return NULL;
+        }
+        ARENA_COUNT(arena->cache_slabs[pages], 1);
+        for (i = 0; i < n; i++) {
+            arena_buf_header_t* hdr
+                = ARENA_HEADER(arena, s->slab + i * s->stride);
+            hdr->arena     = arena;
+            hdr->cache     = cache;
+            hdr->bulk      = HG_BULK_NULL;
+            hdr->class_idx = c;
+            hdr->slot      = i;
+            hdr->kind      = ARENA_BUF_SLAB;
+            arena_stack_push(s, i);
+        }
+    }
+    return cache;
+}
+
+/* finds (and populates on first use) the cache of the calling xstream */
+static arena_cache_t* arena_get_cache(struct bake_buffer_arena* arena)
+{
+    arena_cache_t* cache    = NULL;
+    arena_cache_t* expected = NULL;
+    int            rank     = 0;
+    int            c;
+
+    if (arena->num_buffers == 0) return NULL;
+
+    ABT_xstream_self_rank(&rank);
+    rank %= BAKE_BUFFER_ARENA_MAX_XSTREAMS;
+
+    cache = __atomic_load_n(&arena->caches[rank], __ATOMIC_ACQUIRE);
+    if (cache) return cache;
+
+    cache = arena_cache_create(arena);
+    if (!cache) return NULL;
+    if (!__atomic_compare_exchange_n(&arena->caches[rank], &expected, cache, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        /* another ULT on this xstream populated it first */
+        arena_cache_free(cache);
+        return expected;
+    }
+    ARENA_COUNT(arena->caches_populated, 1);
+    for (c = 0; c < BAKE_BUFFER_ARENA_NCLASSES; c++)
+        ARENA_COUNT(arena->cache_bytes, cache->stacks[c].slab_len);
+    return cache;
+}
+
+bake_buffer_arena_t bake_buffer_arena_create(bake_provider_t provider,
+                                             size_t          alignment)
+{
+    struct bake_buffer_arena* arena;
+    int                       c;
+
+    assert(alignment >= sizeof(arena_buf_header_t));
+    assert((alignment & (alignment - 1)) == 0);
+
+    arena = calloc(1, sizeof(*arena));
+    if (!arena) return NULL;
+
+    arena->provider    = provider;
+    arena->alignment   = alignment;
+    arena->num_buffers = BAKE_BUFFER_ARENA_DEFAULT_NUM_BUFFERS;
+    arena->numa_node   = -1;
+    /* size classes of 1, 4, 16 and 64 alignment units (4 KiB to 256 KiB
+     * with the file backend's alignment) cover typical eager sizes
+     */
+    for (c = 0; c < BAKE_BUFFER_ARENA_NCLASSES; c++)
+        arena->class_size[c] = alignment << (2 * c);
+
+    return arena;
+}
+
+void bake_buffer_arena_destroy(bake_buffer_arena_t arena)
+{
+    int i;
+    if (!arena) return;
+    for (i = 0; i < BAKE_BUFFER_ARENA_MAX_XSTREAMS; i++)
+        arena_cache_free(arena->caches[i]);
+    free(arena);
+}
+
+int bake_buffer_arena_set_num_buffers(bake_buffer_arena_t arena,
+                                      unsigned            num_buffers)
+{
+    arena->num_buffers = num_buffers;
+    return BAKE_SUCCESS;
+}
+
+int bake_buffer_arena_set_placement(bake_buffer_arena_t arena,
+                                    int                 numa_node,
+                                    int                 huge_pages)
+{
+    arena->numa_node  = numa_node;
+    arena->huge_pages = huge_pages;
+    return BAKE_SUCCESS;
+}
+
+void* bake_buffer_arena_alloc(bake_buffer_arena_t arena, size_t size)
+{
+    arena_buf_header_t* hdr = NULL;
+    arena_cache_t*      cache;
+    hg_size_t           max_size = 0;
+    hg_size_t           buf_size;
+    hg_uint32_t         count;
+    hg_bulk_t           bulk = HG_BULK_NULL;
+    void*               ptr;
+    uint32_t            slot;
+    int                 c, ret;
+
+    for (c = 0; c < BAKE_BUFFER_ARENA_NCLASSES; c++)
+        if (size <= arena->class_size[c]) break;
+    ARENA_COUNT(arena->stats[c].allocs, 1);
+
+    /* fast path: buffer from this xstream's cache */
+    if (c < BAKE_BUFFER_ARENA_NCLASSES && (cache = arena_get_cache(arena))) {
+        arena_stack_t* s = &cache->stacks[c];
+        if (arena_stack_pop(s, &slot) == 0) {
+            ARENA_COUNT(arena->stats[c].hits, 1);
+            ARENA_COUNT(arena->stats[c].in_use, 1);
+            return s->slab + slot * s->stride + arena->alignment;
+        }
+    }
+
+    /* fall back to the pipeline poolset if it has a buffer to spare */
+    if (arena->provider->config.pipeline_enable) {
+        bake_poolset_get_max(arena->provider->poolset, &max_size);
+        if (size + arena->alignment <= max_size) {
+            bake_poolset_tryget(arena->provider->poolset,
+                                size + arena->alignment, HG_TRUE, &bulk);
+        }
+    }
+    if (bulk != HG_BULK_NULL) {
+        ret = margo_bulk_access(bulk, 0, size + arena->alignment,
+                                HG_BULK_READWRITE, 1, &ptr, &buf_size, &count);
+        /* shouldn't ever fail in this use case */
+        assert(ret == 0);
+        hdr       = ARENA_HEADER(arena, ptr);
+        hdr->bulk = bulk;
+        hdr->kind = ARENA_BUF_POOLSET;
+        ARENA_COUNT(arena->stats[c].poolsets, 1);
+    } else {
+        ret = posix_memalign(&ptr, arena->alignment, size + arena->alignment);
+        if (ret != 0) return NULL;
+        hdr       = ARENA_HEADER(arena, ptr);
+        hdr->bulk = HG_BULK_NULL;
+        hdr->kind = ARENA_BUF_HEAP;
+        ARENA_COUNT(arena->stats[c].heaps, 1);
+    }
+    hdr->arena     = arena;
+    hdr->cache     = NULL;
+    hdr->class_idx = c;
+    hdr->slot      = 0;
+
+    return (char*)ptr + arena->alignment;
+}
+
+void bake_buffer_arena_free(void* buffer)
+{
+    arena_buf_header_t*       hdr;
+    struct bake_buffer_arena* arena;
+
+    if (!buffer) return;
+
+    hdr   = (arena_buf_header_t*)((char*)buffer - sizeof(arena_buf_header_t));
+    arena = hdr->arena;
+
+    switch (hdr->kind) {
+    case ARENA_BUF_SLAB:
+        ARENA_COUNT(arena->stats[hdr->class_idx].in_use, -1);
+        arena_stack_push(&hdr->cache->stacks[hdr->class_idx], hdr->slot);
+        break;
+    case ARENA_BUF_POOLSET:
+        bake_poolset_release(arena->provider->poolset, hdr->bulk);
+        break;
+    case ARENA_BUF_HEAP:
+        free((char*)buffer - arena->alignment);
+        break;
+    default:
+        assert(0);
+    }
+}
+
+void bake_buffer_arena_print_stats(bake_buffer_arena_t arena,
+                                   const char*         prefix,
+                                   FILE*               out)
+{
+    int c;
+
+    fprintf(out, "%sarena_buffers_per_class = %u\n", prefix,
+            arena->num_buffers);
+    fprintf(out, "%sarena_caches_populated = %" PRIu64 "\n", prefix,
+            ARENA_READ(arena->caches_populated));
+    fprintf(out, "%sarena_cache_bytes = %" PRIu64 "\n", prefix,
+            ARENA_READ(arena->cache_bytes));
+    fprintf(out, "%sarena_numa_node = %d\n", prefix, arena->numa_node);
+    fprintf(out, "%sarena_huge_pages = %d\n", prefix, arena->huge_pages);
+    fprintf(out,
+            "%sarena_cache_slabs = hugetlb %" PRIu64 " thp %" PRIu64
+            " normal %" PRIu64 "\n",
+            prefix, ARENA_READ(arena->cache_slabs[BAKE_NUMA_PAGES_HUGE]),
+            ARENA_READ(arena->cache_slabs[BAKE_NUMA_PAGES_THP]),
+            ARENA_READ(arena->cache_slabs[BAKE_NUMA_PAGES_NORMAL]));
+    for (c = 0; c <= BAKE_BUFFER_ARENA_NCLASSES; c++) {
+        arena_class_stats_t* st = &arena->stats[c];
+        char                 name[32];
+        if (c < BAKE_BUFFER_ARENA_NCLASSES)
+            snprintf(name, sizeof(name), "%zu", arena->class_size[c]);
+        else
+            snprintf(name, sizeof(name), "large");
+        fprintf(out,
+                "%sarena_class_%s = allocs %" PRIu64 " hits %" PRIu64
+                " in_use %" PRIu64 " poolset %" PRIu64 " heap %" PRIu64 "\n",
+                prefix, name, ARENA_READ(st->allocs), ARENA_READ(st->hits),
+                ARENA_READ(st->in_use), ARENA_READ(st->poolsets),
+                ARENA_READ(st->heaps));
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_BUFFER_ARENA_H
+#define __BAKE_BUFFER_ARENA_H
+
+#include <stdio.h>
+#include "bake-backend.h"
+
+/* bake-buffer-arena
+ *
+ * Pre-aligned intermediate buffers for backends that need bounce buffers on
+ * the eager path (e.g. the file backend with directio).  Each arena holds a
+ * lazily populated cache per execution stream, and each cache holds a fixed
+ * number of buffers in a few size classes.  Free lists are lock-free so that
+ * a buffer can be released from a different execution stream than the one it
+ * was obtained from.  Requests that do not fit in the largest size class (or
+ * that find their free list empty) are served from the provider's pipeline
+ * poolset, and from the heap as a last resort.
+ */
+
+#define BAKE_BUFFER_ARENA_NCLASSES            4
+#define BAKE_BUFFER_ARENA_MAX_XSTREAMS        64
+#define BAKE_BUFFER_ARENA_DEFAULT_NUM_BUFFERS 16
+
+typedef struct bake_buffer_arena* bake_buffer_arena_t;
+
+/**
+ * Creates an arena.  Buffers are aligned to (and their sizes rounded up to)
+ * the given alignment, which must be a power of two.  No memory is allocated
+ * for a given execution stream until it first requests a buffer.
+ */
+bake_buffer_arena_t bake_buffer_arena_create(bake_provider_t provider,
+                                             size_t          alignment);
+
+void bake_buffer_arena_destroy(bake_buffer_arena_t arena);
+
+/**
+ * Sets the number of buffers per size class held by each execution stream's
+ * cache.  Only affects caches that have not been populated yet.  Setting it
+ * to zero disables the caches entirely.
+ */
+int bake_buffer_arena_set_num_buffers(bake_buffer_arena_t arena,
+                                      unsigned            num_buffers);
+
+/**
+ * Binds the caches to a NUMA node (-1 for none) and backs them with huge
+ * pages if huge_pages is set.  Only affects caches that have not been
+ * populated yet.
+ */
+int bake_buffer_arena_set_placement(bake_buffer_arena_t arena,
+                                    int                 numa_node,
+                                    int                 huge_pages);
+
+/**
+ * Returns an aligned buffer of at least size bytes, or NULL on failure.
+ */
+void* bake_buffer_arena_alloc(bake_buffer_arena_t arena, size_t size);
+
+/**
+ * Releases a buffer previously obtained from bake_buffer_arena_alloc.  The
+ * pointer must be the one returned by bake_buffer_arena_alloc.
+ */
+void bake_buffer_arena_free(void* buffer);
+
+/**
+ * Prints allocation counters and occupancy of the arena, one "key = value"
+ * pair per line, each key prefixed by the given prefix.
+ */
+void bake_buffer_arena_print_stats(bake_buffer_arena_t arena,
+                                   const char*         prefix,
+                                   FILE*               out);
+
+#endif
@@ -12,6 +12,8 @@
 #include "uthash.h"
 #include "bake-rpc.h"
 #include "bake-timing.h"
+#include "bake-metrics.h"
+#include "bake-trace.h"
 
 #define BAKE_DEFAULT_EAGER_LIMIT 2048
 
@@ -37,8 +39,11 @@ struct bake_client {
     hg_id_t bake_remove_id;
     hg_id_t bake_migrate_region_id;
     hg_id_t bake_migrate_target_id;
+    hg_id_t bake_get_stats_id;
+    hg_id_t bake_get_credits_id;
 
-    uint64_t num_provider_handles;
+    uint64_t      num_provider_handles;
+    bake_tracer_t tracer; /* spans of sampled requests */
 };
 
 struct bake_provider_handle {
@@ -47,6 +52,22 @@ struct bake_provider_handle {
     uint16_t            provider_id;
     uint64_t            refcount;
     uint64_t            eager_limit;
+    uint8_t             qos_class; /* tag of writes and reads */
+
+    /* flow control state, protected by credit_mutex */
+    uint64_t  grantee; /* identifies the handle to the provider */
+    ABT_mutex credit_mutex;
+    ABT_cond  credit_cond;
+    int       credits_known;    /* granted by the provider or set locally */
+    int       credits_set;      /* set locally, ignore granted ones */
+    int       credits_fetching; /* a ULT is asking the provider */
+    double    credits_expiry;   /* when to ask the provider again */
+    uint64_t  credit_ops;       /* 0 for unlimited */
+    uint64_t  credit_bytes;     /* 0 for unlimited */
+    uint64_t  ops_in_flight;
+    uint64_t  bytes_in_flight;
+    uint64_t  queued;
+    double    queued_time;
 };
 
 static int bake_client_register(bake_client_t client, margo_instance_id mid)
@@ -91,6 +112,10 @@ static int bake_client_register(bake_client_t client, margo_instance_id mid)
                               &client->bake_migrate_region_id, &flag);
         margo_registered_name(mid, "bake_migrate_target_rpc",
                               &client->bake_migrate_target_id, &flag);
+        margo_registered_name(mid, "bake_get_stats_rpc",
+                              &client->bake_get_stats_id, &flag);
+        margo_registered_name(mid, "bake_get_credits_rpc",
+                              &client->bake_get_credits_id, &flag);
 
     } else { /* RPCs not already registered */
 
@@ -135,6 +160,12 @@ static int bake_client_register(bake_client_t client, margo_instance_id mid)
         client->bake_migrate_target_id = MARGO_REGISTER(
             mid, "bake_migrate_target_rpc", bake_migrate_target_in_t,
             bake_migrate_target_out_t, NULL);
+        client->bake_get_stats_id
+            = MARGO_REGISTER(mid, "bake_get_stats_rpc", void,
+                             bake_get_stats_out_t, NULL);
+        client->bake_get_credits_id
+            = MARGO_REGISTER(mid, "bake_get_credits_rpc", bake_get_credits_in_t,
+                             bake_get_credits_out_t, NULL);
     }
 
     return BAKE_SUCCESS;
@@ -147,6 +178,12 @@ int bake_client_init(margo_instance_id mid, bake_client_t* client)
 
     c->num_provider_handles = 0;
 
+    c->tracer = bake_tracer_create("bake client");
+    if (!c->tracer) {
+        free(c);
+        return BAKE_ERR_ALLOCATION;
+    }
+
     int ret = bake_client_register(c, mid);
     if (ret != BAKE_SUCCESS) return ret;
 
@@ -162,10 +199,47 @@ int bake_client_finalize(bake_client_t client)
                 "bake_client_finalize was called\n",
                 (long long unsigned int)client->num_provider_handles);
     }
+    bake_tracer_destroy(client->tracer);
     free(client);
     return BAKE_SUCCESS;
 }
 
+int bake_client_set_conf(bake_client_t client,
+                         const char*   key,
+                         const char*   value)
+{
+    if (client == BAKE_CLIENT_NULL) return BAKE_ERR_INVALID_ARG;
+    return bake_tracer_set_conf(client->tracer, key, value);
+}
+
+int bake_client_dump_trace(bake_client_t client, const char* filename)
+{
+    if (client == BAKE_CLIENT_NULL) return BAKE_ERR_INVALID_ARG;
+    return bake_tracer_dump_file(client->tracer, filename);
+}
+
+/* forwards an RPC under a new request id (stored into the input before it
+ * is sent), recording the round trip as a span if the request is sampled */
+static hg_return_t forward_traced(bake_provider_handle_t provider,
+                                  hg_handle_t            handle,
+                                  void*                  in,
+                                  uint64_t*              req_id,
+                                  int                    op,
+                                  uint64_t               size)
+{
+    bake_tracer_t tracer = provider->client->tracer;
+    uint64_t      start  = 0;
+    hg_return_t   hret;
+
+    *req_id = bake_tracer_new_request(tracer);
+    if (*req_id & BAKE_TRACE_SAMPLED) start = bake_trace_now();
+    hret = margo_provider_forward(provider->provider_id, handle, in);
+    if (start)
+        bake_tracer_record(tracer, *req_id, BAKE_TRACE_FORWARD, op, start,
+                           bake_trace_now(), size);
+    return hret;
+}
+
 int bake_probe(bake_provider_handle_t provider,
                uint64_t               max_targets,
                bake_target_id_t*      bti,
@@ -247,6 +321,13 @@ int bake_provider_handle_create(bake_client_t           client,
     provider->provider_id = provider_id;
     provider->refcount    = 1;
     provider->eager_limit = BAKE_DEFAULT_EAGER_LIMIT;
+    {
+        uuid_t id;
+        uuid_generate(id);
+        memcpy(&provider->grantee, id, sizeof(provider->grantee));
+    }
+    ABT_mutex_create(&provider->credit_mutex);
+    ABT_cond_create(&provider->credit_cond);
 
     client->num_provider_handles += 1;
 
@@ -270,6 +351,190 @@ int bake_provider_handle_set_eager_limit(bake_provider_handle_t handle,
     return BAKE_SUCCESS;
 }
 
+int bake_provider_handle_get_qos_class(bake_provider_handle_t handle,
+                                       uint8_t*               qos_class)
+{
+    if (handle == BAKE_PROVIDER_HANDLE_NULL) return BAKE_ERR_INVALID_ARG;
+    *qos_class = handle->qos_class;
+    return BAKE_SUCCESS;
+}
+
+int bake_provider_handle_set_qos_class(bake_provider_handle_t handle,
+                                       uint8_t                qos_class)
+{
+    if (handle == BAKE_PROVIDER_HANDLE_NULL) return BAKE_ERR_INVALID_ARG;
+    if (qos_class > BAKE_QOS_CLASS_BACKGROUND) return BAKE_ERR_INVALID_ARG;
+    handle->qos_class = qos_class;
+    return BAKE_SUCCESS;
+}
+
+static void credit_renew(bake_provider_handle_t provider);
+
+int bake_provider_handle_get_credits(bake_provider_handle_t handle,
+                                     uint64_t*              ops,
+                                     uint64_t*              bytes)
+{
+    if (handle == BAKE_PROVIDER_HANDLE_NULL) return BAKE_ERR_INVALID_ARG;
+    credit_renew(handle);
+    ABT_mutex_lock(handle->credit_mutex);
+    *ops   = handle->credit_ops;
+    *bytes = handle->credit_bytes;
+    ABT_mutex_unlock(handle->credit_mutex);
+    return BAKE_SUCCESS;
+}
+
+int bake_provider_handle_set_credits(bake_provider_handle_t handle,
+                                     uint64_t               ops,
+                                     uint64_t               bytes)
+{
+    if (handle == BAKE_PROVIDER_HANDLE_NULL) return BAKE_ERR_INVALID_ARG;
+    ABT_mutex_lock(handle->credit_mutex);
+    handle->credit_ops    = ops;
+    handle->credit_bytes  = bytes;
+    handle->credits_known = 1;
+    handle->credits_set   = 1;
+    ABT_cond_broadcast(handle->credit_cond);
+    ABT_mutex_unlock(handle->credit_mutex);
+    return BAKE_SUCCESS;
+}
+
+int bake_provider_handle_get_flow_stats(bake_provider_handle_t handle,
+                                        uint64_t*              queued,
+                                        double*                queued_time)
+{
+    if (handle == BAKE_PROVIDER_HANDLE_NULL) return BAKE_ERR_INVALID_ARG;
+    ABT_mutex_lock(handle->credit_mutex);
+    *queued      = handle->queued;
+    *queued_time = handle->queued_time;
+    ABT_mutex_unlock(handle->credit_mutex);
+    return BAKE_SUCCESS;
+}
+
+/* whether an operation of the given size must wait for credits; called with
+ * the credit mutex held */
+static int out_of_credits(bake_provider_handle_t provider, uint64_t size)
+{
+    if (provider->ops_in_flight == 0) return 0;
+    if (provider->credit_ops && provider->ops_in_flight >= provider->credit_ops)
+        return 1;
+    return provider->credit_bytes
+        && provider->bytes_in_flight + size > provider->credit_bytes;
+}
+
+/* asks the provider for the handle's share of its credits */
+static int get_credits(bake_provider_handle_t provider,
+                       uint64_t*              ops,
+                       uint64_t*              bytes,
+                       uint64_t*              lease_ms)
+{
+    hg_return_t            hret;
+    hg_handle_t            handle;
+    bake_get_credits_in_t  in;
+    bake_get_credits_out_t out;
+    int                    ret;
+
+    in.grantee = provider->grantee;
+    hret       = margo_create(provider->client->mid, provider->addr,
+                        provider->client->bake_get_credits_id, &handle);
+    if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+
+    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    if (hret != HG_SUCCESS) {
+        margo_destroy(handle);
+        return BAKE_ERR_MERCURY;
+    }
+
+    hret = margo_get_output(handle, &out);
+    if (hret != HG_SUCCESS) {
+        margo_destroy(handle);
+        return BAKE_ERR_MERCURY;
+    }
+
+    ret = out.ret;
+    if (ret == BAKE_SUCCESS) {
+        *ops      = out.credit_ops;
+        *bytes    = out.credit_bytes;
+        *lease_ms = out.lease_ms;
+    }
+    margo_free_output(handle, &out);
+    margo_destroy(handle);
+    return ret;
+}
+
+/* renews the handle's credits if they expired; one ULT asks the provider
+ * while the others go on with the previous credits, or wait if there are
+ * none yet */
+static void credit_renew(bake_provider_handle_t provider)
+{
+    uint64_t ops = 0, bytes = 0, lease_ms = 0;
+    int      ret;
+
+    ABT_mutex_lock(provider->credit_mutex);
+    if (provider->credits_set || provider->credits_fetching
+        || (provider->credits_known
+            && ABT_get_wtime() < provider->credits_expiry)) {
+        while (!provider->credits_known)
+            ABT_cond_wait(provider->credit_cond, provider->credit_mutex);
+        ABT_mutex_unlock(provider->credit_mutex);
+        return;
+    }
+    provider->credits_fetching = 1;
+    ABT_mutex_unlock(provider->credit_mutex);
+
+    ret = get_credits(provider, &ops, &bytes, &lease_ms);
+
+    ABT_mutex_lock(provider->credit_mutex);
+    provider->credits_fetching = 0;
+    if (!provider->credits_set) {
+        if (ret == BAKE_SUCCESS) {
+            provider->credit_ops     = ops;
+            provider->credit_bytes   = bytes;
+            provider->credits_expiry = ABT_get_wtime() + lease_ms / 1000.0;
+        } else {
+            /* providers that predate flow control do not know this RPC;
+             * the handle stays unlimited, and a real error will be
+             * reported by the operation itself */
+            provider->credit_ops     = 0;
+            provider->credit_bytes   = 0;
+            provider->credits_expiry = 1e300;
+        }
+        provider->credits_known = 1;
+    }
+    ABT_cond_broadcast(provider->credit_cond);
+    ABT_mutex_unlock(provider->credit_mutex);
+}
+
+/* takes the credits of a data operation, queueing until earlier operations
+ * give back enough of them */
+static int credit_acquire(bake_provider_handle_t provider, uint64_t size)
+{
+    double t0;
+
+    credit_renew(provider);
+
+    ABT_mutex_lock(provider->credit_mutex);
+    if (out_of_credits(provider, size)) {
+        provider->queued++;
+        t0 = ABT_get_wtime();
+        while (out_of_credits(provider, size))
+            ABT_cond_wait(provider->credit_cond, provider->credit_mutex);
+        provider->queued_time += ABT_get_wtime() - t0;
+    }
+    provider->ops_in_flight++;
+    provider->bytes_in_flight += size;
+    ABT_mutex_unlock(provider->credit_mutex);
+    return BAKE_SUCCESS;
+}
+
+static void credit_release(bake_provider_handle_t provider, uint64_t size)
+{
+    ABT_mutex_lock(provider->credit_mutex);
+    provider->ops_in_flight--;
+    provider->bytes_in_flight -= size;
+    ABT_cond_broadcast(provider->credit_cond);
+    ABT_mutex_unlock(provider->credit_mutex);
+}
+
 int bake_provider_handle_ref_incr(bake_provider_handle_t handle)
 {
     if (handle == BAKE_PROVIDER_HANDLE_NULL) return BAKE_ERR_INVALID_ARG;
@@ -299,6 +564,8 @@ int bake_provider_handle_release(bake_provider_handle_t handle)
     if (handle->refcount == 0) {
         margo_addr_free(handle->client->mid, handle->addr);
         handle->client->num_provider_handles -= 1;
+        ABT_cond_free(&handle->credit_cond);
+        ABT_mutex_free(&handle->credit_mutex);
         free(handle);
     }
     return BAKE_SUCCESS;
@@ -328,6 +595,7 @@ static int bake_eager_write(bake_provider_handle_t provider,
     in.region_offset = region_offset;
     in.size          = buf_size;
     in.buffer        = (char*)buf;
+    in.qos_class     = provider->qos_class;
 
     hret = margo_create(provider->client->mid, provider->addr,
                         provider->client->bake_eager_write_id, &handle);
@@ -339,7 +607,8 @@ static int bake_eager_write(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(eager_write), in.size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -378,10 +647,14 @@ int bake_write(bake_provider_handle_t provider,
     bake_write_out_t out;
     int              ret;
 
+    ret = credit_acquire(provider, buf_size);
+    if (ret != BAKE_SUCCESS) return ret;
+
     if (buf_size <= provider->eager_limit) {
         fprintf(stderr, "Do I get here bake_write\n");
-        return (
-            bake_eager_write(provider, tid, rid, region_offset, buf, buf_size));
+        ret = bake_eager_write(provider, tid, rid, region_offset, buf, buf_size);
+        credit_release(provider, buf_size);
+        return ret;
     }
 
     TIMERS_INITIALIZE("bulk_create", "forward", "end");
@@ -394,6 +667,7 @@ int bake_write(bake_provider_handle_t provider,
     in.bulk_size     = buf_size;
     in.remote_addr_str
         = NULL; /* set remote_addr to NULL to disable proxy write */
+    in.qos_class = provider->qos_class;
 
     hret = margo_bulk_create(provider->client->mid, 1, (void**)(&buf),
                              &buf_size, HG_BULK_READ_ONLY, &in.bulk_handle);
@@ -412,7 +686,8 @@ int bake_write(bake_provider_handle_t provider,
         goto finish;
     }
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(write), in.bulk_size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -433,6 +708,7 @@ finish:
     margo_free_output(handle, &out);
     margo_bulk_free(in.bulk_handle);
     margo_destroy(handle);
+    credit_release(provider, buf_size);
 
     TIMERS_END_STEP(2);
     TIMERS_FINALIZE();
@@ -463,6 +739,10 @@ int bake_proxy_write(bake_provider_handle_t provider,
     in.bulk_offset     = remote_offset;
     in.bulk_size       = size;
     in.remote_addr_str = (char*)remote_addr;
+    in.qos_class       = provider->qos_class;
+
+    ret = credit_acquire(provider, size);
+    if (ret != BAKE_SUCCESS) return ret;
 
     hret = margo_create(provider->client->mid, provider->addr,
                         provider->client->bake_write_id, &handle);
@@ -474,7 +754,8 @@ int bake_proxy_write(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(write), in.bulk_size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -494,6 +775,7 @@ finish:
 
     margo_free_output(handle, &out);
     margo_destroy(handle);
+    credit_release(provider, size);
 
     TIMERS_END_STEP(2);
     TIMERS_FINALIZE();
@@ -526,7 +808,8 @@ int bake_create(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(create), 0);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -583,7 +866,8 @@ int bake_persist(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(persist), in.size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -622,9 +906,10 @@ static int bake_eager_create_write_persist(bake_provider_handle_t provider,
     bake_eager_create_write_persist_out_t out;
     int                                   ret;
 
-    in.bti    = bti;
-    in.buffer = (char*)buf;
-    in.size   = buf_size;
+    in.bti       = bti;
+    in.buffer    = (char*)buf;
+    in.size      = buf_size;
+    in.qos_class = provider->qos_class;
 
     hret = margo_create(provider->client->mid, provider->addr,
                         provider->client->bake_eager_create_write_persist_id,
@@ -636,7 +921,8 @@ static int bake_eager_create_write_persist(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(eager_create_write_persist), in.size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -678,9 +964,15 @@ int bake_create_write_persist(bake_provider_handle_t provider,
     bake_create_write_persist_out_t out;
     int                             ret;
 
-    if (buf_size <= provider->eager_limit)
-        return (
-            bake_eager_create_write_persist(provider, bti, buf, buf_size, rid));
+    ret = credit_acquire(provider, buf_size);
+    if (ret != BAKE_SUCCESS) return ret;
+
+    if (buf_size <= provider->eager_limit) {
+        ret = bake_eager_create_write_persist(provider, bti, buf, buf_size,
+                                              rid);
+        credit_release(provider, buf_size);
+        return ret;
+    }
 
     TIMERS_INITIALIZE("bulk_create", "forward", "end");
 
@@ -690,6 +982,7 @@ int bake_create_write_persist(bake_provider_handle_t provider,
     in.region_size = buf_size;
     in.remote_addr_str
         = NULL; /* set remote_addr to NULL to disable proxy write */
+    in.qos_class = provider->qos_class;
 
     hret = margo_bulk_create(provider->client->mid, 1, (void**)(&buf),
                              &buf_size, HG_BULK_READ_ONLY, &in.bulk_handle);
@@ -709,7 +1002,8 @@ int bake_create_write_persist(bake_provider_handle_t provider,
         goto finish;
     }
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(create_write_persist), in.bulk_size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -732,6 +1026,7 @@ finish:
     margo_free_output(handle, &out);
     margo_bulk_free(in.bulk_handle);
     margo_destroy(handle);
+    credit_release(provider, buf_size);
     TIMERS_END_STEP(2);
     TIMERS_FINALIZE();
     return (ret);
@@ -757,6 +1052,10 @@ int bake_create_write_persist_proxy(bake_provider_handle_t provider,
     in.bulk_offset     = remote_offset;
     in.bulk_size       = size;
     in.remote_addr_str = (char*)remote_addr;
+    in.qos_class       = provider->qos_class;
+
+    ret = credit_acquire(provider, size);
+    if (ret != BAKE_SUCCESS) return ret;
 
     hret
         = margo_create(provider->client->mid, provider->addr,
@@ -769,7 +1068,8 @@ int bake_create_write_persist_proxy(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(create_write_persist), in.bulk_size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -789,6 +1089,7 @@ int bake_create_write_persist_proxy(bake_provider_handle_t provider,
 finish:
     margo_free_output(handle, &out);
     margo_destroy(handle);
+    credit_release(provider, size);
 
     TIMERS_END_STEP(2);
     TIMERS_FINALIZE();
@@ -821,7 +1122,8 @@ int bake_get_size(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(get_size), 0);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -905,7 +1207,8 @@ int bake_get_data(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(get_data), 0);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -966,7 +1269,8 @@ int bake_migrate_region(bake_provider_handle_t source,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(source->provider_id, handle, &in);
+    hret = forward_traced(source, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(migrate_region), in.region_size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -1022,7 +1326,8 @@ int bake_migrate_target(bake_provider_handle_t source,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(source->provider_id, handle, &in);
+    hret = forward_traced(source, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(migrate_target), 0);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -1067,6 +1372,42 @@ int bake_noop(bake_provider_handle_t provider)
     return BAKE_SUCCESS;
 }
 
+int bake_get_stats(bake_provider_handle_t provider, char** stats)
+{
+    hg_return_t          hret;
+    hg_handle_t          handle = HG_HANDLE_NULL;
+    bake_get_stats_out_t out;
+    int                  ret;
+
+    *stats = NULL;
+
+    hret = margo_create(provider->client->mid, provider->addr,
+                        provider->client->bake_get_stats_id, &handle);
+    if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+
+    hret = margo_provider_forward(provider->provider_id, handle, NULL);
+    if (hret != HG_SUCCESS) {
+        margo_destroy(handle);
+        return BAKE_ERR_MERCURY;
+    }
+
+    hret = margo_get_output(handle, &out);
+    if (hret != HG_SUCCESS) {
+        margo_destroy(handle);
+        return BAKE_ERR_MERCURY;
+    }
+
+    ret = out.ret;
+    if (ret == BAKE_SUCCESS) {
+        *stats = strdup(out.stats ? out.stats : "");
+        if (!*stats) ret = BAKE_ERR_ALLOCATION;
+    }
+
+    margo_free_output(handle, &out);
+    margo_destroy(handle);
+    return ret;
+}
+
 static int bake_eager_read(bake_provider_handle_t provider,
                            bake_target_id_t       bti,
                            bake_region_id_t       rid,
@@ -1088,6 +1429,7 @@ static int bake_eager_read(bake_provider_handle_t provider,
     in.rid           = rid;
     in.region_offset = region_offset;
     in.size          = buf_size;
+    in.qos_class     = provider->qos_class;
 
     hret = margo_create(provider->client->mid, provider->addr,
                         provider->client->bake_eager_read_id, &handle);
@@ -1099,7 +1441,8 @@ static int bake_eager_read(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(eager_read), in.size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -1145,10 +1488,15 @@ int bake_read(bake_provider_handle_t provider,
     bake_read_out_t out;
     int             ret;
 
+    ret = credit_acquire(provider, buf_size);
+    if (ret != BAKE_SUCCESS) return ret;
+
     if (buf_size <= provider->eager_limit) {
         fprintf(stderr, "Do I get here bake_read\n");
-        return (bake_eager_read(provider, bti, rid, region_offset, buf,
-                                buf_size, bytes_read));
+        ret = bake_eager_read(provider, bti, rid, region_offset, buf, buf_size,
+                              bytes_read);
+        credit_release(provider, buf_size);
+        return ret;
     }
 
     TIMERS_INITIALIZE("bulk_create", "forward", "end");
@@ -1160,6 +1508,7 @@ int bake_read(bake_provider_handle_t provider,
     in.bulk_size     = buf_size;
     in.remote_addr_str
         = NULL; /* set remote_addr to NULL to disable proxy read */
+    in.qos_class = provider->qos_class;
 
     hret = margo_bulk_create(provider->client->mid, 1, (void**)(&buf),
                              &buf_size, HG_BULK_WRITE_ONLY, &in.bulk_handle);
@@ -1178,7 +1527,8 @@ int bake_read(bake_provider_handle_t provider,
         goto finish;
     }
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(read), in.bulk_size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -1200,6 +1550,7 @@ finish:
     margo_free_output(handle, &out);
     margo_bulk_free(in.bulk_handle);
     margo_destroy(handle);
+    credit_release(provider, buf_size);
     TIMERS_END_STEP(2);
     TIMERS_FINALIZE();
     return (ret);
@@ -1229,6 +1580,10 @@ int bake_proxy_read(bake_provider_handle_t provider,
     in.bulk_offset     = remote_offset;
     in.bulk_size       = size;
     in.remote_addr_str = (char*)remote_addr;
+    in.qos_class       = provider->qos_class;
+
+    ret = credit_acquire(provider, size);
+    if (ret != BAKE_SUCCESS) return ret;
 
     hret = margo_create(provider->client->mid, provider->addr,
                         provider->client->bake_read_id, &handle);
@@ -1240,7 +1595,8 @@ int bake_proxy_read(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(read), in.bulk_size);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -1261,6 +1617,7 @@ finish:
 
     margo_free_output(handle, &out);
     margo_destroy(handle);
+    credit_release(provider, size);
 
     TIMERS_END_STEP(2);
     TIMERS_FINALIZE();
@@ -1291,7 +1648,8 @@ int bake_remove(bake_provider_handle_t provider,
 
     TIMERS_END_STEP(0);
 
-    hret = margo_provider_forward(provider->provider_id, handle, &in);
+    hret = forward_traced(provider, handle, &in, &in.req_id,
+                          BAKE_METRIC_RPC(remove), 0);
     if (hret != HG_SUCCESS) {
         ret = BAKE_ERR_MERCURY;
         goto finish;
@@ -0,0 +1,40 @@
+#!/bin/bash
+#
+# Runs bake-benchmark with the given configuration once for each number of
+# server handler execution streams ("rpc-thread-count") from 1 to 64, and
+# prints the throughput of each throughput-reporting benchmark of the
+# configuration (e.g. create-throughput).
+#
+# usage: bake-create-scaling.sh <config.json> [mpirun arguments...]
+#
+# The bake-benchmark and mpirun programs can be overridden with the
+# BAKE_BENCHMARK and MPIRUN environment variables.
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <config.json> [mpirun arguments...]"
+    exit 1
+fi
+
+CONFIG=$1
+shift
+BAKE_BENCHMARK=${BAKE_BENCHMARK:-bake-benchmark}
+MPIRUN=${MPIRUN:-mpirun}
+
+TMPCONFIG=$(mktemp --suffix=.json)
+trap "rm -f $TMPCONFIG" EXIT
+
+printf "%-10s %s\n" "xstreams" "throughput(op/s)"
+for XSTREAMS in 1 2 4 8 16 32 64
+do
+    sed -E "s/(\"rpc-thread-count\"[[:space:]]*:[[:space:]]*)[0-9]+/\1${XSTREAMS}/" \
+        $CONFIG > $TMPCONFIG
+    OUTPUT=`$MPIRUN "$@" $BAKE_BENCHMARK $TMPCONFIG`
+    if [ $? -ne 0 ]; then
+        echo "$OUTPUT"
+        exit 1
+    fi
+    THROUGHPUT=`echo "$OUTPUT" | grep "Throughput(op/s)" | awk '{print $NF}' | xargs`
+    printf "%-10s %s\n" $XSTREAMS "$THROUGHPUT"
+done
+
+exit 0
@@ -0,0 +1,363 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <abt.h>
+#include "bake-elastic.h"
+#include "bake-xstream.h"
+
+struct bake_elastic_pool {
+    margo_instance_id mid;
+    ABT_pool          pool;
+    ABT_thread        controller;
+    ABT_mutex         mutex;
+    ABT_cond          cond; /* wakes up the controller */
+    int               stopping;
+
+    unsigned min_xstreams;
+    unsigned max_xstreams;
+    unsigned period_ms;
+    unsigned queue_per_xstream;
+    unsigned wait_us;
+    unsigned idle_ms;
+
+    /* only modified by the controller, and by the finalize callback once
+     * the controller has stopped */
+    bake_xstream_t xstreams[BAKE_ELASTIC_MAX_XSTREAMS];
+    unsigned       num_xstreams;
+
+    int    probe_pending;
+    double probe_posted;
+    double idle_since; /* 0 while the pool is busy */
+
+    unsigned peak_xstreams;
+    uint64_t grows;
+    uint64_t shrinks;
+    size_t   last_queue;
+    size_t   peak_queue;
+    uint64_t probes;
+    double   last_wait;
+    double   total_wait;
+    double   max_wait;
+
+    struct bake_elastic_pool* next;
+};
+
+static pthread_mutex_t           g_epools_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct bake_elastic_pool* g_epools       = NULL;
+
+bake_elastic_pool_t bake_elastic_pool_find(ABT_pool pool)
+{
+    struct bake_elastic_pool* e;
+
+    pthread_mutex_lock(&g_epools_mutex);
+    for (e = g_epools; e; e = e->next)
+        if (e->pool == pool) break;
+    pthread_mutex_unlock(&g_epools_mutex);
+    return e;
+}
+
+ABT_pool bake_elastic_pool_get_abt_pool(bake_elastic_pool_t epool)
+{
+    return epool->pool;
+}
+
+/* measures how long a ULT waits in the pool before it runs */
+static void probe_ult(void* arg)
+{
+    struct bake_elastic_pool* e = arg;
+    double                    wait;
+
+    ABT_mutex_lock(e->mutex);
+    wait             = ABT_get_wtime() - e->probe_posted;
+    e->probe_pending = 0;
+    e->last_wait     = wait;
+    e->total_wait += wait;
+    e->probes++;
+    if (wait > e->max_wait) e->max_wait = wait;
+    ABT_mutex_unlock(e->mutex);
+}
+
+static int add_xstream(struct bake_elastic_pool* e)
+{
+    bake_xstream_t xstream;
+    int            ret;
+
+    /* the streams sleep on the pool while it is empty */
+    ret = bake_xstream_create(e->pool, &xstream);
+    if (ret != BAKE_SUCCESS) return ret;
+    ABT_mutex_lock(e->mutex);
+    e->xstreams[e->num_xstreams++] = xstream;
+    if (e->num_xstreams > e->peak_xstreams)
+        e->peak_xstreams = e->num_xstreams;
+    ABT_mutex_unlock(e->mutex);
+    return BAKE_SUCCESS;
+}
+
+/* joins the most recently added stream once it is done with the ULT it is
+ * running, leaving the rest of the pool to the other streams, or once the
+ * pool is empty if drain is set; called without the mutex held since that
+ * ULT may be a probe */
+static void retire_xstream(struct bake_elastic_pool* e, int drain)
+{
+    bake_xstream_t xstream;
+
+    ABT_mutex_lock(e->mutex);
+    xstream = e->xstreams[--e->num_xstreams];
+    ABT_mutex_unlock(e->mutex);
+    bake_xstream_stop(xstream, drain);
+    bake_xstream_join(xstream);
+}
+
+/* one sampling round of the controller */
+static void adjust(struct bake_elastic_pool* e)
+{
+    size_t   queue = 0;
+    double   now   = ABT_get_wtime();
+    double   wait;
+    unsigned n, target;
+    int      post_probe;
+
+    ABT_pool_get_size(e->pool, &queue);
+
+    ABT_mutex_lock(e->mutex);
+    n    = e->num_xstreams;
+    wait = e->probe_pending ? now - e->probe_posted : e->last_wait;
+    e->last_queue = queue;
+    if (queue > e->peak_queue) e->peak_queue = queue;
+
+    target = n;
+    if (queue > (size_t)e->queue_per_xstream * n
+        || (e->wait_us && wait * 1e6 > e->wait_us)) {
+        /* enough streams to bring the queue under its threshold at once */
+        target = (queue + e->queue_per_xstream - 1) / e->queue_per_xstream;
+        if (target <= n) target = n + 1;
+        e->idle_since = 0;
+    } else if (queue == 0 && !e->probe_pending) {
+        if (e->idle_since == 0)
+            e->idle_since = now;
+        else if (n > e->min_xstreams
+                 && (now - e->idle_since) * 1e3 >= e->idle_ms) {
+            /* one stream per idle period */
+            target        = n - 1;
+            e->idle_since = now;
+        }
+    } else
+        e->idle_since = 0;
+    if (target > e->max_xstreams) target = e->max_xstreams;
+    if (target < e->min_xstreams) target = e->min_xstreams;
+    if (target > n) e->grows++;
+    if (target < n) e->shrinks++;
+    ABT_mutex_unlock(e->mutex);
+
+    while (n < target && add_xstream(e) == BAKE_SUCCESS) n++;
+    while (n > target) {
+        retire_xstream(e, 0);
+        n--;
+    }
+
+    /* a probe can only run if some stream serves the pool */
+    ABT_mutex_lock(e->mutex);
+    post_probe = n > 0 && !e->probe_pending;
+    if (post_probe) {
+        e->probe_pending = 1;
+        e->probe_posted  = ABT_get_wtime();
+    }
+    ABT_mutex_unlock(e->mutex);
+    if (post_probe
+        && ABT_thread_create(e->pool, probe_ult, e, ABT_THREAD_ATTR_NULL, NULL)
+               != ABT_SUCCESS) {
+        ABT_mutex_lock(e->mutex);
+        e->probe_pending = 0;
+        ABT_mutex_unlock(e->mutex);
+    }
+}
+
+static void controller_ult(void* arg)
+{
+    struct bake_elastic_pool* e = arg;
+    struct timespec           deadline;
+
+    ABT_mutex_lock(e->mutex);
+    while (!e->stopping) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += e->period_ms / 1000;
+        deadline.tv_nsec += (e->period_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        ABT_cond_timedwait(e->cond, e->mutex, &deadline);
+        if (e->stopping) break;
+        ABT_mutex_unlock(e->mutex);
+        adjust(e);
+        ABT_mutex_lock(e->mutex);
+    }
+    ABT_mutex_unlock(e->mutex);
+}
+
+static void finalize_cb(void* arg)
+{
+    struct bake_elastic_pool*  e = arg;
+    struct bake_elastic_pool** p;
+    size_t                     left = 0;
+
+    ABT_mutex_lock(e->mutex);
+    e->stopping = 1;
+    ABT_cond_signal(e->cond);
+    ABT_mutex_unlock(e->mutex);
+    ABT_thread_join(e->controller);
+    ABT_thread_free(&e->controller);
+
+    /* run whatever is left in the pool, such as a probe, before freeing it */
+    ABT_pool_get_total_size(e->pool, &left);
+    if (left && e->num_xstreams == 0) add_xstream(e);
+    while (e->num_xstreams) retire_xstream(e, 1);
+    ABT_pool_free(&e->pool);
+
+    pthread_mutex_lock(&g_epools_mutex);
+    for (p = &g_epools; *p; p = &(*p)->next) {
+        if (*p == e) {
+            *p = e->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_epools_mutex);
+
+    ABT_cond_free(&e->cond);
+    ABT_mutex_free(&e->mutex);
+    free(e);
+}
+
+int bake_elastic_pool_create(margo_instance_id    mid,
+                             unsigned             min_xstreams,
+                             unsigned             max_xstreams,
+                             bake_elastic_pool_t* epool)
+{
+    struct bake_elastic_pool* e;
+    ABT_pool                  progress_pool;
+    unsigned                  i;
+    int                       ret;
+
+    if (max_xstreams == 0 || min_xstreams > max_xstreams
+        || max_xstreams > BAKE_ELASTIC_MAX_XSTREAMS)
+        return BAKE_ERR_INVALID_ARG;
+
+    e = calloc(1, sizeof(*e));
+    if (!e) return BAKE_ERR_ALLOCATION;
+    e->mid               = mid;
+    e->min_xstreams      = min_xstreams;
+    e->max_xstreams      = max_xstreams;
+    e->period_ms         = BAKE_ELASTIC_DEFAULT_PERIOD_MS;
+    e->queue_per_xstream = BAKE_ELASTIC_DEFAULT_QUEUE;
+    e->wait_us           = BAKE_ELASTIC_DEFAULT_WAIT_US;
+    e->idle_ms           = BAKE_ELASTIC_DEFAULT_IDLE_MS;
+
+    /* not freed with its schedulers, since it may have none at times */
+    ret = ABT_pool_create_basic(ABT_POOL_FIFO_WAIT, ABT_POOL_ACCESS_MPMC,
+                                ABT_FALSE, &e->pool);
+    if (ret != ABT_SUCCESS) {
+        free(e);
+        return BAKE_ERR_ARGOBOTS;
+    }
+    ABT_mutex_create(&e->mutex);
+    ABT_cond_create(&e->cond);
+
+    for (i = 0; i < min_xstreams; i++) {
+        ret = add_xstream(e);
+        if (ret != BAKE_SUCCESS) goto error;
+    }
+
+    /* the controller runs next to the progress loop, so that it is not
+     * delayed by the handlers it is scaling for */
+    margo_get_progress_pool(mid, &progress_pool);
+    ret = ABT_thread_create(progress_pool, controller_ult, e,
+                            ABT_THREAD_ATTR_NULL, &e->controller);
+    if (ret != ABT_SUCCESS) {
+        ret = BAKE_ERR_ARGOBOTS;
+        goto error;
+    }
+
+    pthread_mutex_lock(&g_epools_mutex);
+    e->next  = g_epools;
+    g_epools = e;
+    pthread_mutex_unlock(&g_epools_mutex);
+
+    margo_push_finalize_callback(mid, finalize_cb, e);
+    *epool = e;
+    return BAKE_SUCCESS;
+
+error:
+    while (e->num_xstreams) retire_xstream(e, 1);
+    ABT_pool_free(&e->pool);
+    ABT_cond_free(&e->cond);
+    ABT_mutex_free(&e->mutex);
+    free(e);
+    return ret;
+}
+
+int bake_elastic_pool_set_conf(bake_elastic_pool_t e,
+                               const char*         key,
+                               const char*         value)
+{
+    unsigned u;
+    int      ret = BAKE_SUCCESS;
+
+    if (sscanf(value, "%u", &u) != 1) return BAKE_ERR_INVALID_ARG;
+
+    /* the controller picks new bounds up in its next round */
+    ABT_mutex_lock(e->mutex);
+    if (strcmp(key, "elastic_min_xstreams") == 0) {
+        if (u <= e->max_xstreams)
+            e->min_xstreams = u;
+        else
+            ret = BAKE_ERR_INVALID_ARG;
+    } else if (strcmp(key, "elastic_max_xstreams") == 0) {
+        if (u >= e->min_xstreams && u > 0 && u <= BAKE_ELASTIC_MAX_XSTREAMS)
+            e->max_xstreams = u;
+        else
+            ret = BAKE_ERR_INVALID_ARG;
+    } else if (strcmp(key, "elastic_period_ms") == 0 && u > 0) {
+        e->period_ms = u;
+    } else if (strcmp(key, "elastic_queue_per_xstream") == 0 && u > 0) {
+        e->queue_per_xstream = u;
+    } else if (strcmp(key, "elastic_wait_us") == 0) {
+        e->wait_us = u;
+    } else if (strcmp(key, "elastic_idle_ms") == 0) {
+        e->idle_ms = u;
+    } else
+        ret = BAKE_ERR_INVALID_ARG;
+    ABT_mutex_unlock(e->mutex);
+    return ret;
+}
+
+void bake_elastic_pool_print_stats(bake_elastic_pool_t e, FILE* out)
+{
+    ABT_mutex_lock(e->mutex);
+    fprintf(out, "elastic_min_xstreams = %u\n", e->min_xstreams);
+    fprintf(out, "elastic_max_xstreams = %u\n", e->max_xstreams);
+    fprintf(out, "elastic_period_ms = %u\n", e->period_ms);
+    fprintf(out, "elastic_queue_per_xstream = %u\n", e->queue_per_xstream);
+    fprintf(out, "elastic_wait_us = %u\n", e->wait_us);
+    fprintf(out, "elastic_idle_ms = %u\n", e->idle_ms);
+    fprintf(out, "elastic.xstreams = %u\n", e->num_xstreams);
+    fprintf(out, "elastic.peak_xstreams = %u\n", e->peak_xstreams);
+    fprintf(out, "elastic.grows = %" PRIu64 "\n", e->grows);
+    fprintf(out, "elastic.shrinks = %" PRIu64 "\n", e->shrinks);
+    fprintf(out, "elastic.queue = %zu\n", e->last_queue);
+    fprintf(out, "elastic.peak_queue = %zu\n", e->peak_queue);
+    fprintf(out, "elastic.wait = %f\n", e->last_wait);
+    fprintf(out, "elastic.mean_wait = %f\n",
+            e->probes ? e->total_wait / e->probes : 0.0);
+    fprintf(out, "elastic.max_wait = %f\n", e->max_wait);
+    ABT_mutex_unlock(e->mutex);
+}
@@ -0,0 +1,52 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_ELASTIC_H
+#define __BAKE_ELASTIC_H
+
+#include <stdio.h>
+#include "bake-server.h"
+
+/* bake-elastic
+ *
+ * Elastic pool of RPC handler ULTs.  The pool is served by a set of
+ * execution streams that sleep when it is empty.  A controller ULT running
+ * in margo's progress pool samples the number of ULTs waiting in the pool
+ * and the time a probe ULT spends waiting before it runs, and adds
+ * execution streams (up to a maximum) as soon as either grows beyond its
+ * threshold, or retires one (down to a minimum) once the pool has stayed
+ * empty for a while.  The pool and its execution streams are torn down when
+ * margo is finalized.
+ */
+
+#define BAKE_ELASTIC_MAX_XSTREAMS         256
+#define BAKE_ELASTIC_DEFAULT_PERIOD_MS    1
+#define BAKE_ELASTIC_DEFAULT_QUEUE        4
+#define BAKE_ELASTIC_DEFAULT_WAIT_US      500
+#define BAKE_ELASTIC_DEFAULT_IDLE_MS      1000
+
+/**
+ * Returns the elastic pool whose Argobots pool is the given one, or NULL.
+ */
+bake_elastic_pool_t bake_elastic_pool_find(ABT_pool pool);
+
+/**
+ * Sets a configuration parameter.  Recognized keys are
+ * "elastic_min_xstreams" and "elastic_max_xstreams", "elastic_period_ms"
+ * (sampling period), "elastic_queue_per_xstream" (waiting ULTs per
+ * execution stream above which one is added), "elastic_wait_us" (probe
+ * waiting time above which one is added, 0 to only watch the queue) and
+ * "elastic_idle_ms" (time the pool must stay empty before one is retired).
+ */
+int bake_elastic_pool_set_conf(bake_elastic_pool_t epool,
+                               const char*         key,
+                               const char*         value);
+
+/**
+ * Prints settings and counters, one "key = value" pair per line.
+ */
+void bake_elastic_pool_print_stats(bake_elastic_pool_t epool, FILE* out);
+
+#endif
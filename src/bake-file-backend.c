@@ -11,13 +11,16 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-#include <abt-io.h>
 #include "bake-config.h"
 #include "bake.h"
 #include "bake-rpc.h"
 #include "bake-server.h"
 #include "bake-provider.h"
 #include "bake-backend.h"
+#include "bake-buffer-arena.h"
+#include "bake-block-cache.h"
+#include "bake-io-engine.h"
+#include "bake-numa.h"
 
 /* bake-file-backend
  *
@@ -43,9 +46,12 @@ typedef struct {
 /* definition of internal BAKE region_id_t identifier for file back end */
 typedef struct {
     off_t  log_entry_offset;
-    size_t log_entry_size;
+    size_t region_size; /* as created; the log entry is rounded up from it */
 } file_region_id_t;
 
+/* size of the log entry of a region, rounded up for directio alignment */
+#define LOG_ENTRY_SIZE(frid) BAKE_ALIGN_UP((frid)->region_size)
+
 typedef struct {
     char data[1];
 } region_content_t;
@@ -56,10 +62,15 @@ typedef struct {
     off_t           log_offset; /* next available unused offset in log */
     ABT_mutex log_offset_mutex; /* protects the above during concurrent region
                                    creation */
-    abt_io_instance_id abtioi;  /* abt-io instance used by this provider */
+    bake_io_engine_t io;        /* I/O engine shared by targets on this device */
     bake_root_t*       file_root;
     char*              root;
     char*              filename;
+    bake_buffer_arena_t arena; /* bounce buffers for the eager paths */
+    int numa_node;  /* node of the bounce buffers and I/O threads, or -1 */
+    int huge_pages; /* back the bounce buffers with huge pages */
+    bake_block_cache_t  cache; /* optional DRAM cache of log blocks */
+    void* zero_block; /* aligned block of zeros used to extend the log */
 } bake_file_entry_t;
 
 typedef struct xfer_args {
@@ -89,6 +100,8 @@ typedef struct xfer_args {
     ABT_mutex    mutex;       /* protect shared fields in this struct */
     ABT_eventual eventual;    /* signal when complete */
     int          op_flag;     /* read or write */
+
+    bake_trace_ctx_t* trace; /* request on whose behalf the ULTs work */
 } xfer_args;
 
 static int transfer_data(bake_file_entry_t* entry,
@@ -103,6 +116,13 @@ static int transfer_data(bake_file_entry_t* entry,
 
 static void xfer_ult(void* _args);
 
+/* reads from the log, bypassing the block cache; used to fill it */
+static ssize_t log_pread(void* arg, void* buf, size_t size, off_t offset)
+{
+    bake_file_entry_t* entry = (bake_file_entry_t*)arg;
+    return bake_io_pread(entry->io, entry->log_fd, buf, size, offset);
+}
+
 /* TODO: reorganize this later into the "admin library" model */
 int bake_file_makepool(const char* file_name,
                        size_t      file_size,
@@ -119,7 +139,7 @@ int bake_file_makepool(const char* file_name,
         if (save_errno == EINVAL)
             fprintf(stderr,
                     "... does your file system support O_DIRECT? tmpfs does "
-                    "not.\n");
+                    "not (the mmap: backend does not need it).\n");
         return (BAKE_ERR_IO);
     }
 
@@ -155,6 +175,7 @@ static int bake_file_backend_initialize(bake_provider_t    provider,
     int                ret       = BAKE_SUCCESS;
     bake_file_entry_t* new_entry = calloc(1, sizeof(*new_entry));
     new_entry->provider          = provider;
+    new_entry->numa_node         = -1;
     new_entry->log_fd            = -1;
     const char* tmp;
     ptrdiff_t   d;
@@ -177,16 +198,17 @@ static int bake_file_backend_initialize(bake_provider_t    provider,
     d                   = tmp - path;
     new_entry->root     = strndup(path, d);
 
-    /* initialize an abt-io instance just for this target */
-    /* TODO: make number of backing threads tunable */
-    new_entry->abtioi = abt_io_init(16);
-    if (!new_entry->abtioi) {
+    /* attach to the I/O engine of the device holding this target; its
+     * threads are tuned with the io_* configuration keys
+     */
+    new_entry->io = bake_io_engine_acquire(path);
+    if (!new_entry->io) {
         ret = BAKE_ERR_IO;
         goto error_cleanup;
     }
 
     new_entry->log_fd
-        = abt_io_open(new_entry->abtioi, path, O_RDWR | O_DIRECT, 0);
+        = bake_io_open(new_entry->io, path, O_RDWR | O_DIRECT, 0);
     if (new_entry->log_fd < 0) {
         perror("open");
         ret = BAKE_ERR_IO;
@@ -211,7 +233,7 @@ static int bake_file_backend_initialize(bake_provider_t    provider,
         ret = BAKE_ERR_IO;
         goto error_cleanup;
     }
-    ret = abt_io_pread(new_entry->abtioi, new_entry->log_fd,
+    ret = bake_io_pread(new_entry->io, new_entry->log_fd,
                        new_entry->file_root, BAKE_ALIGNMENT, 0);
     if (ret < 0) {
         ret = BAKE_ERR_IO;
@@ -219,6 +241,33 @@ static int bake_file_backend_initialize(bake_provider_t    provider,
     }
     *target = new_entry->file_root->pool_id;
 
+    /* bounce buffers used by read_raw/write_raw */
+    new_entry->arena = bake_buffer_arena_create(provider, BAKE_ALIGNMENT);
+    if (!new_entry->arena) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto error_cleanup;
+    }
+
+    /* DRAM cache of log blocks; disabled until given a size with
+     * bake_target_set_conf(..., "cache_size", ...)
+     */
+    new_entry->cache = bake_block_cache_create(provider, BAKE_ALIGNMENT,
+                                               log_pread, new_entry);
+    if (!new_entry->cache) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto error_cleanup;
+    }
+
+    /* block written by bake_file_create() when extending the log */
+    ret = posix_memalign(&new_entry->zero_block, BAKE_ALIGNMENT,
+                         BAKE_ALIGNMENT);
+    if (ret != 0) {
+        new_entry->zero_block = NULL;
+        ret                   = BAKE_ERR_ALLOCATION;
+        goto error_cleanup;
+    }
+    memset(new_entry->zero_block, 0, BAKE_ALIGNMENT);
+
     if (uuid_is_null(target->id)) {
         fprintf(stderr, "Error: BAKE pool %s is not properly formatted\n",
                 path);
@@ -236,8 +285,11 @@ static int bake_file_backend_initialize(bake_provider_t    provider,
 error_cleanup:
     if (new_entry) {
         if (new_entry->file_root) free(new_entry->file_root);
+        if (new_entry->zero_block) free(new_entry->zero_block);
+        if (new_entry->arena) bake_buffer_arena_destroy(new_entry->arena);
+        if (new_entry->cache) bake_block_cache_destroy(new_entry->cache);
         if (new_entry->log_fd > -1) close(new_entry->log_fd);
-        if (new_entry->abtioi) abt_io_finalize(new_entry->abtioi);
+        if (new_entry->io) bake_io_engine_release(new_entry->io);
         if (new_entry->filename) free(new_entry->filename);
         if (new_entry->root) free(new_entry->root);
         free(new_entry);
@@ -250,8 +302,11 @@ static int bake_file_backend_finalize(backend_context_t context)
 {
     bake_file_entry_t* entry = (bake_file_entry_t*)context;
     free(entry->file_root);
+    free(entry->zero_block);
+    bake_buffer_arena_destroy(entry->arena);
+    bake_block_cache_destroy(entry->cache);
     close(entry->log_fd);
-    abt_io_finalize(entry->abtioi);
+    bake_io_engine_release(entry->io);
     free(entry->filename);
     free(entry->root);
     free(entry);
@@ -265,15 +320,14 @@ bake_file_create(backend_context_t context, size_t size, bake_region_id_t* rid)
 {
     bake_file_entry_t* entry = (bake_file_entry_t*)context;
     int                ret;
-    void*              zero_block;
     file_region_id_t*  frid = (file_region_id_t*)rid->data;
 
     assert(sizeof(file_region_id_t) <= BAKE_REGION_ID_DATA_SIZE);
 
+    frid->region_size = size;
     /* round up size for directio alignment */
-    size = BAKE_ALIGN_UP(size);
+    size = LOG_ENTRY_SIZE(frid);
 
-    frid->log_entry_size = size;
     ABT_mutex_lock(entry->log_offset_mutex);
     frid->log_entry_offset = entry->log_offset;
     entry->log_offset += size;
@@ -292,23 +346,16 @@ bake_file_create(backend_context_t context, size_t size, bake_region_id_t* rid)
      *
      * We write a full block to make sure it will work with O_DIRECT.
      */
-    ret = posix_memalign(&zero_block, BAKE_ALIGNMENT, BAKE_ALIGNMENT);
+    ret = bake_io_pwrite(entry->io, entry->log_fd, entry->zero_block,
+                        BAKE_ALIGNMENT,
+                        frid->log_entry_offset + size - BAKE_ALIGNMENT);
+    if (ret != BAKE_ALIGNMENT) return (BAKE_ERR_IO);
+    bake_block_cache_write(entry->cache, entry->zero_block, BAKE_ALIGNMENT,
+                           frid->log_entry_offset + size - BAKE_ALIGNMENT);
+
+    ret = bake_io_fdatasync(entry->io, entry->log_fd);
     if (ret != 0) return (BAKE_ERR_IO);
 
-    ret = abt_io_pwrite(entry->abtioi, entry->log_fd, zero_block,
-                        BAKE_ALIGNMENT, entry->log_offset - BAKE_ALIGNMENT);
-    if (ret != BAKE_ALIGNMENT) {
-        free(zero_block);
-        return (BAKE_ERR_IO);
-    }
-
-    ret = abt_io_fdatasync(entry->abtioi, entry->log_fd);
-    if (ret != 0) {
-        free(zero_block);
-        return (BAKE_ERR_IO);
-    }
-
-    free(zero_block);
     return (BAKE_SUCCESS);
 }
 
@@ -344,26 +391,30 @@ static int bake_file_write_raw(backend_context_t context,
         return (BAKE_ERR_OP_UNSUPPORTED);
     }
 
-    if (size + offset > frid->log_entry_size) {
+    if (size + offset > LOG_ENTRY_SIZE(frid)) {
         /* caller is attempting to write more data into this region than was
          * allocated for at creation time
          */
         return BAKE_ERR_OUT_OF_BOUNDS;
     }
 
-    ret = posix_memalign(&bounce_buffer, BAKE_ALIGNMENT, BAKE_ALIGN_UP(size));
-    if (ret != 0) return (BAKE_ERR_IO);
+    bounce_buffer = bake_buffer_arena_alloc(entry->arena, BAKE_ALIGN_UP(size));
+    if (!bounce_buffer) return (BAKE_ERR_ALLOCATION);
 
     memcpy(bounce_buffer, data, size);
+    /* don't write stale arena contents into the tail of the last block */
+    memset((char*)bounce_buffer + size, 0, BAKE_ALIGN_UP(size) - size);
 
-    ret = abt_io_pwrite(entry->abtioi, entry->log_fd, bounce_buffer,
+    ret = bake_io_pwrite(entry->io, entry->log_fd, bounce_buffer,
                         BAKE_ALIGN_UP(size), frid->log_entry_offset);
-    if (ret != BAKE_ALIGNMENT) {
-        free(bounce_buffer);
+    if (ret != BAKE_ALIGN_UP(size)) {
+        bake_buffer_arena_free(bounce_buffer);
         return (BAKE_ERR_IO);
     }
+    bake_block_cache_write(entry->cache, bounce_buffer, BAKE_ALIGN_UP(size),
+                           frid->log_entry_offset);
 
-    free(bounce_buffer);
+    bake_buffer_arena_free(bounce_buffer);
 
     return (BAKE_SUCCESS);
 }
@@ -393,7 +444,7 @@ static int bake_file_write_bulk(backend_context_t context,
         return (BAKE_ERR_OP_UNSUPPORTED);
     }
 
-    ret = transfer_data(entry, frid->log_entry_offset, frid->log_entry_size,
+    ret = transfer_data(entry, frid->log_entry_offset, LOG_ENTRY_SIZE(frid),
                         region_offset, bulk, bulk_offset, size, source,
                         TRANSFER_DATA_WRITE);
 
@@ -401,12 +452,12 @@ static int bake_file_write_bulk(backend_context_t context,
 }
 
 /* utility function used to free bounce buffers created by
- * bake_file_read_raw().  It is like a normal fre() except that it must
- * round down to block alignment to find the correct pointer to free.
+ * bake_file_read_raw().  It returns the buffer to the arena, but must first
+ * round down to block alignment to find the pointer the arena handed out.
  */
 static void bake_file_read_raw_free(void* ptr)
 {
-    free((void*)(BAKE_ALIGN_DOWN(ptr)));
+    bake_buffer_arena_free((void*)(BAKE_ALIGN_DOWN(ptr)));
     return;
 }
 
@@ -434,7 +485,7 @@ static int bake_file_read_raw(backend_context_t context,
     off_t              natural_offset_start, natural_offset_end;
     off_t              log_offset_start, log_offset_end;
 
-    if (size + offset > frid->log_entry_size) {
+    if (size + offset > LOG_ENTRY_SIZE(frid)) {
         /* caller is attempting to read more data from this region than was
          * allocated for at creation time
          */
@@ -448,16 +499,17 @@ static int bake_file_read_raw(backend_context_t context,
     log_offset_start = BAKE_ALIGN_DOWN(natural_offset_start);
     log_offset_end   = BAKE_ALIGN_UP(natural_offset_end);
 
-    /* create aligned bounce buffer large enough to hold log extent */
-    ret = posix_memalign(&bounce_buffer, BAKE_ALIGNMENT,
-                         log_offset_end - log_offset_start);
-    if (ret != 0) return (BAKE_ERR_IO);
-
-    /* read extent from log */
-    ret = abt_io_pread(entry->abtioi, entry->log_fd, bounce_buffer,
-                       log_offset_end - log_offset_start, log_offset_start);
-    if (ret != BAKE_ALIGNMENT) {
-        free(bounce_buffer);
+    /* get aligned bounce buffer large enough to hold log extent */
+    bounce_buffer = bake_buffer_arena_alloc(entry->arena,
+                                            log_offset_end - log_offset_start);
+    if (!bounce_buffer) return (BAKE_ERR_ALLOCATION);
+
+    /* read extent from log (or from the block cache) */
+    ret = bake_block_cache_read(entry->cache, bounce_buffer,
+                                log_offset_end - log_offset_start,
+                                log_offset_start);
+    if (ret != log_offset_end - log_offset_start) {
+        bake_buffer_arena_free(bounce_buffer);
         return (BAKE_ERR_IO);
     }
 
@@ -486,7 +538,7 @@ static int bake_file_read_bulk(backend_context_t context,
     file_region_id_t*  frid  = (file_region_id_t*)rid.data;
     int                ret;
 
-    ret = transfer_data(entry, frid->log_entry_offset, frid->log_entry_size,
+    ret = transfer_data(entry, frid->log_entry_offset, LOG_ENTRY_SIZE(frid),
                         region_offset, bulk, bulk_offset, size, source,
                         TRANSFER_DATA_READ);
 
@@ -505,7 +557,7 @@ static int bake_file_persist(backend_context_t context,
      * portable function that can be used to sync portion of a log; we have
      * to sync the whole thing.
      */
-    ret = abt_io_fdatasync(entry->abtioi, entry->log_fd);
+    ret = bake_io_fdatasync(entry->io, entry->log_fd);
     if (ret != 0) return (BAKE_ERR_IO);
 
     return BAKE_SUCCESS;
@@ -515,7 +567,10 @@ static int bake_file_get_region_size(backend_context_t context,
                                      bake_region_id_t  rid,
                                      size_t*           size)
 {
-    return BAKE_ERR_OP_UNSUPPORTED;
+    file_region_id_t* frid = (file_region_id_t*)rid.data;
+
+    *size = frid->region_size;
+    return BAKE_SUCCESS;
 }
 
 static int bake_file_get_region_data(backend_context_t context,
@@ -546,9 +601,13 @@ static int bake_file_remove(backend_context_t context, bake_region_id_t rid)
      * The log could be defragmented, but that would be a higher level
      * opertion.
      */
-    ret = abt_io_fallocate(entry->abtioi, entry->log_fd,
+    ret = bake_io_fallocate(entry->io, entry->log_fd,
                            FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
-                           frid->log_entry_offset, frid->log_entry_size);
+                           frid->log_entry_offset, LOG_ENTRY_SIZE(frid));
+
+    /* the punched blocks now read as zeros; drop cached copies */
+    bake_block_cache_invalidate(entry->cache, LOG_ENTRY_SIZE(frid),
+                                frid->log_entry_offset);
 
     return (ret);
 }
@@ -565,11 +624,66 @@ static int bake_file_migrate_region(backend_context_t context,
     return BAKE_ERR_OP_UNSUPPORTED;
 }
 
+/* binds the bounce buffers and the I/O threads to the node of the device
+ * (value "auto") or to the given node */
+static int set_conf_numa_node(bake_file_entry_t* entry, const char* value)
+{
+    char* cpus;
+    int   node, ret;
+
+    if (strcmp(value, "auto") == 0)
+        node = bake_numa_node_of_fd(entry->log_fd);
+    else {
+        ret = bake_numa_parse_node(value, &node);
+        if (ret != BAKE_SUCCESS) return ret;
+    }
+    if (node >= 0) {
+        cpus = bake_numa_node_cpus(node);
+        if (!cpus) return BAKE_ERR_INVALID_ARG;
+        ret = bake_io_engine_set_conf(entry->io, "io_cpus", cpus);
+        free(cpus);
+        if (ret != BAKE_SUCCESS) return ret;
+    }
+    entry->numa_node = node;
+    return bake_buffer_arena_set_placement(entry->arena, entry->numa_node,
+                                           entry->huge_pages);
+}
+
 static int bake_file_set_conf(backend_context_t context,
                               const char*       key,
                               const char*       value)
 {
-    return 0;
+    bake_file_entry_t* entry = (bake_file_entry_t*)context;
+    unsigned           num_buffers, u;
+
+    if (strcmp(key, "arena_buffers_per_class") == 0) {
+        if (sscanf(value, "%u", &num_buffers) != 1)
+            return BAKE_ERR_INVALID_ARG;
+        return bake_buffer_arena_set_num_buffers(entry->arena, num_buffers);
+    }
+    if (strcmp(key, "arena_huge_pages") == 0) {
+        if (sscanf(value, "%u", &u) != 1) return BAKE_ERR_INVALID_ARG;
+        entry->huge_pages = !!u;
+        return bake_buffer_arena_set_placement(entry->arena, entry->numa_node,
+                                               entry->huge_pages);
+    }
+    if (strcmp(key, "numa_node") == 0) return set_conf_numa_node(entry, value);
+    if (strncmp(key, "cache_", 6) == 0)
+        return bake_block_cache_set_conf(entry->cache, key, value);
+    if (strncmp(key, "io_", 3) == 0)
+        return bake_io_engine_set_conf(entry->io, key, value);
+    return BAKE_ERR_OP_UNSUPPORTED;
+}
+
+static int bake_file_get_stats(backend_context_t context, FILE* out)
+{
+    bake_file_entry_t* entry = (bake_file_entry_t*)context;
+
+    fprintf(out, "numa_node = %d\n", entry->numa_node);
+    bake_buffer_arena_print_stats(entry->arena, "", out);
+    bake_block_cache_print_stats(entry->cache, "", out);
+    bake_io_engine_print_stats(entry->io, "", out);
+    return BAKE_SUCCESS;
 }
 
 #ifdef USE_REMI
@@ -620,7 +734,8 @@ bake_backend g_bake_file_backend
 #ifdef USE_REMI
        ._create_fileset = bake_file_create_fileset,
 #endif
-       ._set_conf = bake_file_set_conf};
+       ._set_conf  = bake_file_set_conf,
+       ._get_stats = bake_file_get_stats};
 
 /* common utility function for relaying data in read_bulk/write_bulk */
 static int transfer_data(bake_file_entry_t* entry,
@@ -661,11 +776,11 @@ static int transfer_data(bake_file_entry_t* entry,
     xargs.transmit_offset_in_log
         = log_entry_offset + region_offset - xargs.log_entry_offset;
     xargs.transmit_issued = 0;
-    margo_bulk_poolset_get_max(entry->provider->poolset,
-                               &xargs.poolset_max_size);
+    bake_poolset_get_max(entry->provider->poolset, &xargs.poolset_max_size);
     xargs.ret         = 0;
     xargs.ults_active = 0;
     xargs.op_flag     = op_flag;
+    xargs.trace       = bake_trace_get_current();
     ABT_mutex_create(&xargs.mutex);
     ABT_eventual_create(0, &xargs.eventual);
 
@@ -731,6 +846,7 @@ static void xfer_ult(void* _args)
     /* Hold lock going into loop so that this ULT can pull of it's unit of
      * work to operate on
      */
+    bake_trace_set_current(args->trace);
     ABT_mutex_lock(args->mutex);
     /* have we issued all of the necessary file operations or hit an error
      * already?
@@ -767,8 +883,8 @@ static void xfer_ult(void* _args)
 
         /* get buffer */
         /* this will block until a buffer is available if pool is exhausted */
-        ret = margo_bulk_poolset_get(args->entry->provider->poolset,
-                                     this_log_size, &local_bulk);
+        ret = bake_poolset_get(args->entry->provider->poolset, this_log_size,
+                               &local_bulk);
         if (ret != 0 && args->ret == 0) {
             args->ret = ret;
             goto finished;
@@ -786,33 +902,35 @@ static void xfer_ult(void* _args)
 
         if (args->op_flag == TRANSFER_DATA_WRITE) {
             /* rdma transfer */
-            ret = margo_bulk_transfer(args->entry->provider->mid, HG_BULK_PULL,
-                                      args->remote_addr, args->remote_bulk,
-                                      this_remote_offset, local_bulk, 0,
-                                      this_transmit_size);
+            ret = bake_bulk_transfer(args->entry->provider->mid, HG_BULK_PULL,
+                                     args->remote_addr, args->remote_bulk,
+                                     this_remote_offset, local_bulk, 0,
+                                     this_transmit_size);
             if (ret != 0 && args->ret == 0) {
                 args->ret = ret;
                 goto finished;
             }
 
             /* relay to log */
-            ret = abt_io_pwrite(args->entry->abtioi, args->entry->log_fd,
+            ret = bake_io_pwrite(args->entry->io, args->entry->log_fd,
                                 local_bulk_ptr, this_log_size, this_log_offset);
             if (ret != this_log_size && args->ret == 0) {
                 args->ret = ret;
                 goto finished;
             }
+            bake_block_cache_write(args->entry->cache, local_bulk_ptr,
+                                   this_log_size, this_log_offset);
         } else if (args->op_flag == TRANSFER_DATA_READ) {
-            /* read from log */
-            ret = abt_io_pread(args->entry->abtioi, args->entry->log_fd,
-                               local_bulk_ptr, this_log_size, this_log_offset);
+            /* read from log (or from the block cache) */
+            ret = bake_block_cache_read(args->entry->cache, local_bulk_ptr,
+                                        this_log_size, this_log_offset);
             if (ret != this_log_size && args->ret == 0) {
                 args->ret = ret;
                 goto finished;
             }
 
             /* rdma transfer */
-            ret = margo_bulk_transfer(
+            ret = bake_bulk_transfer(
                 args->entry->provider->mid, HG_BULK_PUSH, args->remote_addr,
                 args->remote_bulk, this_remote_offset, local_bulk,
                 this_transmit_offset_in_log, this_transmit_size);
@@ -825,7 +943,7 @@ static void xfer_ult(void* _args)
 
         /* let go of bulk handle (we'll re-acquire one on next loop
          * iteration if we have more work to do) */
-        margo_bulk_poolset_release(args->entry->provider->poolset, local_bulk);
+        bake_poolset_release(args->entry->provider->poolset, local_bulk);
         local_bulk = HG_BULK_NULL;
 
         ABT_mutex_lock(args->mutex);
@@ -835,8 +953,9 @@ static void xfer_ult(void* _args)
     ABT_mutex_unlock(args->mutex);
 
 finished:
+    bake_trace_set_current(NULL);
     if (local_bulk != HG_BULK_NULL)
-        margo_bulk_poolset_release(args->entry->provider->poolset, local_bulk);
+        bake_poolset_release(args->entry->provider->poolset, local_bulk);
     ABT_mutex_lock(args->mutex);
     args->ults_active--;
     /* The ULT that sets active to zero is the last one that can possibly
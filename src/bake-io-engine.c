@@ -0,0 +1,484 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include "bake.h"
+#include "bake-io-engine.h"
+#include "bake-trace.h"
+#include "bake-xstream.h"
+
+struct bake_io_engine {
+    /* registry state, protected by g_engines_mutex */
+    dev_t                  device;
+    int                    refcount;
+    struct bake_io_engine* next;
+
+    abt_io_instance_id abtioi;
+    ABT_pool           pool; /* pool served by the xstreams below */
+
+    /* configuration; changes are serialized by conf_mutex, which is never
+     * held while waiting on the queue
+     */
+    ABT_mutex       conf_mutex;
+    bake_xstream_t* xstreams;
+    int             num_xstreams;
+    int*            cpus;
+    int             num_cpus;
+    char*           cpus_str;
+
+    /* queue state, protected by mutex */
+    ABT_mutex mutex;
+    ABT_cond  cond;
+    unsigned  queue_depth; /* 0 means unlimited */
+    unsigned  in_flight;
+    unsigned  waiting;
+    unsigned  peak_in_flight;
+    unsigned  peak_waiting;
+    uint64_t  ops;
+    uint64_t  ops_waited;
+    double    wait_time;        /* total time spent waiting for a slot */
+    double    in_flight_area;   /* integral of in_flight over time */
+    double    waiting_area;     /* integral of waiting over time */
+    double    start_time;
+    double    last_change;
+};
+
+static pthread_mutex_t        g_engines_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct bake_io_engine* g_engines       = NULL;
+
+/* updates the occupancy integrals; called with e->mutex held before any
+ * change to in_flight or waiting
+ */
+static void io_account(struct bake_io_engine* e)
+{
+    double now = ABT_get_wtime();
+    e->in_flight_area += e->in_flight * (now - e->last_change);
+    e->waiting_area += e->waiting * (now - e->last_change);
+    e->last_change = now;
+}
+
+static void io_op_begin(struct bake_io_engine* e)
+{
+    double t0;
+
+    ABT_mutex_lock(e->mutex);
+    e->ops++;
+    if (e->queue_depth && e->in_flight >= e->queue_depth) {
+        t0 = ABT_get_wtime();
+        io_account(e);
+        e->waiting++;
+        e->ops_waited++;
+        if (e->waiting > e->peak_waiting) e->peak_waiting = e->waiting;
+        while (e->queue_depth && e->in_flight >= e->queue_depth)
+            ABT_cond_wait(e->cond, e->mutex);
+        io_account(e);
+        e->waiting--;
+        e->wait_time += ABT_get_wtime() - t0;
+    } else
+        io_account(e);
+    e->in_flight++;
+    if (e->in_flight > e->peak_in_flight) e->peak_in_flight = e->in_flight;
+    ABT_mutex_unlock(e->mutex);
+}
+
+static void io_op_end(struct bake_io_engine* e)
+{
+    ABT_mutex_lock(e->mutex);
+    io_account(e);
+    e->in_flight--;
+    if (e->waiting) ABT_cond_signal(e->cond);
+    ABT_mutex_unlock(e->mutex);
+}
+
+/* parses a CPU list such as "0-3,8"; an empty string selects all CPUs */
+static int io_parse_cpus(const char* str, int** cpus_out, int* num_cpus_out)
+{
+    long  ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    int*  cpus;
+    int   n = 0;
+    char* copy;
+    char* tok;
+    char* saveptr = NULL;
+    int   first, last, i;
+
+    if (ncpus <= 0) return BAKE_ERR_INVALID_ARG;
+    cpus = calloc(ncpus, sizeof(*cpus));
+    if (!cpus) return BAKE_ERR_ALLOCATION;
+
+    if (strlen(str) == 0) {
+        for (i = 0; i < ncpus; i++) cpus[n++] = i;
+        goto finish;
+    }
+
+    copy = strdup(str);
+    for (tok = strtok_r(copy, ",", &saveptr); tok;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        if (sscanf(tok, "%d-%d", &first, &last) != 2) {
+            if (sscanf(tok, "%d", &first) != 1) goto error;
+            last = first;
+        }
+        if (first < 0 || last < first || last >= ncpus) goto error;
+        for (i = first; i <= last && n < ncpus; i++) cpus[n++] = i;
+    }
+    free(copy);
+    if (n == 0) {
+        free(cpus);
+        return BAKE_ERR_INVALID_ARG;
+    }
+
+finish:
+    *cpus_out     = cpus;
+    *num_cpus_out = n;
+    return BAKE_SUCCESS;
+
+error:
+    free(copy);
+    free(cpus);
+    return BAKE_ERR_INVALID_ARG;
+}
+
+/* grows or shrinks the set of xstreams; called with conf_mutex held */
+static int io_set_num_xstreams(struct bake_io_engine* e, int num_xstreams)
+{
+    bake_xstream_t* xstreams;
+    int             i, ret;
+
+    if (num_xstreams < 1) return BAKE_ERR_INVALID_ARG;
+
+    /* shrinking: the xstreams we join finish the operation they are
+     * running and leave the rest of the queue to the others */
+    if (num_xstreams < e->num_xstreams) {
+        for (i = num_xstreams; i < e->num_xstreams; i++)
+            bake_xstream_stop(e->xstreams[i], 0);
+        for (i = num_xstreams; i < e->num_xstreams; i++)
+            bake_xstream_join(e->xstreams[i]);
+        e->num_xstreams = num_xstreams;
+        return BAKE_SUCCESS;
+    }
+
+    xstreams = realloc(e->xstreams, num_xstreams * sizeof(*xstreams));
+    if (!xstreams) return BAKE_ERR_ALLOCATION;
+    e->xstreams = xstreams;
+
+    for (i = e->num_xstreams; i < num_xstreams; i++) {
+        ret = bake_xstream_create(e->pool, &e->xstreams[i]);
+        if (ret != BAKE_SUCCESS) {
+            e->num_xstreams = i;
+            return ret;
+        }
+        if (e->num_cpus)
+            ABT_xstream_set_affinity(bake_xstream_get_abt_xstream(
+                                         e->xstreams[i]),
+                                     e->num_cpus, e->cpus);
+    }
+    e->num_xstreams = num_xstreams;
+    return BAKE_SUCCESS;
+}
+
+static void io_engine_destroy(struct bake_io_engine* e)
+{
+    int i;
+
+    if (e->abtioi) abt_io_finalize(e->abtioi);
+    for (i = 0; i < e->num_xstreams; i++)
+        bake_xstream_stop(e->xstreams[i], 1);
+    for (i = 0; i < e->num_xstreams; i++)
+        bake_xstream_join(e->xstreams[i]);
+    free(e->xstreams);
+    free(e->cpus);
+    free(e->cpus_str);
+    ABT_cond_free(&e->cond);
+    ABT_mutex_free(&e->mutex);
+    ABT_mutex_free(&e->conf_mutex);
+    free(e);
+}
+
+static struct bake_io_engine* io_engine_create(dev_t device)
+{
+    struct bake_io_engine* e = calloc(1, sizeof(*e));
+    int                    ret;
+
+    if (!e) return NULL;
+    e->device      = device;
+    e->refcount    = 1;
+    e->queue_depth = BAKE_IO_ENGINE_DEFAULT_QUEUE_DEPTH;
+    e->start_time = e->last_change = ABT_get_wtime();
+    ABT_mutex_create(&e->conf_mutex);
+    ABT_mutex_create(&e->mutex);
+    ABT_cond_create(&e->cond);
+
+    /* same setup as abt_io_init(), but we keep hold of the xstreams */
+    ret = ABT_pool_create_basic(ABT_POOL_FIFO_WAIT, ABT_POOL_ACCESS_MPMC,
+                                ABT_TRUE, &e->pool);
+    if (ret != ABT_SUCCESS) goto error;
+    ret = io_set_num_xstreams(e, BAKE_IO_ENGINE_DEFAULT_THREADS);
+    if (ret != BAKE_SUCCESS) goto error;
+
+    e->abtioi = abt_io_init_pool(e->pool);
+    if (!e->abtioi) goto error;
+
+    return e;
+
+error:
+    io_engine_destroy(e);
+    return NULL;
+}
+
+bake_io_engine_t bake_io_engine_acquire(const char* path)
+{
+    struct bake_io_engine* e;
+    struct stat            statbuf;
+
+    if (stat(path, &statbuf) != 0) {
+        perror("stat");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_engines_mutex);
+    for (e = g_engines; e; e = e->next) {
+        if (e->device == statbuf.st_dev) {
+            e->refcount++;
+            break;
+        }
+    }
+    if (!e) {
+        e = io_engine_create(statbuf.st_dev);
+        if (e) {
+            e->next   = g_engines;
+            g_engines = e;
+        }
+    }
+    pthread_mutex_unlock(&g_engines_mutex);
+
+    return e;
+}
+
+void bake_io_engine_release(bake_io_engine_t engine)
+{
+    struct bake_io_engine** p;
+    int                     last = 0;
+
+    if (!engine) return;
+
+    pthread_mutex_lock(&g_engines_mutex);
+    if (--engine->refcount == 0) {
+        for (p = &g_engines; *p; p = &(*p)->next) {
+            if (*p == engine) {
+                *p = engine->next;
+                break;
+            }
+        }
+        last = 1;
+    }
+    pthread_mutex_unlock(&g_engines_mutex);
+
+    if (last) io_engine_destroy(engine);
+}
+
+int bake_io_engine_set_conf(bake_io_engine_t engine,
+                            const char*      key,
+                            const char*      value)
+{
+    int      ret = BAKE_SUCCESS;
+    int      num_threads, num_cpus, i;
+    unsigned depth;
+    int*     cpus;
+
+    ABT_mutex_lock(engine->conf_mutex);
+    if (strcmp(key, "io_threads") == 0) {
+        if (sscanf(value, "%d", &num_threads) != 1)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            ret = io_set_num_xstreams(engine, num_threads);
+    } else if (strcmp(key, "io_queue_depth") == 0) {
+        if (sscanf(value, "%u", &depth) != 1)
+            ret = BAKE_ERR_INVALID_ARG;
+        else {
+            ABT_mutex_lock(engine->mutex);
+            engine->queue_depth = depth;
+            ABT_cond_broadcast(engine->cond);
+            ABT_mutex_unlock(engine->mutex);
+        }
+    } else if (strcmp(key, "io_cpus") == 0) {
+        ret = io_parse_cpus(value, &cpus, &num_cpus);
+        if (ret == BAKE_SUCCESS) {
+            for (i = 0; i < engine->num_xstreams; i++)
+                ABT_xstream_set_affinity(
+                    bake_xstream_get_abt_xstream(engine->xstreams[i]),
+                    num_cpus, cpus);
+            free(engine->cpus);
+            free(engine->cpus_str);
+            if (strlen(value)) {
+                engine->cpus     = cpus;
+                engine->num_cpus = num_cpus;
+                engine->cpus_str = strdup(value);
+            } else {
+                /* unbound; new xstreams keep the default affinity */
+                free(cpus);
+                engine->cpus     = NULL;
+                engine->num_cpus = 0;
+                engine->cpus_str = NULL;
+            }
+        }
+    } else
+        ret = BAKE_ERR_OP_UNSUPPORTED;
+    ABT_mutex_unlock(engine->conf_mutex);
+
+    return ret;
+}
+
+void bake_io_engine_print_stats(bake_io_engine_t engine,
+                                const char*      prefix,
+                                FILE*            out)
+{
+    struct bake_io_engine* e = engine;
+    double                 elapsed;
+    int                    num_xstreams;
+    char*                  cpus_str;
+
+    ABT_mutex_lock(e->conf_mutex);
+    num_xstreams = e->num_xstreams;
+    cpus_str     = e->cpus_str ? strdup(e->cpus_str) : NULL;
+    ABT_mutex_unlock(e->conf_mutex);
+
+    ABT_mutex_lock(e->mutex);
+    io_account(e);
+    elapsed = e->last_change - e->start_time;
+    fprintf(out, "%sio_device = %u:%u\n", prefix, major(e->device),
+            minor(e->device));
+    fprintf(out, "%sio_threads = %d\n", prefix, num_xstreams);
+    fprintf(out, "%sio_queue_depth = %u\n", prefix, e->queue_depth);
+    fprintf(out, "%sio_cpus = %s\n", prefix, cpus_str ? cpus_str : "");
+    fprintf(out, "%sio_ops = %" PRIu64 "\n", prefix, e->ops);
+    fprintf(out, "%sio_ops_waited = %" PRIu64 "\n", prefix, e->ops_waited);
+    fprintf(out, "%sio_wait_time = %f\n", prefix, e->wait_time);
+    fprintf(out, "%sio_in_flight = %u\n", prefix, e->in_flight);
+    fprintf(out, "%sio_waiting = %u\n", prefix, e->waiting);
+    fprintf(out, "%sio_peak_in_flight = %u\n", prefix, e->peak_in_flight);
+    fprintf(out, "%sio_peak_waiting = %u\n", prefix, e->peak_waiting);
+    fprintf(out, "%sio_avg_in_flight = %f\n", prefix,
+            elapsed > 0 ? e->in_flight_area / elapsed : 0.0);
+    fprintf(out, "%sio_avg_waiting = %f\n", prefix,
+            elapsed > 0 ? e->waiting_area / elapsed : 0.0);
+    ABT_mutex_unlock(e->mutex);
+
+    free(cpus_str);
+}
+
+int bake_io_open(bake_io_engine_t engine,
+                 const char*      pathname,
+                 int              flags,
+                 mode_t           mode)
+{
+    int ret;
+    io_op_begin(engine);
+    ret = abt_io_open(engine->abtioi, pathname, flags, mode);
+    io_op_end(engine);
+    return ret;
+}
+
+ssize_t bake_io_pread(bake_io_engine_t engine,
+                      int              fd,
+                      void*            buf,
+                      size_t           count,
+                      off_t            offset)
+{
+    uint64_t start = bake_trace_start();
+    ssize_t  ret;
+    io_op_begin(engine);
+    ret = abt_io_pread(engine->abtioi, fd, buf, count, offset);
+    io_op_end(engine);
+    bake_trace_stage(BAKE_TRACE_DISK_READ, start, count);
+    return ret;
+}
+
+ssize_t bake_io_pwrite(bake_io_engine_t engine,
+                       int              fd,
+                       const void*      buf,
+                       size_t           count,
+                       off_t            offset)
+{
+    uint64_t start = bake_trace_start();
+    ssize_t  ret;
+    io_op_begin(engine);
+    ret = abt_io_pwrite(engine->abtioi, fd, buf, count, offset);
+    io_op_end(engine);
+    bake_trace_stage(BAKE_TRACE_DISK_WRITE, start, count);
+    return ret;
+}
+
+int bake_io_fdatasync(bake_io_engine_t engine, int fd)
+{
+    uint64_t start = bake_trace_start();
+    int      ret;
+    io_op_begin(engine);
+    ret = abt_io_fdatasync(engine->abtioi, fd);
+    io_op_end(engine);
+    bake_trace_stage(BAKE_TRACE_DISK_SYNC, start, 0);
+    return ret;
+}
+
+int bake_io_fallocate(
+    bake_io_engine_t engine, int fd, int mode, off_t offset, off_t len)
+{
+    int ret;
+    io_op_begin(engine);
+    ret = abt_io_fallocate(engine->abtioi, fd, mode, offset, len);
+    io_op_end(engine);
+    return ret;
+}
+
+typedef struct {
+    void*  addr;
+    size_t length;
+    int    flags;
+    int    ret;
+} msync_args_t;
+
+static void msync_ult(void* arg)
+{
+    msync_args_t* args = (msync_args_t*)arg;
+
+    args->ret = msync(args->addr, args->length, args->flags);
+    if (args->ret != 0) args->ret = -errno;
+}
+
+int bake_io_msync(bake_io_engine_t engine,
+                  void*            addr,
+                  size_t           length,
+                  int              flags)
+{
+    uint64_t     start = bake_trace_start();
+    msync_args_t args  = {addr, length, flags, 0};
+    ABT_thread   thread;
+    int          ret;
+
+    /* abt-io has no msync; run it on the engine's xstreams the same way */
+    io_op_begin(engine);
+    ret = ABT_thread_create(engine->pool, msync_ult, &args,
+                            ABT_THREAD_ATTR_NULL, &thread);
+    if (ret == ABT_SUCCESS) {
+        ABT_thread_join(thread);
+        ABT_thread_free(&thread);
+        ret = args.ret;
+    } else
+        ret = -ENOMEM;
+    io_op_end(engine);
+    bake_trace_stage(BAKE_TRACE_DISK_SYNC, start, length);
+    return ret;
+}
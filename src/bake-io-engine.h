@@ -0,0 +1,92 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_IO_ENGINE_H
+#define __BAKE_IO_ENGINE_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <abt-io.h>
+
+/* bake-io-engine
+ *
+ * Process-wide, reference-counted abt-io instances shared by the targets
+ * that live on the same device.  Each device gets its own queue: an abt-io
+ * instance driven by a dedicated pool of execution streams.  The number of
+ * execution streams, the maximum number of operations in flight (queue
+ * depth) and the CPU affinity of the execution streams can be changed at
+ * run time, and queue occupancy is tracked so that these can be sized.
+ */
+
+#define BAKE_IO_ENGINE_DEFAULT_THREADS     16
+#define BAKE_IO_ENGINE_DEFAULT_QUEUE_DEPTH 0 /* unlimited */
+
+typedef struct bake_io_engine* bake_io_engine_t;
+
+/**
+ * Returns the engine of the device holding path, creating it if needed.
+ * Each successful call must be matched by a call to
+ * bake_io_engine_release().
+ */
+bake_io_engine_t bake_io_engine_acquire(const char* path);
+
+/**
+ * Drops a reference on the engine, tearing it down with the last one.
+ */
+void bake_io_engine_release(bake_io_engine_t engine);
+
+/**
+ * Sets a configuration parameter.  Recognized keys are "io_threads"
+ * (number of execution streams), "io_queue_depth" (maximum number of
+ * operations in flight, 0 for unlimited) and "io_cpus" (CPU list such as
+ * "0-3,8" to bind the execution streams to, empty to unbind).  Settings
+ * apply to every target sharing the engine.
+ */
+int bake_io_engine_set_conf(bake_io_engine_t engine,
+                            const char*      key,
+                            const char*      value);
+
+/**
+ * Prints settings and queue occupancy, one "key = value" pair per line,
+ * each key prefixed by the given prefix.
+ */
+void bake_io_engine_print_stats(bake_io_engine_t engine,
+                                const char*      prefix,
+                                FILE*            out);
+
+/* the following wrap the abt-io calls of the same name */
+
+int bake_io_open(bake_io_engine_t engine,
+                 const char*      pathname,
+                 int              flags,
+                 mode_t           mode);
+
+ssize_t bake_io_pread(bake_io_engine_t engine,
+                      int              fd,
+                      void*            buf,
+                      size_t           count,
+                      off_t            offset);
+
+ssize_t bake_io_pwrite(bake_io_engine_t engine,
+                       int              fd,
+                       const void*      buf,
+                       size_t           count,
+                       off_t            offset);
+
+int bake_io_fdatasync(bake_io_engine_t engine, int fd);
+
+int bake_io_fallocate(
+    bake_io_engine_t engine, int fd, int mode, off_t offset, off_t len);
+
+/**
+ * Runs msync() on one of the engine's execution streams, like the abt-io
+ * calls above do for theirs; returns 0 or -errno.
+ */
+int bake_io_msync(bake_io_engine_t engine,
+                  void*            addr,
+                  size_t           length,
+                  int              flags);
+
+#endif
@@ -0,0 +1,953 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+/* for MAP_HUGETLB and MADV_HUGEPAGE */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bake-config.h"
+#include "bake.h"
+#include "bake-rpc.h"
+#include "bake-server.h"
+#include "bake-provider.h"
+#include "bake-backend.h"
+#include "uthash.h"
+
+/* bake-mem-backend
+ *
+ * This is an implementation of a back end for the Bake provider that keeps
+ * all data in DRAM, for burst-buffer staging and for measuring the network
+ * and RPC stack without storage in the way.  Nothing survives the process:
+ * persist is a no-op and there is no pool to create.
+ *
+ * Small regions are carved out of slabs of power-of-two slots, one set of
+ * slabs per size class.  Free slots of a class are kept on a lock-free
+ * stack; only growing a class by a new slab takes a lock.  Slabs are
+ * aligned to their size, and their first slot holds a header, so the slab
+ * of a slot is found from its address alone.  Larger regions get their
+ * own mapping.  Slabs and large mappings are backed by huge pages when the
+ * system has some reserved (transparent huge pages otherwise), and are
+ * registered with Mercury once, when they are mapped, so bulk transfers
+ * never register memory.
+ *
+ * Region ids hold the index of a slot within its class, checked against a
+ * bitmap of the allocated slots of each slab, or the id of a large region
+ * in a table.  A forged or stale region id is rejected instead of reaching
+ * memory that is not allocated to a region, and a region can only be
+ * freed once.
+ *
+ * A capacity can be set, in which case regions that would exceed it are
+ * created in a file target ("spill_target") instead, or fail if there is
+ * none.  Spilled regions are told apart by the type of their region id.
+ */
+
+#define BAKE_MEM_HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+#define BAKE_MEM_SLAB_SIZE       BAKE_MEM_HUGE_PAGE_SIZE
+#define BAKE_MEM_MIN_SLOT_SHIFT  6  /* 64 bytes */
+#define BAKE_MEM_MAX_SLOT_SHIFT  16 /* 64 KiB; larger regions are mapped */
+#define BAKE_MEM_NUM_CLASSES \
+    (BAKE_MEM_MAX_SLOT_SHIFT - BAKE_MEM_MIN_SLOT_SHIFT + 1)
+#define BAKE_MEM_MAX_SLABS       4096 /* per class */
+#define BAKE_MEM_NIL_SLOT        UINT32_MAX
+#define BAKE_MEM_ALIGN_UP(x, a)  ((((unsigned long)(x)) + (a)-1) & ~((a)-1))
+
+/* types of region ids */
+#define BAKE_MEM_REGION_DRAM    0
+#define BAKE_MEM_REGION_SPILLED 1
+
+/* definition of internal BAKE region_id_t identifier for mem back end */
+typedef struct {
+    uint64_t handle; /* index of the slot in its class, or large region id */
+    uint64_t size;
+} mem_region_id_t;
+
+/* a large region, with a mapping of its own */
+typedef struct {
+    uint64_t       id; /* key */
+    char*          data;
+    size_t         map_size;
+    hg_bulk_t      bulk; /* registration of the whole mapping */
+    UT_hash_handle hh;
+} large_region_t;
+
+/* kept in the first slot of each slab */
+typedef struct {
+    hg_bulk_t bulk; /* registration of the whole slab */
+    uint32_t  index;
+} mem_slab_header_t;
+
+typedef struct {
+    /* free stack: index of the top slot in the low 32 bits, and a tag
+     * bumped by every update (against ABA) in the high 32 bits; each free
+     * slot holds the index of the next one
+     */
+    uint64_t   free_head;
+    uint32_t   num_slabs; /* slabs[0..num_slabs) are valid */
+    ABT_mutex  grow_mutex;
+    char*      slabs[BAKE_MEM_MAX_SLABS];
+    uint64_t*  allocated[BAKE_MEM_MAX_SLABS]; /* one bit per slot of a slab */
+} mem_class_t;
+
+typedef struct {
+    bake_provider_t   provider;
+    mem_class_t*      classes; /* BAKE_MEM_NUM_CLASSES of them */
+    large_region_t*   large_regions;
+    uint64_t          next_large_id;
+    ABT_mutex         large_mutex; /* protects the two above */
+    size_t            capacity;    /* 0 for unlimited */
+    uint64_t          allocated;   /* bytes of slots and large mappings */
+    uint64_t          num_spilled;
+    backend_context_t spill; /* file target, NULL if none */
+    char*             spill_path;
+    ABT_mutex         spill_mutex;
+} bake_mem_entry_t;
+
+extern bake_backend g_bake_file_backend;
+
+static inline unsigned slot_shift(const mem_class_t* classes,
+                                  const mem_class_t* class)
+{
+    return BAKE_MEM_MIN_SLOT_SHIFT + (class - classes);
+}
+
+/* maps len bytes, from huge pages if possible; multiples of the huge page
+ * size are aligned to it
+ */
+static char* map_memory(size_t len)
+{
+    char*  ptr;
+    size_t head;
+
+    if (len % BAKE_MEM_HUGE_PAGE_SIZE == 0) {
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) return ptr;
+
+        /* no reserved huge pages; transparent ones are the next best, and
+         * need the mapping to be aligned
+         */
+        ptr = mmap(NULL, len + BAKE_MEM_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) return NULL;
+        head = BAKE_MEM_ALIGN_UP(ptr, BAKE_MEM_HUGE_PAGE_SIZE)
+             - (unsigned long)ptr;
+        if (head) munmap(ptr, head);
+        munmap(ptr + head + len, BAKE_MEM_HUGE_PAGE_SIZE - head);
+        ptr += head;
+    } else {
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) return NULL;
+    }
+    madvise(ptr, len, MADV_HUGEPAGE);
+    return ptr;
+}
+
+static inline char* slot_address(mem_class_t* class, unsigned shift,
+                                 uint32_t index)
+{
+    unsigned per_slab = BAKE_MEM_SLAB_SIZE >> shift;
+
+    return class->slabs[index / per_slab]
+         + ((size_t)(index % per_slab) << shift);
+}
+
+static inline mem_slab_header_t* slab_of(const char* ptr)
+{
+    return (mem_slab_header_t*)(((unsigned long)ptr)
+                                & ~((unsigned long)BAKE_MEM_SLAB_SIZE - 1));
+}
+
+/* returns the word of the allocated bitmap holding the bit of a slot and
+ * sets mask to that bit, or returns NULL if the index is past the slabs
+ * of the class or is that of a slab header
+ */
+static uint64_t* allocated_word(mem_class_t* class, unsigned shift,
+                                uint64_t index, uint64_t* mask)
+{
+    unsigned per_slab  = BAKE_MEM_SLAB_SIZE >> shift;
+    uint32_t num_slabs = __atomic_load_n(&class->num_slabs, __ATOMIC_ACQUIRE);
+    uint64_t slot      = index % per_slab;
+
+    if (index >= (uint64_t)num_slabs * per_slab || slot == 0) return NULL;
+    *mask = (uint64_t)1 << (slot % 64);
+    return &class->allocated[index / per_slab][slot / 64];
+}
+
+static int slot_in_use(mem_class_t* class, unsigned shift, uint64_t index)
+{
+    uint64_t  mask;
+    uint64_t* word = allocated_word(class, shift, index, &mask);
+
+    return word && (__atomic_load_n(word, __ATOMIC_ACQUIRE) & mask);
+}
+
+/* pushes the chain of free slots first..last on the free stack */
+static void push_slots(mem_class_t* class, unsigned shift, uint32_t first,
+                       uint32_t last)
+{
+    uint64_t head = __atomic_load_n(&class->free_head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+
+    do {
+        *(uint32_t*)slot_address(class, shift, last) = (uint32_t)head;
+        new_head = ((head >> 32) + 1) << 32 | first;
+    } while (!__atomic_compare_exchange_n(&class->free_head, &head, new_head,
+                                          0, __ATOMIC_RELEASE,
+                                          __ATOMIC_ACQUIRE));
+}
+
+/* adds a slab to the class and pushes its slots on the free stack */
+static int grow_class(bake_mem_entry_t* entry, mem_class_t* class,
+                      unsigned shift)
+{
+    unsigned           per_slab = BAKE_MEM_SLAB_SIZE >> shift;
+    char*              base;
+    mem_slab_header_t* header;
+    hg_size_t          slab_size = BAKE_MEM_SLAB_SIZE;
+    uint32_t           first, i;
+    hg_return_t        hret;
+    int                ret = BAKE_SUCCESS;
+
+    ABT_mutex_lock(class->grow_mutex);
+    /* someone else may have grown the class while we waited */
+    if ((uint32_t)__atomic_load_n(&class->free_head, __ATOMIC_ACQUIRE)
+        != BAKE_MEM_NIL_SLOT)
+        goto finish;
+    if (class->num_slabs == BAKE_MEM_MAX_SLABS) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto finish;
+    }
+
+    /* kept for the next attempt if anything below fails */
+    if (!class->allocated[class->num_slabs])
+        class->allocated[class->num_slabs]
+            = calloc((per_slab + 63) / 64, sizeof(uint64_t));
+    if (!class->allocated[class->num_slabs]) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto finish;
+    }
+    base = map_memory(BAKE_MEM_SLAB_SIZE);
+    if (!base) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto finish;
+    }
+    header        = (mem_slab_header_t*)base;
+    header->index = class->num_slabs;
+    hret = margo_bulk_create(entry->provider->mid, 1, (void**)&base,
+                             &slab_size, HG_BULK_READWRITE, &header->bulk);
+    if (hret != HG_SUCCESS) {
+        munmap(base, BAKE_MEM_SLAB_SIZE);
+        ret = BAKE_ERR_MERCURY;
+        goto finish;
+    }
+
+    /* chain the slots but the header's, then publish the slab before
+     * handing them out
+     */
+    first = class->num_slabs * per_slab;
+    for (i = 1; i < per_slab - 1; i++)
+        *(uint32_t*)(base + ((size_t)i << shift)) = first + i + 1;
+    class->slabs[class->num_slabs] = base;
+    __atomic_store_n(&class->num_slabs, class->num_slabs + 1,
+                     __ATOMIC_RELEASE);
+    push_slots(class, shift, first + 1, first + per_slab - 1);
+
+finish:
+    ABT_mutex_unlock(class->grow_mutex);
+    return ret;
+}
+
+/* pops a free slot and marks it allocated */
+static int
+alloc_slot(bake_mem_entry_t* entry, mem_class_t* class, uint32_t* slot)
+{
+    unsigned shift = slot_shift(entry->classes, class);
+    uint64_t head, new_head, mask;
+    uint32_t index;
+    int      ret;
+
+    head = __atomic_load_n(&class->free_head, __ATOMIC_ACQUIRE);
+    for (;;) {
+        index = (uint32_t)head;
+        if (index == BAKE_MEM_NIL_SLOT) {
+            ret = grow_class(entry, class, shift);
+            if (ret != BAKE_SUCCESS) return ret;
+            head = __atomic_load_n(&class->free_head, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        /* the slot may be popped by someone else meanwhile, in which case
+         * the next index read here is garbage but the tag makes the CAS
+         * fail; slabs are never unmapped while the target is open
+         */
+        new_head = ((head >> 32) + 1) << 32
+                 | *(volatile uint32_t*)slot_address(class, shift, index);
+        if (__atomic_compare_exchange_n(&class->free_head, &head, new_head, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+            break;
+    }
+    __atomic_fetch_or(allocated_word(class, shift, index, &mask), mask,
+                      __ATOMIC_RELEASE);
+    *slot = index;
+    return BAKE_SUCCESS;
+}
+
+/* returns the class of regions of the given size, NULL for large regions */
+static mem_class_t* find_class(bake_mem_entry_t* entry, size_t size)
+{
+    unsigned shift = BAKE_MEM_MIN_SLOT_SHIFT;
+
+    while (((size_t)1 << shift) < size) shift++;
+    if (shift > BAKE_MEM_MAX_SLOT_SHIFT) return NULL;
+    return &entry->classes[shift - BAKE_MEM_MIN_SLOT_SHIFT];
+}
+
+static size_t large_map_size(size_t size)
+{
+    if (size >= BAKE_MEM_HUGE_PAGE_SIZE)
+        return BAKE_MEM_ALIGN_UP(size, BAKE_MEM_HUGE_PAGE_SIZE);
+    return BAKE_MEM_ALIGN_UP(size, sysconf(_SC_PAGESIZE));
+}
+
+static int alloc_large(bake_mem_entry_t* entry, size_t size, uint64_t* id)
+{
+    large_region_t* r = calloc(1, sizeof(*r));
+    hg_size_t       bulk_size;
+    hg_return_t     hret;
+
+    if (!r) return BAKE_ERR_ALLOCATION;
+    r->map_size = large_map_size(size);
+    r->data     = map_memory(r->map_size);
+    if (!r->data) {
+        free(r);
+        return BAKE_ERR_ALLOCATION;
+    }
+    bulk_size = r->map_size;
+    hret = margo_bulk_create(entry->provider->mid, 1, (void**)&r->data,
+                             &bulk_size, HG_BULK_READWRITE, &r->bulk);
+    if (hret != HG_SUCCESS) {
+        munmap(r->data, r->map_size);
+        free(r);
+        return BAKE_ERR_MERCURY;
+    }
+
+    ABT_mutex_lock(entry->large_mutex);
+    r->id = ++entry->next_large_id;
+    HASH_ADD(hh, entry->large_regions, id, sizeof(r->id), r);
+    ABT_mutex_unlock(entry->large_mutex);
+
+    *id = r->id;
+    return BAKE_SUCCESS;
+}
+
+static large_region_t* find_large(bake_mem_entry_t* entry, uint64_t id)
+{
+    large_region_t* r = NULL;
+
+    ABT_mutex_lock(entry->large_mutex);
+    HASH_FIND(hh, entry->large_regions, &id, sizeof(id), r);
+    ABT_mutex_unlock(entry->large_mutex);
+    return r;
+}
+
+static void unmap_large(large_region_t* r)
+{
+    margo_bulk_free(r->bulk);
+    munmap(r->data, r->map_size);
+    free(r);
+}
+
+/* takes a large region out of the table and frees it */
+static int free_large(bake_mem_entry_t* entry, uint64_t id)
+{
+    large_region_t* r = NULL;
+
+    ABT_mutex_lock(entry->large_mutex);
+    HASH_FIND(hh, entry->large_regions, &id, sizeof(id), r);
+    if (r) HASH_DEL(entry->large_regions, r);
+    ABT_mutex_unlock(entry->large_mutex);
+    if (!r) return BAKE_ERR_UNKNOWN_REGION;
+    unmap_large(r);
+    return BAKE_SUCCESS;
+}
+
+/* bytes of DRAM used by a region of the given size */
+static size_t footprint(bake_mem_entry_t* entry, size_t size)
+{
+    mem_class_t* class = find_class(entry, size);
+
+    if (class) return (size_t)1 << slot_shift(entry->classes, class);
+    return large_map_size(size);
+}
+
+/* returns the data of a DRAM region, and the registration and offset to
+ * use for bulk transfers to and from it, or NULL if the region id does not
+ * name an allocated region
+ */
+static char* region_data(bake_mem_entry_t*      entry,
+                         const mem_region_id_t* mrid,
+                         hg_bulk_t*             bulk,
+                         size_t*                bulk_offset)
+{
+    mem_class_t*    class = find_class(entry, mrid->size);
+    large_region_t* large;
+    unsigned        shift;
+    char*           ptr;
+
+    if (class) {
+        shift = slot_shift(entry->classes, class);
+        if (!slot_in_use(class, shift, mrid->handle)) return NULL;
+        ptr = slot_address(class, shift, (uint32_t)mrid->handle);
+        if (bulk) {
+            *bulk        = slab_of(ptr)->bulk;
+            *bulk_offset = ptr - (char*)slab_of(ptr);
+        }
+        return ptr;
+    }
+    large = find_large(entry, mrid->handle);
+    if (!large) return NULL;
+    if (bulk) {
+        *bulk        = large->bulk;
+        *bulk_offset = 0;
+    }
+    return large->data;
+}
+
+static backend_context_t spill_target(bake_mem_entry_t* entry)
+{
+    return __atomic_load_n(&entry->spill, __ATOMIC_ACQUIRE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mem_backend_initialize(bake_provider_t    provider,
+                                       const char*        path,
+                                       bake_target_id_t*  target,
+                                       backend_context_t* context)
+{
+    bake_mem_entry_t* new_entry = calloc(1, sizeof(*new_entry));
+    unsigned          i;
+
+    if (!new_entry) return BAKE_ERR_ALLOCATION;
+    new_entry->classes = calloc(BAKE_MEM_NUM_CLASSES, sizeof(mem_class_t));
+    if (!new_entry->classes) {
+        free(new_entry);
+        return BAKE_ERR_ALLOCATION;
+    }
+
+    new_entry->provider = provider;
+    for (i = 0; i < BAKE_MEM_NUM_CLASSES; i++) {
+        new_entry->classes[i].free_head = BAKE_MEM_NIL_SLOT;
+        ABT_mutex_create(&new_entry->classes[i].grow_mutex);
+    }
+    ABT_mutex_create(&new_entry->large_mutex);
+    ABT_mutex_create(&new_entry->spill_mutex);
+
+    /* the path only names the target; a new one is made every time */
+    uuid_generate(target->id);
+
+    *context = new_entry;
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mem_backend_finalize(backend_context_t context)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_class_t*      class;
+    large_region_t *  large, *tmp;
+    unsigned          i, j;
+
+    HASH_ITER(hh, entry->large_regions, large, tmp)
+    {
+        HASH_DEL(entry->large_regions, large);
+        unmap_large(large);
+    }
+    for (i = 0; i < BAKE_MEM_NUM_CLASSES; i++) {
+        class = &entry->classes[i];
+        for (j = 0; j < class->num_slabs; j++) {
+            margo_bulk_free(((mem_slab_header_t*)class->slabs[j])->bulk);
+            munmap(class->slabs[j], BAKE_MEM_SLAB_SIZE);
+        }
+        /* a bitmap may have been allocated for a slab that failed */
+        for (j = 0; j < BAKE_MEM_MAX_SLABS && class->allocated[j]; j++)
+            free(class->allocated[j]);
+        ABT_mutex_free(&class->grow_mutex);
+    }
+    if (entry->spill) g_bake_file_backend._finalize(entry->spill);
+    ABT_mutex_free(&entry->large_mutex);
+    ABT_mutex_free(&entry->spill_mutex);
+    free(entry->spill_path);
+    free(entry->classes);
+    free(entry);
+
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int
+bake_mem_create(backend_context_t context, size_t size, bake_region_id_t* rid)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid->data;
+    size_t            bytes = footprint(entry, size);
+    mem_class_t*      class;
+    backend_context_t spill;
+    uint32_t          slot;
+    uint64_t          handle;
+    int               ret;
+
+    assert(sizeof(mem_region_id_t) <= BAKE_REGION_ID_DATA_SIZE);
+
+    if (__atomic_add_fetch(&entry->allocated, bytes, __ATOMIC_RELAXED)
+            > entry->capacity
+        && entry->capacity) {
+        __atomic_sub_fetch(&entry->allocated, bytes, __ATOMIC_RELAXED);
+        spill = spill_target(entry);
+        if (!spill) return BAKE_ERR_ALLOCATION;
+        ret = g_bake_file_backend._create(spill, size, rid);
+        if (ret != BAKE_SUCCESS) return ret;
+        rid->type = BAKE_MEM_REGION_SPILLED;
+        __atomic_add_fetch(&entry->num_spilled, 1, __ATOMIC_RELAXED);
+        return BAKE_SUCCESS;
+    }
+    class = find_class(entry, size);
+    if (class) {
+        ret    = alloc_slot(entry, class, &slot);
+        handle = slot;
+    } else
+        ret = alloc_large(entry, size, &handle);
+    if (ret != BAKE_SUCCESS) {
+        __atomic_sub_fetch(&entry->allocated, bytes, __ATOMIC_RELAXED);
+        return ret;
+    }
+
+    rid->type    = BAKE_MEM_REGION_DRAM;
+    mrid->handle = handle;
+    mrid->size   = size;
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mem_write_raw(backend_context_t context,
+                              bake_region_id_t  rid,
+                              size_t            offset,
+                              size_t            size,
+                              const void*       data)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid.data;
+    char*             ptr;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED)
+        return g_bake_file_backend._write_raw(spill_target(entry), rid, offset,
+                                              size, data);
+
+    ptr = region_data(entry, mrid, NULL, NULL);
+    if (!ptr) return BAKE_ERR_UNKNOWN_REGION;
+    if (size + offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+
+    memcpy(ptr + offset, data, size);
+
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mem_write_bulk(backend_context_t context,
+                               bake_region_id_t  rid,
+                               size_t            region_offset,
+                               size_t            size,
+                               hg_bulk_t         bulk,
+                               hg_addr_t         source,
+                               size_t            bulk_offset)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid.data;
+    hg_bulk_t         local_bulk;
+    size_t            local_offset;
+    hg_return_t       hret;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED)
+        return g_bake_file_backend._write_bulk(spill_target(entry), rid,
+                                               region_offset, size, bulk,
+                                               source, bulk_offset);
+
+    if (!region_data(entry, mrid, &local_bulk, &local_offset))
+        return BAKE_ERR_UNKNOWN_REGION;
+    if (size + region_offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+
+    hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PULL, source,
+                              bulk, bulk_offset, local_bulk,
+                              local_offset + region_offset, size);
+    if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+
+    return BAKE_SUCCESS;
+}
+
+static int bake_mem_read_raw(backend_context_t context,
+                             bake_region_id_t  rid,
+                             size_t            offset,
+                             size_t            size,
+                             void**            data,
+                             uint64_t*         data_size,
+                             free_fn*          free_data)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid.data;
+    char*             ptr;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED)
+        return g_bake_file_backend._read_raw(spill_target(entry), rid, offset,
+                                             size, data, data_size, free_data);
+
+    *free_data = NULL;
+    *data      = NULL;
+    *data_size = 0;
+
+    ptr = region_data(entry, mrid, NULL, NULL);
+    if (!ptr) return BAKE_ERR_UNKNOWN_REGION;
+    if (offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+    if (offset + size > mrid->size) size = mrid->size - offset;
+
+    /* the region outlives the response, so no copy is needed */
+    *data      = ptr + offset;
+    *data_size = size;
+
+    return BAKE_SUCCESS;
+}
+
+static int bake_mem_read_bulk(backend_context_t context,
+                              bake_region_id_t  rid,
+                              size_t            region_offset,
+                              size_t            size,
+                              hg_bulk_t         bulk,
+                              hg_addr_t         source,
+                              size_t            bulk_offset,
+                              size_t*           bytes_read)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid.data;
+    hg_bulk_t         local_bulk;
+    size_t            local_offset;
+    hg_return_t       hret;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED)
+        return g_bake_file_backend._read_bulk(spill_target(entry), rid,
+                                              region_offset, size, bulk,
+                                              source, bulk_offset, bytes_read);
+
+    *bytes_read = 0;
+
+    if (!region_data(entry, mrid, &local_bulk, &local_offset))
+        return BAKE_ERR_UNKNOWN_REGION;
+    if (region_offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+    if (region_offset + size > mrid->size) size = mrid->size - region_offset;
+
+    hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PUSH, source,
+                              bulk, bulk_offset, local_bulk,
+                              local_offset + region_offset, size);
+    if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+
+    *bytes_read = size;
+    return BAKE_SUCCESS;
+}
+
+static int bake_mem_persist(backend_context_t context,
+                            bake_region_id_t  rid,
+                            size_t            offset,
+                            size_t            size)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED)
+        return g_bake_file_backend._persist(spill_target(entry), rid, offset,
+                                            size);
+
+    /* DRAM is as persistent as it gets */
+    if (!region_data(entry, (mem_region_id_t*)rid.data, NULL, NULL))
+        return BAKE_ERR_UNKNOWN_REGION;
+    return BAKE_SUCCESS;
+}
+
+static int bake_mem_get_region_size(backend_context_t context,
+                                    bake_region_id_t  rid,
+                                    size_t*           size)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid.data;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED)
+        return g_bake_file_backend._get_region_size(spill_target(entry), rid,
+                                                    size);
+
+    if (!region_data(entry, mrid, NULL, NULL)) return BAKE_ERR_UNKNOWN_REGION;
+    *size = mrid->size;
+    return BAKE_SUCCESS;
+}
+
+static int bake_mem_get_region_data(backend_context_t context,
+                                    bake_region_id_t  rid,
+                                    void**            data)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid.data;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED)
+        return g_bake_file_backend._get_region_data(spill_target(entry), rid,
+                                                    data);
+
+    *data = region_data(entry, mrid, NULL, NULL);
+    if (!*data) return BAKE_ERR_UNKNOWN_REGION;
+    return BAKE_SUCCESS;
+}
+
+static int bake_mem_remove(backend_context_t context, bake_region_id_t rid)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid  = (mem_region_id_t*)rid.data;
+    mem_class_t*      class;
+    unsigned          shift;
+    uint64_t *        word, mask;
+    int               ret;
+
+    if (rid.type == BAKE_MEM_REGION_SPILLED) {
+        ret = g_bake_file_backend._remove(spill_target(entry), rid);
+        if (ret == BAKE_SUCCESS)
+            __atomic_sub_fetch(&entry->num_spilled, 1, __ATOMIC_RELAXED);
+        return ret;
+    }
+
+    class = find_class(entry, mrid->size);
+    if (class) {
+        shift = slot_shift(entry->classes, class);
+        word  = allocated_word(class, shift, mrid->handle, &mask);
+        /* only the remove that clears the bit gives the slot back */
+        if (!word || !(__atomic_fetch_and(word, ~mask, __ATOMIC_ACQ_REL) & mask))
+            return BAKE_ERR_UNKNOWN_REGION;
+        push_slots(class, shift, (uint32_t)mrid->handle,
+                   (uint32_t)mrid->handle);
+    } else {
+        ret = free_large(entry, mrid->handle);
+        if (ret != BAKE_SUCCESS) return ret;
+    }
+
+    __atomic_sub_fetch(&entry->allocated, footprint(entry, mrid->size),
+                       __ATOMIC_RELAXED);
+    return BAKE_SUCCESS;
+}
+
+static int bake_mem_migrate_region(backend_context_t context,
+                                   bake_region_id_t  source_rid,
+                                   size_t            region_size,
+                                   int               remove_source,
+                                   const char*       dest_addr_str,
+                                   uint16_t          dest_provider_id,
+                                   bake_target_id_t  dest_target_id,
+                                   bake_region_id_t* dest_rid)
+{
+    bake_mem_entry_t* entry     = (bake_mem_entry_t*)context;
+    mem_region_id_t*  mrid      = (mem_region_id_t*)source_rid.data;
+    hg_addr_t         dest_addr = HG_ADDR_NULL;
+    int               ret       = BAKE_SUCCESS;
+
+    if (source_rid.type == BAKE_MEM_REGION_SPILLED) {
+        ret = g_bake_file_backend._migrate_region(
+            spill_target(entry), source_rid, region_size, remove_source,
+            dest_addr_str, dest_provider_id, dest_target_id, dest_rid);
+        if (ret == BAKE_SUCCESS && remove_source)
+            __atomic_sub_fetch(&entry->num_spilled, 1, __ATOMIC_RELAXED);
+        return ret;
+    }
+
+    if (region_size != mrid->size) {
+        ret = BAKE_ERR_INVALID_ARG;
+        goto finish;
+    }
+
+    /* lookup the address of the destination provider */
+    hg_return_t hret
+        = margo_addr_lookup(entry->provider->mid, dest_addr_str, &dest_addr);
+    if (hret != HG_SUCCESS) {
+        ret = BAKE_ERR_MERCURY;
+        goto finish;
+    }
+
+    { /* in this block we issue a create_write_persist to the destination */
+        hg_handle_t                     cwp_handle = HG_HANDLE_NULL;
+        bake_create_write_persist_in_t  cwp_in     = {0};
+        bake_create_write_persist_out_t cwp_out;
+
+        char* data = region_data(entry, mrid, NULL, NULL);
+
+        if (!data) {
+            ret = BAKE_ERR_UNKNOWN_REGION;
+            goto finish_scope;
+        }
+        cwp_in.bti             = dest_target_id;
+        cwp_in.region_size     = region_size;
+        cwp_in.bulk_offset     = 0;
+        cwp_in.bulk_size       = region_size;
+        cwp_in.remote_addr_str = NULL;
+        /* the copy is a migration for the destination's scheduler */
+        cwp_in.qos_class = BAKE_QOS_CLASS_BACKGROUND;
+        cwp_in.req_id    = bake_trace_current_request();
+
+        /* not all backends handle a non-zero bulk offset, so expose just
+         * this region rather than the registration of its slab
+         */
+        hret = margo_bulk_create(entry->provider->mid, 1, (void**)(&data),
+                                 &region_size, HG_BULK_READ_ONLY,
+                                 &cwp_in.bulk_handle);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        hret = margo_create(entry->provider->mid, dest_addr,
+                            entry->provider->bake_create_write_persist_id,
+                            &cwp_handle);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        hret = margo_provider_forward(dest_provider_id, cwp_handle, &cwp_in);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        hret = margo_get_output(cwp_handle, &cwp_out);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        if (cwp_out.ret != BAKE_SUCCESS) {
+            ret = cwp_out.ret;
+            margo_free_output(cwp_handle, &cwp_out);
+            goto finish_scope;
+        }
+
+        *dest_rid = cwp_out.rid;
+        ret       = BAKE_SUCCESS;
+        margo_free_output(cwp_handle, &cwp_out);
+
+finish_scope:
+        margo_bulk_free(cwp_in.bulk_handle);
+        margo_destroy(cwp_handle);
+    } /* end of create-write-persist block */
+
+    if (ret != BAKE_SUCCESS) goto finish;
+
+    if (remove_source) ret = bake_mem_remove(context, source_rid);
+
+finish:
+    margo_addr_free(entry->provider->mid, dest_addr);
+    return ret;
+}
+
+#ifdef USE_REMI
+static int bake_mem_create_fileset(backend_context_t context,
+                                   remi_fileset_t*   fileset)
+{
+    /* there are no files to migrate */
+    *fileset = NULL;
+    return BAKE_ERR_OP_UNSUPPORTED;
+}
+#endif
+
+/* opens the file target that regions go to once the capacity is reached */
+static int set_spill_target(bake_mem_entry_t* entry, const char* path)
+{
+    bake_target_id_t  tid;
+    backend_context_t spill;
+    int               ret = BAKE_SUCCESS;
+
+    if (strncmp(path, "file:", 5) == 0) path += 5;
+
+    ABT_mutex_lock(entry->spill_mutex);
+    /* spilled regions would be lost if the spill target changed */
+    if (entry->spill) {
+        ret = BAKE_ERR_FORBIDDEN;
+        goto finish;
+    }
+    ret = g_bake_file_backend._initialize(entry->provider, path, &tid, &spill);
+    if (ret != BAKE_SUCCESS) goto finish;
+    entry->spill_path = strdup(path);
+    __atomic_store_n(&entry->spill, spill, __ATOMIC_RELEASE);
+
+finish:
+    ABT_mutex_unlock(entry->spill_mutex);
+    return ret;
+}
+
+static int bake_mem_set_conf(backend_context_t context,
+                             const char*       key,
+                             const char*       value)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+
+    if (strcmp(key, "capacity") == 0) {
+        if (sscanf(value, "%zu", &entry->capacity) != 1)
+            return BAKE_ERR_INVALID_ARG;
+        return BAKE_SUCCESS;
+    }
+    if (strcmp(key, "spill_target") == 0) return set_spill_target(entry, value);
+    /* the spill target's own settings */
+    if (strncmp(key, "spill.", 6) == 0) {
+        if (!spill_target(entry)) return BAKE_ERR_INVALID_ARG;
+        return g_bake_file_backend._set_conf(spill_target(entry), key + 6,
+                                             value);
+    }
+    return BAKE_ERR_OP_UNSUPPORTED;
+}
+
+static int bake_mem_get_stats(backend_context_t context, FILE* out)
+{
+    bake_mem_entry_t* entry = (bake_mem_entry_t*)context;
+    unsigned          i, num_slabs;
+
+    fprintf(out, "capacity = %zu\n", entry->capacity);
+    fprintf(out, "allocated = %" PRIu64 "\n",
+            __atomic_load_n(&entry->allocated, __ATOMIC_RELAXED));
+    for (i = 0; i < BAKE_MEM_NUM_CLASSES; i++) {
+        num_slabs = __atomic_load_n(&entry->classes[i].num_slabs,
+                                    __ATOMIC_RELAXED);
+        if (num_slabs)
+            fprintf(out, "class.%zu.slabs = %u\n",
+                    (size_t)1 << (BAKE_MEM_MIN_SLOT_SHIFT + i), num_slabs);
+    }
+    fprintf(out, "spill_target = %s\n",
+            spill_target(entry) ? entry->spill_path : "");
+    fprintf(out, "spilled_regions = %" PRIu64 "\n",
+            __atomic_load_n(&entry->num_spilled, __ATOMIC_RELAXED));
+    return BAKE_SUCCESS;
+}
+
+bake_backend g_bake_mem_backend
+    = {.name                       = "mem",
+       ._initialize                = bake_mem_backend_initialize,
+       ._finalize                  = bake_mem_backend_finalize,
+       ._create                    = bake_mem_create,
+       ._write_raw                 = bake_mem_write_raw,
+       ._write_bulk                = bake_mem_write_bulk,
+       ._read_raw                  = bake_mem_read_raw,
+       ._read_bulk                 = bake_mem_read_bulk,
+       ._persist                   = bake_mem_persist,
+       ._create_write_persist_raw  = NULL, /* use default implementation */
+       ._create_write_persist_bulk = NULL, /* use default implementation */
+       ._get_region_size           = bake_mem_get_region_size,
+       ._get_region_data           = bake_mem_get_region_data,
+       ._remove                    = bake_mem_remove,
+       ._migrate_region            = bake_mem_migrate_region,
+#ifdef USE_REMI
+       ._create_fileset = bake_mem_create_fileset,
+#endif
+       ._set_conf  = bake_mem_set_conf,
+       ._get_stats = bake_mem_get_stats};
@@ -0,0 +1,177 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <abt.h>
+#include "bake-metrics.h"
+
+#define METRICS_ADD(x, n)  __atomic_add_fetch(&(x), (n), __ATOMIC_RELAXED)
+#define METRICS_READ(x)    __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+static const char* g_metric_names[BAKE_METRICS_NUM] = {
+#define X(name) "rpc." #name,
+    BAKE_METRICS_RPCS(X)
+#undef X
+#define X(name) "backend." #name,
+    BAKE_METRICS_BACKEND_CALLS(X)
+#undef X
+};
+
+typedef struct {
+    uint64_t count;
+    uint64_t errors;
+    uint64_t bytes;
+    uint64_t latency_ns;
+    uint64_t max_latency_ns;
+    uint64_t latency_histogram[BAKE_METRICS_BUCKETS];
+    uint64_t size_histogram[BAKE_METRICS_BUCKETS];
+} metric_counters_t;
+
+/* counters of one execution stream; several streams only share a shard if
+ * there are more than BAKE_METRICS_MAX_XSTREAMS of them */
+typedef struct {
+    metric_counters_t metrics[BAKE_METRICS_NUM];
+} metrics_shard_t;
+
+struct bake_metrics {
+    uint64_t         created;
+    metrics_shard_t* shards[BAKE_METRICS_MAX_XSTREAMS];
+};
+
+bake_metrics_t bake_metrics_create(void)
+{
+    struct bake_metrics* m = calloc(1, sizeof(*m));
+
+    if (m) m->created = bake_metrics_now();
+    return m;
+}
+
+void bake_metrics_destroy(bake_metrics_t m)
+{
+    unsigned i;
+
+    if (!m) return;
+    for (i = 0; i < BAKE_METRICS_MAX_XSTREAMS; i++) free(m->shards[i]);
+    free(m);
+}
+
+/* finds (and allocates on first use) the shard of the calling xstream */
+static metrics_shard_t* get_shard(struct bake_metrics* m)
+{
+    metrics_shard_t* shard;
+    metrics_shard_t* expected = NULL;
+    int              rank     = 0;
+
+    ABT_xstream_self_rank(&rank);
+    rank %= BAKE_METRICS_MAX_XSTREAMS;
+
+    shard = __atomic_load_n(&m->shards[rank], __ATOMIC_ACQUIRE);
+    if (shard) return shard;
+
+    shard = calloc(1, sizeof(*shard));
+    if (!shard) return NULL;
+    if (!__atomic_compare_exchange_n(&m->shards[rank], &expected, shard, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        /* another ULT on this xstream allocated it first */
+        free(shard);
+        return expected;
+    }
+    return shard;
+}
+
+void bake_metrics_record(bake_metrics_t m,
+                         int            metric,
+                         uint64_t       start,
+                         uint64_t       size,
+                         int            ret)
+{
+    metrics_shard_t*   shard;
+    metric_counters_t* c;
+    uint64_t           t = bake_metrics_now() - start;
+    uint64_t           max;
+
+    if (!m || !(shard = get_shard(m))) return;
+    c = &shard->metrics[metric];
+    METRICS_ADD(c->count, 1);
+    if (ret != 0) METRICS_ADD(c->errors, 1);
+    METRICS_ADD(c->latency_ns, t);
+    METRICS_ADD(c->latency_histogram[bake_metrics_bucket(t)], 1);
+    if (size) {
+        METRICS_ADD(c->bytes, size);
+        METRICS_ADD(c->size_histogram[bake_metrics_bucket(size)], 1);
+    }
+    max = METRICS_READ(c->max_latency_ns);
+    while (t > max
+           && !__atomic_compare_exchange_n(&c->max_latency_ns, &max, t, 1,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void print_histogram(const char*    name,
+                            const char*    kind,
+                            const uint64_t histogram[],
+                            FILE*          out)
+{
+    unsigned b;
+
+    fprintf(out, "metrics.%s.%s =", name, kind);
+    for (b = 0; b < BAKE_METRICS_BUCKETS; b++)
+        if (histogram[b])
+            fprintf(out, " %" PRIu64 ":%" PRIu64, bake_metrics_bucket_lower(b),
+                    histogram[b]);
+    fprintf(out, "\n");
+}
+
+void bake_metrics_print_stats(bake_metrics_t m, FILE* out)
+{
+    metric_counters_t sum;
+    metrics_shard_t*  shard;
+    unsigned          i, s, b, nshards = 0;
+
+    for (s = 0; s < BAKE_METRICS_MAX_XSTREAMS; s++)
+        if (__atomic_load_n(&m->shards[s], __ATOMIC_ACQUIRE)) nshards++;
+    fprintf(out, "metrics.time = %f\n",
+            (bake_metrics_now() - m->created) / 1e9);
+    fprintf(out, "metrics.xstreams = %u\n", nshards);
+
+    for (i = 0; i < BAKE_METRICS_NUM; i++) {
+        memset(&sum, 0, sizeof(sum));
+        for (s = 0; s < BAKE_METRICS_MAX_XSTREAMS; s++) {
+            metric_counters_t* c;
+
+            shard = __atomic_load_n(&m->shards[s], __ATOMIC_ACQUIRE);
+            if (!shard) continue;
+            c = &shard->metrics[i];
+            sum.count += METRICS_READ(c->count);
+            sum.errors += METRICS_READ(c->errors);
+            sum.bytes += METRICS_READ(c->bytes);
+            sum.latency_ns += METRICS_READ(c->latency_ns);
+            if (METRICS_READ(c->max_latency_ns) > sum.max_latency_ns)
+                sum.max_latency_ns = METRICS_READ(c->max_latency_ns);
+            for (b = 0; b < BAKE_METRICS_BUCKETS; b++) {
+                sum.latency_histogram[b]
+                    += METRICS_READ(c->latency_histogram[b]);
+                sum.size_histogram[b] += METRICS_READ(c->size_histogram[b]);
+            }
+        }
+        if (!sum.count) continue;
+        fprintf(out,
+                "metrics.%s = count %" PRIu64 " errors %" PRIu64
+                " bytes %" PRIu64 " latency_ns %" PRIu64
+                " max_latency_ns %" PRIu64 "\n",
+                g_metric_names[i], sum.count, sum.errors, sum.bytes,
+                sum.latency_ns, sum.max_latency_ns);
+        print_histogram(g_metric_names[i], "latency_ns", sum.latency_histogram,
+                        out);
+        if (sum.bytes)
+            print_histogram(g_metric_names[i], "size", sum.size_histogram,
+                            out);
+    }
+}
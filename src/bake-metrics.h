@@ -0,0 +1,140 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_METRICS_H
+#define __BAKE_METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/* bake-metrics
+ *
+ * Always-on counters of a provider's RPCs and backend calls: number of
+ * calls and errors, bytes, and log-linear histograms of latency (in
+ * nanoseconds) and size (in bytes).  Each execution stream updates its own
+ * lazily allocated shard with relaxed atomic additions, so recording takes
+ * no lock and rarely shares a cache line; shards are only merged when the
+ * statistics are printed.
+ */
+
+#define BAKE_METRICS_RPCS(X)                                           \
+    X(create)                                                          \
+    X(write)                                                           \
+    X(eager_write)                                                     \
+    X(persist)                                                         \
+    X(create_write_persist)                                            \
+    X(eager_create_write_persist)                                      \
+    X(get_size)                                                        \
+    X(get_data)                                                        \
+    X(read)                                                            \
+    X(eager_read)                                                      \
+    X(probe)                                                           \
+    X(noop)                                                            \
+    X(remove)                                                          \
+    X(migrate_region)                                                  \
+    X(migrate_target)                                                  \
+    X(get_stats)                                                       \
+    X(get_credits)
+
+#define BAKE_METRICS_BACKEND_CALLS(X)                                  \
+    X(create)                                                          \
+    X(write_raw)                                                       \
+    X(write_bulk)                                                      \
+    X(read_raw)                                                        \
+    X(read_bulk)                                                       \
+    X(persist)                                                         \
+    X(create_write_persist_raw)                                        \
+    X(create_write_persist_bulk)                                       \
+    X(get_region_size)                                                 \
+    X(get_region_data)                                                 \
+    X(remove)                                                          \
+    X(migrate_region)                                                  \
+    X(create_fileset)
+
+#define BAKE_METRIC_RPC(name)     BAKE_METRIC_RPC_##name
+#define BAKE_METRIC_BACKEND(name) BAKE_METRIC_BACKEND_##name
+
+enum {
+#define X(name) BAKE_METRIC_RPC(name),
+    BAKE_METRICS_RPCS(X)
+#undef X
+#define X(name) BAKE_METRIC_BACKEND(name),
+    BAKE_METRICS_BACKEND_CALLS(X)
+#undef X
+    BAKE_METRICS_NUM
+};
+
+#define BAKE_METRICS_MAX_XSTREAMS 64
+
+/* log-linear buckets: values below 4 have a bucket each, and every power
+ * of two above is split in 4 equal buckets, for a relative error of at
+ * most 25% */
+#define BAKE_METRICS_SUB_BUCKETS 4
+#define BAKE_METRICS_BUCKETS     (4 + 62 * BAKE_METRICS_SUB_BUCKETS)
+
+static inline unsigned bake_metrics_bucket(uint64_t v)
+{
+    unsigned msb;
+
+    if (v < 4) return (unsigned)v;
+    msb = 63 - __builtin_clzll(v);
+    return 4 + (msb - 2) * BAKE_METRICS_SUB_BUCKETS
+         + (unsigned)((v >> (msb - 2)) & 3);
+}
+
+/* smallest value that falls in a bucket */
+static inline uint64_t bake_metrics_bucket_lower(unsigned b)
+{
+    unsigned msb;
+
+    if (b < 4) return b;
+    msb = (b - 4) / BAKE_METRICS_SUB_BUCKETS + 2;
+    return (uint64_t)(4 + (b - 4) % BAKE_METRICS_SUB_BUCKETS) << (msb - 2);
+}
+
+/* largest value that falls in a bucket */
+static inline uint64_t bake_metrics_bucket_upper(unsigned b)
+{
+    if (b < 4) return b;
+    return bake_metrics_bucket_lower(b)
+         + ((uint64_t)1 << ((b - 4) / BAKE_METRICS_SUB_BUCKETS)) - 1;
+}
+
+/* monotonic time in nanoseconds */
+static inline uint64_t bake_metrics_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+typedef struct bake_metrics* bake_metrics_t;
+
+bake_metrics_t bake_metrics_create(void);
+
+void bake_metrics_destroy(bake_metrics_t metrics);
+
+/**
+ * Accounts for a call of the given metric that started at start (from
+ * bake_metrics_now), moved size bytes and returned ret.  Does nothing if
+ * metrics is NULL.
+ */
+void bake_metrics_record(bake_metrics_t metrics,
+                         int            metric,
+                         uint64_t       start,
+                         uint64_t       size,
+                         int            ret);
+
+/**
+ * Merges the shards and prints, for every metric called at least once, a
+ * "metrics.<rpc|backend>.<name>" line with its counters and the sparse
+ * "latency_ns" and "size" histograms as "<bucket lower bound>:<count>"
+ * pairs.
+ */
+void bake_metrics_print_stats(bake_metrics_t metrics, FILE* out);
+
+#endif
@@ -25,7 +25,14 @@ void usage(int argc, char* argv[])
     fprintf(stderr,
             "       pmem_pool is the path to the pmemobj pool to create\n");
     fprintf(stderr,
-            "           (prepend pmem: or file: to specify backend format)\n");
+            "           (prepend pmem:, file:, mmap: or mem: to specify "
+            "backend format)\n");
+    fprintf(stderr,
+            "           (pmem: pools may be a comma-separated list of files "
+            "making up one target)\n");
+    fprintf(stderr,
+            "           (tier: may be prepended to any of these, e.g. "
+            "tier:file:foo.dat)\n");
     fprintf(stderr,
             "       [-s size] create pool file named <pmem_pool> with "
             "specified size (K, M, G, etc. suffixes allowed)\n");
@@ -101,6 +108,8 @@ void parse_args(int argc, char* argv[], struct options* opts)
  */
 extern int
 bake_file_makepool(const char* file_name, size_t file_size, mode_t file_mode);
+extern int
+bake_mmap_makepool(const char* file_name, size_t file_size, mode_t file_mode);
 
 int main(int argc, char* argv[])
 {
@@ -110,6 +119,9 @@ int main(int argc, char* argv[])
 
     parse_args(argc, argv, &opts);
 
+    /* a tier: target is made of the target that follows the prefix */
+    if (strncmp(opts.pmem_pool, "tier:", 5) == 0) opts.pmem_pool += 5;
+
     /* figure out the backend by searching until the ":" in the file name */
     char* tmp = strchr(opts.pmem_pool, ':');
     if (tmp != NULL) {
@@ -127,6 +139,14 @@ int main(int argc, char* argv[])
         fprintf(stderr, "Backend type is file\n");
         ret = bake_file_makepool(opts.pmem_pool, opts.pool_size,
                                  opts.pool_mode);
+    } else if (strcmp(backend_type, "mmap") == 0) {
+        fprintf(stderr, "Backend type is mmap\n");
+        ret = bake_mmap_makepool(opts.pmem_pool, opts.pool_size,
+                                 opts.pool_mode);
+    } else if (strcmp(backend_type, "mem") == 0) {
+        /* accepted so that scripts can treat all backends alike */
+        fprintf(stderr, "Backend type is mem, which needs no pool\n");
+        ret = BAKE_SUCCESS;
     } else {
         fprintf(stderr, "ERROR: unknown backend type \"%s\"\n", backend_type);
         free(backend_type);
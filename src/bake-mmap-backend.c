@@ -0,0 +1,603 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+/* for FALLOC_FL_* */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bake-config.h"
+#include "bake.h"
+#include "bake-rpc.h"
+#include "bake-server.h"
+#include "bake-provider.h"
+#include "bake-backend.h"
+#include "bake-io-engine.h"
+
+/* bake-mmap-backend
+ *
+ * This is an implementation of a back end for the Bake provider that stores
+ * all data in a single preallocated POSIX file, mapped into memory.  Regions
+ * are allocated from the front of the file by bumping an offset kept in the
+ * header block.  Eager accesses are plain memcpys to or from the mapping,
+ * and bulk accesses transfer directly to or from the mapping, which is
+ * registered with Mercury once when the target is opened.  Persist is an
+ * msync() of the pages covering the persisted range, run by the I/O engine
+ * of the device so that it does not block the caller's execution stream.
+ *
+ * Unlike the file backend this does not use directio, so it works on tmpfs
+ * and benefits from the page cache.
+ */
+
+/* regions are aligned to a cache line within the mapping */
+#define BAKE_MMAP_REGION_ALIGNMENT 64
+#define BAKE_MMAP_ALIGN_UP(x, a)   ((((unsigned long)(x)) + (a)-1) & ~((a)-1))
+#define BAKE_MMAP_ALIGN_DOWN(x, a) (((unsigned long)(x)) & ~((a)-1))
+
+/* definition of BAKE root data structure, kept at the start of the file */
+typedef struct {
+    bake_target_id_t pool_id;
+    uint64_t         data_offset; /* offset of the first region */
+    uint64_t         log_offset;  /* next available unused offset */
+} bake_mmap_root_t;
+
+/* definition of internal BAKE region_id_t identifier for mmap back end */
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+} mmap_region_id_t;
+
+typedef struct {
+    bake_provider_t   provider;
+    int               fd;
+    char*             base;      /* start of the mapping */
+    size_t            size;      /* size of the file and of the mapping */
+    size_t            page_size;
+    hg_bulk_t         bulk;      /* registration of the whole mapping */
+    bake_mmap_root_t* mmap_root; /* header, at the start of the mapping */
+    ABT_mutex log_offset_mutex;  /* protects mmap_root->log_offset */
+    bake_io_engine_t io;         /* runs the msyncs */
+    char*     root;
+    char*     filename;
+} bake_mmap_entry_t;
+
+/* syncs the pages covering [offset, offset + size) of the mapping */
+static int mmap_sync_range(bake_mmap_entry_t* entry, size_t offset, size_t size)
+{
+    size_t start = BAKE_MMAP_ALIGN_DOWN(offset, entry->page_size);
+    size_t end   = BAKE_MMAP_ALIGN_UP(offset + size, entry->page_size);
+    int    ret;
+
+    if (end > entry->size) end = entry->size;
+    if (end <= start) return BAKE_SUCCESS;
+
+    ret = bake_io_msync(entry->io, entry->base + start, end - start,
+                        MS_SYNC);
+    if (ret != 0) {
+        fprintf(stderr, "msync: %s\n", strerror(-ret));
+        return BAKE_ERR_IO;
+    }
+    return BAKE_SUCCESS;
+}
+
+int bake_mmap_makepool(const char* file_name,
+                       size_t      file_size,
+                       mode_t      file_mode)
+{
+    int              fd = -1;
+    bake_mmap_root_t root;
+    size_t           page_size = sysconf(_SC_PAGESIZE);
+    int              ret;
+
+    if (file_size <= page_size) {
+        fprintf(stderr,
+                "Error: the mmap backend needs a pool size (-s) larger than "
+                "%zu bytes\n",
+                page_size);
+        return (BAKE_ERR_INVALID_ARG);
+    }
+
+    fd = open(file_name, O_EXCL | O_RDWR | O_CREAT, file_mode);
+    if (fd < 0) {
+        perror("open");
+        return (BAKE_ERR_IO);
+    }
+
+    /* reserve the blocks now: stores to a mapping have no way to report
+     * that the file system ran out of space, other than a SIGBUS */
+    ret = posix_fallocate(fd, 0, file_size);
+    if (ret != 0) {
+        fprintf(stderr, "posix_fallocate: %s\n", strerror(ret));
+        goto error;
+    }
+
+    /* the first page holds the root; regions start right after it */
+    memset(&root, 0, sizeof(root));
+    uuid_generate(root.pool_id.id);
+    root.data_offset = page_size;
+    root.log_offset  = page_size;
+
+    ret = pwrite(fd, &root, sizeof(root), 0);
+    if (ret != sizeof(root)) {
+        perror("pwrite");
+        goto error;
+    }
+
+    ret = fsync(fd);
+    if (ret != 0) {
+        perror("fsync");
+        goto error;
+    }
+
+    close(fd);
+
+    return BAKE_SUCCESS;
+
+error:
+    close(fd);
+    unlink(file_name);
+    return (BAKE_ERR_IO);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mmap_backend_initialize(bake_provider_t    provider,
+                                        const char*        path,
+                                        bake_target_id_t*  target,
+                                        backend_context_t* context)
+{
+    int                ret       = BAKE_SUCCESS;
+    bake_mmap_entry_t* new_entry = calloc(1, sizeof(*new_entry));
+    const char*        tmp;
+    ptrdiff_t          d;
+    struct stat        statbuf;
+    hg_size_t          bulk_size;
+    hg_return_t        hret;
+
+    new_entry->provider  = provider;
+    new_entry->fd        = -1;
+    new_entry->base      = MAP_FAILED;
+    new_entry->bulk      = HG_BULK_NULL;
+    new_entry->page_size = sysconf(_SC_PAGESIZE);
+
+    tmp = strrchr(path, '/');
+    if (!tmp) tmp = path;
+    new_entry->filename = strdup(tmp);
+    d                   = tmp - path;
+    new_entry->root     = strndup(path, d);
+
+    new_entry->fd = open(path, O_RDWR);
+    if (new_entry->fd < 0) {
+        perror("open");
+        ret = BAKE_ERR_IO;
+        goto error_cleanup;
+    }
+
+    new_entry->io = bake_io_engine_acquire(path);
+    if (!new_entry->io) {
+        ret = BAKE_ERR_IO;
+        goto error_cleanup;
+    }
+
+    ret = fstat(new_entry->fd, &statbuf);
+    if (ret < 0) {
+        perror("fstat");
+        ret = BAKE_ERR_IO;
+        goto error_cleanup;
+    }
+    new_entry->size = statbuf.st_size;
+    if (new_entry->size < sizeof(bake_mmap_root_t)) {
+        fprintf(stderr, "Error: BAKE pool %s is not properly formatted\n",
+                path);
+        ret = BAKE_ERR_IO;
+        goto error_cleanup;
+    }
+
+    new_entry->base = mmap(NULL, new_entry->size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, new_entry->fd, 0);
+    if (new_entry->base == MAP_FAILED) {
+        perror("mmap");
+        ret = BAKE_ERR_IO;
+        goto error_cleanup;
+    }
+
+    /* check to make sure the root is properly set */
+    new_entry->mmap_root = (bake_mmap_root_t*)new_entry->base;
+    *target              = new_entry->mmap_root->pool_id;
+    if (uuid_is_null(target->id)
+        || new_entry->mmap_root->data_offset < sizeof(bake_mmap_root_t)
+        || new_entry->mmap_root->log_offset < new_entry->mmap_root->data_offset
+        || new_entry->mmap_root->log_offset > new_entry->size) {
+        fprintf(stderr, "Error: BAKE pool %s is not properly formatted\n",
+                path);
+        ret = BAKE_ERR_IO;
+        goto error_cleanup;
+    }
+
+    /* register the whole mapping once; bulk transfers use offsets into it */
+    bulk_size = new_entry->size;
+    hret = margo_bulk_create(provider->mid, 1, (void**)(&new_entry->base),
+                             &bulk_size, HG_BULK_READWRITE, &new_entry->bulk);
+    if (hret != HG_SUCCESS) {
+        ret = BAKE_ERR_MERCURY;
+        goto error_cleanup;
+    }
+
+    ABT_mutex_create(&new_entry->log_offset_mutex);
+
+    *context = new_entry;
+    return 0;
+
+error_cleanup:
+    if (new_entry->bulk != HG_BULK_NULL) margo_bulk_free(new_entry->bulk);
+    if (new_entry->base != MAP_FAILED) munmap(new_entry->base, new_entry->size);
+    if (new_entry->fd > -1) close(new_entry->fd);
+    bake_io_engine_release(new_entry->io);
+    free(new_entry->filename);
+    free(new_entry->root);
+    free(new_entry);
+    return (ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mmap_backend_finalize(backend_context_t context)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+
+    margo_bulk_free(entry->bulk);
+    msync(entry->base, entry->size, MS_SYNC);
+    munmap(entry->base, entry->size);
+    close(entry->fd);
+    bake_io_engine_release(entry->io);
+    ABT_mutex_free(&entry->log_offset_mutex);
+    free(entry->filename);
+    free(entry->root);
+    free(entry);
+
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int
+bake_mmap_create(backend_context_t context, size_t size, bake_region_id_t* rid)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid->data;
+    size_t             aligned_size;
+
+    assert(sizeof(mmap_region_id_t) <= BAKE_REGION_ID_DATA_SIZE);
+
+    aligned_size = BAKE_MMAP_ALIGN_UP(size, BAKE_MMAP_REGION_ALIGNMENT);
+
+    ABT_mutex_lock(entry->log_offset_mutex);
+    if (entry->mmap_root->log_offset + aligned_size > entry->size) {
+        ABT_mutex_unlock(entry->log_offset_mutex);
+        return BAKE_ERR_ALLOCATION;
+    }
+    mrid->offset = entry->mmap_root->log_offset;
+    mrid->size   = size;
+    entry->mmap_root->log_offset += aligned_size;
+    ABT_mutex_unlock(entry->log_offset_mutex);
+
+    /* make the new log offset durable so that a restarted daemon does not
+     * hand out space that was promised to this region
+     */
+    return mmap_sync_range(entry, 0, sizeof(bake_mmap_root_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mmap_write_raw(backend_context_t context,
+                               bake_region_id_t  rid,
+                               size_t            offset,
+                               size_t            size,
+                               const void*       data)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid.data;
+
+    if (size + offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+
+    memcpy(entry->base + mrid->offset + offset, data, size);
+
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_mmap_write_bulk(backend_context_t context,
+                                bake_region_id_t  rid,
+                                size_t            region_offset,
+                                size_t            size,
+                                hg_bulk_t         bulk,
+                                hg_addr_t         source,
+                                size_t            bulk_offset)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid.data;
+    hg_return_t        hret;
+
+    if (size + region_offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+
+    hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PULL, source,
+                              bulk, bulk_offset, entry->bulk,
+                              mrid->offset + region_offset, size);
+    if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+
+    return BAKE_SUCCESS;
+}
+
+static int bake_mmap_read_raw(backend_context_t context,
+                              bake_region_id_t  rid,
+                              size_t            offset,
+                              size_t            size,
+                              void**            data,
+                              uint64_t*         data_size,
+                              free_fn*          free_data)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid.data;
+
+    *free_data = NULL;
+    *data      = NULL;
+    *data_size = 0;
+
+    if (offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+    if (offset + size > mrid->size) size = mrid->size - offset;
+
+    /* the mapping outlives the response, so no copy is needed */
+    *data      = entry->base + mrid->offset + offset;
+    *data_size = size;
+
+    return BAKE_SUCCESS;
+}
+
+static int bake_mmap_read_bulk(backend_context_t context,
+                               bake_region_id_t  rid,
+                               size_t            region_offset,
+                               size_t            size,
+                               hg_bulk_t         bulk,
+                               hg_addr_t         source,
+                               size_t            bulk_offset,
+                               size_t*           bytes_read)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid.data;
+    hg_return_t        hret;
+
+    *bytes_read = 0;
+
+    if (region_offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+    if (region_offset + size > mrid->size) size = mrid->size - region_offset;
+
+    hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PUSH, source,
+                              bulk, bulk_offset, entry->bulk,
+                              mrid->offset + region_offset, size);
+    if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+
+    *bytes_read = size;
+    return BAKE_SUCCESS;
+}
+
+static int bake_mmap_persist(backend_context_t context,
+                             bake_region_id_t  rid,
+                             size_t            offset,
+                             size_t            size)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid.data;
+
+    if (offset > mrid->size) return BAKE_ERR_OUT_OF_BOUNDS;
+    if (offset + size > mrid->size) size = mrid->size - offset;
+
+    /* unlike the file backend, only the pages of this range get synced */
+    return mmap_sync_range(entry, mrid->offset + offset, size);
+}
+
+static int bake_mmap_get_region_size(backend_context_t context,
+                                     bake_region_id_t  rid,
+                                     size_t*           size)
+{
+    mmap_region_id_t* mrid = (mmap_region_id_t*)rid.data;
+    *size                  = mrid->size;
+    return BAKE_SUCCESS;
+}
+
+static int bake_mmap_get_region_data(backend_context_t context,
+                                     bake_region_id_t  rid,
+                                     void**            data)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid.data;
+
+    if (mrid->offset + mrid->size > entry->size) return BAKE_ERR_UNKNOWN_REGION;
+    *data = entry->base + mrid->offset;
+    return BAKE_SUCCESS;
+}
+
+static int bake_mmap_remove(backend_context_t context, bake_region_id_t rid)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid  = (mmap_region_id_t*)rid.data;
+
+    /* Space is not reused for new regions, as with the file backend's log.
+     * The blocks are not punched out either: the file stays fully
+     * allocated, so that stores to the mapping never hit a hole the file
+     * system has no room to fill.
+     */
+    if (mrid->offset + mrid->size > entry->size) return BAKE_ERR_UNKNOWN_REGION;
+
+    return BAKE_SUCCESS;
+}
+
+static int bake_mmap_migrate_region(backend_context_t context,
+                                    bake_region_id_t  source_rid,
+                                    size_t            region_size,
+                                    int               remove_source,
+                                    const char*       dest_addr_str,
+                                    uint16_t          dest_provider_id,
+                                    bake_target_id_t  dest_target_id,
+                                    bake_region_id_t* dest_rid)
+{
+    bake_mmap_entry_t* entry     = (bake_mmap_entry_t*)context;
+    mmap_region_id_t*  mrid      = (mmap_region_id_t*)source_rid.data;
+    hg_addr_t          dest_addr = HG_ADDR_NULL;
+    int                ret       = BAKE_SUCCESS;
+
+    if (region_size != mrid->size) {
+        ret = BAKE_ERR_INVALID_ARG;
+        goto finish;
+    }
+
+    /* lookup the address of the destination provider */
+    hg_return_t hret
+        = margo_addr_lookup(entry->provider->mid, dest_addr_str, &dest_addr);
+    if (hret != HG_SUCCESS) {
+        ret = BAKE_ERR_MERCURY;
+        goto finish;
+    }
+
+    { /* in this block we issue a create_write_persist to the destination */
+        hg_handle_t                     cwp_handle = HG_HANDLE_NULL;
+        bake_create_write_persist_in_t  cwp_in     = {0};
+        bake_create_write_persist_out_t cwp_out;
+
+        char* region_data = entry->base + mrid->offset;
+
+        cwp_in.bti             = dest_target_id;
+        cwp_in.region_size     = region_size;
+        cwp_in.bulk_offset     = 0;
+        cwp_in.bulk_size       = region_size;
+        cwp_in.remote_addr_str = NULL;
+        /* the copy is a migration for the destination's scheduler */
+        cwp_in.qos_class = BAKE_QOS_CLASS_BACKGROUND;
+        cwp_in.req_id    = bake_trace_current_request();
+
+        /* not all backends handle a non-zero bulk offset, so expose just
+         * this region rather than the registration of the whole mapping
+         */
+        hret = margo_bulk_create(entry->provider->mid, 1,
+                                 (void**)(&region_data), &region_size,
+                                 HG_BULK_READ_ONLY, &cwp_in.bulk_handle);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        hret = margo_create(entry->provider->mid, dest_addr,
+                            entry->provider->bake_create_write_persist_id,
+                            &cwp_handle);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        hret = margo_provider_forward(dest_provider_id, cwp_handle, &cwp_in);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        hret = margo_get_output(cwp_handle, &cwp_out);
+        if (hret != HG_SUCCESS) {
+            ret = BAKE_ERR_MERCURY;
+            goto finish_scope;
+        }
+
+        if (cwp_out.ret != BAKE_SUCCESS) {
+            ret = cwp_out.ret;
+            margo_free_output(cwp_handle, &cwp_out);
+            goto finish_scope;
+        }
+
+        *dest_rid = cwp_out.rid;
+        ret       = BAKE_SUCCESS;
+        margo_free_output(cwp_handle, &cwp_out);
+
+finish_scope:
+        margo_bulk_free(cwp_in.bulk_handle);
+        margo_destroy(cwp_handle);
+    } /* end of create-write-persist block */
+
+    if (ret != BAKE_SUCCESS) goto finish;
+
+    if (remove_source) ret = bake_mmap_remove(context, source_rid);
+
+finish:
+    margo_addr_free(entry->provider->mid, dest_addr);
+    return ret;
+}
+
+#ifdef USE_REMI
+static int bake_mmap_create_fileset(backend_context_t context,
+                                    remi_fileset_t*   fileset)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+    int                ret;
+    /* create a fileset */
+    ret = remi_fileset_create("bake", entry->root, fileset);
+    if (ret != REMI_SUCCESS) {
+        ret = BAKE_ERR_REMI;
+        goto error;
+    }
+
+    /* fill the fileset */
+    ret = remi_fileset_register_file(*fileset, entry->filename);
+    if (ret != REMI_SUCCESS) {
+        ret = BAKE_ERR_REMI;
+        goto error;
+    }
+
+finish:
+    return ret;
+error:
+    remi_fileset_free(*fileset);
+    *fileset = NULL;
+    goto finish;
+}
+#endif
+
+static int bake_mmap_set_conf(backend_context_t context,
+                              const char*       key,
+                              const char*       value)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+
+    if (strncmp(key, "io_", 3) == 0)
+        return bake_io_engine_set_conf(entry->io, key, value);
+    return BAKE_ERR_OP_UNSUPPORTED;
+}
+
+static int bake_mmap_get_stats(backend_context_t context, FILE* out)
+{
+    bake_mmap_entry_t* entry = (bake_mmap_entry_t*)context;
+
+    bake_io_engine_print_stats(entry->io, "", out);
+    return BAKE_SUCCESS;
+}
+
+bake_backend g_bake_mmap_backend
+    = {.name                       = "mmap",
+       ._initialize                = bake_mmap_backend_initialize,
+       ._finalize                  = bake_mmap_backend_finalize,
+       ._create                    = bake_mmap_create,
+       ._write_raw                 = bake_mmap_write_raw,
+       ._write_bulk                = bake_mmap_write_bulk,
+       ._read_raw                  = bake_mmap_read_raw,
+       ._read_bulk                 = bake_mmap_read_bulk,
+       ._persist                   = bake_mmap_persist,
+       ._create_write_persist_raw  = NULL, /* use default implementation */
+       ._create_write_persist_bulk = NULL, /* use default implementation */
+       ._get_region_size           = bake_mmap_get_region_size,
+       ._get_region_data           = bake_mmap_get_region_data,
+       ._remove                    = bake_mmap_remove,
+       ._migrate_region            = bake_mmap_migrate_region,
+#ifdef USE_REMI
+       ._create_fileset = bake_mmap_create_fileset,
+#endif
+       ._set_conf  = bake_mmap_set_conf,
+       ._get_stats = bake_mmap_get_stats};
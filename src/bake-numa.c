@@ -0,0 +1,191 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+/* for MAP_HUGETLB and MADV_HUGEPAGE */
+#define _GNU_SOURCE
+
+#include "bake-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include "bake.h"
+#include "bake-numa.h"
+
+/* from <numaif.h> */
+#define BAKE_MPOL_BIND    2
+#define BAKE_MPOL_MF_MOVE (1 << 1)
+
+/* reads the integer in a sysfs file, returning -1 if there is none */
+static int read_sysfs_int(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    int   value;
+
+    if (!f) return -1;
+    if (fscanf(f, "%d", &value) != 1) value = -1;
+    fclose(f);
+    return value;
+}
+
+int bake_numa_node_of_nic(const char* ifname)
+{
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node",
+             ifname);
+    return read_sysfs_int(path);
+}
+
+/* returns the node of a block device, or -1 if unknown */
+static int node_of_dev(dev_t dev)
+{
+    char sysfs[PATH_MAX];
+    int  node;
+
+    snprintf(sysfs, sizeof(sysfs), "/sys/dev/block/%u:%u/device/numa_node",
+             major(dev), minor(dev));
+    node = read_sysfs_int(sysfs);
+    if (node >= 0) return node;
+    /* partitions: look at the whole disk */
+    snprintf(sysfs, sizeof(sysfs),
+             "/sys/dev/block/%u:%u/../device/numa_node", major(dev),
+             minor(dev));
+    return read_sysfs_int(sysfs);
+}
+
+/* a block device itself, or the device of the file system */
+#define STAT_DEV(statbuf) \
+    (S_ISBLK((statbuf).st_mode) ? (statbuf).st_rdev : (statbuf).st_dev)
+
+int bake_numa_node_of_path(const char* path)
+{
+    struct stat statbuf;
+
+    if (stat(path, &statbuf) != 0) return -1;
+    return node_of_dev(STAT_DEV(statbuf));
+}
+
+int bake_numa_node_of_fd(int fd)
+{
+    struct stat statbuf;
+
+    if (fstat(fd, &statbuf) != 0) return -1;
+    return node_of_dev(STAT_DEV(statbuf));
+}
+
+int bake_numa_parse_node(const char* spec, int* node)
+{
+    char* end;
+    long  n;
+
+    if (strncmp(spec, "nic:", 4) == 0)
+        *node = bake_numa_node_of_nic(spec + 4);
+    else if (strncmp(spec, "path:", 5) == 0)
+        *node = bake_numa_node_of_path(spec + 5);
+    else {
+        n = strtol(spec, &end, 10);
+        if (end == spec || *end != '\0' || n < -1 || n >= BAKE_NUMA_MAX_NODES)
+            return BAKE_ERR_INVALID_ARG;
+        *node = (int)n;
+        return BAKE_SUCCESS;
+    }
+    /* a device with no affinity is not an error, it just has no node */
+    return BAKE_SUCCESS;
+}
+
+char* bake_numa_node_cpus(int node)
+{
+    char   path[PATH_MAX];
+    char*  line = NULL;
+    size_t size = 0;
+    FILE*  f;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+    f = fopen(path, "r");
+    if (!f) return NULL;
+    if (getline(&line, &size, f) < 0) {
+        free(line);
+        line = NULL;
+    } else
+        line[strcspn(line, "\n")] = '\0';
+    fclose(f);
+    return line;
+}
+
+int bake_numa_bind_memory(void* ptr, size_t len, int node)
+{
+    unsigned long mask[BAKE_NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+
+    if (node < 0) return BAKE_SUCCESS;
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))]
+        |= 1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_mbind, ptr, len, BAKE_MPOL_BIND, mask,
+                (unsigned long)BAKE_NUMA_MAX_NODES, BAKE_MPOL_MF_MOVE)
+        != 0)
+        return BAKE_ERR_INVALID_ARG;
+    return BAKE_SUCCESS;
+}
+
+void* bake_numa_map(size_t len, int node, int huge_pages, int* pages)
+{
+    char*  ptr;
+    size_t head;
+
+    *pages = BAKE_NUMA_PAGES_NORMAL;
+    if (huge_pages) {
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            *pages = BAKE_NUMA_PAGES_HUGE;
+            goto bind;
+        }
+        /* no reserved huge pages; transparent ones need the mapping to be
+         * aligned */
+        ptr = mmap(NULL, len + BAKE_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) return NULL;
+        head = (BAKE_HUGE_PAGE_SIZE - (unsigned long)ptr % BAKE_HUGE_PAGE_SIZE)
+             % BAKE_HUGE_PAGE_SIZE;
+        if (head) munmap(ptr, head);
+        munmap(ptr + head + len, BAKE_HUGE_PAGE_SIZE - head);
+        ptr += head;
+        if (madvise(ptr, len, MADV_HUGEPAGE) == 0)
+            *pages = BAKE_NUMA_PAGES_THP;
+    } else {
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) return NULL;
+    }
+
+bind:
+    /* nothing is touched yet, so the pages will be allocated on the node;
+     * failing to bind only costs locality */
+    bake_numa_bind_memory(ptr, len, node);
+    return ptr;
+}
+
+void bake_numa_unmap(void* ptr, size_t len) { munmap(ptr, len); }
+
+const char* bake_numa_pages_name(int pages)
+{
+    switch (pages) {
+    case BAKE_NUMA_PAGES_HUGE:
+        return "hugetlb";
+    case BAKE_NUMA_PAGES_THP:
+        return "thp";
+    default:
+        return "normal";
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_NUMA_H
+#define __BAKE_NUMA_H
+
+#include <stddef.h>
+
+/* bake-numa
+ *
+ * Minimal NUMA placement helpers, based on sysfs and the mbind system call
+ * so as not to depend on libnuma.  Nodes are numbered as in
+ * /sys/devices/system/node; -1 stands for no particular node.
+ */
+
+#define BAKE_NUMA_MAX_NODES 256
+
+#define BAKE_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+/**
+ * Parses a node specification: a node number, "-1" for none, "nic:<name>"
+ * for the node of a network interface or "path:<path>" for the node of the
+ * device holding a file.  A device with no known node yields -1.  Returns
+ * BAKE_ERR_INVALID_ARG if the specification cannot be parsed.
+ */
+int bake_numa_parse_node(const char* spec, int* node);
+
+/**
+ * Returns the node of the device holding path, or -1 if unknown.
+ */
+int bake_numa_node_of_path(const char* path);
+
+/**
+ * Returns the node of the device holding an open file, or -1 if unknown.
+ */
+int bake_numa_node_of_fd(int fd);
+
+/**
+ * Returns the node of a network interface, or -1 if unknown.
+ */
+int bake_numa_node_of_nic(const char* ifname);
+
+/**
+ * Returns the CPUs of a node as a CPU list such as "0-3,8" (to be freed by
+ * the caller), or NULL if the node does not exist.
+ */
+char* bake_numa_node_cpus(int node);
+
+/**
+ * Binds memory to a node, moving the pages already touched.  Does nothing
+ * for node -1.
+ */
+int bake_numa_bind_memory(void* ptr, size_t len, int node);
+
+/* how a mapping obtained from bake_numa_map() is backed */
+#define BAKE_NUMA_PAGES_NORMAL 0
+#define BAKE_NUMA_PAGES_THP    1 /* transparent huge pages requested */
+#define BAKE_NUMA_PAGES_HUGE   2 /* reserved (hugetlbfs) huge pages */
+
+/**
+ * Maps len bytes of anonymous memory bound to a node.  If huge_pages is
+ * set, len must be a multiple of BAKE_HUGE_PAGE_SIZE, and the mapping is
+ * backed by reserved huge pages if there are any and by transparent huge
+ * pages otherwise.  The backing is returned in pages.  Returns NULL on
+ * failure.
+ */
+void* bake_numa_map(size_t len, int node, int huge_pages, int* pages);
+
+void bake_numa_unmap(void* ptr, size_t len);
+
+/**
+ * Returns a printable name of a BAKE_NUMA_PAGES_* value.
+ */
+const char* bake_numa_pages_name(int pages);
+
+#endif
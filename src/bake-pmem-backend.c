@@ -1,4 +1,8 @@
 #include <assert.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "bake-config.h"
 #include "bake.h"
 #include "bake-rpc.h"
@@ -6,12 +10,61 @@
 #include "bake-provider.h"
 #include "bake-backend.h"
 
-/* definition of BAKE root data structure (just a uuid for now) */
+#define TRANSFER_DATA_READ  1
+#define TRANSFER_DATA_WRITE 2
+
+/* reads of at least this size use the pipelined path when pipelining is
+ * enabled; smaller ones register the pmem memory directly
+ */
+#define BAKE_PMEM_DEFAULT_PIPELINE_READ_THRESHOLD (1024 * 1024)
+
+/* the pool is registered with mercury once, as windows of twice this size
+ * starting every BAKE_PMEM_BULK_WINDOW_SIZE bytes, so that any transfer of up
+ * to this size falls entirely within one window; larger transfers register
+ * their memory on the fly
+ */
+#define BAKE_PMEM_BULK_WINDOW_SIZE (1024UL * 1024UL * 1024UL)
+
+#define BAKE_PMEM_MAX_ARENAS        64
+#define BAKE_PMEM_MAX_ALLOC_CLASSES 16
+#define BAKE_PMEM_MAX_POOLS         16
+
+/* region sizes served by dedicated allocation classes unless configured
+ * otherwise with "alloc_classes"
+ */
+#define BAKE_PMEM_DEFAULT_ALLOC_CLASSES "256,4096,65536"
+
+/* regions of at least chunked_region_threshold bytes (0 for none) are
+ * created as a map of chunks that are only allocated when first written
+ */
+#define BAKE_PMEM_DEFAULT_CHUNK_SIZE (16 * 1024 * 1024)
+#define BAKE_PMEM_CHUNK_LOCKS        64
+/* zeros pushed to clients reading chunks that were never written */
+#define BAKE_PMEM_ZERO_BLOCK_SIZE (1024 * 1024)
+
+/* pmemobj type numbers of the objects of a target */
+#define BAKE_PMEM_TYPE_REGION    0 /* plain region */
+#define BAKE_PMEM_TYPE_CHUNK_MAP 1 /* chunk map of a chunked region */
+#define BAKE_PMEM_TYPE_CHUNK     2 /* chunk of a chunked region */
+
+/* how new regions are spread over the pools of a multi-pool target */
+#define POOL_ROUTING_ROUND_ROBIN     0 /* one pool after the other */
+#define POOL_ROUTING_XSTREAM         1 /* by execution stream rank */
+#define POOL_ROUTING_LEAST_ALLOCATED 2 /* to the pool with the fewest bytes */
+
+/* definition of BAKE root data structure */
 typedef struct {
     bake_target_id_t pool_id;
+    /* position of this pool among the pools of the target and number of
+     * pools; 0 and 0 for pools created before multi-pool targets
+     */
+    uint32_t pool_index;
+    uint32_t num_pools;
 } bake_root_t;
 
-/* definition of internal BAKE region_id_t identifier for libpmemobj back end */
+/* definition of internal BAKE region_id_t identifier for libpmemobj back end;
+ * the pool_uuid_lo field of the oid identifies the pool of the region
+ */
 typedef struct {
     PMEMoid oid;
 } pmemobj_region_id_t;
@@ -23,12 +76,68 @@ typedef struct {
     char data[1];
 } region_content_t;
 
+#define REGION_HEADER_SIZE offsetof(region_content_t, data)
+
+/* a chunked region; chunks are in the same pool as their map */
+typedef struct {
+    uint64_t size; /* size of the region */
+    uint64_t chunk_size;
+    uint64_t num_chunks;
+    PMEMoid  chunks[1]; /* OID_NULL until first written */
+} chunk_map_t;
+
+/* allocation settings; they are never modified in place but replaced by an
+ * updated copy, so that allocations can use them without locking
+ */
+typedef struct pmem_alloc_conf {
+    struct pmem_alloc_conf* prev; /* replaced settings */
+    /* arenas of each pool, 0 to let libpmemobj assign arenas */
+    unsigned num_arenas;
+    unsigned arena_ids[BAKE_PMEM_MAX_POOLS][BAKE_PMEM_MAX_ARENAS];
+    /* classes of each pool, sorted by increasing unit size */
+    unsigned num_classes;
+    size_t   class_unit_sizes[BAKE_PMEM_MAX_ALLOC_CLASSES];
+    unsigned class_ids[BAKE_PMEM_MAX_POOLS][BAKE_PMEM_MAX_ALLOC_CLASSES];
+    int      pool_routing;
+} pmem_alloc_conf_t;
+
+/* one of the pmemobj pools of a target */
+typedef struct {
+    PMEMobjpool* pmem_pool;
+    bake_root_t* pmem_root;
+    uint64_t     uuid_lo;      /* pool_uuid_lo of the pool's oids */
+    char*        root;
+    char*        filename;
+    char*        pool_base;    /* start of the pool's mapping */
+    size_t       pool_size;    /* size of the pool's mapping */
+    hg_bulk_t*   bulk_windows; /* registered windows of the mapping */
+    size_t       num_bulk_windows;
+    uint64_t     allocated; /* bytes allocated since the target was added */
+    /* arenas and classes created in the pool so far; libpmemobj cannot
+     * delete them, so they are reused when the configuration changes
+     */
+    unsigned num_created_arenas;
+    unsigned created_arena_ids[BAKE_PMEM_MAX_ARENAS];
+    unsigned num_created_classes;
+    size_t   created_class_unit_sizes[BAKE_PMEM_MAX_ALLOC_CLASSES * 4];
+    unsigned created_class_ids[BAKE_PMEM_MAX_ALLOC_CLASSES * 4];
+} bake_pmem_pool_t;
+
 typedef struct {
-    bake_provider_t provider;
-    PMEMobjpool*    pmem_pool;
-    bake_root_t*    pmem_root;
-    char*           root;
-    char*           filename;
+    bake_provider_t    provider;
+    unsigned           num_pools;
+    bake_pmem_pool_t*  pools;
+    uint64_t           next_pool; /* for round-robin routing */
+    size_t             pipeline_read_threshold;
+    int                durable_writes; /* non-temporal, persisting copies */
+    pmem_alloc_conf_t* alloc_conf;
+    ABT_mutex          alloc_conf_mutex; /* serializes updates of alloc_conf */
+    size_t             chunked_region_threshold;
+    size_t             chunk_size;
+    ABT_mutex          chunk_locks[BAKE_PMEM_CHUNK_LOCKS]; /* chunk allocation */
+    ABT_mutex          zero_mutex;
+    char*              zero_block; /* allocated on first use */
+    hg_bulk_t          zero_bulk;
 } bake_pmem_entry_t;
 
 typedef struct xfer_args {
@@ -40,18 +149,36 @@ typedef struct xfer_args {
     char*             local_ptr;
     size_t            bytes_issued;
     size_t            bytes_retired;
-    margo_bulk_poolset_t poolset;
+    bake_poolset_t       poolset;
     size_t               poolset_max_size;
     int32_t              ret; // return value of the xfer_ult function
     int                  done;
     int                  ults_active;
     ABT_mutex            mutex;
     ABT_eventual         eventual;
+    int                  op_flag; // read or write
+    PMEMobjpool*         durable_pool; // if set, writes are made durable
+    bake_trace_ctx_t*    trace; // request on whose behalf the ULTs work
 } xfer_args;
 
 static void xfer_ult(void* _args);
 
-int bake_makepool(const char* pool_name, size_t pool_size, mode_t pool_mode)
+static int pipelined_transfer_data(bake_provider_t provider,
+                                   char*           memory,
+                                   hg_bulk_t       remote_bulk,
+                                   uint64_t        remote_bulk_offset,
+                                   uint64_t        bulk_size,
+                                   hg_addr_t       remote_addr,
+                                   ABT_pool        target_pool,
+                                   int             op_flag,
+                                   PMEMobjpool*    durable_pool);
+
+static int make_pool(const char*      pool_name,
+                     size_t           pool_size,
+                     mode_t           pool_mode,
+                     bake_target_id_t pool_id,
+                     uint32_t         pool_index,
+                     uint32_t         num_pools)
 {
     PMEMobjpool* pool;
     PMEMoid      root_oid;
@@ -68,63 +195,744 @@ int bake_makepool(const char* pool_name, size_t pool_size, mode_t pool_mode)
     root     = pmemobj_direct(root_oid);
 
     /* store the target id for this bake pool at the root */
-    uuid_generate(root->pool_id.id);
+    root->pool_id    = pool_id;
+    root->pool_index = pool_index;
+    root->num_pools  = num_pools;
     pmemobj_persist(pool, root, sizeof(bake_root_t));
 
     pmemobj_close(pool);
 
     return BAKE_SUCCESS;
 }
+
+/* pool_name may be a comma-separated list of files, in which case each of
+ * them gets a pool of pool_size bytes and they make up a single target
+ */
+int bake_makepool(const char* pool_name, size_t pool_size, mode_t pool_mode)
+{
+    char*            names = strdup(pool_name);
+    char*            paths[BAKE_PMEM_MAX_POOLS];
+    char *           name, *saveptr;
+    unsigned         n = 0, i;
+    bake_target_id_t pool_id;
+    int              ret = BAKE_SUCCESS;
+
+    if (!names) return BAKE_ERR_ALLOCATION;
+    for (name = strtok_r(names, ",", &saveptr); name;
+         name = strtok_r(NULL, ",", &saveptr)) {
+        if (n == BAKE_PMEM_MAX_POOLS) {
+            fprintf(stderr, "Error: a BAKE target spans at most %d pools\n",
+                    BAKE_PMEM_MAX_POOLS);
+            ret = BAKE_ERR_INVALID_ARG;
+            goto finish;
+        }
+        paths[n++] = name;
+    }
+    if (n == 0) {
+        ret = BAKE_ERR_INVALID_ARG;
+        goto finish;
+    }
+
+    uuid_generate(pool_id.id);
+    for (i = 0; i < n; i++) {
+        ret = make_pool(paths[i], pool_size, pool_mode, pool_id, i, n);
+        if (ret != BAKE_SUCCESS) {
+            /* the pools made so far are of no use without the others */
+            while (i-- > 0) unlink(paths[i]);
+            goto finish;
+        }
+    }
+
+finish:
+    free(names);
+    return ret;
+}
 ////////////////////////////////////////////////////////////////////////////////////////////
-static int bake_pmem_backend_initialize(bake_provider_t    provider,
-                                        const char*        path,
-                                        bake_target_id_t*  target,
-                                        backend_context_t* context)
+/* returns the pool that holds the given object */
+static bake_pmem_pool_t* find_pool(bake_pmem_entry_t* entry, PMEMoid oid)
 {
-    bake_pmem_entry_t* new_context
-        = (bake_pmem_entry_t*)calloc(1, sizeof(*new_context));
-    char* tmp             = strrchr(path, '/');
-    new_context->provider = provider;
-    new_context->filename = strdup(tmp);
-    ptrdiff_t d           = tmp - path;
-    new_context->root     = strndup(path, d);
+    unsigned i;
+
+    for (i = 0; i < entry->num_pools; i++)
+        if (entry->pools[i].uuid_lo == oid.pool_uuid_lo)
+            return &entry->pools[i];
+    return NULL;
+}
+
+/* sets the number of arenas that allocations are spread over, by execution
+ * stream rank, creating the missing ones in each pool
+ */
+static int set_alloc_arenas(bake_pmem_entry_t* entry,
+                            pmem_alloc_conf_t* conf,
+                            unsigned           num_arenas)
+{
+    bake_pmem_pool_t* pool;
+    char              name[64];
+    unsigned          id, p;
+    int               automatic = 0;
+
+    if (num_arenas > BAKE_PMEM_MAX_ARENAS) return BAKE_ERR_INVALID_ARG;
+
+    for (p = 0; p < entry->num_pools; p++) {
+        pool = &entry->pools[p];
+        while (pool->num_created_arenas < num_arenas) {
+            if (pmemobj_ctl_exec(pool->pmem_pool, "heap.arena.create", &id)
+                != 0) {
+                fprintf(stderr, "pmemobj_ctl_exec(heap.arena.create): %s\n",
+                        pmemobj_errormsg());
+                return BAKE_ERR_PMEM;
+            }
+            /* keep threads that libpmemobj assigns arenas to out of ours */
+            snprintf(name, sizeof(name), "heap.arena.%u.automatic", id);
+            pmemobj_ctl_set(pool->pmem_pool, name, &automatic);
+            pool->created_arena_ids[pool->num_created_arenas++] = id;
+        }
+        memcpy(conf->arena_ids[p], pool->created_arena_ids,
+               num_arenas * sizeof(*pool->created_arena_ids));
+    }
+    conf->num_arenas = num_arenas;
+    return BAKE_SUCCESS;
+}
+
+/* registers (or reuses) an allocation class with the given unit size */
+static int
+get_alloc_class(bake_pmem_pool_t* pool, size_t unit_size, unsigned* class_id)
+{
+    struct pobj_alloc_class_desc desc = {0};
+    unsigned                     i;
+
+    for (i = 0; i < pool->num_created_classes; i++) {
+        if (pool->created_class_unit_sizes[i] == unit_size) {
+            *class_id = pool->created_class_ids[i];
+            return BAKE_SUCCESS;
+        }
+    }
+    if (pool->num_created_classes == BAKE_PMEM_MAX_ALLOC_CLASSES * 4)
+        return BAKE_ERR_INVALID_ARG;
+
+    /* no per-object header: each region is a single unit of its class */
+    desc.unit_size       = unit_size;
+    desc.alignment       = 0;
+    desc.units_per_block = (256 * 1024) / unit_size;
+    if (desc.units_per_block < 16) desc.units_per_block = 16;
+    desc.header_type = POBJ_HEADER_NONE;
+    if (pmemobj_ctl_set(pool->pmem_pool, "heap.alloc_class.new.desc", &desc)
+        != 0) {
+        fprintf(stderr, "pmemobj_ctl_set(heap.alloc_class.new.desc): %s\n",
+                pmemobj_errormsg());
+        return BAKE_ERR_PMEM;
+    }
+    *class_id                                                 = desc.class_id;
+    pool->created_class_unit_sizes[pool->num_created_classes] = unit_size;
+    pool->created_class_ids[pool->num_created_classes]        = desc.class_id;
+    pool->num_created_classes++;
+    return BAKE_SUCCESS;
+}
+
+/* sets the allocation classes from a comma-separated list of region sizes */
+static int set_alloc_classes(bake_pmem_entry_t* entry,
+                             pmem_alloc_conf_t* conf,
+                             const char*        sizes)
+{
+    size_t   unit_sizes[BAKE_PMEM_MAX_ALLOC_CLASSES];
+    unsigned n = 0, i, j, p;
+    size_t   region_size, unit_size;
+    char *   copy, *tok, *saveptr, *end;
+    int      ret = BAKE_SUCCESS;
+
+    copy = strdup(sizes);
+    if (!copy) return BAKE_ERR_ALLOCATION;
+    for (tok = strtok_r(copy, ",", &saveptr); tok;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        region_size = strtoul(tok, &end, 0);
+        if (end == tok || *end != '\0' || region_size == 0
+            || n == BAKE_PMEM_MAX_ALLOC_CLASSES) {
+            ret = BAKE_ERR_INVALID_ARG;
+            goto finish;
+        }
+        unit_size = region_size + REGION_HEADER_SIZE;
+        /* insertion sort by unit size */
+        for (i = 0; i < n && unit_sizes[i] < unit_size; i++)
+            ;
+        if (i < n && unit_sizes[i] == unit_size) continue;
+        for (j = n; j > i; j--) unit_sizes[j] = unit_sizes[j - 1];
+        unit_sizes[i] = unit_size;
+        n++;
+    }
+
+    for (p = 0; p < entry->num_pools; p++) {
+        for (i = 0; i < n; i++) {
+            ret = get_alloc_class(&entry->pools[p], unit_sizes[i],
+                                  &conf->class_ids[p][i]);
+            if (ret != BAKE_SUCCESS) goto finish;
+        }
+    }
+    memcpy(conf->class_unit_sizes, unit_sizes, n * sizeof(*unit_sizes));
+    conf->num_classes = n;
+
+finish:
+    free(copy);
+    return ret;
+}
+
+/* applies a change to the allocation settings and publishes them */
+static int update_alloc_conf(bake_pmem_entry_t* entry,
+                             const char*        key,
+                             const char*        value)
+{
+    pmem_alloc_conf_t* conf;
+    unsigned           num_arenas;
+    char*              end;
+    int                ret = BAKE_SUCCESS;
+
+    conf = malloc(sizeof(*conf));
+    if (!conf) return BAKE_ERR_ALLOCATION;
+
+    ABT_mutex_lock(entry->alloc_conf_mutex);
+    if (entry->alloc_conf)
+        memcpy(conf, entry->alloc_conf, sizeof(*conf));
+    else
+        memset(conf, 0, sizeof(*conf));
+    conf->prev = entry->alloc_conf;
+
+    if (strcmp(key, "alloc_arenas") == 0) {
+        num_arenas = strtoul(value, &end, 0);
+        if (end == value || *end != '\0')
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            ret = set_alloc_arenas(entry, conf, num_arenas);
+    } else if (strcmp(key, "alloc_classes") == 0) {
+        ret = set_alloc_classes(entry, conf, value);
+    } else if (strcmp(key, "pool_routing") == 0) {
+        if (strcmp(value, "round-robin") == 0)
+            conf->pool_routing = POOL_ROUTING_ROUND_ROBIN;
+        else if (strcmp(value, "xstream") == 0)
+            conf->pool_routing = POOL_ROUTING_XSTREAM;
+        else if (strcmp(value, "least-allocated") == 0)
+            conf->pool_routing = POOL_ROUTING_LEAST_ALLOCATED;
+        else
+            ret = BAKE_ERR_INVALID_ARG;
+    } else {
+        ret = BAKE_ERR_INVALID_ARG;
+    }
+
+    if (ret == BAKE_SUCCESS)
+        __atomic_store_n(&entry->alloc_conf, conf, __ATOMIC_RELEASE);
+    else
+        free(conf);
+    ABT_mutex_unlock(entry->alloc_conf_mutex);
+    return ret;
+}
+
+/* picks the pool of a new region according to the routing policy */
+static unsigned
+route_alloc(bake_pmem_entry_t* entry, pmem_alloc_conf_t* conf, int rank)
+{
+    unsigned p = 0, i;
+
+    if (entry->num_pools == 1) return 0;
+
+    switch (conf ? conf->pool_routing : POOL_ROUTING_ROUND_ROBIN) {
+    case POOL_ROUTING_XSTREAM:
+        p = rank % entry->num_pools;
+        break;
+    case POOL_ROUTING_LEAST_ALLOCATED:
+        for (i = 1; i < entry->num_pools; i++)
+            if (__atomic_load_n(&entry->pools[i].allocated, __ATOMIC_RELAXED)
+                < __atomic_load_n(&entry->pools[p].allocated, __ATOMIC_RELAXED))
+                p = i;
+        break;
+    default:
+        p = __atomic_fetch_add(&entry->next_pool, 1, __ATOMIC_RELAXED)
+          % entry->num_pools;
+        break;
+    }
+    return p;
+}
+
+/* allocates an object in pool p, from the calling execution stream's arena;
+ * plain regions also use the smallest allocation class that fits them
+ * without wasting more than half of a unit (the classes have no object
+ * header, hence no type number, so they are not used for other objects)
+ */
+static int pmem_alloc_in_pool(bake_pmem_entry_t* entry,
+                              unsigned           p,
+                              PMEMoid*           oid,
+                              size_t             size,
+                              uint64_t           type_num,
+                              uint64_t           flags)
+{
+    pmem_alloc_conf_t* conf
+        = __atomic_load_n(&entry->alloc_conf, __ATOMIC_ACQUIRE);
+    bake_pmem_pool_t* pool = &entry->pools[p];
+    unsigned          i;
+    int               rank, ret;
+
+    if (ABT_xstream_self_rank(&rank) != ABT_SUCCESS) rank = 0;
+
+    if (conf) {
+        for (i = 0; type_num == BAKE_PMEM_TYPE_REGION && i < conf->num_classes;
+             i++) {
+            if (size <= conf->class_unit_sizes[i]) {
+                if (size > conf->class_unit_sizes[i] / 2)
+                    flags |= POBJ_CLASS_ID(conf->class_ids[p][i]);
+                break;
+            }
+        }
+        if (conf->num_arenas)
+            flags |= POBJ_ARENA_ID(
+                conf->arena_ids[p][rank % conf->num_arenas]);
+    }
+    ret = pmemobj_xalloc(pool->pmem_pool, oid, size, type_num, flags, NULL,
+                         NULL);
+    if (ret == 0)
+        __atomic_add_fetch(&pool->allocated, pmemobj_alloc_usable_size(*oid),
+                           __ATOMIC_RELAXED);
+    return ret;
+}
+
+/* allocates an object in the pool chosen by route_alloc() */
+static int pmem_alloc_object(bake_pmem_entry_t* entry,
+                             PMEMoid*           oid,
+                             size_t             size,
+                             uint64_t           type_num,
+                             uint64_t           flags)
+{
+    pmem_alloc_conf_t* conf
+        = __atomic_load_n(&entry->alloc_conf, __ATOMIC_ACQUIRE);
+    int rank;
 
-    new_context->pmem_pool = pmemobj_open(path, NULL);
-    if (!(new_context->pmem_pool)) {
+    if (ABT_xstream_self_rank(&rank) != ABT_SUCCESS) rank = 0;
+    return pmem_alloc_in_pool(entry, route_alloc(entry, conf, rank), oid,
+                              size, type_num, flags);
+}
+
+/* allocates a plain region */
+static int pmem_alloc(bake_pmem_entry_t* entry, PMEMoid* oid, size_t size)
+{
+    return pmem_alloc_object(entry, oid, size, BAKE_PMEM_TYPE_REGION, 0);
+}
+
+static void pmem_free(bake_pmem_entry_t* entry, PMEMoid* oid)
+{
+    bake_pmem_pool_t* pool = find_pool(entry, *oid);
+
+    if (pool)
+        __atomic_sub_fetch(&pool->allocated, pmemobj_alloc_usable_size(*oid),
+                           __ATOMIC_RELAXED);
+    pmemobj_free(oid);
+}
+
+/* returns the chunk map of a chunked region, NULL for a plain region */
+static chunk_map_t* get_chunk_map(PMEMoid oid)
+{
+    chunk_map_t* map = pmemobj_direct(oid);
+
+    if (!map || pmemobj_type_num(oid) != BAKE_PMEM_TYPE_CHUNK_MAP) return NULL;
+    return map;
+}
+
+/* creates the chunk map of a chunked region; chunks are allocated by
+ * get_chunk() when first written, so this does not depend on the size
+ */
+static int
+create_chunked_region(bake_pmem_entry_t* entry, size_t size, PMEMoid* oid)
+{
+    size_t       chunk_size = entry->chunk_size;
+    uint64_t     num_chunks = (size + chunk_size - 1) / chunk_size;
+    chunk_map_t* map;
+
+    if (pmem_alloc_object(entry, oid,
+                          offsetof(chunk_map_t, chunks)
+                              + num_chunks * sizeof(PMEMoid),
+                          BAKE_PMEM_TYPE_CHUNK_MAP, POBJ_XALLOC_ZERO)
+        != 0)
+        return BAKE_ERR_PMEM;
+    map = pmemobj_direct(*oid);
+    if (!map) return BAKE_ERR_PMEM;
+
+    map->size       = size;
+    map->chunk_size = chunk_size;
+    map->num_chunks = num_chunks;
+    pmemobj_persist(pmemobj_pool_by_oid(*oid), map,
+                    offsetof(chunk_map_t, chunks));
+    return BAKE_SUCCESS;
+}
+
+/* looks up chunk i of a chunked region, allocating it (zeroed, in the pool
+ * of the map) if allocate is set; otherwise unwritten chunks are OID_NULL
+ */
+static int get_chunk(bake_pmem_entry_t* entry,
+                     PMEMoid            map_oid,
+                     chunk_map_t*       map,
+                     uint64_t           i,
+                     int                allocate,
+                     PMEMoid*           chunk)
+{
+    bake_pmem_pool_t* pool;
+    ABT_mutex         lock;
+    size_t            size;
+    int               ret = BAKE_SUCCESS;
+
+    /* a slot being allocated may be seen half-written, in which case
+     * pmemobj_direct() returns NULL and the chunk is treated as unwritten
+     */
+    *chunk = map->chunks[i];
+    if (!allocate || pmemobj_direct(*chunk)) return BAKE_SUCCESS;
+
+    lock = entry->chunk_locks[(map_oid.off / 16 + i) % BAKE_PMEM_CHUNK_LOCKS];
+    ABT_mutex_lock(lock);
+    if (!pmemobj_direct(map->chunks[i])) {
+        size = map->size - i * map->chunk_size;
+        if (size > map->chunk_size) size = map->chunk_size;
+        pool = find_pool(entry, map_oid);
+        /* the slot is set atomically by the allocator */
+        if (!pool
+            || pmem_alloc_in_pool(entry, pool - entry->pools, &map->chunks[i],
+                                  size, BAKE_PMEM_TYPE_CHUNK, POBJ_XALLOC_ZERO)
+                   != 0)
+            ret = BAKE_ERR_PMEM;
+    }
+    *chunk = map->chunks[i];
+    ABT_mutex_unlock(lock);
+    return ret;
+}
+
+/* called for each piece of an access to a chunked region; data is NULL
+ * for unwritten chunks, done is the number of bytes already processed
+ */
+typedef int (*chunk_fn)(bake_pmem_entry_t* entry,
+                        PMEMoid            chunk,
+                        char*              data,
+                        size_t             size,
+                        size_t             done,
+                        void*              arg);
+
+static int for_each_chunk(bake_pmem_entry_t* entry,
+                          PMEMoid            map_oid,
+                          chunk_map_t*       map,
+                          uint64_t           offset,
+                          uint64_t           size,
+                          int                allocate,
+                          chunk_fn           fn,
+                          void*              arg)
+{
+    uint64_t done = 0, chunk_offset, len;
+    PMEMoid  chunk;
+    char*    data;
+    int      ret;
+
+    while (done < size) {
+        chunk_offset = (offset + done) % map->chunk_size;
+        len          = map->chunk_size - chunk_offset;
+        if (len > size - done) len = size - done;
+
+        ret = get_chunk(entry, map_oid, map, (offset + done) / map->chunk_size,
+                        allocate, &chunk);
+        if (ret != BAKE_SUCCESS) return ret;
+        data = pmemobj_direct(chunk);
+        ret  = fn(entry, chunk, data ? data + chunk_offset : NULL, len, done,
+                 arg);
+        if (ret != BAKE_SUCCESS) return ret;
+        done += len;
+    }
+    return BAKE_SUCCESS;
+}
+
+/* frees a region; the chunks of a chunked region are freed with their map
+ * in a single transaction, so that a crash cannot leave a map pointing to
+ * freed chunks or chunks that nothing points to
+ */
+static int remove_region(bake_pmem_entry_t* entry, PMEMoid* oid)
+{
+    chunk_map_t*      map = get_chunk_map(*oid);
+    bake_pmem_pool_t* pool;
+    size_t            freed = 0;
+    uint64_t          i;
+    int               ret = BAKE_SUCCESS;
+
+    if (!map) {
+        pmem_free(entry, oid);
+        return BAKE_SUCCESS;
+    }
+
+    /* the chunks are in the pool of their map */
+    pool = find_pool(entry, *oid);
+    if (!pool) return BAKE_ERR_UNKNOWN_REGION;
+
+    TX_BEGIN(pool->pmem_pool)
+    {
+        for (i = 0; i < map->num_chunks; i++) {
+            if (OID_IS_NULL(map->chunks[i])) continue;
+            freed += pmemobj_alloc_usable_size(map->chunks[i]);
+            pmemobj_tx_free(map->chunks[i]);
+        }
+        freed += pmemobj_alloc_usable_size(*oid);
+        pmemobj_tx_free(*oid);
+    }
+    TX_ONABORT
+    {
+        fprintf(stderr, "pmemobj_tx_free: %s\n", pmemobj_errormsg());
+        ret = BAKE_ERR_PMEM;
+    }
+    TX_END
+
+    if (ret != BAKE_SUCCESS) return ret;
+    __atomic_sub_fetch(&pool->allocated, freed, __ATOMIC_RELAXED);
+    *oid = OID_NULL;
+    return BAKE_SUCCESS;
+}
+
+/* sets up allocation with one arena per execution stream and the default
+ * allocation classes; failures leave allocation to libpmemobj's defaults
+ */
+static void init_alloc_conf(bake_pmem_entry_t* entry)
+{
+    int  num_xstreams = 0;
+    char value[16];
+
+    ABT_mutex_create(&entry->alloc_conf_mutex);
+    update_alloc_conf(entry, "pool_routing", "round-robin");
+    ABT_xstream_get_num(&num_xstreams);
+    if (num_xstreams > BAKE_PMEM_MAX_ARENAS)
+        num_xstreams = BAKE_PMEM_MAX_ARENAS;
+    snprintf(value, sizeof(value), "%d", num_xstreams);
+    if (num_xstreams > 0) update_alloc_conf(entry, "alloc_arenas", value);
+    update_alloc_conf(entry, "alloc_classes", BAKE_PMEM_DEFAULT_ALLOC_CLASSES);
+}
+
+static void destroy_alloc_conf(bake_pmem_entry_t* entry)
+{
+    pmem_alloc_conf_t *conf = entry->alloc_conf, *prev;
+
+    while (conf) {
+        prev = conf->prev;
+        free(conf);
+        conf = prev;
+    }
+    entry->alloc_conf = NULL;
+    ABT_mutex_free(&entry->alloc_conf_mutex);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static void unregister_pool(bake_pmem_pool_t* pool)
+{
+    size_t i;
+
+    for (i = 0; i < pool->num_bulk_windows; i++)
+        margo_bulk_free(pool->bulk_windows[i]);
+    free(pool->bulk_windows);
+    pool->bulk_windows     = NULL;
+    pool->num_bulk_windows = 0;
+}
+
+/* registers the pool's mapping with mercury; on failure the target still
+ * works, registering memory for each transfer instead
+ */
+static void register_pool(bake_pmem_entry_t* entry,
+                          bake_pmem_pool_t*  pool,
+                          const char*        path)
+{
+    struct stat st;
+    size_t      i, n;
+    hg_size_t   window_size;
+    void*       window_ptr;
+    hg_return_t hret;
+
+    /* the mapping of a pool held in a single file covers the whole file;
+     * for poolsets and device dax we do not know its extent
+     */
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return;
+    pool->pool_base = (char*)pool->pmem_pool;
+    pool->pool_size = st.st_size;
+    if (pool->pool_size == 0) return;
+
+    n = (pool->pool_size + BAKE_PMEM_BULK_WINDOW_SIZE - 1)
+      / BAKE_PMEM_BULK_WINDOW_SIZE;
+    pool->bulk_windows = calloc(n, sizeof(*pool->bulk_windows));
+    if (!pool->bulk_windows) return;
+
+    for (i = 0; i < n; i++) {
+        window_ptr  = pool->pool_base + i * BAKE_PMEM_BULK_WINDOW_SIZE;
+        window_size = pool->pool_size - i * BAKE_PMEM_BULK_WINDOW_SIZE;
+        if (window_size > 2 * BAKE_PMEM_BULK_WINDOW_SIZE)
+            window_size = 2 * BAKE_PMEM_BULK_WINDOW_SIZE;
+        hret = margo_bulk_create(entry->provider->mid, 1, &window_ptr,
+                                 &window_size, HG_BULK_READWRITE,
+                                 &pool->bulk_windows[i]);
+        if (hret != HG_SUCCESS) {
+            fprintf(stderr,
+                    "Warning: could not register pmem pool %s, "
+                    "registering memory per transfer\n",
+                    path);
+            unregister_pool(pool);
+            return;
+        }
+        pool->num_bulk_windows++;
+    }
+}
+
+/* returns the registered window covering size bytes at ptr and sets offset
+ * to the position of ptr in it, or returns HG_BULK_NULL if there is none
+ */
+static hg_bulk_t find_bulk_window(bake_pmem_entry_t* entry,
+                                  char*              ptr,
+                                  size_t             size,
+                                  size_t*            offset)
+{
+    bake_pmem_pool_t* pool;
+    size_t            pool_offset, i;
+    unsigned          p;
+
+    for (p = 0; p < entry->num_pools; p++) {
+        pool = &entry->pools[p];
+        if (pool->num_bulk_windows == 0 || ptr < pool->pool_base
+            || ptr >= pool->pool_base + pool->pool_size)
+            continue;
+        pool_offset = ptr - pool->pool_base;
+        if (pool_offset + size > pool->pool_size) return HG_BULK_NULL;
+
+        i = pool_offset / BAKE_PMEM_BULK_WINDOW_SIZE;
+        /* window i spans two strides, which is only guaranteed to be enough
+         * for transfers of up to one stride
+         */
+        if (pool_offset + size > (i + 2) * BAKE_PMEM_BULK_WINDOW_SIZE)
+            return HG_BULK_NULL;
+        *offset = pool_offset - i * BAKE_PMEM_BULK_WINDOW_SIZE;
+        return pool->bulk_windows[i];
+    }
+    return HG_BULK_NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int open_pool(bake_pmem_entry_t* entry,
+                     bake_pmem_pool_t*  pool,
+                     const char*        path)
+{
+    char* tmp      = strrchr(path, '/');
+    pool->filename = strdup(tmp);
+    ptrdiff_t d    = tmp - path;
+    pool->root     = strndup(path, d);
+
+    pool->pmem_pool = pmemobj_open(path, NULL);
+    if (!(pool->pmem_pool)) {
         fprintf(stderr, "pmemobj_open: %s\n", pmemobj_errormsg());
-        free(new_context->filename);
-        free(new_context->root);
-        free(new_context);
         return BAKE_ERR_PMEM;
     }
 
     /* check to make sure the root is properly set */
-    PMEMoid root_oid
-        = pmemobj_root(new_context->pmem_pool, sizeof(bake_root_t));
-    new_context->pmem_root = pmemobj_direct(root_oid);
-    bake_target_id_t tid   = new_context->pmem_root->pool_id;
+    PMEMoid root_oid = pmemobj_root(pool->pmem_pool, sizeof(bake_root_t));
+    pool->pmem_root  = pmemobj_direct(root_oid);
+    pool->uuid_lo    = root_oid.pool_uuid_lo;
 
-    if (uuid_is_null(tid.id)) {
+    if (uuid_is_null(pool->pmem_root->pool_id.id)) {
         fprintf(stderr, "Error: BAKE pool %s is not properly initialized\n",
                 path);
-        pmemobj_close(new_context->pmem_pool);
-        free(new_context->filename);
-        free(new_context->root);
-        free(new_context);
         return BAKE_ERR_UNKNOWN_TARGET;
     }
 
-    *target  = tid;
+    /* register the pool once; transfers use offsets into it */
+    register_pool(entry, pool, path);
+    return BAKE_SUCCESS;
+}
+
+static void close_pool(bake_pmem_pool_t* pool)
+{
+    unregister_pool(pool);
+    if (pool->pmem_pool) pmemobj_close(pool->pmem_pool);
+    free(pool->filename);
+    free(pool->root);
+}
+
+/* path is a pool file, or a comma-separated list of the pool files of a
+ * multi-pool target in the order given to bake_makepool
+ */
+static int bake_pmem_backend_initialize(bake_provider_t    provider,
+                                        const char*        path,
+                                        bake_target_id_t*  target,
+                                        backend_context_t* context)
+{
+    bake_pmem_entry_t* new_context
+        = (bake_pmem_entry_t*)calloc(1, sizeof(*new_context));
+    char *       paths = strdup(path), *name, *saveptr;
+    bake_root_t* root;
+    unsigned     i;
+    int          ret = BAKE_SUCCESS;
+
+    new_context->provider = provider;
+    new_context->pools
+        = calloc(BAKE_PMEM_MAX_POOLS, sizeof(*new_context->pools));
+
+    for (name = strtok_r(paths, ",", &saveptr); name;
+         name = strtok_r(NULL, ",", &saveptr)) {
+        if (new_context->num_pools == BAKE_PMEM_MAX_POOLS) {
+            ret = BAKE_ERR_INVALID_ARG;
+            goto error;
+        }
+        ret = open_pool(new_context,
+                        &new_context->pools[new_context->num_pools++], name);
+        if (ret != BAKE_SUCCESS) goto error;
+    }
+    if (new_context->num_pools == 0) {
+        ret = BAKE_ERR_INVALID_ARG;
+        goto error;
+    }
+
+    /* check that the pools make up one whole target, in order */
+    for (i = 0; i < new_context->num_pools; i++) {
+        root = new_context->pools[i].pmem_root;
+        if (uuid_compare(root->pool_id.id,
+                         new_context->pools[0].pmem_root->pool_id.id)
+                != 0
+            || root->pool_index != i
+            || (root->num_pools != new_context->num_pools
+                && !(root->num_pools == 0 && new_context->num_pools == 1))) {
+            fprintf(stderr,
+                    "Error: BAKE pools %s do not make up a target "
+                    "(pool %u is pool %u of %u)\n",
+                    path, i, root->pool_index, root->num_pools);
+            ret = BAKE_ERR_UNKNOWN_TARGET;
+            goto error;
+        }
+    }
+
+    new_context->pipeline_read_threshold
+        = BAKE_PMEM_DEFAULT_PIPELINE_READ_THRESHOLD;
+    new_context->chunk_size = BAKE_PMEM_DEFAULT_CHUNK_SIZE;
+    for (i = 0; i < BAKE_PMEM_CHUNK_LOCKS; i++)
+        ABT_mutex_create(&new_context->chunk_locks[i]);
+    ABT_mutex_create(&new_context->zero_mutex);
+    new_context->zero_bulk = HG_BULK_NULL;
+
+    init_alloc_conf(new_context);
+
+    free(paths);
+    *target  = new_context->pools[0].pmem_root->pool_id;
     *context = new_context;
     return 0;
+
+error:
+    for (i = 0; i < new_context->num_pools; i++)
+        close_pool(&new_context->pools[i]);
+    free(new_context->pools);
+    free(new_context);
+    free(paths);
+    return ret;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////
 static int bake_pmem_backend_finalize(backend_context_t context)
 {
     bake_pmem_entry_t* entry = (bake_pmem_entry_t*)context;
-    pmemobj_close(entry->pmem_pool);
-    free(entry->filename);
-    free(entry->root);
+    unsigned           i;
+
+    destroy_alloc_conf(entry);
+    for (i = 0; i < BAKE_PMEM_CHUNK_LOCKS; i++)
+        ABT_mutex_free(&entry->chunk_locks[i]);
+    ABT_mutex_free(&entry->zero_mutex);
+    margo_bulk_free(entry->zero_bulk);
+    free(entry->zero_block);
+    for (i = 0; i < entry->num_pools; i++) close_pool(&entry->pools[i]);
+    free(entry->pools);
     free(entry);
     return 0;
 }
@@ -144,8 +952,11 @@ bake_pmem_create(backend_context_t context, size_t size, bake_region_id_t* rid)
 
     pmemobj_region_id_t* prid = (pmemobj_region_id_t*)rid->data;
 
-    int ret = pmemobj_alloc(entry->pmem_pool, &prid->oid, content_size, 0, NULL,
-                            NULL);
+    if (entry->chunked_region_threshold
+        && size >= entry->chunked_region_threshold)
+        return create_chunked_region(entry, size, &prid->oid);
+
+    int ret = pmem_alloc(entry, &prid->oid, content_size);
     if (ret != 0) return BAKE_ERR_PMEM;
 
 #ifdef USE_SIZECHECK_HEADERS
@@ -161,34 +972,25 @@ bake_pmem_create(backend_context_t context, size_t size, bake_region_id_t* rid)
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
-static int write_transfer_data(margo_instance_id mid,
-                               bake_provider_t   provider,
-                               PMEMoid           pmoid,
-                               uint64_t          region_offset,
-                               hg_bulk_t         remote_bulk,
-                               uint64_t          remote_bulk_offset,
-                               uint64_t          bulk_size,
-                               hg_addr_t         src_addr,
-                               ABT_pool          target_pool)
+/* pulls bulk_size bytes of remote_bulk into memory, which belongs to the
+ * object pmoid
+ */
+static int write_to_pmem(bake_pmem_entry_t* entry,
+                         PMEMoid            pmoid,
+                         char*              memory,
+                         hg_bulk_t          remote_bulk,
+                         uint64_t           remote_bulk_offset,
+                         uint64_t           bulk_size,
+                         hg_addr_t          src_addr,
+                         ABT_pool           target_pool)
 {
-    region_content_t* region;
-    char*             memory;
+    margo_instance_id mid      = entry->provider->mid;
+    bake_provider_t   provider = entry->provider;
     hg_return_t       hret;
     hg_bulk_t         bulk_handle = HG_BULK_NULL;
-    int               ret         = 0;
-    struct xfer_args  x_args      = {0};
-    size_t            i;
-
-    /* find memory address for target object */
-    region = pmemobj_direct(pmoid);
-    if (!region) return (BAKE_ERR_UNKNOWN_REGION);
-
-#ifdef USE_SIZECHECK_HEADERS
-    if (region_offset + bulk_size > region->size)
-        return (BAKE_ERR_OUT_OF_BOUNDS);
-#endif
-
-    memory = region->data + region_offset;
+    hg_bulk_t         local_bulk;
+    size_t            local_offset = 0;
+    int               ret          = 0;
 
     /* resolve addr, could be addr of rpc sender (normal case) or a third
      * party (proxy write)
@@ -196,16 +998,20 @@ static int write_transfer_data(margo_instance_id mid,
     if (provider->config.pipeline_enable == 0) {
         /* normal path; no pipeline or intermediate buffers */
 
-        /* create bulk handle for local side of transfer */
-        hret = margo_bulk_create(mid, 1, (void**)(&memory), &bulk_size,
-                                 HG_BULK_WRITE_ONLY, &bulk_handle);
-        if (hret != HG_SUCCESS) {
-            ret = BAKE_ERR_MERCURY;
-            goto finish;
+        local_bulk = find_bulk_window(entry, memory, bulk_size, &local_offset);
+        if (local_bulk == HG_BULK_NULL) {
+            /* create bulk handle for local side of transfer */
+            hret = margo_bulk_create(mid, 1, (void**)(&memory), &bulk_size,
+                                     HG_BULK_WRITE_ONLY, &bulk_handle);
+            if (hret != HG_SUCCESS) {
+                ret = BAKE_ERR_MERCURY;
+                goto finish;
+            }
+            local_bulk = bulk_handle;
         }
-        hret = margo_bulk_transfer(mid, HG_BULK_PULL, src_addr, remote_bulk,
-                                   remote_bulk_offset, bulk_handle, 0,
-                                   bulk_size);
+        hret = bake_bulk_transfer(mid, HG_BULK_PULL, src_addr, remote_bulk,
+                                  remote_bulk_offset, local_bulk,
+                                  local_offset, bulk_size);
         if (hret != HG_SUCCESS) {
             ret = BAKE_ERR_MERCURY;
             goto finish;
@@ -214,41 +1020,10 @@ static int write_transfer_data(margo_instance_id mid,
     } else {
 
         /* pipelining mode, with intermediate buffers */
-
-        x_args.mid           = mid;
-        x_args.remote_addr   = src_addr;
-        x_args.remote_bulk   = remote_bulk;
-        x_args.remote_offset = remote_bulk_offset;
-        x_args.bulk_size     = bulk_size;
-        x_args.local_ptr     = memory;
-        x_args.bytes_issued  = 0;
-        x_args.bytes_retired = 0;
-        x_args.poolset       = provider->poolset;
-        margo_bulk_poolset_get_max(provider->poolset, &x_args.poolset_max_size);
-        x_args.ret = 0;
-        ABT_mutex_create(&x_args.mutex);
-        ABT_eventual_create(0, &x_args.eventual);
-
-        for (i = 0; i < bulk_size; i += x_args.poolset_max_size)
-            x_args.ults_active++;
-
-        /* issue one ult per pipeline chunk */
-        for (i = 0; i < bulk_size; i += x_args.poolset_max_size) {
-            /* note: setting output tid to NULL to ignore; we will let
-             * threads clean up themselves, with the last one setting an
-             * eventual to signal completion.
-             */
-            ABT_thread_create(target_pool, xfer_ult, &x_args,
-                              ABT_THREAD_ATTR_NULL, NULL);
-        }
-
-        ABT_eventual_wait(x_args.eventual, NULL);
-        ABT_eventual_free(&x_args.eventual);
-
-        /* consolidated error code (0 if all successful, otherwise first
-         * non-zero error code)
-         */
-        ret = x_args.ret;
+        ret = pipelined_transfer_data(
+            provider, memory, remote_bulk, remote_bulk_offset, bulk_size,
+            src_addr, target_pool, TRANSFER_DATA_WRITE,
+            entry->durable_writes ? pmemobj_pool_by_oid(pmoid) : NULL);
     }
 
 finish:
@@ -257,25 +1032,112 @@ finish:
     return (ret);
 }
 
+struct chunk_bulk_args {
+    hg_bulk_t bulk;
+    size_t    bulk_offset;
+    hg_addr_t addr;
+    ABT_pool  target_pool;
+};
+
+static int write_bulk_to_chunk(bake_pmem_entry_t* entry,
+                               PMEMoid            chunk,
+                               char*              data,
+                               size_t             size,
+                               size_t             done,
+                               void*              arg)
+{
+    struct chunk_bulk_args* args = arg;
+
+    return write_to_pmem(entry, chunk, data, args->bulk,
+                         args->bulk_offset + done, size, args->addr,
+                         args->target_pool);
+}
+
+static int write_transfer_data(bake_pmem_entry_t* entry,
+                               PMEMoid            pmoid,
+                               uint64_t           region_offset,
+                               hg_bulk_t          remote_bulk,
+                               uint64_t           remote_bulk_offset,
+                               uint64_t           bulk_size,
+                               hg_addr_t          src_addr,
+                               ABT_pool           target_pool)
+{
+    region_content_t* region;
+    chunk_map_t*      map;
+
+    /* find memory address for target object */
+    region = pmemobj_direct(pmoid);
+    if (!region) return (BAKE_ERR_UNKNOWN_REGION);
+
+    map = get_chunk_map(pmoid);
+    if (map) {
+        struct chunk_bulk_args args
+            = {remote_bulk, remote_bulk_offset, src_addr, target_pool};
+
+        if (region_offset + bulk_size > map->size)
+            return (BAKE_ERR_OUT_OF_BOUNDS);
+        return for_each_chunk(entry, pmoid, map, region_offset, bulk_size, 1,
+                              write_bulk_to_chunk, &args);
+    }
+
+#ifdef USE_SIZECHECK_HEADERS
+    if (region_offset + bulk_size > region->size)
+        return (BAKE_ERR_OUT_OF_BOUNDS);
+#endif
+
+    return write_to_pmem(entry, pmoid, region->data + region_offset,
+                         remote_bulk, remote_bulk_offset, bulk_size, src_addr,
+                         target_pool);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
+static int write_raw_to_chunk(bake_pmem_entry_t* entry,
+                              PMEMoid            chunk,
+                              char*              data,
+                              size_t             size,
+                              size_t             done,
+                              void*              arg)
+{
+    if (entry->durable_writes)
+        pmemobj_memcpy(pmemobj_pool_by_oid(chunk), data,
+                       (const char*)arg + done, size,
+                       PMEMOBJ_F_MEM_NONTEMPORAL);
+    else
+        memcpy(data, (const char*)arg + done, size);
+    return BAKE_SUCCESS;
+}
+
 static int bake_pmem_write_raw(backend_context_t context,
                                bake_region_id_t  rid,
                                size_t            offset,
                                size_t            size,
                                const void*       data)
 {
-    char*                ptr  = NULL;
-    pmemobj_region_id_t* prid = (pmemobj_region_id_t*)rid.data;
+    bake_pmem_entry_t*   entry = (bake_pmem_entry_t*)context;
+    char*                ptr   = NULL;
+    pmemobj_region_id_t* prid  = (pmemobj_region_id_t*)rid.data;
+    chunk_map_t*         map;
     /* find memory address for target object */
     region_content_t* region = pmemobj_direct(prid->oid);
     if (!region) return BAKE_ERR_PMEM;
 
+    map = get_chunk_map(prid->oid);
+    if (map) {
+        if (size + offset > map->size) return BAKE_ERR_OUT_OF_BOUNDS;
+        return for_each_chunk(entry, prid->oid, map, offset, size, 1,
+                              write_raw_to_chunk, (void*)data);
+    }
+
 #ifdef USE_SIZECHECK_HEADERS
     if (size + offset > region->size) return BAKE_ERR_OUT_OF_BOUNDS;
 #endif
 
     ptr = region->data + offset;
-    memcpy(ptr, data, size);
+    if (entry->durable_writes)
+        pmemobj_memcpy(pmemobj_pool_by_oid(prid->oid), ptr, data, size,
+                       PMEMOBJ_F_MEM_NONTEMPORAL);
+    else
+        memcpy(ptr, data, size);
 
     return BAKE_SUCCESS;
 }
@@ -296,12 +1158,26 @@ static int bake_pmem_write_bulk(backend_context_t context,
 
     ABT_pool handler_pool = entry->provider->handler_pool;
 
-    int ret = write_transfer_data(entry->provider->mid, entry->provider,
-                                  prid->oid, region_offset, bulk, bulk_offset,
-                                  size, source, handler_pool);
+    int ret = write_transfer_data(entry, prid->oid, region_offset, bulk,
+                                  bulk_offset, size, source, handler_pool);
     return ret;
 }
 
+/* copies a piece of a chunked region into arg, or zeros if unwritten */
+static int read_raw_from_chunk(bake_pmem_entry_t* entry,
+                               PMEMoid            chunk,
+                               char*              data,
+                               size_t             size,
+                               size_t             done,
+                               void*              arg)
+{
+    if (data)
+        memcpy((char*)arg + done, data, size);
+    else
+        memset((char*)arg + done, 0, size);
+    return BAKE_SUCCESS;
+}
+
 static int bake_pmem_read_raw(backend_context_t context,
                               bake_region_id_t  rid,
                               size_t            offset,
@@ -314,9 +1190,12 @@ static int bake_pmem_read_raw(backend_context_t context,
     *data      = NULL;
     *data_size = 0;
 
+    bake_pmem_entry_t*   entry  = (bake_pmem_entry_t*)context;
     char*                buffer = NULL;
     hg_size_t            size_to_read;
     pmemobj_region_id_t* prid = (pmemobj_region_id_t*)rid.data;
+    chunk_map_t*         map;
+    int                  ret;
 
     /* find memory address for target object */
     region_content_t* region = pmemobj_direct(prid->oid);
@@ -324,6 +1203,25 @@ static int bake_pmem_read_raw(backend_context_t context,
 
     size_to_read = size;
 
+    map = get_chunk_map(prid->oid);
+    if (map) {
+        /* the region is not contiguous; gather it in a buffer */
+        if (offset > map->size) return BAKE_ERR_OUT_OF_BOUNDS;
+        if (offset + size > map->size) size_to_read = map->size - offset;
+        buffer = malloc(size_to_read);
+        if (!buffer && size_to_read) return BAKE_ERR_ALLOCATION;
+        ret = for_each_chunk(entry, prid->oid, map, offset, size_to_read, 0,
+                             read_raw_from_chunk, buffer);
+        if (ret != BAKE_SUCCESS) {
+            free(buffer);
+            return ret;
+        }
+        *data      = buffer;
+        *data_size = size_to_read;
+        *free_data = free;
+        return BAKE_SUCCESS;
+    }
+
 #ifdef USE_SIZECHECK_HEADERS
     if (offset > region->size) return BAKE_ERR_OUT_OF_BOUNDS;
     if (offset + size > region->size) { size_to_read = region->size - offset; }
@@ -337,6 +1235,94 @@ static int bake_pmem_read_raw(backend_context_t context,
     return BAKE_SUCCESS;
 }
 
+/* pushes size_to_read bytes from buffer (in pmem) to bulk */
+static int read_from_pmem(bake_pmem_entry_t* entry,
+                          char*              buffer,
+                          hg_size_t          size_to_read,
+                          hg_bulk_t          bulk,
+                          hg_addr_t          source,
+                          size_t             bulk_offset)
+{
+    int         ret         = BAKE_SUCCESS;
+    hg_bulk_t   bulk_handle = HG_BULK_NULL;
+    hg_bulk_t   local_bulk;
+    size_t      local_offset = 0;
+    hg_return_t hret;
+
+    if (entry->provider->config.pipeline_enable
+        && size_to_read >= entry->pipeline_read_threshold) {
+        /* large read: relay through intermediate buffers */
+        return pipelined_transfer_data(
+            entry->provider, buffer, bulk, bulk_offset, size_to_read, source,
+            entry->provider->handler_pool, TRANSFER_DATA_READ, NULL);
+    }
+
+    local_bulk = find_bulk_window(entry, buffer, size_to_read, &local_offset);
+    if (local_bulk == HG_BULK_NULL) {
+        /* create bulk handle for local side of transfer */
+        hret = margo_bulk_create(entry->provider->mid, 1, (void**)(&buffer),
+                                 &size_to_read, HG_BULK_READ_ONLY,
+                                 &bulk_handle);
+        if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+        local_bulk = bulk_handle;
+    }
+
+    hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PUSH, source, bulk,
+                              bulk_offset, local_bulk, local_offset,
+                              size_to_read);
+    if (hret != HG_SUCCESS) ret = BAKE_ERR_MERCURY;
+
+    margo_bulk_free(bulk_handle);
+    return ret;
+}
+
+/* pushes size zeros to bulk, for unwritten chunks of chunked regions */
+static int push_zeros(bake_pmem_entry_t* entry,
+                      size_t             size,
+                      hg_bulk_t          bulk,
+                      hg_addr_t          source,
+                      size_t             bulk_offset)
+{
+    hg_size_t   block_size = BAKE_PMEM_ZERO_BLOCK_SIZE;
+    size_t      len;
+    hg_return_t hret;
+
+    ABT_mutex_lock(entry->zero_mutex);
+    if (entry->zero_bulk == HG_BULK_NULL) {
+        if (!entry->zero_block) entry->zero_block = calloc(1, block_size);
+        if (entry->zero_block)
+            margo_bulk_create(entry->provider->mid, 1,
+                              (void**)&entry->zero_block, &block_size,
+                              HG_BULK_READ_ONLY, &entry->zero_bulk);
+    }
+    ABT_mutex_unlock(entry->zero_mutex);
+    if (entry->zero_bulk == HG_BULK_NULL) return BAKE_ERR_MERCURY;
+
+    for (; size; size -= len, bulk_offset += len) {
+        len  = size < block_size ? size : block_size;
+        hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PUSH, source,
+                                  bulk, bulk_offset, entry->zero_bulk, 0, len);
+        if (hret != HG_SUCCESS) return BAKE_ERR_MERCURY;
+    }
+    return BAKE_SUCCESS;
+}
+
+static int read_bulk_from_chunk(bake_pmem_entry_t* entry,
+                                PMEMoid            chunk,
+                                char*              data,
+                                size_t             size,
+                                size_t             done,
+                                void*              arg)
+{
+    struct chunk_bulk_args* args = arg;
+
+    if (!data)
+        return push_zeros(entry, size, args->bulk, args->addr,
+                          args->bulk_offset + done);
+    return read_from_pmem(entry, data, size, args->bulk, args->addr,
+                          args->bulk_offset + done);
+}
+
 static int bake_pmem_read_bulk(backend_context_t context,
                                bake_region_id_t  rid,
                                size_t            region_offset,
@@ -346,11 +1332,11 @@ static int bake_pmem_read_bulk(backend_context_t context,
                                size_t            bulk_offset,
                                size_t*           bytes_read)
 {
-    int                  ret         = BAKE_SUCCESS;
-    bake_pmem_entry_t*   entry       = (bake_pmem_entry_t*)context;
-    char*                buffer      = NULL;
-    hg_bulk_t            bulk_handle = HG_BULK_NULL;
+    int                  ret    = BAKE_SUCCESS;
+    bake_pmem_entry_t*   entry  = (bake_pmem_entry_t*)context;
+    char*                buffer = NULL;
     pmemobj_region_id_t* prid;
+    chunk_map_t*         map;
     hg_size_t            size_to_read;
     *bytes_read = 0;
 
@@ -365,6 +1351,19 @@ static int bake_pmem_read_bulk(backend_context_t context,
 
     size_to_read = size;
 
+    map = get_chunk_map(prid->oid);
+    if (map) {
+        struct chunk_bulk_args args = {bulk, bulk_offset, source, NULL};
+
+        if (region_offset > map->size) return BAKE_ERR_OUT_OF_BOUNDS;
+        if (region_offset + size > map->size)
+            size_to_read = map->size - region_offset;
+        ret = for_each_chunk(entry, prid->oid, map, region_offset,
+                             size_to_read, 0, read_bulk_from_chunk, &args);
+        if (ret == BAKE_SUCCESS) *bytes_read = size_to_read;
+        return ret;
+    }
+
 #ifdef USE_SIZECHECK_HEADERS
     if (region_offset > region->size) {
         ret = BAKE_ERR_OUT_OF_BOUNDS;
@@ -379,42 +1378,48 @@ static int bake_pmem_read_bulk(backend_context_t context,
 
     buffer = region->data + region_offset;
 
-    /* create bulk handle for local side of transfer */
-    hg_return_t hret
-        = margo_bulk_create(entry->provider->mid, 1, (void**)(&buffer),
-                            &size_to_read, HG_BULK_READ_ONLY, &bulk_handle);
-    if (hret != HG_SUCCESS) {
-        ret = BAKE_ERR_MERCURY;
-        goto finish;
-    }
-
-    hret = margo_bulk_transfer(entry->provider->mid, HG_BULK_PUSH, source, bulk,
-                               bulk_offset, bulk_handle, 0, size_to_read);
-
-    if (hret != HG_SUCCESS) {
-        ret = BAKE_ERR_MERCURY;
-        goto finish;
-    }
-
-    *bytes_read = size_to_read;
+    ret = read_from_pmem(entry, buffer, size_to_read, bulk, source,
+                         bulk_offset);
+    if (ret == BAKE_SUCCESS) *bytes_read = size_to_read;
 
 finish:
-    margo_bulk_free(bulk_handle);
     return ret;
 }
 
+/* unwritten chunks have nothing to persist */
+static int persist_chunk(bake_pmem_entry_t* entry,
+                         PMEMoid            chunk,
+                         char*              data,
+                         size_t             size,
+                         size_t             done,
+                         void*              arg)
+{
+    if (data) pmemobj_persist(pmemobj_pool_by_oid(chunk), data, size);
+    return BAKE_SUCCESS;
+}
+
 static int bake_pmem_persist(backend_context_t context,
                              bake_region_id_t  rid,
                              size_t            offset,
                              size_t            size)
 {
-    char*                ptr  = NULL;
-    pmemobj_region_id_t* prid = (pmemobj_region_id_t*)rid.data;
+    bake_pmem_entry_t*   entry = (bake_pmem_entry_t*)context;
+    char*                ptr   = NULL;
+    pmemobj_region_id_t* prid  = (pmemobj_region_id_t*)rid.data;
+    chunk_map_t*         map;
     /* find memory address for target object */
     region_content_t* region = pmemobj_direct(prid->oid);
     if (!region) return BAKE_ERR_PMEM;
     ptr = region->data;
 
+    map = get_chunk_map(prid->oid);
+    if (map) {
+        if (offset > map->size) return BAKE_ERR_OUT_OF_BOUNDS;
+        if (offset + size > map->size) size = map->size - offset;
+        return for_each_chunk(entry, prid->oid, map, offset, size, 0,
+                              persist_chunk, NULL);
+    }
+
     /* TODO: should this have an abt shim in case it blocks? */
     PMEMobjpool* pmem_pool = pmemobj_pool_by_oid(prid->oid);
     pmemobj_persist(pmem_pool, ptr + offset, size);
@@ -441,8 +1446,7 @@ static int bake_pmem_create_write_persist_raw(backend_context_t context,
 #endif
     prid = (pmemobj_region_id_t*)rid->data;
 
-    int ret = pmemobj_alloc(entry->pmem_pool, &prid->oid, content_size, 0, NULL,
-                            NULL);
+    int ret = pmem_alloc(entry, &prid->oid, content_size);
     if (ret != 0) return BAKE_ERR_PMEM;
 
     /* find memory address for target object */
@@ -453,10 +1457,17 @@ static int bake_pmem_create_write_persist_raw(backend_context_t context,
 #endif
     buffer = region->data;
 
-    memcpy(buffer, data, size);
+    if (entry->durable_writes) {
+        /* the data is persisted as it is copied; only the header is left */
+        pmemobj_memcpy(pmemobj_pool_by_oid(prid->oid), buffer, data, size,
+                       PMEMOBJ_F_MEM_NONTEMPORAL);
+        content_size -= size;
+    } else
+        memcpy(buffer, data, size);
 
     /* TODO: should this have an abt shim in case it blocks? */
-    pmemobj_persist(entry->pmem_pool, region, content_size);
+    if (content_size)
+        pmemobj_persist(pmemobj_pool_by_oid(prid->oid), region, content_size);
 
     return BAKE_SUCCESS;
 }
@@ -483,12 +1494,11 @@ static int bake_pmem_create_write_persist_bulk(backend_context_t context,
 
     prid = (pmemobj_region_id_t*)rid->data;
 
-    int ret = pmemobj_alloc(entry->pmem_pool, &prid->oid, content_size, 0, NULL,
-                            NULL);
+    int ret = pmem_alloc(entry, &prid->oid, content_size);
     if (ret != 0) return BAKE_ERR_PMEM;
 
-    ret = write_transfer_data(entry->provider->mid, entry->provider, prid->oid,
-                              0, bulk, bulk_offset, size, source, handler_pool);
+    ret = write_transfer_data(entry, prid->oid, 0, bulk, bulk_offset, size,
+                              source, handler_pool);
 
     if (ret == BAKE_SUCCESS) {
         /* find memory address for target object */
@@ -497,7 +1507,14 @@ static int bake_pmem_create_write_persist_bulk(backend_context_t context,
 #ifdef USE_SIZECHECK_HEADERS
         region->size = size;
 #endif
-        pmemobj_persist(entry->pmem_pool, region, content_size);
+        /* data relayed by the pipeline in durable mode is already
+         * persistent; only the header is left
+         */
+        if (entry->durable_writes && entry->provider->config.pipeline_enable)
+            content_size -= size;
+        if (content_size)
+            pmemobj_persist(pmemobj_pool_by_oid(prid->oid), region,
+                            content_size);
     }
 
     return BAKE_SUCCESS;
@@ -507,8 +1524,15 @@ static int bake_pmem_get_region_size(backend_context_t context,
                                      bake_region_id_t  rid,
                                      size_t*           size)
 {
-#ifdef USE_SIZECHECK_HEADERS
     pmemobj_region_id_t* prid = (pmemobj_region_id_t*)rid.data;
+    chunk_map_t*         map  = get_chunk_map(prid->oid);
+
+    /* chunked regions always record their size */
+    if (map) {
+        *size = map->size;
+        return BAKE_SUCCESS;
+    }
+#ifdef USE_SIZECHECK_HEADERS
     /* lock provider */
     region_content_t* region = pmemobj_direct(prid->oid);
     if (!region) return BAKE_ERR_PMEM;
@@ -528,15 +1552,18 @@ static int bake_pmem_get_region_data(backend_context_t context,
     region_content_t* region = pmemobj_direct(prid->oid);
     if (!region) return BAKE_ERR_UNKNOWN_REGION;
 
+    /* chunked regions are not contiguous */
+    if (get_chunk_map(prid->oid)) return BAKE_ERR_OP_UNSUPPORTED;
+
     *data = region->data;
     return BAKE_SUCCESS;
 }
 
 static int bake_pmem_remove(backend_context_t context, bake_region_id_t rid)
 {
-    pmemobj_region_id_t* prid = (pmemobj_region_id_t*)rid.data;
-    pmemobj_free(&prid->oid);
-    return BAKE_SUCCESS;
+    bake_pmem_entry_t*   entry = (bake_pmem_entry_t*)context;
+    pmemobj_region_id_t* prid  = (pmemobj_region_id_t*)rid.data;
+    return remove_region(entry, &prid->oid);
 }
 
 static int bake_pmem_migrate_region(backend_context_t context,
@@ -550,6 +1577,8 @@ static int bake_pmem_migrate_region(backend_context_t context,
 {
     bake_pmem_entry_t*   entry = (bake_pmem_entry_t*)context;
     pmemobj_region_id_t* prid;
+    chunk_map_t*         map;
+    char*                gathered  = NULL;
     hg_addr_t            dest_addr = HG_ADDR_NULL;
     int                  ret       = BAKE_SUCCESS;
 
@@ -565,9 +1594,26 @@ static int bake_pmem_migrate_region(backend_context_t context,
     /* get the size of the region */
     char* region_data = region->data;
 
+    map = get_chunk_map(prid->oid);
+    if (map) {
+        /* send a contiguous copy of chunked regions */
+        if (region_size != map->size) {
+            ret = BAKE_ERR_INVALID_ARG;
+            goto finish;
+        }
+        gathered = malloc(region_size);
+        if (!gathered && region_size) {
+            ret = BAKE_ERR_ALLOCATION;
+            goto finish;
+        }
+        ret = for_each_chunk(entry, prid->oid, map, 0, region_size, 0,
+                             read_raw_from_chunk, gathered);
+        if (ret != BAKE_SUCCESS) goto finish;
+        region_data = gathered;
+    }
 #ifdef USE_SIZECHECK_HEADERS
     /* check region size */
-    if (region_size != region->size) {
+    else if (region_size != region->size) {
         ret = BAKE_ERR_INVALID_ARG;
         goto finish;
     }
@@ -583,13 +1629,17 @@ static int bake_pmem_migrate_region(backend_context_t context,
 
     { /* in this block we issue a create_write_persist to the destination */
         hg_handle_t                     cwp_handle = HG_HANDLE_NULL;
-        bake_create_write_persist_in_t  cwp_in;
+        bake_create_write_persist_in_t  cwp_in = {0};
         bake_create_write_persist_out_t cwp_out;
 
         cwp_in.bti             = dest_target_id;
+        cwp_in.region_size     = region_size;
         cwp_in.bulk_offset     = 0;
         cwp_in.bulk_size       = region_size;
         cwp_in.remote_addr_str = NULL;
+        /* the copy is a migration for the destination's scheduler */
+        cwp_in.qos_class = BAKE_QOS_CLASS_BACKGROUND;
+        cwp_in.req_id    = bake_trace_current_request();
 
         hret = margo_bulk_create(entry->provider->mid, 1,
                                  (void**)(&region_data), &region_size,
@@ -635,9 +1685,10 @@ finish_scope:
 
     if (ret != BAKE_SUCCESS) goto finish;
 
-    if (remove_source) { pmemobj_free(&prid->oid); }
+    if (remove_source) ret = remove_region(entry, &prid->oid);
 
 finish:
+    free(gathered);
     margo_addr_free(entry->provider->mid, dest_addr);
     return ret;
 }
@@ -648,15 +1699,21 @@ static int bake_pmem_create_fileset(backend_context_t context,
 {
     bake_pmem_entry_t* entry = (bake_pmem_entry_t*)context;
     int                ret;
+
+    /* the pools of a multi-pool target usually live in different
+     * directories, and the destination would add each of them as a target
+     */
+    if (entry->num_pools > 1) return BAKE_ERR_OP_UNSUPPORTED;
+
     /* create a fileset */
-    ret = remi_fileset_create("bake", entry->root, fileset);
+    ret = remi_fileset_create("bake", entry->pools[0].root, fileset);
     if (ret != REMI_SUCCESS) {
         ret = BAKE_ERR_REMI;
         goto error;
     }
 
     /* fill the fileset */
-    ret = remi_fileset_register_file(*fileset, entry->filename);
+    ret = remi_fileset_register_file(*fileset, entry->pools[0].filename);
     if (ret != REMI_SUCCESS) {
         ret = BAKE_ERR_REMI;
         goto error;
@@ -675,7 +1732,121 @@ static int bake_pmem_set_conf(backend_context_t context,
                               const char*       key,
                               const char*       value)
 {
-    return 0;
+    bake_pmem_entry_t* entry = (bake_pmem_entry_t*)context;
+
+    if (strcmp(key, "pipeline_read_threshold") == 0) {
+        if (sscanf(value, "%zu", &entry->pipeline_read_threshold) != 1)
+            return BAKE_ERR_INVALID_ARG;
+        return BAKE_SUCCESS;
+    }
+    if (strcmp(key, "durable_writes") == 0) {
+        if (sscanf(value, "%d", &entry->durable_writes) != 1)
+            return BAKE_ERR_INVALID_ARG;
+        return BAKE_SUCCESS;
+    }
+    if (strcmp(key, "chunked_region_threshold") == 0) {
+        if (sscanf(value, "%zu", &entry->chunked_region_threshold) != 1)
+            return BAKE_ERR_INVALID_ARG;
+        return BAKE_SUCCESS;
+    }
+    if (strcmp(key, "chunk_size") == 0) {
+        size_t chunk_size;
+        if (sscanf(value, "%zu", &chunk_size) != 1 || chunk_size == 0)
+            return BAKE_ERR_INVALID_ARG;
+        entry->chunk_size = chunk_size;
+        return BAKE_SUCCESS;
+    }
+    if (strncmp(key, "alloc_", 6) == 0 || strcmp(key, "pool_routing") == 0)
+        return update_alloc_conf(entry, key, value);
+    return BAKE_ERR_OP_UNSUPPORTED;
+}
+
+static int bake_pmem_get_stats(backend_context_t context, FILE* out)
+{
+    bake_pmem_entry_t* entry = (bake_pmem_entry_t*)context;
+    pmem_alloc_conf_t* conf
+        = __atomic_load_n(&entry->alloc_conf, __ATOMIC_ACQUIRE);
+    static const char* routings[] = {"round-robin", "xstream",
+                                       "least-allocated"};
+    unsigned           i, num_classes = conf ? conf->num_classes : 0;
+
+    fprintf(out, "pipeline_read_threshold = %zu\n",
+            entry->pipeline_read_threshold);
+    fprintf(out, "durable_writes = %d\n", entry->durable_writes);
+    fprintf(out, "chunked_region_threshold = %zu\n",
+            entry->chunked_region_threshold);
+    fprintf(out, "chunk_size = %zu\n", entry->chunk_size);
+    fprintf(out, "pools = %u\n", entry->num_pools);
+    fprintf(out, "pool_routing = %s\n",
+            routings[conf ? conf->pool_routing : POOL_ROUTING_ROUND_ROBIN]);
+    for (i = 0; i < entry->num_pools; i++) {
+        fprintf(out, "pool.%u.allocated = %" PRIu64 "\n", i,
+                __atomic_load_n(&entry->pools[i].allocated, __ATOMIC_RELAXED));
+        fprintf(out, "pool.%u.registered_windows = %zu\n", i,
+                entry->pools[i].num_bulk_windows);
+    }
+    fprintf(out, "alloc_arenas = %u\n", conf ? conf->num_arenas : 0);
+    fprintf(out, "alloc_classes = ");
+    for (i = 0; i < num_classes; i++)
+        fprintf(out, "%s%zu", i ? "," : "",
+                conf->class_unit_sizes[i] - REGION_HEADER_SIZE);
+    fprintf(out, "\n");
+    return BAKE_SUCCESS;
+}
+
+/* common utility function for relaying data through the pipeline poolset;
+ * memory is the local (pmem) side of the transfer
+ */
+static int pipelined_transfer_data(bake_provider_t provider,
+                                   char*           memory,
+                                   hg_bulk_t       remote_bulk,
+                                   uint64_t        remote_bulk_offset,
+                                   uint64_t        bulk_size,
+                                   hg_addr_t       remote_addr,
+                                   ABT_pool        target_pool,
+                                   int             op_flag,
+                                   PMEMobjpool*    durable_pool)
+{
+    struct xfer_args x_args = {0};
+    size_t           i;
+
+    x_args.mid           = provider->mid;
+    x_args.remote_addr   = remote_addr;
+    x_args.remote_bulk   = remote_bulk;
+    x_args.remote_offset = remote_bulk_offset;
+    x_args.bulk_size     = bulk_size;
+    x_args.local_ptr     = memory;
+    x_args.bytes_issued  = 0;
+    x_args.bytes_retired = 0;
+    x_args.poolset       = provider->poolset;
+    bake_poolset_get_max(provider->poolset, &x_args.poolset_max_size);
+    x_args.ret     = 0;
+    x_args.op_flag      = op_flag;
+    x_args.durable_pool = durable_pool;
+    x_args.trace        = bake_trace_get_current();
+    ABT_mutex_create(&x_args.mutex);
+    ABT_eventual_create(0, &x_args.eventual);
+
+    for (i = 0; i < bulk_size; i += x_args.poolset_max_size)
+        x_args.ults_active++;
+
+    /* issue one ult per pipeline chunk */
+    for (i = 0; i < bulk_size; i += x_args.poolset_max_size) {
+        /* note: setting output tid to NULL to ignore; we will let
+         * threads clean up themselves, with the last one setting an
+         * eventual to signal completion.
+         */
+        ABT_thread_create(target_pool, xfer_ult, &x_args, ABT_THREAD_ATTR_NULL,
+                          NULL);
+    }
+
+    ABT_eventual_wait(x_args.eventual, NULL);
+    ABT_eventual_free(&x_args.eventual);
+
+    /* consolidated error code (0 if all successful, otherwise first
+     * non-zero error code)
+     */
+    return x_args.ret;
 }
 
 bake_backend g_bake_pmem_backend
@@ -697,7 +1868,8 @@ bake_backend g_bake_pmem_backend
 #ifdef USE_REMI
        ._create_fileset = bake_pmem_create_fileset,
 #endif
-       ._set_conf = bake_pmem_set_conf};
+       ._set_conf = bake_pmem_set_conf,
+       ._get_stats = bake_pmem_get_stats};
 
 static void xfer_ult(void* _args)
 {
@@ -716,6 +1888,7 @@ static void xfer_ult(void* _args)
      * timing of whether this ULT gets through a cycle before other ULTs
      * start running.  We don't care which ULT does the next chunk.
      */
+    bake_trace_set_current(args->trace);
     ABT_mutex_lock(args->mutex);
     while (args->bytes_issued < args->bulk_size && !args->ret) {
         /* calculate what work we will do in this cycle */
@@ -733,7 +1906,7 @@ static void xfer_ult(void* _args)
         ABT_mutex_unlock(args->mutex);
 
         /* get buffer */
-        ret = margo_bulk_poolset_get(args->poolset, this_size, &local_bulk);
+        ret = bake_poolset_get(args->poolset, this_size, &local_bulk);
         if (ret != 0 && args->ret == 0) {
             args->ret = ret;
             goto finished;
@@ -745,20 +1918,44 @@ static void xfer_ult(void* _args)
         /* shouldn't ever fail in this use case */
         assert(ret == 0);
 
-        /* do the rdma transfer */
-        ret = margo_bulk_transfer(args->mid, HG_BULK_PULL, args->remote_addr,
-                                  args->remote_bulk, this_remote_offset,
-                                  local_bulk, 0, this_size);
-        if (ret != 0 && args->ret == 0) {
-            args->ret = ret;
-            goto finished;
-        }
-
-        /* copy to real destination */
-        memcpy(this_local_ptr, local_bulk_ptr, this_size);
+        if (args->op_flag == TRANSFER_DATA_WRITE) {
+            /* do the rdma transfer */
+            ret = bake_bulk_transfer(args->mid, HG_BULK_PULL,
+                                     args->remote_addr, args->remote_bulk,
+                                     this_remote_offset, local_bulk, 0,
+                                     this_size);
+            if (ret != 0 && args->ret == 0) {
+                args->ret = ret;
+                goto finished;
+            }
+
+            /* copy to real destination, bypassing the cache and persisting
+             * in the same pass in durable mode
+             */
+            if (args->durable_pool)
+                pmemobj_memcpy(args->durable_pool, this_local_ptr,
+                               local_bulk_ptr, this_size,
+                               PMEMOBJ_F_MEM_NONTEMPORAL);
+            else
+                memcpy(this_local_ptr, local_bulk_ptr, this_size);
+        } else if (args->op_flag == TRANSFER_DATA_READ) {
+            /* copy from real source */
+            memcpy(local_bulk_ptr, this_local_ptr, this_size);
+
+            /* do the rdma transfer */
+            ret = bake_bulk_transfer(args->mid, HG_BULK_PUSH,
+                                     args->remote_addr, args->remote_bulk,
+                                     this_remote_offset, local_bulk, 0,
+                                     this_size);
+            if (ret != 0 && args->ret == 0) {
+                args->ret = ret;
+                goto finished;
+            }
+        } else
+            assert(0);
 
         /* let go of bulk handle */
-        margo_bulk_poolset_release(args->poolset, local_bulk);
+        bake_poolset_release(args->poolset, local_bulk);
         local_bulk = HG_BULK_NULL;
 
         ABT_mutex_lock(args->mutex);
@@ -781,8 +1978,9 @@ static void xfer_ult(void* _args)
     ABT_mutex_unlock(args->mutex);
 
 finished:
+    bake_trace_set_current(NULL);
     if (local_bulk != HG_BULK_NULL)
-        margo_bulk_poolset_release(args->poolset, local_bulk);
+        bake_poolset_release(args->poolset, local_bulk);
     ABT_mutex_lock(args->mutex);
     args->ults_active--;
     if (!args->ults_active) turn_out_the_lights = 1;
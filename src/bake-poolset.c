@@ -0,0 +1,691 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "bake.h"
+#include "bake-poolset.h"
+#include "bake-numa.h"
+#include "bake-trace.h"
+
+/* pipeline buffers are relayed to and from directio files */
+#define BAKE_POOLSET_ALIGNMENT 4096
+
+/* upper bounds of the wait time histogram buckets, in seconds; the last
+ * bucket counts longer waits */
+static const double g_wait_bounds[BAKE_POOLSET_WAIT_BUCKETS - 1]
+    = {1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1.0};
+static const char* g_wait_labels[BAKE_POOLSET_WAIT_BUCKETS]
+    = {"10us", "100us", "1ms", "10ms", "100ms", "1s", "inf"};
+
+/* a mapping holding consecutive buffers of a pool, each registered on its
+ * own; with huge pages a slab spans at least one huge page, so that small
+ * buffers do not each take one */
+typedef struct slab {
+    char*        base;
+    size_t       len;
+    unsigned     nbufs;
+    int          pages; /* BAKE_NUMA_PAGES_* */
+    hg_bulk_t*   bulks;
+    struct slab* next;
+} slab_t;
+
+/* buffers of one size */
+typedef struct {
+    hg_size_t  buffer_size;
+    size_t     stride; /* buffer_size rounded up to BAKE_POOLSET_ALIGNMENT */
+    unsigned   buffers_per_slab;
+    slab_t*    slabs;
+    hg_bulk_t* free; /* stack of free buffers, max_buffers entries */
+    unsigned   num_free;
+    unsigned   num_allocated; /* including those being allocated */
+    unsigned   peak_allocated;
+    unsigned   low_free; /* fewest free buffers since the window started */
+    unsigned   waiting;
+    ABT_cond   cond;
+    uint64_t   gets;
+    uint64_t   waits;
+    uint64_t   grows;
+    uint64_t   shrinks;
+} pool_t;
+
+/* one per margo instance and geometry */
+struct shared_poolset {
+    /* registry state, protected by g_poolsets_mutex */
+    margo_instance_id      mid;
+    int                    refcount;
+    struct shared_poolset* next;
+
+    hg_size_t npools, max_buffers, first_size, size_multiple;
+    int       numa_node; /* -1 for none */
+    int       huge_pages;
+
+    /* pool state, protected by mutex */
+    ABT_mutex mutex;
+    pool_t*   pools;
+    unsigned  min_buffers;
+    unsigned  idle_ms; /* 0 never shrinks */
+    double    window_start;
+    uint64_t  wait_histogram[BAKE_POOLSET_WAIT_BUCKETS];
+    double    wait_time;
+    unsigned  slabs_by_pages[3]; /* indexed by BAKE_NUMA_PAGES_* */
+};
+
+/* one per provider */
+struct bake_poolset {
+    struct shared_poolset* shared;
+
+    /* quota state, protected by mutex */
+    ABT_mutex mutex;
+    ABT_cond  cond;
+    size_t    quota; /* 0 means unlimited */
+    size_t    in_use;
+    unsigned  buffers;
+    unsigned  waiting;
+    size_t    peak_in_use;
+    uint64_t  gets;
+    uint64_t  gets_waited;
+    uint64_t  trygets_refused;
+};
+
+static pthread_mutex_t        g_poolsets_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct shared_poolset* g_poolsets       = NULL;
+
+static void slab_destroy(slab_t* slab)
+{
+    unsigned i;
+
+    for (i = 0; i < slab->nbufs; i++)
+        if (slab->bulks[i] != HG_BULK_NULL) margo_bulk_free(slab->bulks[i]);
+    free(slab->bulks);
+    bake_numa_unmap(slab->base, slab->len);
+    free(slab);
+}
+
+/* maps and registers a slab of nbufs buffers; called without the mutex
+ * held */
+static slab_t* slab_create(struct shared_poolset* s, pool_t* pool, unsigned nbufs)
+{
+    slab_t*     slab;
+    hg_size_t   size = pool->buffer_size;
+    size_t      unit = s->huge_pages ? BAKE_HUGE_PAGE_SIZE : BAKE_POOLSET_ALIGNMENT;
+    void*       ptr;
+    unsigned    i;
+    hg_return_t hret;
+
+    slab = calloc(1, sizeof(*slab));
+    if (!slab) return NULL;
+    slab->nbufs = nbufs;
+    slab->len   = (nbufs * pool->stride + unit - 1) / unit * unit;
+    slab->bulks = calloc(nbufs, sizeof(*slab->bulks));
+    if (!slab->bulks) {
+        free(slab);
+        return NULL;
+    }
+    slab->base = bake_numa_map(slab->len, s->numa_node, s->huge_pages,
+                               &slab->pages);
+    if (!slab->base) {
+        free(slab->bulks);
+        free(slab);
+        return NULL;
+    }
+    for (i = 0; i < nbufs; i++) {
+        ptr  = slab->base + i * pool->stride;
+        hret = margo_bulk_create(s->mid, 1, &ptr, &size, HG_BULK_READWRITE,
+                                 &slab->bulks[i]);
+        if (hret != HG_SUCCESS) {
+            slab->bulks[i] = HG_BULK_NULL;
+            slab_destroy(slab);
+            return NULL;
+        }
+    }
+    return slab;
+}
+
+/* returns whether a free buffer lies in a slab */
+static int slab_contains(slab_t* slab, hg_bulk_t bulk)
+{
+    unsigned i;
+
+    for (i = 0; i < slab->nbufs; i++)
+        if (slab->bulks[i] == bulk) return 1;
+    return 0;
+}
+
+/* removes a slab whose buffers are all free from the pool; called with the
+ * mutex held */
+static void pool_drop_slab(struct shared_poolset* s, pool_t* pool, slab_t** link)
+{
+    slab_t*  slab = *link;
+    unsigned i, j;
+
+    for (i = 0, j = 0; i < pool->num_free; i++)
+        if (!slab_contains(slab, pool->free[i]))
+            pool->free[j++] = pool->free[i];
+    pool->num_free = j;
+    pool->num_allocated -= slab->nbufs;
+    pool->shrinks += slab->nbufs;
+    s->slabs_by_pages[slab->pages]--;
+    *link = slab->next;
+    slab_destroy(slab);
+}
+
+/* frees the slabs whose buffers all stayed free for a whole idle period,
+ * keeping at least min_buffers per pool; called with the mutex held */
+static void maybe_shrink(struct shared_poolset* s, double now)
+{
+    pool_t*  pool;
+    slab_t** link;
+    unsigned i, j, nfree, budget;
+
+    if (!s->idle_ms || (now - s->window_start) * 1000.0 < s->idle_ms) return;
+    for (i = 0; i < s->npools; i++) {
+        pool   = &s->pools[i];
+        budget = pool->low_free;
+        for (link = &pool->slabs; *link;) {
+            for (j = 0, nfree = 0; j < pool->num_free; j++)
+                nfree += slab_contains(*link, pool->free[j]);
+            if (nfree == (*link)->nbufs && nfree <= budget
+                && pool->num_allocated >= s->min_buffers + nfree) {
+                budget -= nfree;
+                pool_drop_slab(s, pool, link);
+            } else
+                link = &(*link)->next;
+        }
+        pool->low_free = pool->num_free;
+    }
+    s->window_start = now;
+}
+
+static void pop_free(pool_t* pool, hg_bulk_t* bulk)
+{
+    *bulk = pool->free[--pool->num_free];
+    if (pool->num_free < pool->low_free) pool->low_free = pool->num_free;
+}
+
+/* grows a pool by one slab, returning one of its buffers and putting the
+ * others on the free stack; drops the mutex while the slab is mapped and
+ * registered; called with the mutex held */
+static int pool_grow(struct shared_poolset* s, pool_t* pool, hg_bulk_t* bulk)
+{
+    slab_t*  slab;
+    unsigned n = pool->buffers_per_slab, i;
+
+    if (n > s->max_buffers - pool->num_allocated)
+        n = s->max_buffers - pool->num_allocated;
+    pool->num_allocated += n;
+    if (pool->num_allocated > pool->peak_allocated)
+        pool->peak_allocated = pool->num_allocated;
+    ABT_mutex_unlock(s->mutex);
+    slab = slab_create(s, pool, n);
+    ABT_mutex_lock(s->mutex);
+    if (!slab) {
+        pool->num_allocated -= n;
+        return -1;
+    }
+    slab->next  = pool->slabs;
+    pool->slabs = slab;
+    s->slabs_by_pages[slab->pages]++;
+    pool->grows += n;
+    *bulk = slab->bulks[0];
+    for (i = 1; i < n; i++) pool->free[pool->num_free++] = slab->bulks[i];
+    if (n > 1 && pool->waiting) ABT_cond_broadcast(pool->cond);
+    return 0;
+}
+
+static void record_wait(struct shared_poolset* s, double t)
+{
+    unsigned b;
+
+    for (b = 0; b < BAKE_POOLSET_WAIT_BUCKETS - 1; b++)
+        if (t < g_wait_bounds[b]) break;
+    s->wait_histogram[b]++;
+    s->wait_time += t;
+}
+
+/* returns the pool of the smallest buffers that hold size bytes, or -1 */
+static int pool_index(struct shared_poolset* s, hg_size_t size)
+{
+    unsigned i;
+
+    for (i = 0; i < s->npools; i++)
+        if (s->pools[i].buffer_size >= size) return i;
+    return -1;
+}
+
+static int shared_get(struct shared_poolset* s, hg_size_t size, hg_bulk_t* bulk)
+{
+    pool_t* pool;
+    int     i   = pool_index(s, size);
+    int     ret = 0;
+    double  t0;
+
+    if (i < 0) return -1;
+    pool = &s->pools[i];
+
+    ABT_mutex_lock(s->mutex);
+    pool->gets++;
+    t0 = ABT_get_wtime();
+    maybe_shrink(s, t0);
+    for (;;) {
+        if (pool->num_free) {
+            pop_free(pool, bulk);
+            break;
+        }
+        if (pool->num_allocated < s->max_buffers) {
+            ret = pool_grow(s, pool, bulk);
+            break;
+        }
+        pool->waiting++;
+        pool->waits++;
+        ABT_cond_wait(pool->cond, s->mutex);
+        pool->waiting--;
+    }
+    /* every get counts, so that the histogram shows how often we wait */
+    record_wait(s, ABT_get_wtime() - t0);
+    ABT_mutex_unlock(s->mutex);
+    return ret;
+}
+
+static int shared_tryget(struct shared_poolset* s,
+                         hg_size_t              size,
+                         hg_bool_t              any_flag,
+                         hg_bulk_t*             bulk)
+{
+    pool_t* pool;
+    int     i = pool_index(s, size);
+    int     last;
+
+    *bulk = HG_BULK_NULL;
+    if (i < 0) return -1;
+    last = any_flag ? (int)s->npools - 1 : i;
+
+    ABT_mutex_lock(s->mutex);
+    s->pools[i].gets++;
+    maybe_shrink(s, ABT_get_wtime());
+    for (; i <= last && *bulk == HG_BULK_NULL; i++) {
+        pool = &s->pools[i];
+        if (pool->num_free)
+            pop_free(pool, bulk);
+        else if (pool->num_allocated < s->max_buffers)
+            pool_grow(s, pool, bulk);
+    }
+    ABT_mutex_unlock(s->mutex);
+    return 0;
+}
+
+static int shared_release(struct shared_poolset* s, hg_bulk_t bulk)
+{
+    pool_t* pool;
+    int     i = pool_index(s, HG_Bulk_get_size(bulk));
+
+    if (i < 0 || s->pools[i].buffer_size != HG_Bulk_get_size(bulk))
+        return -1;
+    pool = &s->pools[i];
+
+    ABT_mutex_lock(s->mutex);
+    pool->free[pool->num_free++] = bulk;
+    if (pool->waiting) ABT_cond_signal(pool->cond);
+    maybe_shrink(s, ABT_get_wtime());
+    ABT_mutex_unlock(s->mutex);
+    return 0;
+}
+
+static void shared_destroy(struct shared_poolset* s)
+{
+    unsigned i;
+    slab_t*  slab;
+
+    for (i = 0; s->pools && i < s->npools; i++) {
+        while ((slab = s->pools[i].slabs)) {
+            s->pools[i].slabs = slab->next;
+            slab_destroy(slab);
+        }
+        free(s->pools[i].free);
+        if (s->pools[i].cond != ABT_COND_NULL)
+            ABT_cond_free(&s->pools[i].cond);
+    }
+    free(s->pools);
+    ABT_mutex_free(&s->mutex);
+    free(s);
+}
+
+static struct shared_poolset* shared_create(margo_instance_id mid,
+                                            hg_size_t         npools,
+                                            hg_size_t         max_buffers,
+                                            hg_size_t         first_size,
+                                            hg_size_t         size_multiple,
+                                            int               numa_node,
+                                            int               huge_pages)
+{
+    struct shared_poolset* s;
+    hg_size_t              size = first_size;
+    unsigned               i;
+
+    if (npools == 0 || max_buffers == 0 || first_size == 0
+        || (npools > 1 && size_multiple < 2))
+        return NULL;
+
+    s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->mid           = mid;
+    s->refcount      = 1;
+    s->npools        = npools;
+    s->max_buffers   = max_buffers;
+    s->first_size    = first_size;
+    s->size_multiple = size_multiple;
+    s->numa_node     = numa_node;
+    s->huge_pages    = huge_pages;
+    s->min_buffers   = BAKE_POOLSET_DEFAULT_MIN_BUFFERS;
+    s->idle_ms       = BAKE_POOLSET_DEFAULT_IDLE_MS;
+    s->window_start  = ABT_get_wtime();
+    ABT_mutex_create(&s->mutex);
+    s->pools = calloc(npools, sizeof(*s->pools));
+    if (!s->pools) goto error;
+    for (i = 0; i < npools; i++, size *= size_multiple) {
+        s->pools[i].cond        = ABT_COND_NULL;
+        s->pools[i].buffer_size = size;
+        s->pools[i].stride = (size + BAKE_POOLSET_ALIGNMENT - 1)
+                           / BAKE_POOLSET_ALIGNMENT * BAKE_POOLSET_ALIGNMENT;
+        s->pools[i].buffers_per_slab = 1;
+        if (huge_pages && s->pools[i].stride < BAKE_HUGE_PAGE_SIZE)
+            s->pools[i].buffers_per_slab
+                = BAKE_HUGE_PAGE_SIZE / s->pools[i].stride;
+        s->pools[i].free = calloc(max_buffers, sizeof(*s->pools[i].free));
+        if (!s->pools[i].free) goto error;
+        if (ABT_cond_create(&s->pools[i].cond) != ABT_SUCCESS) goto error;
+    }
+    return s;
+
+error:
+    shared_destroy(s);
+    return NULL;
+}
+
+/* allocates buffers until every pool has at least min_buffers */
+static void shared_fill(struct shared_poolset* s)
+{
+    pool_t*   pool;
+    hg_bulk_t bulk;
+    unsigned  i;
+
+    ABT_mutex_lock(s->mutex);
+    for (i = 0; i < s->npools; i++) {
+        pool = &s->pools[i];
+        while (pool->num_allocated < s->min_buffers
+               && pool->num_allocated < s->max_buffers) {
+            if (pool_grow(s, pool, &bulk) != 0) break;
+            pool->free[pool->num_free++] = bulk;
+            if (pool->waiting) ABT_cond_broadcast(pool->cond);
+        }
+        pool->low_free = pool->num_free;
+    }
+    ABT_mutex_unlock(s->mutex);
+}
+
+bake_poolset_t bake_poolset_attach(margo_instance_id mid,
+                                   hg_size_t         npools,
+                                   hg_size_t         nbufs,
+                                   hg_size_t         first_size,
+                                   hg_size_t         size_multiple,
+                                   int               numa_node,
+                                   int               huge_pages)
+{
+    struct bake_poolset*   p;
+    struct shared_poolset* s;
+
+    p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+
+    pthread_mutex_lock(&g_poolsets_mutex);
+    for (s = g_poolsets; s; s = s->next) {
+        if (s->mid == mid && s->npools == npools && s->max_buffers == nbufs
+            && s->first_size == first_size
+            && s->size_multiple == size_multiple && s->numa_node == numa_node
+            && s->huge_pages == huge_pages) {
+            s->refcount++;
+            break;
+        }
+    }
+    if (!s) {
+        s = shared_create(mid, npools, nbufs, first_size, size_multiple,
+                          numa_node, huge_pages);
+        if (s) {
+            s->next    = g_poolsets;
+            g_poolsets = s;
+        }
+    }
+    pthread_mutex_unlock(&g_poolsets_mutex);
+
+    if (!s) {
+        free(p);
+        return NULL;
+    }
+    p->shared = s;
+    ABT_mutex_create(&p->mutex);
+    ABT_cond_create(&p->cond);
+    return p;
+}
+
+void bake_poolset_detach(bake_poolset_t p)
+{
+    struct shared_poolset** s;
+    struct shared_poolset*  last = NULL;
+
+    if (!p) return;
+
+    pthread_mutex_lock(&g_poolsets_mutex);
+    if (--p->shared->refcount == 0) {
+        for (s = &g_poolsets; *s; s = &(*s)->next) {
+            if (*s == p->shared) {
+                *s = p->shared->next;
+                break;
+            }
+        }
+        last = p->shared;
+    }
+    pthread_mutex_unlock(&g_poolsets_mutex);
+
+    if (last) shared_destroy(last);
+    ABT_cond_free(&p->cond);
+    ABT_mutex_free(&p->mutex);
+    free(p);
+}
+
+void bake_poolset_set_quota(bake_poolset_t p, size_t quota)
+{
+    ABT_mutex_lock(p->mutex);
+    p->quota = quota;
+    ABT_cond_broadcast(p->cond);
+    ABT_mutex_unlock(p->mutex);
+}
+
+int bake_poolset_set_conf(bake_poolset_t p, const char* key, const char* value)
+{
+    struct shared_poolset* s = p->shared;
+    unsigned               u;
+
+    if (sscanf(value, "%u", &u) != 1) return BAKE_ERR_INVALID_ARG;
+    if (strcmp(key, "pipeline_min_buffers_per_pool") == 0) {
+        ABT_mutex_lock(s->mutex);
+        s->min_buffers = u;
+        ABT_mutex_unlock(s->mutex);
+        shared_fill(s);
+    } else if (strcmp(key, "pipeline_idle_ms") == 0) {
+        ABT_mutex_lock(s->mutex);
+        s->idle_ms      = u;
+        s->window_start = ABT_get_wtime();
+        ABT_mutex_unlock(s->mutex);
+    } else
+        return BAKE_ERR_INVALID_ARG;
+    return BAKE_SUCCESS;
+}
+
+void bake_poolset_get_max(bake_poolset_t p, hg_size_t* max_size)
+{
+    *max_size = p->shared->pools[p->shared->npools - 1].buffer_size;
+}
+
+/* whether a buffer of the given size would exceed the quota; called with
+ * the mutex held */
+static int over_quota(bake_poolset_t p, hg_size_t size)
+{
+    return p->quota && p->in_use && p->in_use + size > p->quota;
+}
+
+/* accounts for a buffer obtained from the shared poolset; called with the
+ * mutex held */
+static void account_get(bake_poolset_t p, hg_bulk_t bulk)
+{
+    p->in_use += HG_Bulk_get_size(bulk);
+    p->buffers++;
+    if (p->in_use > p->peak_in_use) p->peak_in_use = p->in_use;
+}
+
+int bake_poolset_get(bake_poolset_t p, hg_size_t size, hg_bulk_t* bulk)
+{
+    uint64_t start = bake_trace_start();
+    int      ret;
+
+    ABT_mutex_lock(p->mutex);
+    p->gets++;
+    if (over_quota(p, size)) {
+        p->gets_waited++;
+        p->waiting++;
+        while (over_quota(p, size)) ABT_cond_wait(p->cond, p->mutex);
+        p->waiting--;
+    }
+    /* reserve the requested size while blocking in the shared poolset */
+    p->in_use += size;
+    ABT_mutex_unlock(p->mutex);
+
+    ret = shared_get(p->shared, size, bulk);
+
+    ABT_mutex_lock(p->mutex);
+    p->in_use -= size;
+    if (ret == 0)
+        account_get(p, *bulk);
+    else if (p->waiting)
+        ABT_cond_broadcast(p->cond);
+    ABT_mutex_unlock(p->mutex);
+    bake_trace_stage(BAKE_TRACE_POOLSET_WAIT, start, size);
+    return ret;
+}
+
+int bake_poolset_tryget(bake_poolset_t p,
+                        hg_size_t      size,
+                        hg_bool_t      any_flag,
+                        hg_bulk_t*     bulk)
+{
+    int ret;
+
+    *bulk = HG_BULK_NULL;
+    ABT_mutex_lock(p->mutex);
+    if (over_quota(p, size)) {
+        p->trygets_refused++;
+        ABT_mutex_unlock(p->mutex);
+        return 0;
+    }
+    /* reserve the requested size while the shared poolset may grow */
+    p->in_use += size;
+    ABT_mutex_unlock(p->mutex);
+
+    ret = shared_tryget(p->shared, size, any_flag, bulk);
+
+    ABT_mutex_lock(p->mutex);
+    p->in_use -= size;
+    if (ret == 0 && *bulk != HG_BULK_NULL)
+        account_get(p, *bulk);
+    else if (p->waiting)
+        ABT_cond_broadcast(p->cond);
+    ABT_mutex_unlock(p->mutex);
+    return ret;
+}
+
+int bake_poolset_release(bake_poolset_t p, hg_bulk_t bulk)
+{
+    hg_size_t size = HG_Bulk_get_size(bulk);
+    int       ret;
+
+    /* a buffer the shared poolset does not take back was never accounted
+     * for */
+    ret = shared_release(p->shared, bulk);
+    if (ret != 0) return ret;
+
+    ABT_mutex_lock(p->mutex);
+    p->in_use -= size;
+    p->buffers--;
+    if (p->waiting) ABT_cond_broadcast(p->cond);
+    ABT_mutex_unlock(p->mutex);
+    return ret;
+}
+
+void bake_poolset_print_stats(bake_poolset_t p,
+                              const char*    prefix,
+                              FILE*          out)
+{
+    struct shared_poolset* s = p->shared;
+    pool_t*                pool;
+    unsigned               i;
+
+    pthread_mutex_lock(&g_poolsets_mutex);
+    fprintf(out, "%spipeline_providers = %d\n", prefix, s->refcount);
+    pthread_mutex_unlock(&g_poolsets_mutex);
+
+    fprintf(out, "%spipeline_npools = %" PRIu64 "\n", prefix,
+            (uint64_t)s->npools);
+    fprintf(out, "%spipeline_nbuffers_per_pool = %" PRIu64 "\n", prefix,
+            (uint64_t)s->max_buffers);
+    fprintf(out, "%spipeline_first_buffer_size = %" PRIu64 "\n", prefix,
+            (uint64_t)s->first_size);
+    fprintf(out, "%spipeline_multiplier = %" PRIu64 "\n", prefix,
+            (uint64_t)s->size_multiple);
+    fprintf(out, "%spipeline_numa_node = %d\n", prefix, s->numa_node);
+    fprintf(out, "%spipeline_huge_pages = %d\n", prefix, s->huge_pages);
+
+    ABT_mutex_lock(s->mutex);
+    fprintf(out, "%spipeline_min_buffers_per_pool = %u\n", prefix,
+            s->min_buffers);
+    fprintf(out, "%spipeline_idle_ms = %u\n", prefix, s->idle_ms);
+    for (i = 0; i < s->npools; i++) {
+        pool = &s->pools[i];
+        fprintf(out,
+                "%spipeline.pool%u = size %" PRIu64 " allocated %u free %u"
+                " peak %u waiting %u gets %" PRIu64 " waits %" PRIu64
+                " grows %" PRIu64 " shrinks %" PRIu64 " buffers_per_slab %u\n",
+                prefix, i, (uint64_t)pool->buffer_size, pool->num_allocated,
+                pool->num_free, pool->peak_allocated, pool->waiting,
+                pool->gets, pool->waits, pool->grows, pool->shrinks,
+                pool->buffers_per_slab);
+    }
+    fprintf(out, "%spipeline.slabs = hugetlb %u thp %u normal %u\n", prefix,
+            s->slabs_by_pages[BAKE_NUMA_PAGES_HUGE],
+            s->slabs_by_pages[BAKE_NUMA_PAGES_THP],
+            s->slabs_by_pages[BAKE_NUMA_PAGES_NORMAL]);
+    fprintf(out, "%spipeline.wait_time = %f\n", prefix, s->wait_time);
+    fprintf(out, "%spipeline.wait_histogram =", prefix);
+    for (i = 0; i < BAKE_POOLSET_WAIT_BUCKETS; i++)
+        fprintf(out, " <%s:%" PRIu64, g_wait_labels[i], s->wait_histogram[i]);
+    fprintf(out, "\n");
+    ABT_mutex_unlock(s->mutex);
+
+    ABT_mutex_lock(p->mutex);
+    fprintf(out, "%spipeline_quota = %zu\n", prefix, p->quota);
+    fprintf(out, "%spipeline.bytes_in_use = %zu\n", prefix, p->in_use);
+    fprintf(out, "%spipeline.buffers_in_use = %u\n", prefix, p->buffers);
+    fprintf(out, "%spipeline.peak_bytes_in_use = %zu\n", prefix,
+            p->peak_in_use);
+    fprintf(out, "%spipeline.gets = %" PRIu64 "\n", prefix, p->gets);
+    fprintf(out, "%spipeline.gets_waited = %" PRIu64 "\n", prefix,
+            p->gets_waited);
+    fprintf(out, "%spipeline.trygets_refused = %" PRIu64 "\n", prefix,
+            p->trygets_refused);
+    ABT_mutex_unlock(p->mutex);
+}
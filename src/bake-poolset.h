@@ -0,0 +1,99 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_POOLSET_H
+#define __BAKE_POOLSET_H
+
+#include <stdio.h>
+#include <margo.h>
+#include <margo-bulk-pool.h>
+
+/* bake-poolset
+ *
+ * Pipelining buffers shared by all the providers of a margo instance.  The
+ * first provider to enable pipelining creates a poolset for its margo
+ * instance and the following ones with the same geometry attach to it, so
+ * that the amount of registered memory does not grow with the number of
+ * providers.  A poolset is a set of pools of registered buffers, the
+ * buffers of each pool being a multiple larger than those of the previous
+ * one.  Pools start with a minimum number of buffers, grow on demand up to
+ * a maximum, and give back the buffers that stayed unused for a whole idle
+ * period.  Waits for a buffer are counted in a histogram.  Each
+ * attachment has a quota, the number of bytes of buffers that it may hold
+ * at once (0 for unlimited), so that a busy provider cannot starve the
+ * others.  A provider that holds no buffer always gets one, whatever its
+ * quota.  Buffers are carved out of anonymous mappings bound to a NUMA node
+ * when one is given, and backed by 2 MiB huge pages when requested (reserved
+ * ones if the system has any, transparent ones otherwise); a huge page then
+ * holds several small buffers, and is only freed when all of them are.
+ */
+
+#define BAKE_POOLSET_DEFAULT_MIN_BUFFERS 0
+#define BAKE_POOLSET_DEFAULT_IDLE_MS     10000
+#define BAKE_POOLSET_WAIT_BUCKETS        7
+
+typedef struct bake_poolset* bake_poolset_t;
+
+/**
+ * Attaches to the poolset of a margo instance with the given geometry
+ * (number of pools, maximum number of buffers per pool, size of the buffers
+ * of the first pool and size multiple between pools) and placement (NUMA
+ * node or -1, and whether to use huge pages), creating it if it does not
+ * exist yet.  Returns NULL on failure.
+ */
+bake_poolset_t bake_poolset_attach(margo_instance_id mid,
+                                   hg_size_t         npools,
+                                   hg_size_t         nbufs,
+                                   hg_size_t         first_size,
+                                   hg_size_t         size_multiple,
+                                   int               numa_node,
+                                   int               huge_pages);
+
+/**
+ * Detaches from the poolset, destroying it with the last attachment.  All
+ * buffers must have been released.
+ */
+void bake_poolset_detach(bake_poolset_t poolset);
+
+/**
+ * Sets the quota of an attachment, in bytes (0 for unlimited).
+ */
+void bake_poolset_set_quota(bake_poolset_t poolset, size_t quota);
+
+/**
+ * Sets a parameter of the shared poolset.  Recognized keys are
+ * "pipeline_min_buffers_per_pool" (buffers each pool keeps, allocated right
+ * away) and "pipeline_idle_ms" (period after which unused buffers are
+ * freed, 0 to never free them).  Settings apply to every provider sharing
+ * the poolset.
+ */
+int bake_poolset_set_conf(bake_poolset_t poolset,
+                          const char*    key,
+                          const char*    value);
+
+/* the following behave as the margo_bulk_poolset calls of the same name,
+ * and also wait for (or, for tryget, fail on) the attachment's quota */
+
+void bake_poolset_get_max(bake_poolset_t poolset, hg_size_t* max_size);
+
+int bake_poolset_get(bake_poolset_t poolset, hg_size_t size, hg_bulk_t* bulk);
+
+int bake_poolset_tryget(bake_poolset_t poolset,
+                        hg_size_t      size,
+                        hg_bool_t      any_flag,
+                        hg_bulk_t*     bulk);
+
+int bake_poolset_release(bake_poolset_t poolset, hg_bulk_t bulk);
+
+/**
+ * Prints the settings, pool occupancy and wait histogram of the shared
+ * poolset and the usage of the attachment, one "key = value" pair per line, each key prefixed by the
+ * given prefix.
+ */
+void bake_poolset_print_stats(bake_poolset_t poolset,
+                              const char*    prefix,
+                              FILE*          out);
+
+#endif
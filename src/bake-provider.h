@@ -10,6 +10,7 @@
 
 #include <libpmemobj.h>
 #include <unistd.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <margo.h>
 #include <margo-bulk-pool.h>
@@ -19,6 +20,9 @@
 #endif
 #include "bake-server.h"
 #include "bake-backend.h"
+#include "bake-poolset.h"
+#include "bake-metrics.h"
+#include "bake-trace.h"
 #include "uthash.h"
 
 #ifdef USE_SYMBIOMON
@@ -34,15 +38,42 @@ typedef struct {
     UT_hash_handle    hh;
 } bake_target_t;
 
+#define BAKE_PIPELINE_CONF_UNSET UINT_MAX
+
+/* flow control credits sized from the pipelining buffers */
+#define BAKE_FLOW_CREDITS_AUTO UINT64_MAX
+/* how long credits granted to a provider handle are valid, in ms; handles
+ * that did not renew them for two leases no longer get a share */
+#define BAKE_FLOW_CREDIT_LEASE_MS 1000
+
 struct bake_provider_conf {
     unsigned pipeline_enable; /* pipeline yes or no; implies intermediate
                                  buffering */
-    unsigned pipeline_npools; /* number of preallocated buffer pools */
-    unsigned pipeline_nbuffers_per_pool; /* buffers per buffer pool */
+    unsigned pipeline_npools; /* number of buffer pools */
+    unsigned pipeline_nbuffers_per_pool; /* max buffers per buffer pool */
     unsigned pipeline_first_buffer_size; /* size of buffers in smallest pool */
     unsigned pipeline_multiplier;        /* factor size increase per pool */
+    size_t   pipeline_quota; /* bytes of shared buffers this provider may
+                                hold at once, 0 for unlimited */
+    int      pipeline_numa_node;  /* node the buffers are bound to, or -1 */
+    unsigned pipeline_huge_pages; /* back the buffers with huge pages */
+    /* settings of the shared buffer pools, applied when attaching to them
+     * unless left to BAKE_PIPELINE_CONF_UNSET */
+    unsigned pipeline_min_buffers_per_pool;
+    unsigned pipeline_idle_ms;
+    /* flow control credits shared among the provider handles of clients,
+     * 0 for unlimited or BAKE_FLOW_CREDITS_AUTO */
+    uint64_t flow_credit_ops;
+    uint64_t flow_credit_bytes;
 };
 
+/* a provider handle that was granted flow control credits */
+typedef struct bake_flow_grantee {
+    uint64_t       id; /* key */
+    double         expires;
+    UT_hash_handle hh;
+} bake_flow_grantee_t;
+
 typedef struct bake_provider {
     margo_instance_id mid;
     ABT_pool   handler_pool; // pool used to run RPC handlers for this provider
@@ -61,7 +92,13 @@ typedef struct bake_provider {
 #endif
 
     struct bake_provider_conf config;  /* configuration for transfers */
-    margo_bulk_poolset_t      poolset; /* intermediate buffers, if used */
+    bake_poolset_t            poolset; /* intermediate buffers, if used */
+    struct bake_tiering*      tiering; /* automatic tiering, if configured */
+    struct bake_qos*          qos;     /* request scheduler, if configured */
+    bake_metrics_t            metrics; /* counters of RPCs and backend calls */
+    bake_tracer_t             tracer;  /* spans of sampled requests */
+    ABT_mutex                 flow_mutex;    /* protects flow_grantees */
+    bake_flow_grantee_t*      flow_grantees; /* holders of live credits */
 
     // list of RPC ids
     hg_id_t rpc_create_id;
@@ -79,6 +116,8 @@ typedef struct bake_provider {
     hg_id_t rpc_remove_id;
     hg_id_t rpc_migrate_region_id;
     hg_id_t rpc_migrate_target_id;
+    hg_id_t rpc_get_stats_id;
+    hg_id_t rpc_get_credits_id;
 
 #ifdef USE_SYMBIOMON
     symbiomon_provider_t metric_provider;
@@ -96,4 +135,23 @@ typedef struct bake_provider {
 
 } bake_provider;
 
+/* margo_bulk_transfer, traced as an RDMA stage of the request served by the
+ * calling ULT */
+static inline hg_return_t bake_bulk_transfer(margo_instance_id mid,
+                                             hg_bulk_op_t      op,
+                                             hg_addr_t         origin_addr,
+                                             hg_bulk_t         origin_handle,
+                                             size_t            origin_offset,
+                                             hg_bulk_t         local_handle,
+                                             size_t            local_offset,
+                                             size_t            size)
+{
+    uint64_t    start = bake_trace_start();
+    hg_return_t hret  = margo_bulk_transfer(mid, op, origin_addr, origin_handle,
+                                           origin_offset, local_handle,
+                                           local_offset, size);
+    bake_trace_stage(BAKE_TRACE_RDMA, start, size);
+    return hret;
+}
+
 #endif
@@ -0,0 +1,264 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <abt.h>
+#include "bake-qos.h"
+
+#define QOS_POLICY_PRIORITY 0
+#define QOS_POLICY_WEIGHTED 1
+
+/* stride scheduling: a class advances by QOS_STRIDE / weight each time one
+ * of its requests starts */
+#define QOS_STRIDE (1 << 20)
+
+/* upper bounds of the latency histogram buckets, in seconds; the last
+ * bucket counts longer requests */
+static const double g_latency_bounds[BAKE_QOS_LATENCY_BUCKETS - 1]
+    = {1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1.0};
+static const char* g_latency_labels[BAKE_QOS_LATENCY_BUCKETS]
+    = {"10us", "100us", "1ms", "10ms", "100ms", "1s", "inf"};
+
+static const char* g_class_names[BAKE_QOS_NUM_CLASSES]
+    = {"metadata", "small", "bulk", "background"};
+
+typedef struct {
+    unsigned limit; /* 0 for unlimited */
+    unsigned weight;
+    unsigned running;
+    unsigned waiting;
+    unsigned grants; /* slots handed to waiting requests not yet awake */
+    uint64_t pass;
+    ABT_cond cond;
+
+    uint64_t requests;
+    uint64_t queued;
+    double   wait_time;
+    double   latency;
+    double   max_latency;
+    uint64_t histogram[BAKE_QOS_LATENCY_BUCKETS];
+} qos_class_t;
+
+struct bake_qos {
+    ABT_mutex   mutex;
+    int         enabled;
+    int         policy;
+    unsigned    max_concurrency; /* 0 for unlimited */
+    unsigned    running;
+    uint64_t    small_threshold;
+    uint64_t    vtime; /* pass of the last class served */
+    qos_class_t classes[BAKE_QOS_NUM_CLASSES];
+};
+
+int bake_qos_create(bake_qos_t* qos)
+{
+    struct bake_qos* q;
+    unsigned         i;
+
+    q = calloc(1, sizeof(*q));
+    if (!q) return BAKE_ERR_ALLOCATION;
+    q->policy          = QOS_POLICY_PRIORITY;
+    q->small_threshold = BAKE_QOS_DEFAULT_SMALL_THRESHOLD;
+    ABT_mutex_create(&q->mutex);
+    for (i = 0; i < BAKE_QOS_NUM_CLASSES; i++) {
+        /* metadata 8, small 4, bulk 2, background 1 */
+        q->classes[i].weight = 8 >> i;
+        ABT_cond_create(&q->classes[i].cond);
+    }
+    *qos = q;
+    return BAKE_SUCCESS;
+}
+
+void bake_qos_destroy(bake_qos_t q)
+{
+    unsigned i;
+
+    if (!q) return;
+    for (i = 0; i < BAKE_QOS_NUM_CLASSES; i++)
+        ABT_cond_free(&q->classes[i].cond);
+    ABT_mutex_free(&q->mutex);
+    free(q);
+}
+
+static int can_start(struct bake_qos* q, qos_class_t* c)
+{
+    if (!q->enabled) return 1;
+    return (!q->max_concurrency || q->running < q->max_concurrency)
+        && (!c->limit || c->running < c->limit);
+}
+
+static void start(struct bake_qos* q, qos_class_t* c)
+{
+    q->running++;
+    c->running++;
+    q->vtime = c->pass;
+    c->pass += QOS_STRIDE / c->weight;
+}
+
+/* hands free slots to waiting requests; called with the mutex held */
+static void dispatch(struct bake_qos* q)
+{
+    qos_class_t* c;
+    qos_class_t* best;
+    unsigned     i;
+
+    for (;;) {
+        best = NULL;
+        for (i = 0; i < BAKE_QOS_NUM_CLASSES; i++) {
+            c = &q->classes[i];
+            if (c->waiting <= c->grants || !can_start(q, c)) continue;
+            if (!best
+                || (q->policy == QOS_POLICY_WEIGHTED && c->pass < best->pass))
+                best = c;
+            if (q->policy == QOS_POLICY_PRIORITY) break;
+        }
+        if (!best) break;
+        best->grants++;
+        start(q, best);
+        ABT_cond_signal(best->cond);
+    }
+}
+
+int bake_qos_data_class(bake_qos_t q, uint8_t tag, uint64_t size)
+{
+    if (tag >= BAKE_QOS_CLASS_METADATA && tag <= BAKE_QOS_CLASS_BACKGROUND)
+        return tag;
+    return size <= q->small_threshold ? BAKE_QOS_CLASS_SMALL
+                                      : BAKE_QOS_CLASS_BULK;
+}
+
+void bake_qos_enter(bake_qos_t q, int cls, bake_qos_slot_t* slot)
+{
+    qos_class_t* c = &q->classes[cls - 1];
+
+    ABT_mutex_lock(q->mutex);
+    slot->cls   = cls;
+    slot->start = ABT_get_wtime();
+    c->requests++;
+    if (c->waiting == 0 && can_start(q, c)) {
+        start(q, c);
+    } else {
+        /* a class that was idle does not get credit for its idle time */
+        if (c->waiting == 0 && c->pass < q->vtime) c->pass = q->vtime;
+        c->waiting++;
+        c->queued++;
+        while (c->grants == 0) ABT_cond_wait(c->cond, q->mutex);
+        c->grants--;
+        c->waiting--;
+        c->wait_time += ABT_get_wtime() - slot->start;
+    }
+    ABT_mutex_unlock(q->mutex);
+}
+
+void bake_qos_exit(bake_qos_t q, bake_qos_slot_t* slot)
+{
+    qos_class_t* c = &q->classes[slot->cls - 1];
+    double       t = ABT_get_wtime() - slot->start;
+    unsigned     b;
+
+    for (b = 0; b < BAKE_QOS_LATENCY_BUCKETS - 1; b++)
+        if (t < g_latency_bounds[b]) break;
+
+    ABT_mutex_lock(q->mutex);
+    c->running--;
+    q->running--;
+    c->latency += t;
+    if (t > c->max_latency) c->max_latency = t;
+    c->histogram[b]++;
+    dispatch(q);
+    ABT_mutex_unlock(q->mutex);
+    slot->cls = -1;
+}
+
+/* finds the class of a "qos_<class>_<param>" key */
+static int parse_class_key(const char* key, const char** param)
+{
+    size_t   len;
+    unsigned i;
+
+    for (i = 0; i < BAKE_QOS_NUM_CLASSES; i++) {
+        len = strlen(g_class_names[i]);
+        if (strncmp(key + 4, g_class_names[i], len) == 0
+            && key[4 + len] == '_') {
+            *param = key + 5 + len;
+            return i;
+        }
+    }
+    return -1;
+}
+
+int bake_qos_set_conf(bake_qos_t q, const char* key, const char* value)
+{
+    const char* param;
+    uint64_t    u;
+    int         i, ret = BAKE_SUCCESS;
+
+    ABT_mutex_lock(q->mutex);
+    if (strcmp(key, "qos_policy") == 0) {
+        if (strcmp(value, "priority") == 0)
+            q->policy = QOS_POLICY_PRIORITY;
+        else if (strcmp(value, "weighted") == 0)
+            q->policy = QOS_POLICY_WEIGHTED;
+        else
+            ret = BAKE_ERR_INVALID_ARG;
+    } else if (sscanf(value, "%" SCNu64, &u) != 1) {
+        ret = BAKE_ERR_INVALID_ARG;
+    } else if (strcmp(key, "qos_enabled") == 0) {
+        q->enabled = !!u;
+    } else if (strcmp(key, "qos_max_concurrency") == 0) {
+        q->max_concurrency = u;
+    } else if (strcmp(key, "qos_small_threshold") == 0) {
+        q->small_threshold = u;
+    } else if (strncmp(key, "qos_", 4) == 0
+               && (i = parse_class_key(key, &param)) >= 0) {
+        if (strcmp(param, "limit") == 0)
+            q->classes[i].limit = u;
+        else if (strcmp(param, "weight") == 0 && u > 0)
+            q->classes[i].weight = u;
+        else
+            ret = BAKE_ERR_INVALID_ARG;
+    } else
+        ret = BAKE_ERR_INVALID_ARG;
+    /* limits may have been raised, or the scheduler disabled */
+    if (ret == BAKE_SUCCESS) dispatch(q);
+    ABT_mutex_unlock(q->mutex);
+    return ret;
+}
+
+void bake_qos_print_stats(bake_qos_t q, FILE* out)
+{
+    qos_class_t* c;
+    unsigned     i, b;
+
+    ABT_mutex_lock(q->mutex);
+    fprintf(out, "qos_enabled = %d\n", q->enabled);
+    fprintf(out, "qos_policy = %s\n",
+            q->policy == QOS_POLICY_WEIGHTED ? "weighted" : "priority");
+    fprintf(out, "qos_max_concurrency = %u\n", q->max_concurrency);
+    fprintf(out, "qos_small_threshold = %" PRIu64 "\n", q->small_threshold);
+    fprintf(out, "qos.running = %u\n", q->running);
+    for (i = 0; i < BAKE_QOS_NUM_CLASSES; i++) {
+        c = &q->classes[i];
+        fprintf(out, "qos_%s_limit = %u\n", g_class_names[i], c->limit);
+        fprintf(out, "qos_%s_weight = %u\n", g_class_names[i], c->weight);
+        fprintf(out,
+                "qos.%s = requests %" PRIu64 " queued %" PRIu64
+                " running %u waiting %u wait_time %f latency %f"
+                " max_latency %f\n",
+                g_class_names[i], c->requests, c->queued, c->running,
+                c->waiting, c->wait_time, c->latency, c->max_latency);
+        fprintf(out, "qos.%s.latency_histogram =", g_class_names[i]);
+        for (b = 0; b < BAKE_QOS_LATENCY_BUCKETS; b++)
+            fprintf(out, " <%s:%" PRIu64, g_latency_labels[b],
+                    c->histogram[b]);
+        fprintf(out, "\n");
+    }
+    ABT_mutex_unlock(q->mutex);
+}
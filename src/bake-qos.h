@@ -0,0 +1,85 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_QOS_H
+#define __BAKE_QOS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "bake.h"
+
+/* bake-qos
+ *
+ * Admission scheduler of a provider.  Every request is put in a class
+ * (metadata, small, bulk or background) according to its RPC type and size,
+ * unless the client tagged it with a class.  A request starts right away if
+ * its class and the provider are below their concurrency limits; otherwise
+ * its ULT waits, before taking the provider lock, until a running request
+ * completes and the scheduler hands the freed slot to the class with the
+ * highest priority (strict priority policy) or with the least service
+ * relative to its weight (weighted fair policy, stride scheduling).
+ * Latency and queueing time are accounted per class.
+ */
+
+#define BAKE_QOS_NUM_CLASSES 4 /* BAKE_QOS_CLASS_METADATA to _BACKGROUND */
+
+#define BAKE_QOS_DEFAULT_SMALL_THRESHOLD (64 * 1024)
+#define BAKE_QOS_LATENCY_BUCKETS         7
+
+typedef struct bake_qos* bake_qos_t;
+
+/* admission of one request, kept by its handler between enter and exit */
+typedef struct {
+    int    cls; /* -1 if the request was not admitted through the scheduler */
+    double start;
+} bake_qos_slot_t;
+
+#define BAKE_QOS_SLOT_INITIALIZER \
+    {                             \
+        -1, 0.0                   \
+    }
+
+int bake_qos_create(bake_qos_t* qos);
+
+/**
+ * Frees the scheduler; no request may be in it.
+ */
+void bake_qos_destroy(bake_qos_t qos);
+
+/**
+ * Sets a configuration parameter.  Recognized keys are "qos_enabled" (0 or
+ * 1), "qos_policy" ("priority" or "weighted"), "qos_max_concurrency"
+ * (requests running at once in the provider, 0 for unlimited),
+ * "qos_small_threshold" (size in bytes up to which writes and reads are
+ * small), and "qos_<class>_limit" (requests of the class running at once, 0
+ * for unlimited) and "qos_<class>_weight" for the classes "metadata",
+ * "small", "bulk" and "background".
+ */
+int bake_qos_set_conf(bake_qos_t qos, const char* key, const char* value);
+
+/**
+ * Returns the class of a write or read of the given size, or the class the
+ * client tagged it with (one of BAKE_QOS_CLASS_*, BAKE_QOS_CLASS_DEFAULT
+ * for none).
+ */
+int bake_qos_data_class(bake_qos_t qos, uint8_t tag, uint64_t size);
+
+/**
+ * Waits until a request of the given class may run.
+ */
+void bake_qos_enter(bake_qos_t qos, int cls, bake_qos_slot_t* slot);
+
+/**
+ * Accounts for the completion of a request admitted by bake_qos_enter and
+ * hands its slot to a waiting request.
+ */
+void bake_qos_exit(bake_qos_t qos, bake_qos_slot_t* slot);
+
+/**
+ * Prints settings and per-class counters, one "key = value" pair per line.
+ */
+void bake_qos_print_stats(bake_qos_t qos, FILE* out);
+
+#endif
@@ -21,7 +21,8 @@ static inline hg_return_t hg_proc_bake_probe_out_t(hg_proc_t proc, void* out);
 
 /* BAKE create */
 MERCURY_GEN_PROC(bake_create_in_t,
-                 ((bake_target_id_t)(bti))((uint64_t)(region_size)))
+                 ((bake_target_id_t)(bti))((uint64_t)(region_size))(
+                     (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_create_out_t, ((int32_t)(ret))((bake_region_id_t)(rid)))
 
 /* BAKE write */
@@ -29,7 +30,8 @@ MERCURY_GEN_PROC(bake_write_in_t,
                  ((bake_target_id_t)(bti))((bake_region_id_t)(rid))(
                      (uint64_t)(region_offset))((hg_bulk_t)(bulk_handle))(
                      (uint64_t)(bulk_offset))((uint64_t)(bulk_size))(
-                     (hg_string_t)(remote_addr_str)))
+                     (hg_string_t)(remote_addr_str))((uint8_t)(qos_class))(
+                     (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_write_out_t, ((int32_t)(ret)))
 
 /* BAKE eager write */
@@ -39,6 +41,8 @@ typedef struct {
     uint64_t         region_offset;
     uint64_t         size;
     char*            buffer;
+    uint8_t          qos_class;
+    uint64_t         req_id;
 } bake_eager_write_in_t;
 static inline hg_return_t hg_proc_bake_eager_write_in_t(hg_proc_t proc,
                                                         void*     v_out_p);
@@ -47,14 +51,15 @@ MERCURY_GEN_PROC(bake_eager_write_out_t, ((int32_t)(ret)))
 /* BAKE persist */
 MERCURY_GEN_PROC(bake_persist_in_t,
                  ((bake_target_id_t)(bti))((bake_region_id_t)(rid))(
-                     (uint64_t)(offset))((uint64_t)(size)))
+                     (uint64_t)(offset))((uint64_t)(size))((uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_persist_out_t, ((int32_t)(ret)))
 
 /* BAKE create/write/persist */
 MERCURY_GEN_PROC(bake_create_write_persist_in_t,
                  ((bake_target_id_t)(bti))((uint64_t)(region_size))(
                      (hg_bulk_t)(bulk_handle))((uint64_t)(bulk_offset))(
-                     (uint64_t)(bulk_size))((hg_string_t)(remote_addr_str)))
+                     (uint64_t)(bulk_size))((hg_string_t)(remote_addr_str))(
+                     (uint8_t)(qos_class))((uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_create_write_persist_out_t,
                  ((int32_t)(ret))((bake_region_id_t)(rid)))
 
@@ -63,6 +68,8 @@ typedef struct {
     bake_target_id_t bti;
     uint64_t         size;
     char*            buffer;
+    uint8_t          qos_class;
+    uint64_t         req_id;
 } bake_eager_create_write_persist_in_t;
 static inline hg_return_t
 hg_proc_bake_eager_create_write_persist_in_t(hg_proc_t proc, void* v_out_p);
@@ -71,12 +78,14 @@ MERCURY_GEN_PROC(bake_eager_create_write_persist_out_t,
 
 /* BAKE get size */
 MERCURY_GEN_PROC(bake_get_size_in_t,
-                 ((bake_target_id_t)(bti))((bake_region_id_t)(rid)))
+                 ((bake_target_id_t)(bti))((bake_region_id_t)(rid))(
+                     (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_get_size_out_t, ((int32_t)(ret))((uint64_t)(size)))
 
 /* BAKE get data */
 MERCURY_GEN_PROC(bake_get_data_in_t,
-                 ((bake_target_id_t)(bti))((bake_region_id_t)(rid)))
+                 ((bake_target_id_t)(bti))((bake_region_id_t)(rid))(
+                     (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_get_data_out_t, ((int32_t)(ret))((uint64_t)(ptr)))
 
 /* BAKE read */
@@ -84,13 +93,15 @@ MERCURY_GEN_PROC(bake_read_in_t,
                  ((bake_target_id_t)(bti))((bake_region_id_t)(rid))(
                      (uint64_t)(region_offset))((hg_bulk_t)(bulk_handle))(
                      (uint64_t)(bulk_offset))((uint64_t)(bulk_size))(
-                     (hg_string_t)(remote_addr_str)))
+                     (hg_string_t)(remote_addr_str))((uint8_t)(qos_class))(
+                     (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_read_out_t, ((hg_size_t)(size))((int32_t)(ret)))
 
 /* BAKE eager read */
 MERCURY_GEN_PROC(bake_eager_read_in_t,
                  ((bake_target_id_t)(bti))((bake_region_id_t)(rid))(
-                     (uint64_t)(region_offset))((uint64_t)(size)))
+                     (uint64_t)(region_offset))((uint64_t)(size))(
+                     (uint8_t)(qos_class))((uint64_t)(req_id)))
 typedef struct {
     int32_t  ret;
     uint64_t size;
@@ -107,9 +118,21 @@ typedef struct {
     bake_target_id_t* targets;
 } bake_probe_out_t;
 
+/* BAKE get credits: grantee identifies the provider handle asking, so that
+ * the provider can split its credits among the handles using them; credits
+ * are 0 for unlimited, and expire after lease_ms */
+MERCURY_GEN_PROC(bake_get_credits_in_t, ((uint64_t)(grantee)))
+MERCURY_GEN_PROC(bake_get_credits_out_t,
+                 ((int32_t)(ret))((uint64_t)(credit_ops))(
+                     (uint64_t)(credit_bytes))((uint64_t)(lease_ms)))
+
+/* BAKE get stats */
+MERCURY_GEN_PROC(bake_get_stats_out_t, ((int32_t)(ret))((hg_string_t)(stats)))
+
 /* BAKE remove */
 MERCURY_GEN_PROC(bake_remove_in_t,
-                 ((bake_target_id_t)(bti))((bake_region_id_t)(rid)))
+                 ((bake_target_id_t)(bti))((bake_region_id_t)(rid))(
+                     (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_remove_out_t, ((int32_t)(ret)))
 
 /* BAKE migrate region */
@@ -117,7 +140,8 @@ MERCURY_GEN_PROC(
     bake_migrate_region_in_t,
     ((bake_target_id_t)(bti))((bake_region_id_t)(source_rid))((uint64_t)(
         region_size))((int32_t)(remove_src))((hg_const_string_t)(dest_addr))(
-        (uint16_t)(dest_provider_id))((bake_target_id_t)(dest_target_id)))
+        (uint16_t)(dest_provider_id))((bake_target_id_t)(dest_target_id))(
+        (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_migrate_region_out_t,
                  ((int32_t)(ret))((bake_region_id_t)(dest_rid)))
 
@@ -125,7 +149,8 @@ MERCURY_GEN_PROC(bake_migrate_region_out_t,
 MERCURY_GEN_PROC(bake_migrate_target_in_t,
                  ((bake_target_id_t)(bti))((int32_t)(remove_src))(
                      (hg_const_string_t)(dest_remi_addr))((uint16_t)(
-                     dest_remi_provider_id))((hg_const_string_t)(dest_root)))
+                     dest_remi_provider_id))((hg_const_string_t)(dest_root))(
+                     (uint64_t)(req_id)))
 MERCURY_GEN_PROC(bake_migrate_target_out_t, ((int32_t)(ret)))
 
 static inline hg_return_t hg_proc_bake_region_id_t(hg_proc_t         proc,
@@ -169,6 +194,8 @@ static inline hg_return_t hg_proc_bake_eager_write_in_t(hg_proc_t proc,
         if (hg_proc_get_op(proc) == HG_DECODE) in->buffer = buf;
         hg_proc_restore_ptr(proc, buf, in->size);
     }
+    hg_proc_uint8_t(proc, &in->qos_class);
+    hg_proc_uint64_t(proc, &in->req_id);
 
     return (HG_SUCCESS);
 }
@@ -189,6 +216,8 @@ hg_proc_bake_eager_create_write_persist_in_t(hg_proc_t proc, void* v_out_p)
         if (hg_proc_get_op(proc) == HG_DECODE) in->buffer = buf;
         hg_proc_restore_ptr(proc, buf, in->size);
     }
+    hg_proc_uint8_t(proc, &in->qos_class);
+    hg_proc_uint64_t(proc, &in->req_id);
 
     return (HG_SUCCESS);
 }
@@ -25,6 +25,21 @@ struct options {
     char*        host_file;
     int          pipeline_enabled;
     mplex_mode_t mplex_mode;
+    unsigned     num_target_confs;
+    char**       target_confs;         /* "key=value" strings */
+    int*         target_confs_applied; /* accepted by at least one target */
+    unsigned     num_provider_confs;
+    char**       provider_confs; /* "key=value" strings */
+    int          elastic;
+    unsigned     elastic_min_xstreams;
+    unsigned     elastic_max_xstreams;
+    char*        trace_prefix;
+};
+
+/* a provider whose trace is written out at shutdown */
+struct trace_dump {
+    bake_provider_t provider;
+    char            filename[256];
 };
 
 static void usage(int argc, char** argv)
@@ -35,13 +50,28 @@ static void usage(int argc, char** argv)
     fprintf(stderr, "       listen_addr is the Mercury address to listen on\n");
     fprintf(stderr, "       bake_pool is the path to the BAKE pool\n");
     fprintf(stderr,
-            "           (prepend pmem: or file: to specify backend format)\n");
+            "           (prepend pmem:, file:, mmap: or mem: to specify "
+            "backend format,\n"
+            "           and tier: to put a DRAM tier in front of the "
+            "target)\n");
     fprintf(stderr,
             "       [-f filename] to write the server address to a file\n");
     fprintf(stderr,
             "       [-m mode] multiplexing mode (providers or targets) for "
             "managing multiple pools (default is targets)\n");
     fprintf(stderr, "       [-p] enable pipelining\n");
+    fprintf(stderr,
+            "       [-c key=value] set a configuration parameter on every "
+            "target (may be repeated)\n");
+    fprintf(stderr,
+            "       [-C key=value] set a configuration parameter on every "
+            "provider (may be repeated)\n");
+    fprintf(stderr,
+            "       [-e min:max] run RPC handlers on between min and max "
+            "execution streams, scaled with the load\n");
+    fprintf(stderr,
+            "       [-t prefix] write the traces of the sampled requests of "
+            "each provider to <prefix>.<mplex id>.json at shutdown\n");
     fprintf(stderr,
             "Example: ./bake-server-daemon tcp://localhost:1234 "
             "/dev/shm/foo.dat /dev/shm/bar.dat\n");
@@ -55,7 +85,7 @@ static void parse_args(int argc, char** argv, struct options* opts)
     memset(opts, 0, sizeof(*opts));
 
     /* get options */
-    while ((opt = getopt(argc, argv, "f:m:p")) != -1) {
+    while ((opt = getopt(argc, argv, "f:m:pc:C:e:t:")) != -1) {
         switch (opt) {
         case 'f':
             opts->host_file = optarg;
@@ -74,6 +104,44 @@ static void parse_args(int argc, char** argv, struct options* opts)
         case 'p':
             opts->pipeline_enabled = 1;
             break;
+        case 'c':
+            if (!strchr(optarg, '=')) {
+                fprintf(stderr, "Expected key=value, got \"%s\"\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            opts->target_confs
+                = realloc(opts->target_confs,
+                          (opts->num_target_confs + 1) * sizeof(char*));
+            opts->target_confs_applied
+                = realloc(opts->target_confs_applied,
+                          (opts->num_target_confs + 1) * sizeof(int));
+            opts->target_confs_applied[opts->num_target_confs] = 0;
+            opts->target_confs[opts->num_target_confs++]       = optarg;
+            break;
+        case 'C':
+            if (!strchr(optarg, '=')) {
+                fprintf(stderr, "Expected key=value, got \"%s\"\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            opts->provider_confs
+                = realloc(opts->provider_confs,
+                          (opts->num_provider_confs + 1) * sizeof(char*));
+            opts->provider_confs[opts->num_provider_confs++] = optarg;
+            break;
+        case 'e':
+            if (sscanf(optarg, "%u:%u", &opts->elastic_min_xstreams,
+                       &opts->elastic_max_xstreams)
+                    != 2
+                || opts->elastic_max_xstreams == 0
+                || opts->elastic_min_xstreams > opts->elastic_max_xstreams) {
+                fprintf(stderr, "Expected min:max, got \"%s\"\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            opts->elastic = 1;
+            break;
+        case 't':
+            opts->trace_prefix = optarg;
+            break;
         default:
             usage(argc, argv);
             exit(EXIT_FAILURE);
@@ -96,16 +164,172 @@ static void parse_args(int argc, char** argv, struct options* opts)
     return;
 }
 
+/* applies the -c key=value options to a newly added target; a key the
+ * target's backend does not know is skipped, since the same options go to
+ * targets of every backend */
+static int apply_target_confs(struct options*  opts,
+                              bake_provider_t  provider,
+                              bake_target_id_t tid)
+{
+    unsigned i;
+    int      ret;
+
+    for (i = 0; i < opts->num_target_confs; i++) {
+        char*  conf = opts->target_confs[i];
+        char*  eq   = strchr(conf, '=');
+        char   key[256];
+        size_t len = eq - conf;
+
+        if (len >= sizeof(key)) len = sizeof(key) - 1;
+        memcpy(key, conf, len);
+        key[len] = '\0';
+
+        ret = bake_target_set_conf(provider, tid, key, eq + 1);
+        if (ret == BAKE_ERR_OP_UNSUPPORTED) continue;
+        if (ret != 0) {
+            fprintf(stderr, "Error: could not set \"%s\" on target\n", conf);
+            bake_perror("Error: bake_target_set_conf()", ret);
+            return ret;
+        }
+        opts->target_confs_applied[i] = 1;
+    }
+    return 0;
+}
+
+/* checks that each -c key=value option was accepted by at least one
+ * target, once all of them are added */
+static int check_target_confs(struct options* opts)
+{
+    unsigned i;
+    int      ret = 0;
+
+    for (i = 0; i < opts->num_target_confs; i++) {
+        if (opts->target_confs_applied[i]) continue;
+        fprintf(stderr, "Error: no target accepts \"%s\"\n",
+                opts->target_confs[i]);
+        ret = -1;
+    }
+    return ret;
+}
+
+/* applies the -C key=value options to a newly registered provider, before
+ * pipelining is enabled so that the buffer pools can be shaped */
+static int apply_provider_confs(struct options* opts, bake_provider_t provider)
+{
+    unsigned i;
+    int      ret;
+
+    for (i = 0; i < opts->num_provider_confs; i++) {
+        char*  conf = opts->provider_confs[i];
+        char*  eq   = strchr(conf, '=');
+        char   key[256];
+        size_t len = eq - conf;
+
+        if (len >= sizeof(key)) len = sizeof(key) - 1;
+        memcpy(key, conf, len);
+        key[len] = '\0';
+
+        ret = bake_provider_set_conf(provider, key, eq + 1);
+        if (ret != 0) {
+            fprintf(stderr, "Error: could not set \"%s\" on provider\n",
+                    conf);
+            bake_perror("Error: bake_provider_set_conf()", ret);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/* prints the lines of a statistics string that describe where the buffers
+ * and I/O threads were placed */
+static void print_placement(const char* who, char* stats)
+{
+    static const char* keys[]
+        = {"numa_node", "huge_pages", "slabs", "io_cpus", NULL};
+    char* line;
+    char* save = NULL;
+    int   k;
+
+    for (line = strtok_r(stats, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        char* eq = strchr(line, '=');
+        if (!eq) continue;
+        for (k = 0; keys[k]; k++) {
+            char* found = strstr(line, keys[k]);
+            if (found && found < eq) {
+                printf("%s placement: %s\n", who, line);
+                break;
+            }
+        }
+    }
+}
+
+static void report_provider_placement(int id, bake_provider_t provider)
+{
+    char  who[64];
+    char* stats = NULL;
+
+    if (bake_provider_get_stats(provider, &stats) != 0) return;
+    snprintf(who, sizeof(who), "Provider %d", id);
+    print_placement(who, stats);
+    free(stats);
+}
+
+static void dump_trace_cb(void* arg)
+{
+    struct trace_dump* td = arg;
+    int                ret;
+
+    ret = bake_provider_dump_trace(td->provider, td->filename);
+    if (ret != 0) bake_perror("Error: bake_provider_dump_trace()", ret);
+    free(td);
+}
+
+/* dumps the provider's trace when margo is finalized; pushed after the
+ * provider is registered, the callback runs before the provider goes
+ * away */
+static void push_trace_dump(struct options*   opts,
+                            margo_instance_id mid,
+                            int               mplex_id,
+                            bake_provider_t   provider)
+{
+    struct trace_dump* td;
+
+    if (!opts->trace_prefix) return;
+    td = calloc(1, sizeof(*td));
+    if (!td) return;
+    td->provider = provider;
+    snprintf(td->filename, sizeof(td->filename), "%s.%d.json",
+             opts->trace_prefix, mplex_id);
+    margo_push_finalize_callback(mid, dump_trace_cb, td);
+}
+
+static void report_target_placement(int              id,
+                                    bake_provider_t  provider,
+                                    bake_target_id_t tid)
+{
+    char  who[64];
+    char* stats = NULL;
+
+    if (bake_target_get_stats(provider, tid, &stats) != 0) return;
+    snprintf(who, sizeof(who), "Provider %d target", id);
+    print_placement(who, stats);
+    free(stats);
+}
+
 int main(int argc, char** argv)
 {
-    struct options    opts;
-    margo_instance_id mid;
-    int               ret;
+    struct options      opts;
+    margo_instance_id   mid;
+    bake_elastic_pool_t epool;
+    ABT_pool            handler_pool = BAKE_ABT_POOL_DEFAULT;
+    int                 ret;
 
     parse_args(argc, argv, &opts);
 
     /* start margo */
-    /* use the main xstream for driving progress and executing rpc handlers */
+    /* use the main xstream for driving progress and executing rpc handlers,
+     * unless they get an elastic pool of their own below */
     mid = margo_init(opts.listen_addr_str, MARGO_SERVER_MODE, 0, -1);
     if (mid == MARGO_INSTANCE_NULL) {
         fprintf(stderr, "Error: margo_init()\n");
@@ -150,13 +374,27 @@ int main(int argc, char** argv)
         fclose(fp);
     }
 
+    /* the elastic pool must exist before the providers that use it */
+    if (opts.elastic) {
+        ret = bake_elastic_pool_create(mid, opts.elastic_min_xstreams,
+                                       opts.elastic_max_xstreams, &epool);
+        if (ret != 0) {
+            bake_perror("Error: bake_elastic_pool_create()", ret);
+            margo_finalize(mid);
+            return (-1);
+        }
+        handler_pool = bake_elastic_pool_get_abt_pool(epool);
+        printf("Running RPC handlers on %u to %u execution streams\n",
+               opts.elastic_min_xstreams, opts.elastic_max_xstreams);
+    }
+
     /* initialize the BAKE server */
     if (opts.mplex_mode == MODE_PROVIDERS) {
         int i;
         for (i = 0; i < opts.num_pools; i++) {
             bake_provider_t  provider;
             bake_target_id_t tid;
-            ret = bake_provider_register(mid, i + 1, BAKE_ABT_POOL_DEFAULT,
+            ret = bake_provider_register(mid, i + 1, handler_pool,
                                          &provider);
 
             if (ret != 0) {
@@ -165,6 +403,13 @@ int main(int argc, char** argv)
                 return (-1);
             }
 
+            ret = apply_provider_confs(&opts, provider);
+            if (ret != 0) {
+                margo_finalize(mid);
+                return (-1);
+            }
+            push_trace_dump(&opts, mid, i + 1, provider);
+
             if (opts.pipeline_enabled)
                 bake_provider_set_conf(provider, "pipeline_enabled", "1");
 
@@ -177,15 +422,23 @@ int main(int argc, char** argv)
                 return (-1);
             }
 
+            ret = apply_target_confs(&opts, provider, tid);
+            if (ret != 0) {
+                margo_finalize(mid);
+                return (-1);
+            }
+
             printf("Provider %d managing new target at multiplex id %d\n", i,
                    i + 1);
+            report_provider_placement(i, provider);
+            report_target_placement(i, provider, tid);
         }
 
     } else {
 
         int             i;
         bake_provider_t provider;
-        ret = bake_provider_register(mid, 1, BAKE_ABT_POOL_DEFAULT, &provider);
+        ret = bake_provider_register(mid, 1, handler_pool, &provider);
 
         if (ret != 0) {
             bake_perror("Error: bake_provider_register()", ret);
@@ -193,6 +446,13 @@ int main(int argc, char** argv)
             return (-1);
         }
 
+        ret = apply_provider_confs(&opts, provider);
+        if (ret != 0) {
+            margo_finalize(mid);
+            return (-1);
+        }
+        push_trace_dump(&opts, mid, 1, provider);
+
         if (opts.pipeline_enabled)
             bake_provider_set_conf(provider, "pipeline_enabled", "1");
 
@@ -207,14 +467,31 @@ int main(int argc, char** argv)
                 return (-1);
             }
 
+            ret = apply_target_confs(&opts, provider, tid);
+            if (ret != 0) {
+                margo_finalize(mid);
+                return (-1);
+            }
+
             printf("Provider 0 managing new target at multiplex id %d\n", 1);
+            report_target_placement(0, provider, tid);
         }
+        report_provider_placement(0, provider);
+    }
+
+    ret = check_target_confs(&opts);
+    if (ret != 0) {
+        margo_finalize(mid);
+        return (-1);
     }
 
     /* suspend until the BAKE server gets a shutdown signal from the client */
     margo_wait_for_finalize(mid);
 
     free(opts.bake_pools);
+    free(opts.target_confs);
+    free(opts.target_confs_applied);
+    free(opts.provider_confs);
 
     return (0);
 }
@@ -10,6 +10,7 @@
 #include <libpmemobj.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <margo.h>
 #include <margo-bulk-pool.h>
 #ifdef USE_REMI
@@ -21,6 +22,12 @@
 #include "bake-rpc.h"
 #include "bake-timing.h"
 #include "bake-provider.h"
+#include "bake-tiering.h"
+#include "bake-numa.h"
+#include "bake-qos.h"
+#include "bake-elastic.h"
+#include "bake-metrics.h"
+#include "bake-trace.h"
 
 #ifdef USE_SYMBIOMON
 #include <symbiomon/symbiomon-metric.h>
@@ -32,6 +39,23 @@
 
 extern bake_backend g_bake_pmem_backend;
 extern bake_backend g_bake_file_backend;
+extern bake_backend g_bake_mmap_backend;
+extern bake_backend g_bake_mem_backend;
+extern bake_backend g_bake_tier_backend;
+
+static bake_backend_t g_bake_backends[]
+    = {&g_bake_pmem_backend, &g_bake_file_backend, &g_bake_mmap_backend,
+       &g_bake_mem_backend, &g_bake_tier_backend};
+
+bake_backend_t bake_backend_lookup(const char* type)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(g_bake_backends) / sizeof(g_bake_backends[0]); i++)
+        if (strcmp(g_bake_backends[i]->name, type) == 0)
+            return g_bake_backends[i];
+    return NULL;
+}
 
 DECLARE_MARGO_RPC_HANDLER(bake_shutdown_ult)
 DECLARE_MARGO_RPC_HANDLER(bake_create_ult)
@@ -49,14 +73,23 @@ DECLARE_MARGO_RPC_HANDLER(bake_noop_ult)
 DECLARE_MARGO_RPC_HANDLER(bake_remove_ult)
 DECLARE_MARGO_RPC_HANDLER(bake_migrate_region_ult)
 DECLARE_MARGO_RPC_HANDLER(bake_migrate_target_ult)
+DECLARE_MARGO_RPC_HANDLER(bake_get_stats_ult)
+DECLARE_MARGO_RPC_HANDLER(bake_get_credits_ult)
 
 /* TODO: support different parameters per provider instance */
 struct bake_provider_conf g_default_bake_provider_conf
-    = {.pipeline_enable            = 0,
-       .pipeline_npools            = 4,
-       .pipeline_nbuffers_per_pool = 32,
-       .pipeline_first_buffer_size = 65536,
-       .pipeline_multiplier        = 4};
+    = {.pipeline_enable               = 0,
+       .pipeline_npools               = 4,
+       .pipeline_nbuffers_per_pool    = 32,
+       .pipeline_first_buffer_size    = 65536,
+       .pipeline_multiplier           = 4,
+       .pipeline_quota                = 0,
+       .pipeline_numa_node            = -1,
+       .pipeline_huge_pages           = 0,
+       .pipeline_min_buffers_per_pool = BAKE_PIPELINE_CONF_UNSET,
+       .pipeline_idle_ms              = BAKE_PIPELINE_CONF_UNSET,
+       .flow_credit_ops               = BAKE_FLOW_CREDITS_AUTO,
+       .flow_credit_bytes             = BAKE_FLOW_CREDITS_AUTO};
 
 static bake_target_t* find_target_entry(bake_provider_t  provider,
                                         bake_target_id_t target_id)
@@ -109,9 +142,36 @@ int bake_provider_register(margo_instance_id mid,
 
     tmp_provider->config = g_default_bake_provider_conf;
 
+    tmp_provider->metrics = bake_metrics_create();
+    if (!tmp_provider->metrics) {
+        free(tmp_provider);
+        return BAKE_ERR_ALLOCATION;
+    }
+
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "bake provider %d", provider_id);
+        tmp_provider->tracer = bake_tracer_create(name);
+    }
+    if (!tmp_provider->tracer) {
+        bake_metrics_destroy(tmp_provider->metrics);
+        free(tmp_provider);
+        return BAKE_ERR_ALLOCATION;
+    }
+
     /* Create rwlock */
     ret = ABT_rwlock_create(&(tmp_provider->lock));
     if (ret != ABT_SUCCESS) {
+        bake_tracer_destroy(tmp_provider->tracer);
+        bake_metrics_destroy(tmp_provider->metrics);
+        free(tmp_provider);
+        return BAKE_ERR_ARGOBOTS;
+    }
+    ret = ABT_mutex_create(&(tmp_provider->flow_mutex));
+    if (ret != ABT_SUCCESS) {
+        ABT_rwlock_free(&(tmp_provider->lock));
+        bake_tracer_destroy(tmp_provider->tracer);
+        bake_metrics_destroy(tmp_provider->metrics);
         free(tmp_provider);
         return BAKE_ERR_ARGOBOTS;
     }
@@ -212,6 +272,18 @@ int bake_provider_register(margo_instance_id mid,
     margo_register_data(mid, rpc_id, (void*)tmp_provider, NULL);
     tmp_provider->rpc_migrate_target_id = rpc_id;
 
+    rpc_id = MARGO_REGISTER_PROVIDER(mid, "bake_get_stats_rpc", void,
+                                     bake_get_stats_out_t, bake_get_stats_ult,
+                                     provider_id, abt_pool);
+    margo_register_data(mid, rpc_id, (void*)tmp_provider, NULL);
+    tmp_provider->rpc_get_stats_id = rpc_id;
+
+    rpc_id = MARGO_REGISTER_PROVIDER(
+        mid, "bake_get_credits_rpc", bake_get_credits_in_t,
+        bake_get_credits_out_t, bake_get_credits_ult, provider_id, abt_pool);
+    margo_register_data(mid, rpc_id, (void*)tmp_provider, NULL);
+    tmp_provider->rpc_get_credits_id = rpc_id;
+
     /* get a client-side version of the bake_create_write_persist RPC */
     hg_bool_t flag;
     margo_registered_name(mid, "bake_create_write_persist_rpc", &rpc_id, &flag);
@@ -362,13 +434,11 @@ int bake_provider_add_storage_target(bake_provider_t   provider,
 
     bake_target_t* new_entry = calloc(1, sizeof(*new_entry));
 
-    if (strcmp(backend_type, "pmem") == 0) {
-        new_entry->backend = &g_bake_pmem_backend;
-    } else if (strcmp(backend_type, "file") == 0) {
-        new_entry->backend = &g_bake_file_backend;
-    } else {
+    new_entry->backend = bake_backend_lookup(backend_type);
+    if (!new_entry->backend) {
         fprintf(stderr, "ERROR: unknown backend type \"%s\"\n", backend_type);
         free(backend_type);
+        free(new_entry);
         return BAKE_ERR_BACKEND_TYPE;
     }
 
@@ -438,7 +508,6 @@ int bake_provider_remove_all_storage_targets(bake_provider_t provider)
         free(p);
     }
     provider->num_targets = 0;
-    margo_bulk_poolset_destroy(provider->poolset);
     ABT_rwlock_unlock(provider->lock);
     return BAKE_SUCCESS;
 }
@@ -467,15 +536,21 @@ int bake_provider_list_storage_targets(bake_provider_t   provider,
     return BAKE_SUCCESS;
 }
 
-#define DECLARE_LOCAL_VARS(rpc_name)                    \
-    margo_instance_id       mid = MARGO_INSTANCE_NULL;  \
-    bake_##rpc_name##_out_t out = {0};                  \
-    bake_##rpc_name##_in_t  in;                         \
-    hg_return_t             hret;                       \
-    ABT_rwlock              lock     = ABT_RWLOCK_NULL; \
-    const struct hg_info*   info     = NULL;            \
-    bake_provider_t         provider = NULL;            \
-    bake_target_t*          target   = NULL
+#define DECLARE_LOCAL_VARS(rpc_name)                                 \
+    margo_instance_id       mid = MARGO_INSTANCE_NULL;               \
+    bake_##rpc_name##_out_t out = {0};                               \
+    bake_##rpc_name##_in_t  in;                                      \
+    hg_return_t             hret;                                    \
+    ABT_rwlock              lock        = ABT_RWLOCK_NULL;           \
+    const struct hg_info*   info        = NULL;                      \
+    bake_provider_t         provider    = NULL;                      \
+    bake_target_t*          target      = NULL;                      \
+    bake_qos_slot_t         qos_slot    = BAKE_QOS_SLOT_INITIALIZER; \
+    const int               rpc_metric  = BAKE_METRIC_RPC(rpc_name); \
+    const uint64_t          rpc_start   = bake_metrics_now();        \
+    uint64_t                rpc_bytes   = 0;                         \
+    bake_trace_ctx_t        trace       = {NULL, 0, rpc_metric};     \
+    uint64_t                trace_start = 0
 
 #define FIND_PROVIDER                                    \
     do {                                                 \
@@ -489,28 +564,103 @@ int bake_provider_list_storage_targets(bake_provider_t   provider,
         }                                                \
     } while (0)
 
-#define GET_RPC_INPUT                        \
-    do {                                     \
-        hret = margo_get_input(handle, &in); \
-        if (hret != HG_SUCCESS) {            \
-            out.ret = BAKE_ERR_MERCURY;      \
-            goto finish;                     \
-        }                                    \
+/* clock reads of the stages of a request are skipped unless it is
+ * sampled */
+#define TRACE_SAMPLED (trace.req_id & BAKE_TRACE_SAMPLED)
+#define TRACE_NOW()   (TRACE_SAMPLED ? bake_trace_now() : 0)
+#define TRACE_STAGE(stage, op, start, arg)                                   \
+    do {                                                                     \
+        if (TRACE_SAMPLED)                                                   \
+            bake_tracer_record(trace.tracer, trace.req_id, (stage), (op),    \
+                               (start), bake_trace_now(), (arg));            \
     } while (0)
 
-#define LOCK_PROVIDER            \
-    do {                         \
-        lock = provider->lock;   \
-        ABT_rwlock_rdlock(lock); \
+/* decodes the input and adopts the request id chosen by the client; a
+ * sampled request becomes the current request of the ULT, and its start
+ * is backdated to when the handler started */
+#define GET_RPC_INPUT                                                        \
+    do {                                                                     \
+        hret = margo_get_input(handle, &in);                                 \
+        if (hret != HG_SUCCESS) {                                            \
+            out.ret = BAKE_ERR_MERCURY;                                      \
+            goto finish;                                                     \
+        }                                                                    \
+        trace.tracer = provider->tracer;                                     \
+        trace.req_id                                                         \
+            = bake_tracer_adopt_request(provider->tracer, in.req_id);        \
+        if (TRACE_SAMPLED) {                                                 \
+            trace_start                                                      \
+                = bake_trace_now() - (bake_metrics_now() - rpc_start);       \
+            bake_trace_set_current(&trace);                                  \
+            TRACE_STAGE(BAKE_TRACE_DECODE, -1, trace_start, 0);              \
+        }                                                                    \
     } while (0)
 
-#define FIND_TARGET                                   \
-    do {                                              \
-        target = find_target_entry(provider, in.bti); \
-        if (target == NULL) {                         \
-            out.ret = BAKE_ERR_UNKNOWN_TARGET;        \
-            goto finish;                              \
-        }                                             \
+/* waits for the provider's scheduler to admit the request; must come before
+ * LOCK_PROVIDER so that queued requests do not hold the lock */
+#define QOS_ENTER(cls)                                             \
+    do {                                                           \
+        if (provider->qos) {                                       \
+            uint64_t start_ = TRACE_NOW();                         \
+            bake_qos_enter(provider->qos, (cls), &qos_slot);       \
+            TRACE_STAGE(BAKE_TRACE_QOS_WAIT, -1, start_, 0);       \
+        }                                                          \
+    } while (0)
+
+/* same as QOS_ENTER for a write or read of the given size, which is also
+ * the size accounted for in the metrics of the RPC */
+#define QOS_ENTER_DATA(size)                                                   \
+    do {                                                                       \
+        rpc_bytes = (size);                                                    \
+        QOS_ENTER(provider->qos                                                \
+                      ? bake_qos_data_class(provider->qos, in.qos_class, size) \
+                      : 0);                                                    \
+    } while (0)
+
+#define LOCK_PROVIDER                                     \
+    do {                                                  \
+        uint64_t start_ = TRACE_NOW();                    \
+        lock            = provider->lock;                 \
+        ABT_rwlock_rdlock(lock);                          \
+        TRACE_STAGE(BAKE_TRACE_LOCK_WAIT, -1, start_, 0); \
+    } while (0)
+
+#define FIND_TARGET                                           \
+    do {                                                      \
+        uint64_t start_ = TRACE_NOW();                        \
+        target          = find_target_entry(provider, in.bti); \
+        TRACE_STAGE(BAKE_TRACE_TARGET_LOOKUP, -1, start_, 0); \
+        if (target == NULL) {                                 \
+            out.ret = BAKE_ERR_UNKNOWN_TARGET;                \
+            goto finish;                                      \
+        }                                                     \
+    } while (0)
+
+/* follows the forwarding entry left by the tiering policy if the region was
+ * moved to another target */
+#define RESOLVE_REGION(rid)                                                \
+    do {                                                                   \
+        bake_target_id_t tid_ = in.bti;                                    \
+        if (provider->tiering                                              \
+            && bake_tiering_resolve(provider->tiering, &tid_, &(rid))) {   \
+            target = find_target_entry(provider, tid_);                    \
+            if (target == NULL) {                                          \
+                out.ret = BAKE_ERR_UNKNOWN_TARGET;                         \
+                goto finish;                                               \
+            }                                                              \
+        }                                                                  \
+    } while (0)
+
+/* same as RESOLVE_REGION, and counts an access to the region; write_end
+ * is the end of the range written, 0 for a read */
+#define TRACK_REGION(rid, write_end)                                       \
+    do {                                                                   \
+        bake_region_id_t origin_rid_ = (rid);                              \
+        RESOLVE_REGION(rid);                                               \
+        if (provider->tiering)                                             \
+            bake_tiering_record_access(provider->tiering, &in.bti,         \
+                                       &origin_rid_, &target->target_id,   \
+                                       &(rid), (write_end));               \
     } while (0)
 
 #define UNLOCK_PROVIDER                                       \
@@ -518,25 +668,76 @@ int bake_provider_list_storage_targets(bake_provider_t   provider,
         if (lock != ABT_RWLOCK_NULL) ABT_rwlock_unlock(lock); \
     } while (0)
 
-#define RESPOND_AND_CLEANUP            \
-    do {                               \
-        margo_respond(handle, &out);   \
-        margo_free_input(handle, &in); \
-        margo_destroy(handle);         \
+/* runs a backend call into out.ret, accounting for it in the provider's
+ * metrics and in the trace of the request */
+#define BACKEND_CALL(name, size, call)                                     \
+    do {                                                                   \
+        uint64_t start_       = bake_metrics_now();                        \
+        uint64_t trace_start_ = TRACE_NOW();                               \
+        out.ret               = (call);                                    \
+        bake_metrics_record(provider->metrics, BAKE_METRIC_BACKEND(name),  \
+                            start_, (size), out.ret);                      \
+        TRACE_STAGE(BAKE_TRACE_BACKEND, BAKE_METRIC_BACKEND(name),         \
+                    trace_start_, (size));                                 \
+    } while (0)
+
+#define RESPOND_AND_CLEANUP                                                 \
+    do {                                                                    \
+        uint64_t start_ = TRACE_NOW();                                      \
+        margo_respond(handle, &out);                                        \
+        TRACE_STAGE(BAKE_TRACE_RESPOND, -1, start_, 0);                     \
+        if (qos_slot.cls >= 0) bake_qos_exit(provider->qos, &qos_slot);     \
+        if (provider)                                                       \
+            bake_metrics_record(provider->metrics, rpc_metric, rpc_start,   \
+                                rpc_bytes, out.ret);                        \
+        if (TRACE_SAMPLED) {                                                \
+            TRACE_STAGE(BAKE_TRACE_REQUEST, rpc_metric, trace_start,        \
+                        rpc_bytes);                                         \
+            bake_trace_set_current(NULL);                                   \
+        }                                                                   \
+        margo_free_input(handle, &in);                                      \
+        margo_destroy(handle);                                              \
     } while (0)
 
+/* creates a region, keeping clear of the ids of regions that the tiering
+ * policy moved away from the target */
+static int create_region(bake_provider_t   provider,
+                         bake_target_t*    target,
+                         size_t            size,
+                         bake_region_id_t* rid)
+{
+    if (provider->tiering)
+        return bake_tiering_create_region(provider->tiering, target, size,
+                                          rid);
+    return target->backend->_create(target->context, size, rid);
+}
+
+/* lets the tiering policy know the size of a region that was just created */
+static void track_created_region(bake_provider_t         provider,
+                                 bake_target_t*          target,
+                                 const bake_region_id_t* rid,
+                                 size_t                  size)
+{
+    if (provider->tiering)
+        bake_tiering_record_access(provider->tiering, &target->target_id, rid,
+                                   &target->target_id, rid, size);
+}
+
 /* service a remote RPC that creates a BAKE region */
 static void bake_create_ult(hg_handle_t handle)
 {
     DECLARE_LOCAL_VARS(create);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER(BAKE_QOS_CLASS_METADATA);
     LOCK_PROVIDER;
     FIND_TARGET;
 
     memset(&out, 0, sizeof(out));
-    out.ret
-        = target->backend->_create(target->context, in.region_size, &out.rid);
+    BACKEND_CALL(create, 0,
+                 create_region(provider, target, in.region_size, &out.rid));
+    if (out.ret == BAKE_SUCCESS)
+        track_created_region(provider, target, &out.rid, in.region_size);
 
 finish:
     UNLOCK_PROVIDER;
@@ -550,8 +751,10 @@ static void bake_write_ult(hg_handle_t handle)
     DECLARE_LOCAL_VARS(write);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER_DATA(in.bulk_size);
     LOCK_PROVIDER;
     FIND_TARGET;
+    TRACK_REGION(in.rid, in.region_offset + in.bulk_size);
 
     double start, end;
 
@@ -571,9 +774,10 @@ static void bake_write_ult(hg_handle_t handle)
     symbiomon_metric_update_gauge_by_fixed_amount(provider->write_num_entrants, 1);
     start = ABT_get_wtime();
 #endif
-    out.ret = target->backend->_write_bulk(
-        target->context, in.rid, in.region_offset, in.bulk_size, in.bulk_handle,
-        src_addr, in.bulk_offset);
+    BACKEND_CALL(write_bulk, in.bulk_size,
+                 target->backend->_write_bulk(
+                     target->context, in.rid, in.region_offset, in.bulk_size,
+                     in.bulk_handle, src_addr, in.bulk_offset));
 
     end = ABT_get_wtime();
 #ifdef USE_SYMBIOMON
@@ -583,7 +787,6 @@ static void bake_write_ult(hg_handle_t handle)
     symbiomon_metric_update(provider->write_latency, (end-start));
     symbiomon_metric_update(provider->write_size, in.bulk_size);
     symbiomon_metric_update(provider->write_rss, (double)usage.ru_maxrss);
-    fprintf(stderr, "Write Latency value: %lf and size: %lu\n", end-start, in.bulk_size);
 #endif
 
 finish:
@@ -603,12 +806,16 @@ static void bake_eager_write_ult(hg_handle_t handle)
     in.size   = 0;
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER_DATA(in.size);
     LOCK_PROVIDER;
     FIND_TARGET;
+    TRACK_REGION(in.rid, in.region_offset + in.size);
 
     start = ABT_get_wtime();
-    out.ret = target->backend->_write_raw(target->context, in.rid,
-                                          in.region_offset, in.size, in.buffer);
+    BACKEND_CALL(write_raw, in.size,
+                 target->backend->_write_raw(target->context, in.rid,
+                                             in.region_offset, in.size,
+                                             in.buffer));
     end = ABT_get_wtime();
 #ifdef USE_SYMBIOMON
     struct rusage usage;    
@@ -616,7 +823,6 @@ static void bake_eager_write_ult(hg_handle_t handle)
     symbiomon_metric_update(provider->eager_write_latency, (end-start));
     symbiomon_metric_update(provider->eager_write_size, in.size);
     symbiomon_metric_update(provider->eager_write_rss, (double)usage.ru_maxrss);
-    fprintf(stderr, "Eager write Latency value: %lf and size: %lu\n", end-start, in.size);
 #endif
 finish:
     UNLOCK_PROVIDER;
@@ -630,11 +836,14 @@ static void bake_persist_ult(hg_handle_t handle)
     DECLARE_LOCAL_VARS(persist);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER(BAKE_QOS_CLASS_METADATA);
     LOCK_PROVIDER;
     FIND_TARGET;
+    RESOLVE_REGION(in.rid);
 
-    out.ret = target->backend->_persist(target->context, in.rid, in.offset,
-                                        in.size);
+    BACKEND_CALL(persist, in.size,
+                 target->backend->_persist(target->context, in.rid, in.offset,
+                                           in.size));
 
 finish:
     UNLOCK_PROVIDER;
@@ -647,6 +856,7 @@ static void bake_create_write_persist_ult(hg_handle_t handle)
     DECLARE_LOCAL_VARS(create_write_persist);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER_DATA(in.bulk_size);
     LOCK_PROVIDER;
     FIND_TARGET;
     memset(&out, 0, sizeof(out));
@@ -662,25 +872,32 @@ static void bake_create_write_persist_ult(hg_handle_t handle)
         goto finish;
     }
 
-    if (!target->backend->_create_write_persist_bulk) {
+    if (!target->backend->_create_write_persist_bulk
+        || (provider->tiering && bake_tiering_has_forwards(provider->tiering))) {
         /* If the backend does not provide a combination
-         * create_write_persist function, then issue constituent backend
-         * calls instead.
+         * create_write_persist function, or if the new region must not
+         * shadow a forwarded one, then issue constituent backend calls
+         * instead.
          */
-        out.ret = target->backend->_create(target->context, in.region_size,
-                                           &out.rid);
+        BACKEND_CALL(create, 0,
+                     create_region(provider, target, in.bulk_size, &out.rid));
         if (out.ret != BAKE_SUCCESS) goto finish;
-        out.ret = target->backend->_write_bulk(target->context, out.rid, 0,
-                                               in.bulk_size, in.bulk_handle,
-                                               src_addr, in.bulk_offset);
+        BACKEND_CALL(write_bulk, in.bulk_size,
+                     target->backend->_write_bulk(
+                         target->context, out.rid, 0, in.bulk_size,
+                         in.bulk_handle, src_addr, in.bulk_offset));
         if (out.ret != BAKE_SUCCESS) goto finish;
-        out.ret = target->backend->_persist(target->context, out.rid, 0,
-                                            in.region_size);
+        BACKEND_CALL(persist, in.bulk_size,
+                     target->backend->_persist(target->context, out.rid, 0,
+                                               in.bulk_size));
     } else {
-        out.ret = target->backend->_create_write_persist_bulk(
-            target->context, in.bulk_handle, src_addr, in.bulk_offset,
-            in.bulk_size, &out.rid);
+        BACKEND_CALL(create_write_persist_bulk, in.bulk_size,
+                     target->backend->_create_write_persist_bulk(
+                         target->context, in.bulk_handle, src_addr,
+                         in.bulk_offset, in.bulk_size, &out.rid));
     }
+    if (out.ret == BAKE_SUCCESS)
+        track_created_region(provider, target, &out.rid, in.bulk_size);
 
 finish:
     UNLOCK_PROVIDER;
@@ -697,27 +914,36 @@ static void bake_eager_create_write_persist_ult(hg_handle_t handle)
     in.size   = 0;
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER_DATA(in.size);
     LOCK_PROVIDER;
     FIND_TARGET;
 
     memset(&out, 0, sizeof(out));
 
-    if (!target->backend->_create_write_persist_raw) {
+    if (!target->backend->_create_write_persist_raw
+        || (provider->tiering && bake_tiering_has_forwards(provider->tiering))) {
         /* If the backend does not provide a combination
-         * create_write_persist function, then issue constituent backend
-         * calls instead.
+         * create_write_persist function, or if the new region must not
+         * shadow a forwarded one, then issue constituent backend calls
+         * instead.
          */
-        out.ret = target->backend->_create(target->context, in.size, &out.rid);
+        BACKEND_CALL(create, 0,
+                     create_region(provider, target, in.size, &out.rid));
         if (out.ret != BAKE_SUCCESS) goto finish;
-        out.ret = target->backend->_write_raw(target->context, out.rid, 0,
-                                              in.size, in.buffer);
+        BACKEND_CALL(write_raw, in.size,
+                     target->backend->_write_raw(target->context, out.rid, 0,
+                                                 in.size, in.buffer));
         if (out.ret != BAKE_SUCCESS) goto finish;
-        out.ret
-            = target->backend->_persist(target->context, out.rid, 0, in.size);
+        BACKEND_CALL(persist, in.size,
+                     target->backend->_persist(target->context, out.rid, 0,
+                                               in.size));
     } else {
-        out.ret = target->backend->_create_write_persist_raw(
-            target->context, in.buffer, in.size, &out.rid);
+        BACKEND_CALL(create_write_persist_raw, in.size,
+                     target->backend->_create_write_persist_raw(
+                         target->context, in.buffer, in.size, &out.rid));
     }
+    if (out.ret == BAKE_SUCCESS)
+        track_created_region(provider, target, &out.rid, in.size);
 
 finish:
     UNLOCK_PROVIDER;
@@ -731,12 +957,15 @@ static void bake_get_size_ult(hg_handle_t handle)
     DECLARE_LOCAL_VARS(get_size);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER(BAKE_QOS_CLASS_METADATA);
     LOCK_PROVIDER;
     FIND_TARGET;
+    RESOLVE_REGION(in.rid);
 
     memset(&out, 0, sizeof(out));
-    out.ret
-        = target->backend->_get_region_size(target->context, in.rid, &out.size);
+    BACKEND_CALL(get_region_size, 0,
+                 target->backend->_get_region_size(target->context, in.rid,
+                                                   &out.size));
 
 finish:
     UNLOCK_PROVIDER;
@@ -750,12 +979,15 @@ static void bake_get_data_ult(hg_handle_t handle)
     DECLARE_LOCAL_VARS(get_data);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER(BAKE_QOS_CLASS_METADATA);
     LOCK_PROVIDER;
     FIND_TARGET;
+    RESOLVE_REGION(in.rid);
     out.ptr = 0;
 
-    out.ret = target->backend->_get_region_data(target->context, in.rid,
-                                                (void**)&out.ptr);
+    BACKEND_CALL(get_region_data, 0,
+                 target->backend->_get_region_data(target->context, in.rid,
+                                                   (void**)&out.ptr));
 
 finish:
     UNLOCK_PROVIDER;
@@ -766,10 +998,16 @@ DEFINE_MARGO_RPC_HANDLER(bake_get_data_ult)
 /* service a remote RPC for a BAKE no-op */
 static void bake_noop_ult(hg_handle_t handle)
 {
-    margo_instance_id mid = margo_hg_handle_get_instance(handle);
+    uint64_t          start = bake_metrics_now();
+    margo_instance_id mid   = margo_hg_handle_get_instance(handle);
     assert(mid);
+    const struct hg_info* hgi      = margo_get_info(handle);
+    bake_provider_t       provider = margo_registered_data(mid, hgi->id);
 
     margo_respond(handle, NULL);
+    if (provider)
+        bake_metrics_record(provider->metrics, BAKE_METRIC_RPC(noop), start, 0,
+                            0);
     margo_destroy(handle);
     return;
 }
@@ -783,8 +1021,10 @@ static void bake_read_ult(hg_handle_t handle)
     in.remote_addr_str = NULL;
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER_DATA(in.bulk_size);
     LOCK_PROVIDER;
     FIND_TARGET;
+    TRACK_REGION(in.rid, 0);
 
     memset(&out, 0, sizeof(out));
     hg_addr_t src_addr = HG_ADDR_NULL;
@@ -798,9 +1038,10 @@ static void bake_read_ult(hg_handle_t handle)
         goto finish;
     }
 
-    out.ret = target->backend->_read_bulk(
-        target->context, in.rid, in.region_offset, in.bulk_size, in.bulk_handle,
-        src_addr, in.bulk_offset, &out.size);
+    BACKEND_CALL(read_bulk, in.bulk_size,
+                 target->backend->_read_bulk(
+                     target->context, in.rid, in.region_offset, in.bulk_size,
+                     in.bulk_handle, src_addr, in.bulk_offset, &out.size));
 
 finish:
     UNLOCK_PROVIDER;
@@ -818,18 +1059,21 @@ static void bake_eager_read_ult(hg_handle_t handle)
     DECLARE_LOCAL_VARS(eager_read);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER_DATA(in.size);
     LOCK_PROVIDER;
     FIND_TARGET;
+    TRACK_REGION(in.rid, 0);
 
     free_fn free_data = NULL;
-    out.ret           = target->backend->_read_raw(
-        target->context, in.rid, in.region_offset, in.size, (void**)&out.buffer,
-        &out.size, &free_data);
+    BACKEND_CALL(read_raw, in.size,
+                 target->backend->_read_raw(target->context, in.rid,
+                                            in.region_offset, in.size,
+                                            (void**)&out.buffer, &out.size,
+                                            &free_data));
     end = ABT_get_wtime();
 #ifdef USE_SYMBIOMON
     symbiomon_metric_update(provider->eager_read_latency, (end-start));
     symbiomon_metric_update(provider->eager_read_size, in.size);
-    fprintf(stderr, "Eager read Latency value: %lf and size: %lu\n", end-start, in.size);
 #endif
 
 finish:
@@ -843,6 +1087,7 @@ DEFINE_MARGO_RPC_HANDLER(bake_eager_read_ult)
 static void bake_probe_ult(hg_handle_t handle)
 {
     bake_probe_out_t out;
+    uint64_t         start = bake_metrics_now();
 
     memset(&out, 0, sizeof(out));
 
@@ -867,6 +1112,8 @@ static void bake_probe_ult(hg_handle_t handle)
     out.num_targets = targets_count;
 
     margo_respond(handle, &out);
+    bake_metrics_record(provider->metrics, BAKE_METRIC_RPC(probe), start, 0,
+                        out.ret);
 
     margo_destroy(handle);
 }
@@ -877,10 +1124,15 @@ static void bake_remove_ult(hg_handle_t handle)
     DECLARE_LOCAL_VARS(remove);
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER(BAKE_QOS_CLASS_METADATA);
     LOCK_PROVIDER;
     FIND_TARGET;
+    bake_region_id_t origin_rid = in.rid;
+    RESOLVE_REGION(in.rid);
 
-    out.ret = target->backend->_remove(target->context, in.rid);
+    BACKEND_CALL(remove, 0, target->backend->_remove(target->context, in.rid));
+    if (out.ret == BAKE_SUCCESS && provider->tiering)
+        bake_tiering_forget(provider->tiering, &in.bti, &origin_rid);
 finish:
     UNLOCK_PROVIDER;
     RESPOND_AND_CLEANUP;
@@ -893,14 +1145,21 @@ static void bake_migrate_region_ult(hg_handle_t handle)
     in.dest_addr = NULL;
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER(BAKE_QOS_CLASS_BACKGROUND);
     LOCK_PROVIDER;
     FIND_TARGET;
+    bake_region_id_t origin_rid = in.source_rid;
+    RESOLVE_REGION(in.source_rid);
 
     memset(&out, 0, sizeof(out));
 
-    out.ret = target->backend->_migrate_region(
-        target->context, in.source_rid, in.region_size, in.remove_src,
-        in.dest_addr, in.dest_provider_id, in.dest_target_id, &out.dest_rid);
+    BACKEND_CALL(migrate_region, in.region_size,
+                 target->backend->_migrate_region(
+                     target->context, in.source_rid, in.region_size,
+                     in.remove_src, in.dest_addr, in.dest_provider_id,
+                     in.dest_target_id, &out.dest_rid));
+    if (out.ret == BAKE_SUCCESS && in.remove_src && provider->tiering)
+        bake_tiering_forget(provider->tiering, &in.bti, &origin_rid);
 
 finish:
     UNLOCK_PROVIDER;
@@ -917,6 +1176,7 @@ static void bake_migrate_target_ult(hg_handle_t handle)
     in.dest_root      = NULL;
     FIND_PROVIDER;
     GET_RPC_INPUT;
+    QOS_ENTER(BAKE_QOS_CLASS_BACKGROUND);
     hg_addr_t dest_addr = HG_ADDR_NULL;
 
     memset(&out, 0, sizeof(out));
@@ -945,7 +1205,9 @@ static void bake_migrate_target_ult(hg_handle_t handle)
     }
 
     /* ask the backend to fill the fileset */
-    out.ret = target->backend->_create_fileset(target->context, &local_fileset);
+    BACKEND_CALL(create_fileset, 0,
+                 target->backend->_create_fileset(target->context,
+                                                  &local_fileset));
     if (out.ret != BAKE_SUCCESS) { goto finish; }
     if (local_fileset == NULL) {
         out.ret = BAKE_ERR_OP_UNSUPPORTED;
@@ -990,9 +1252,142 @@ finish:
 
 DEFINE_MARGO_RPC_HANDLER(bake_migrate_target_ult)
 
+/* service a remote RPC that retrieves the settings and statistics of a
+ * provider */
+static void bake_get_stats_ult(hg_handle_t handle)
+{
+    bake_get_stats_out_t out;
+    uint64_t             start = bake_metrics_now();
+    char*                stats = NULL;
+
+    memset(&out, 0, sizeof(out));
+    out.stats = "";
+
+    margo_instance_id mid = margo_hg_handle_get_instance(handle);
+    assert(mid);
+    const struct hg_info* hgi      = margo_get_info(handle);
+    bake_provider_t       provider = margo_registered_data(mid, hgi->id);
+    if (!provider) {
+        out.ret = BAKE_ERR_UNKNOWN_PROVIDER;
+        margo_respond(handle, &out);
+        margo_destroy(handle);
+        return;
+    }
+
+    out.ret = bake_provider_get_stats(provider, &stats);
+    if (stats) out.stats = stats;
+
+    margo_respond(handle, &out);
+    bake_metrics_record(provider->metrics, BAKE_METRIC_RPC(get_stats), start,
+                        0, out.ret);
+    free(stats);
+
+    margo_destroy(handle);
+}
+DEFINE_MARGO_RPC_HANDLER(bake_get_stats_ult)
+
+/* the credits of the provider as a whole: as configured, or else as many
+ * operations and bytes as its pipelining buffers can hold (unlimited
+ * without pipelining) */
+static void flow_credit_totals(bake_provider_t provider,
+                               uint64_t*       ops,
+                               uint64_t*       bytes)
+{
+    struct bake_provider_conf* conf = &provider->config;
+    uint64_t                   size = conf->pipeline_first_buffer_size;
+    unsigned                   i;
+
+    *ops   = conf->flow_credit_ops;
+    *bytes = conf->flow_credit_bytes;
+    if (*ops == BAKE_FLOW_CREDITS_AUTO)
+        *ops = conf->pipeline_enable ? (uint64_t)conf->pipeline_npools
+                                           * conf->pipeline_nbuffers_per_pool
+                                     : 0;
+    if (*bytes == BAKE_FLOW_CREDITS_AUTO) {
+        *bytes = 0;
+        if (conf->pipeline_enable && conf->pipeline_quota)
+            *bytes = conf->pipeline_quota;
+        else if (conf->pipeline_enable) {
+            for (i = 0; i < conf->pipeline_npools; i++) {
+                *bytes += size * conf->pipeline_nbuffers_per_pool;
+                size *= conf->pipeline_multiplier;
+            }
+        }
+    }
+}
+
+/* grants a provider handle its share of the provider's credits, split
+ * evenly among the handles that renewed their lease recently */
+static void bake_get_credits_ult(hg_handle_t handle)
+{
+    bake_get_credits_in_t  in;
+    bake_get_credits_out_t out;
+    bake_flow_grantee_t *  g = NULL, *tmp;
+    uint64_t               ops, bytes, n;
+    double                 now;
+    uint64_t               start = bake_metrics_now();
+    hg_return_t            hret;
+
+    memset(&out, 0, sizeof(out));
+
+    margo_instance_id mid = margo_hg_handle_get_instance(handle);
+    assert(mid);
+    const struct hg_info* hgi      = margo_get_info(handle);
+    bake_provider_t       provider = margo_registered_data(mid, hgi->id);
+    if (!provider) {
+        out.ret = BAKE_ERR_UNKNOWN_PROVIDER;
+        margo_respond(handle, &out);
+        margo_destroy(handle);
+        return;
+    }
+
+    hret = margo_get_input(handle, &in);
+    if (hret != HG_SUCCESS) {
+        out.ret = BAKE_ERR_MERCURY;
+        goto finish;
+    }
+
+    now = ABT_get_wtime();
+    ABT_mutex_lock(provider->flow_mutex);
+    HASH_ITER(hh, provider->flow_grantees, g, tmp)
+    {
+        if (g->expires < now) {
+            HASH_DEL(provider->flow_grantees, g);
+            free(g);
+        }
+    }
+    HASH_FIND(hh, provider->flow_grantees, &in.grantee, sizeof(uint64_t), g);
+    if (!g) {
+        g = calloc(1, sizeof(*g));
+        if (g) {
+            g->id = in.grantee;
+            HASH_ADD(hh, provider->flow_grantees, id, sizeof(uint64_t), g);
+        }
+    }
+    if (g) g->expires = now + 2 * BAKE_FLOW_CREDIT_LEASE_MS / 1000.0;
+    n = HASH_COUNT(provider->flow_grantees);
+    ABT_mutex_unlock(provider->flow_mutex);
+
+    flow_credit_totals(provider, &ops, &bytes);
+    if (n == 0) n = 1;
+    out.ret          = BAKE_SUCCESS;
+    out.credit_ops   = ops ? (ops / n ? ops / n : 1) : 0;
+    out.credit_bytes = bytes ? (bytes / n ? bytes / n : 1) : 0;
+    out.lease_ms     = BAKE_FLOW_CREDIT_LEASE_MS;
+    margo_free_input(handle, &in);
+
+finish:
+    margo_respond(handle, &out);
+    bake_metrics_record(provider->metrics, BAKE_METRIC_RPC(get_credits),
+                        start, 0, out.ret);
+    margo_destroy(handle);
+}
+DEFINE_MARGO_RPC_HANDLER(bake_get_credits_ult)
+
 static void bake_server_finalize_cb(void* data)
 {
-    bake_provider* provider = (bake_provider*)data;
+    bake_provider*       provider = (bake_provider*)data;
+    bake_flow_grantee_t *grantee, *tmp_grantee;
     assert(provider);
     margo_instance_id mid = provider->mid;
 
@@ -1011,6 +1406,8 @@ static void bake_server_finalize_cb(void* data)
     margo_deregister(mid, provider->rpc_remove_id);
     margo_deregister(mid, provider->rpc_migrate_region_id);
     margo_deregister(mid, provider->rpc_migrate_target_id);
+    margo_deregister(mid, provider->rpc_get_stats_id);
+    margo_deregister(mid, provider->rpc_get_credits_id);
 
 #ifdef USE_REMI
     remi_client_finalize(provider->remi_client);
@@ -1019,10 +1416,23 @@ static void bake_server_finalize_cb(void* data)
     }
 #endif
 
+    bake_tiering_destroy(provider->tiering);
+    bake_qos_destroy(provider->qos);
+
     bake_provider_remove_all_storage_targets(provider);
+    bake_poolset_detach(provider->poolset);
+    bake_metrics_destroy(provider->metrics);
+    bake_tracer_destroy(provider->tracer);
 
     ABT_rwlock_free(&(provider->lock));
 
+    HASH_ITER(hh, provider->flow_grantees, grantee, tmp_grantee)
+    {
+        HASH_DEL(provider->flow_grantees, grantee);
+        free(grantee);
+    }
+    ABT_mutex_free(&(provider->flow_mutex));
+
     free(provider);
 
     return;
@@ -1074,24 +1484,158 @@ static int bake_target_post_migration_callback(remi_fileset_t fileset,
 static int set_conf_cb_pipeline_enabled(bake_provider_t provider,
                                         const char*     value)
 {
-    int         ret;
-    hg_return_t hret;
+    int  ret;
+    char str[16];
 
     ret = sscanf(value, "%u", &provider->config.pipeline_enable);
     if (ret != 1) return BAKE_ERR_INVALID_ARG;
 
-    if (provider->config.pipeline_enable) {
-        hret = margo_bulk_poolset_create(
+    if (provider->config.pipeline_enable && !provider->poolset) {
+        /* the buffers are shared by the providers of the margo instance */
+        provider->poolset = bake_poolset_attach(
             provider->mid, provider->config.pipeline_npools,
             provider->config.pipeline_nbuffers_per_pool,
             provider->config.pipeline_first_buffer_size,
-            provider->config.pipeline_multiplier, HG_BULK_READWRITE,
-            &(provider->poolset));
-        if (hret != 0) return BAKE_ERR_MERCURY;
+            provider->config.pipeline_multiplier,
+            provider->config.pipeline_numa_node,
+            provider->config.pipeline_huge_pages);
+        if (!provider->poolset) return BAKE_ERR_MERCURY;
+        bake_poolset_set_quota(provider->poolset,
+                               provider->config.pipeline_quota);
+        if (provider->config.pipeline_min_buffers_per_pool
+            != BAKE_PIPELINE_CONF_UNSET) {
+            sprintf(str, "%u", provider->config.pipeline_min_buffers_per_pool);
+            bake_poolset_set_conf(provider->poolset,
+                                  "pipeline_min_buffers_per_pool", str);
+        }
+        if (provider->config.pipeline_idle_ms != BAKE_PIPELINE_CONF_UNSET) {
+            sprintf(str, "%u", provider->config.pipeline_idle_ms);
+            bake_poolset_set_conf(provider->poolset, "pipeline_idle_ms", str);
+        }
     }
     return BAKE_SUCCESS;
 }
 
+/* the geometry and placement of the buffer pools, which cannot change once
+ * pipelining is enabled */
+static int set_conf_cb_pipeline_geometry(bake_provider_t provider,
+                                         const char*     key,
+                                         const char*     value)
+{
+    unsigned u;
+    int      node, ret;
+
+    if (strcmp(key, "pipeline_numa_node") == 0) {
+        ret = bake_numa_parse_node(value, &node);
+        if (ret != BAKE_SUCCESS) return ret;
+        if (provider->poolset) return BAKE_ERR_FORBIDDEN;
+        provider->config.pipeline_numa_node = node;
+        return BAKE_SUCCESS;
+    }
+    if (strcmp(key, "pipeline_huge_pages") == 0) {
+        if (sscanf(value, "%u", &u) != 1) return BAKE_ERR_INVALID_ARG;
+        if (provider->poolset) return BAKE_ERR_FORBIDDEN;
+        provider->config.pipeline_huge_pages = !!u;
+        return BAKE_SUCCESS;
+    }
+    if (sscanf(value, "%u", &u) != 1 || u == 0) return BAKE_ERR_INVALID_ARG;
+    if (provider->poolset) return BAKE_ERR_FORBIDDEN;
+    if (strcmp(key, "pipeline_npools") == 0)
+        provider->config.pipeline_npools = u;
+    else if (strcmp(key, "pipeline_nbuffers_per_pool") == 0)
+        provider->config.pipeline_nbuffers_per_pool = u;
+    else if (strcmp(key, "pipeline_first_buffer_size") == 0)
+        provider->config.pipeline_first_buffer_size = u;
+    else if (strcmp(key, "pipeline_multiplier") == 0) {
+        if (u < 2) return BAKE_ERR_INVALID_ARG;
+        provider->config.pipeline_multiplier = u;
+    } else
+        return BAKE_ERR_INVALID_ARG;
+    return BAKE_SUCCESS;
+}
+
+/* settings of the shared buffer pools, which can change at any time */
+static int set_conf_cb_pipeline_pools(bake_provider_t provider,
+                                      const char*     key,
+                                      const char*     value)
+{
+    unsigned u;
+
+    if (sscanf(value, "%u", &u) != 1) return BAKE_ERR_INVALID_ARG;
+    if (strcmp(key, "pipeline_min_buffers_per_pool") == 0)
+        provider->config.pipeline_min_buffers_per_pool = u;
+    else
+        provider->config.pipeline_idle_ms = u;
+    if (!provider->poolset) return BAKE_SUCCESS;
+    return bake_poolset_set_conf(provider->poolset, key, value);
+}
+
+static int set_conf_cb_pipeline_quota(bake_provider_t provider,
+                                      const char*     value)
+{
+    size_t quota;
+
+    if (sscanf(value, "%zu", &quota) != 1) return BAKE_ERR_INVALID_ARG;
+    provider->config.pipeline_quota = quota;
+    if (provider->poolset) bake_poolset_set_quota(provider->poolset, quota);
+    return BAKE_SUCCESS;
+}
+
+/* credits shared among the provider handles of clients, which pick up new
+ * values when they renew their lease */
+static int set_conf_cb_flow_credits(bake_provider_t provider,
+                                    const char*     key,
+                                    const char*     value)
+{
+    uint64_t u;
+
+    if (strcmp(value, "auto") == 0)
+        u = BAKE_FLOW_CREDITS_AUTO;
+    else if (sscanf(value, "%" SCNu64, &u) != 1 || u == BAKE_FLOW_CREDITS_AUTO)
+        return BAKE_ERR_INVALID_ARG;
+    if (strcmp(key, "flow_credit_ops") == 0)
+        provider->config.flow_credit_ops = u;
+    else
+        provider->config.flow_credit_bytes = u;
+    return BAKE_SUCCESS;
+}
+
+static int set_conf_cb_tiering(bake_provider_t provider,
+                               const char*     key,
+                               const char*     value)
+{
+    int ret;
+
+    if (!provider->tiering) {
+        ret = bake_tiering_create(provider, &provider->tiering);
+        if (ret != BAKE_SUCCESS) return ret;
+    }
+    return bake_tiering_set_conf(provider->tiering, key, value);
+}
+
+static int set_conf_cb_qos(bake_provider_t provider,
+                           const char*     key,
+                           const char*     value)
+{
+    int ret;
+
+    if (!provider->qos) {
+        ret = bake_qos_create(&provider->qos);
+        if (ret != BAKE_SUCCESS) return ret;
+    }
+    return bake_qos_set_conf(provider->qos, key, value);
+}
+
+static int set_conf_cb_elastic(bake_provider_t provider,
+                               const char*     key,
+                               const char*     value)
+{
+    bake_elastic_pool_t epool = bake_elastic_pool_find(provider->handler_pool);
+
+    if (!epool) return BAKE_ERR_OP_UNSUPPORTED;
+    return bake_elastic_pool_set_conf(epool, key, value);
+}
+
 int bake_provider_set_conf(bake_provider_t provider,
                            const char*     key,
                            const char*     value)
@@ -1101,15 +1645,152 @@ int bake_provider_set_conf(bake_provider_t provider,
      */
     if (strcmp(key, "pipeline_enabled") == 0)
         return set_conf_cb_pipeline_enabled(provider, value);
+    else if (strcmp(key, "pipeline_quota") == 0)
+        return set_conf_cb_pipeline_quota(provider, value);
+    else if (strcmp(key, "pipeline_npools") == 0
+             || strcmp(key, "pipeline_nbuffers_per_pool") == 0
+             || strcmp(key, "pipeline_first_buffer_size") == 0
+             || strcmp(key, "pipeline_multiplier") == 0
+             || strcmp(key, "pipeline_numa_node") == 0
+             || strcmp(key, "pipeline_huge_pages") == 0)
+        return set_conf_cb_pipeline_geometry(provider, key, value);
+    else if (strcmp(key, "pipeline_min_buffers_per_pool") == 0
+             || strcmp(key, "pipeline_idle_ms") == 0)
+        return set_conf_cb_pipeline_pools(provider, key, value);
+    else if (strcmp(key, "flow_credit_ops") == 0
+             || strcmp(key, "flow_credit_bytes") == 0)
+        return set_conf_cb_flow_credits(provider, key, value);
+    else if (strncmp(key, "tiering_", 8) == 0)
+        return set_conf_cb_tiering(provider, key, value);
+    else if (strncmp(key, "qos_", 4) == 0)
+        return set_conf_cb_qos(provider, key, value);
+    else if (strncmp(key, "elastic_", 8) == 0)
+        return set_conf_cb_elastic(provider, key, value);
+    else if (strncmp(key, "trace_", 6) == 0)
+        return bake_tracer_set_conf(provider->tracer, key, value);
     else
         return BAKE_ERR_INVALID_ARG;
 }
 
+/* prints the statistics of every target that has some, each line prefixed
+ * with "target.<target id>." */
+static void print_target_stats(bake_provider_t provider, FILE* out)
+{
+    bake_target_t *t, *tmp;
+    char           tid_str[37];
+    char *         buf = NULL, *line, *saveptr;
+    size_t         size;
+    FILE*          target_out;
+
+    ABT_rwlock_rdlock(provider->lock);
+    HASH_ITER(hh, provider->targets, t, tmp)
+    {
+        if (!t->backend->_get_stats) continue;
+        size       = 0;
+        target_out = open_memstream(&buf, &size);
+        if (!target_out) break;
+        t->backend->_get_stats(t->context, target_out);
+        fclose(target_out);
+        bake_target_id_to_string(t->target_id, tid_str, sizeof(tid_str));
+        for (line = strtok_r(buf, "\n", &saveptr); line;
+             line = strtok_r(NULL, "\n", &saveptr))
+            fprintf(out, "target.%s.%s\n", tid_str, line);
+        free(buf);
+        buf = NULL;
+    }
+    ABT_rwlock_unlock(provider->lock);
+}
+
+int bake_provider_get_stats(bake_provider_t provider, char** stats)
+{
+    char*               buf  = NULL;
+    size_t              size = 0;
+    FILE*               out;
+    bake_elastic_pool_t epool;
+    uint64_t            credit_ops, credit_bytes;
+
+    *stats = NULL;
+    out    = open_memstream(&buf, &size);
+    if (!out) return BAKE_ERR_ALLOCATION;
+    fprintf(out, "pipeline_enabled = %u\n", provider->config.pipeline_enable);
+    flow_credit_totals(provider, &credit_ops, &credit_bytes);
+    fprintf(out, "flow_credit_ops = %" PRIu64 "\n", credit_ops);
+    fprintf(out, "flow_credit_bytes = %" PRIu64 "\n", credit_bytes);
+    ABT_mutex_lock(provider->flow_mutex);
+    fprintf(out, "flow.grantees = %u\n", HASH_COUNT(provider->flow_grantees));
+    ABT_mutex_unlock(provider->flow_mutex);
+    if (provider->poolset) bake_poolset_print_stats(provider->poolset, "", out);
+    if (provider->tiering) bake_tiering_print_stats(provider->tiering, out);
+    if (provider->qos) bake_qos_print_stats(provider->qos, out);
+    epool = bake_elastic_pool_find(provider->handler_pool);
+    if (epool) bake_elastic_pool_print_stats(epool, out);
+    bake_metrics_print_stats(provider->metrics, out);
+    print_target_stats(provider, out);
+    fclose(out);
+    *stats = buf;
+    return BAKE_SUCCESS;
+}
+
+int bake_provider_dump_trace(bake_provider_t provider, const char* filename)
+{
+    return bake_tracer_dump_file(provider->tracer, filename);
+}
+
 int bake_target_set_conf(bake_provider_t  provider,
                          bake_target_id_t tid,
                          const char*      key,
                          const char*      value)
 {
-    // TODO
-    return 0;
+    int ret;
+    ABT_rwlock_rdlock(provider->lock);
+    bake_target_t* entry = NULL;
+    HASH_FIND(hh, provider->targets, &tid, sizeof(bake_target_id_t), entry);
+    if (!entry)
+        ret = BAKE_ERR_UNKNOWN_TARGET;
+    else if (!entry->backend->_set_conf)
+        ret = BAKE_ERR_OP_UNSUPPORTED;
+    else
+        ret = entry->backend->_set_conf(entry->context, key, value);
+    ABT_rwlock_unlock(provider->lock);
+    return ret;
+}
+
+int bake_target_get_stats(bake_provider_t  provider,
+                          bake_target_id_t tid,
+                          char**           stats)
+{
+    int    ret;
+    char*  buf  = NULL;
+    size_t size = 0;
+    FILE*  out;
+
+    *stats = NULL;
+
+    ABT_rwlock_rdlock(provider->lock);
+    bake_target_t* entry = NULL;
+    HASH_FIND(hh, provider->targets, &tid, sizeof(bake_target_id_t), entry);
+    if (!entry) {
+        ret = BAKE_ERR_UNKNOWN_TARGET;
+        goto finish;
+    }
+    if (!entry->backend->_get_stats) {
+        ret = BAKE_ERR_OP_UNSUPPORTED;
+        goto finish;
+    }
+
+    out = open_memstream(&buf, &size);
+    if (!out) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto finish;
+    }
+    ret = entry->backend->_get_stats(entry->context, out);
+    fclose(out);
+    if (ret != BAKE_SUCCESS)
+        free(buf);
+    else
+        *stats = buf;
+
+finish:
+    ABT_rwlock_unlock(provider->lock);
+    return ret;
 }
@@ -0,0 +1,301 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "bake-client.h"
+#include "bake-metrics.h"
+
+/* client program that prints the rates and latency percentiles of the RPCs
+ * and backend calls of a BAKE provider */
+
+#define MAX_NAME 64
+
+typedef struct {
+    char     name[MAX_NAME];
+    uint64_t count;
+    uint64_t errors;
+    uint64_t bytes;
+    uint64_t latency_ns;
+    uint64_t max_latency_ns;
+    uint64_t latency_histogram[BAKE_METRICS_BUCKETS];
+} metric_t;
+
+typedef struct {
+    double   time;
+    unsigned num_metrics;
+    metric_t metrics[BAKE_METRICS_NUM];
+} sample_t;
+
+static metric_t* find_metric(sample_t* s, const char* name, int create)
+{
+    unsigned i;
+
+    for (i = 0; i < s->num_metrics; i++)
+        if (strcmp(s->metrics[i].name, name) == 0) return &s->metrics[i];
+    if (!create || s->num_metrics == BAKE_METRICS_NUM) return NULL;
+    memset(&s->metrics[s->num_metrics], 0, sizeof(metric_t));
+    snprintf(s->metrics[s->num_metrics].name, MAX_NAME, "%s", name);
+    return &s->metrics[s->num_metrics++];
+}
+
+/* reads the "metrics.*" lines of a provider's statistics */
+static void parse_sample(char* stats, sample_t* s)
+{
+    char*     line;
+    char*     save = NULL;
+    char*     eq;
+    char*     tok;
+    char*     save_tok;
+    char*     suffix;
+    metric_t* m;
+    uint64_t  lower, count;
+
+    memset(s, 0, sizeof(*s));
+    for (line = strtok_r(stats, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        if (strncmp(line, "metrics.", 8) != 0) continue;
+        eq = strstr(line, " = ");
+        if (!eq) continue;
+        *eq = '\0';
+        line += 8;
+        eq += 3;
+        if (strcmp(line, "time") == 0) {
+            s->time = atof(eq);
+        } else if (strncmp(eq, "count ", 6) == 0) {
+            m = find_metric(s, line, 1);
+            if (!m) continue;
+            sscanf(eq,
+                   "count %" SCNu64 " errors %" SCNu64 " bytes %" SCNu64
+                   " latency_ns %" SCNu64 " max_latency_ns %" SCNu64,
+                   &m->count, &m->errors, &m->bytes, &m->latency_ns,
+                   &m->max_latency_ns);
+        } else if ((suffix = strstr(line, ".latency_ns"))
+                   && suffix[11] == '\0') {
+            *suffix = '\0';
+            m       = find_metric(s, line, 1);
+            if (!m) continue;
+            save_tok = NULL;
+            for (tok = strtok_r(eq, " ", &save_tok); tok;
+                 tok = strtok_r(NULL, " ", &save_tok)) {
+                if (sscanf(tok, "%" SCNu64 ":%" SCNu64, &lower, &count) == 2)
+                    m->latency_histogram[bake_metrics_bucket(lower)] = count;
+            }
+        }
+    }
+}
+
+/* upper bound of the bucket holding the given fraction of the calls */
+static double percentile_us(const uint64_t histogram[], uint64_t total, double p)
+{
+    uint64_t rank = (uint64_t)(p * total + 0.999999);
+    uint64_t seen = 0;
+    unsigned b;
+
+    if (rank == 0) rank = 1;
+    for (b = 0; b < BAKE_METRICS_BUCKETS; b++) {
+        seen += histogram[b];
+        if (seen >= rank) return bake_metrics_bucket_upper(b) / 1e3;
+    }
+    return 0.0;
+}
+
+/* prints what happened between two samples (from the start of the provider
+ * if prev is NULL) */
+static void report(sample_t* prev, sample_t* cur)
+{
+    uint64_t  histogram[BAKE_METRICS_BUCKETS];
+    metric_t  zero;
+    metric_t* m;
+    metric_t* p;
+    uint64_t  count;
+    double    elapsed, max;
+    unsigned  i, b;
+
+    memset(&zero, 0, sizeof(zero));
+    elapsed = cur->time - (prev ? prev->time : 0.0);
+    if (elapsed <= 0.0) elapsed = 1e-9;
+
+    printf("%-40s %10s %10s %8s %10s %10s %10s %10s %10s\n", "# call",
+           "ops/s", "MiB/s", "errors", "mean_us", "p50_us", "p99_us",
+           "p99.9_us", "max_us");
+    for (i = 0; i < cur->num_metrics; i++) {
+        m = &cur->metrics[i];
+        p = prev ? find_metric(prev, m->name, 0) : NULL;
+        if (!p) p = &zero;
+        count = m->count - p->count;
+        if (count == 0) continue;
+        for (b = 0; b < BAKE_METRICS_BUCKETS; b++)
+            histogram[b] = m->latency_histogram[b] - p->latency_histogram[b];
+        /* the exact maximum is only known since the start of the provider */
+        max = percentile_us(histogram, count, 1.0);
+        if (!prev) max = m->max_latency_ns / 1e3;
+        printf("%-40s %10.1f %10.2f %8" PRIu64
+               " %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+               m->name, count / elapsed,
+               (m->bytes - p->bytes) / elapsed / (1024.0 * 1024.0),
+               m->errors - p->errors,
+               (m->latency_ns - p->latency_ns) / 1e3 / count,
+               percentile_us(histogram, count, 0.5),
+               percentile_us(histogram, count, 0.99),
+               percentile_us(histogram, count, 0.999), max);
+    }
+    fflush(stdout);
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: bake-stat [-i interval] [-n count] [-r] <server addr> "
+            "<mplex id>\n");
+    fprintf(stderr,
+            "       [-i interval] seconds between samples; 0 reports the "
+            "totals since the provider started (default 1)\n");
+    fprintf(stderr, "       [-n count] number of reports (default 1)\n");
+    fprintf(stderr,
+            "       [-r] print the raw statistics of the provider and exit\n");
+    fprintf(stderr, "  Example: ./bake-stat -i 2 -n 10 tcp://localhost:1234 1\n");
+}
+
+int main(int argc, char** argv)
+{
+    int                    i, opt;
+    char                   cli_addr_prefix[64] = {0};
+    char*                  svr_addr_str;
+    hg_addr_t              svr_addr;
+    margo_instance_id      mid;
+    bake_client_t          bcl;
+    bake_provider_handle_t bph;
+    uint8_t                mplex_id;
+    hg_return_t            hret;
+    int                    ret;
+    double                 interval = 1.0;
+    int                    count    = 1;
+    int                    raw      = 0;
+    char*                  stats    = NULL;
+    sample_t*              prev;
+    sample_t*              cur;
+    sample_t*              tmp;
+
+    while ((opt = getopt(argc, argv, "i:n:r")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval = atof(optarg);
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'r':
+            raw = 1;
+            break;
+        default:
+            usage();
+            return (-1);
+        }
+    }
+    if (argc - optind != 2 || interval < 0 || count < 1) {
+        usage();
+        return (-1);
+    }
+    svr_addr_str = argv[optind];
+    mplex_id     = atoi(argv[optind + 1]);
+
+    /* initialize Margo using the transport portion of the server
+     * address (i.e., the part before the first : character if present)
+     */
+    for (i = 0; (i < 63 && svr_addr_str[i] != '\0' && svr_addr_str[i] != ':');
+         i++)
+        cli_addr_prefix[i] = svr_addr_str[i];
+
+    mid = margo_init(cli_addr_prefix, MARGO_CLIENT_MODE, 0, -1);
+    if (mid == MARGO_INSTANCE_NULL) {
+        fprintf(stderr, "Error: margo_init()\n");
+        return -1;
+    }
+
+    ret = bake_client_init(mid, &bcl);
+    if (ret != 0) {
+        bake_perror("Error: bake_client_init()", ret);
+        margo_finalize(mid);
+        return -1;
+    }
+
+    hret = margo_addr_lookup(mid, svr_addr_str, &svr_addr);
+    if (hret != HG_SUCCESS) {
+        fprintf(stderr, "Error: margo_addr_lookup()\n");
+        bake_client_finalize(bcl);
+        margo_finalize(mid);
+        return (-1);
+    }
+
+    ret = bake_provider_handle_create(bcl, svr_addr, mplex_id, &bph);
+    if (ret < 0) {
+        bake_perror("Error: bake_provider_handle_create()", ret);
+        margo_addr_free(mid, svr_addr);
+        bake_client_finalize(bcl);
+        margo_finalize(mid);
+        return (-1);
+    }
+
+    prev = calloc(1, sizeof(*prev));
+    cur  = calloc(1, sizeof(*cur));
+    if (!prev || !cur) {
+        ret = BAKE_ERR_ALLOCATION;
+        bake_perror("Error: bake-stat", ret);
+        goto finish;
+    }
+
+    ret = bake_get_stats(bph, &stats);
+    if (ret != 0) {
+        bake_perror("Error: bake_get_stats()", ret);
+        goto finish;
+    }
+    if (raw) {
+        printf("%s", stats);
+        goto finish;
+    }
+    parse_sample(stats, prev);
+    free(stats);
+    stats = NULL;
+
+    if (interval == 0) {
+        report(NULL, prev);
+        goto finish;
+    }
+
+    for (i = 0; i < count; i++) {
+        margo_thread_sleep(mid, interval * 1000.0);
+        ret = bake_get_stats(bph, &stats);
+        if (ret != 0) {
+            bake_perror("Error: bake_get_stats()", ret);
+            goto finish;
+        }
+        parse_sample(stats, cur);
+        free(stats);
+        stats = NULL;
+        report(prev, cur);
+        tmp  = prev;
+        prev = cur;
+        cur  = tmp;
+    }
+
+finish:
+    free(stats);
+    free(prev);
+    free(cur);
+    bake_provider_handle_release(bph);
+    margo_addr_free(mid, svr_addr);
+    bake_client_finalize(bcl);
+    margo_finalize(mid);
+
+    return ret == 0 ? 0 : -1;
+}
@@ -0,0 +1,941 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "bake-config.h"
+#include "bake.h"
+#include "bake-rpc.h"
+#include "bake-server.h"
+#include "bake-provider.h"
+#include "bake-backend.h"
+#include "uthash.h"
+
+/* bake-tier-backend
+ *
+ * This is a back end that puts a DRAM tier in front of a target of another
+ * back end.  A "tier:file:/path" target is the file target "/path" with
+ * copies of its regions in DRAM.  Region ids and the target id are those
+ * of the inner target.
+ *
+ * Regions created through the tier, and regions read while the tier has
+ * room, get a DRAM copy (registered with Mercury once) that serves reads.
+ * In write-back mode writes only update the copy; dirty ranges are flushed
+ * to the inner target, and persisted there, by background ULTs.  persist
+ * flushes the region before persisting it.  In write-through mode writes go
+ * to both.  A region whose copy cannot be made because the tier is full of
+ * dirty data, or that is larger than a quarter of the capacity, is accessed
+ * in the inner target directly.
+ */
+
+#define BAKE_TIER_DEFAULT_CAPACITY      (1024UL * 1024 * 1024)
+#define BAKE_TIER_DEFAULT_FLUSH_THREADS 4
+
+#define BAKE_TIER_WRITE_BACK    0
+#define BAKE_TIER_WRITE_THROUGH 1
+
+typedef struct tier_region {
+    bake_region_id_t rid; /* key */
+    size_t           size;
+    char*            data;
+    hg_bulk_t        bulk;
+    size_t           dirty_start, dirty_end; /* empty if start >= end */
+    int              queued;     /* on the dirty queue */
+    int              dropped;    /* out of the table, freed by last user;
+                                    set with flush_mutex and mutex held */
+    unsigned         refs;       /* users, besides the table */
+    ABT_mutex        mutex;      /* protects the dirty range */
+    ABT_mutex        flush_mutex; /* held for the whole of a flush */
+    struct tier_region *lru_prev, *lru_next; /* most recent first */
+    struct tier_region* dirty_next;
+    UT_hash_handle      hh;
+} tier_region_t;
+
+typedef struct {
+    bake_provider_t   provider;
+    bake_backend_t    inner;
+    backend_context_t inner_context;
+    int               policy;
+    size_t            capacity;
+    unsigned          num_flush_threads;
+    ABT_thread*       flush_threads;
+    int               stopping; /* flush threads must exit */
+    ABT_mutex         conf_mutex;
+    /* the following are protected by mutex */
+    ABT_mutex      mutex;
+    ABT_cond       dirty_cond;
+    tier_region_t* table;
+    tier_region_t *lru_head, *lru_tail;
+    tier_region_t *dirty_head, *dirty_tail;
+    size_t         cached_bytes;
+    /* writes that went to the inner target for lack of a copy: started so
+     * far, and still in progress; a copy read from the inner target in
+     * the meantime may be stale */
+    uint64_t       direct_writes;
+    unsigned       direct_writers;
+    uint64_t       hits, misses, flushes; /* updated atomically */
+} bake_tier_entry_t;
+
+static void lru_unlink(bake_tier_entry_t* entry, tier_region_t* r)
+{
+    if (r->lru_prev)
+        r->lru_prev->lru_next = r->lru_next;
+    else
+        entry->lru_head = r->lru_next;
+    if (r->lru_next)
+        r->lru_next->lru_prev = r->lru_prev;
+    else
+        entry->lru_tail = r->lru_prev;
+}
+
+static void lru_push(bake_tier_entry_t* entry, tier_region_t* r)
+{
+    r->lru_prev = NULL;
+    r->lru_next = entry->lru_head;
+    if (entry->lru_head)
+        entry->lru_head->lru_prev = r;
+    else
+        entry->lru_tail = r;
+    entry->lru_head = r;
+}
+
+static void region_free(tier_region_t* r)
+{
+    margo_bulk_free(r->bulk);
+    ABT_mutex_free(&r->mutex);
+    ABT_mutex_free(&r->flush_mutex);
+    free(r->data);
+    free(r);
+}
+
+static tier_region_t*
+region_alloc(bake_tier_entry_t* entry, bake_region_id_t rid, size_t size)
+{
+    tier_region_t* r = calloc(1, sizeof(*r));
+    hg_size_t      bulk_size = size ? size : 1;
+    hg_return_t    hret;
+
+    if (!r) return NULL;
+    r->data = calloc(1, bulk_size);
+    if (!r->data) {
+        free(r);
+        return NULL;
+    }
+    hret = margo_bulk_create(entry->provider->mid, 1, (void**)&r->data,
+                             &bulk_size, HG_BULK_READWRITE, &r->bulk);
+    if (hret != HG_SUCCESS) {
+        free(r->data);
+        free(r);
+        return NULL;
+    }
+    r->rid  = rid;
+    r->size = size;
+    ABT_mutex_create(&r->mutex);
+    ABT_mutex_create(&r->flush_mutex);
+    return r;
+}
+
+/* makes room for size bytes by dropping clean, unused regions from the
+ * least recently used end; called with entry->mutex held
+ */
+static int make_room(bake_tier_entry_t* entry, size_t size)
+{
+    tier_region_t *r, *prev;
+
+    if (size > entry->capacity / 4) return 0;
+    for (r = entry->lru_tail; r && entry->cached_bytes + size > entry->capacity;
+         r = prev) {
+        prev = r->lru_prev;
+        if (r->refs || r->queued || r->dirty_start < r->dirty_end) continue;
+        lru_unlink(entry, r);
+        HASH_DEL(entry->table, r);
+        entry->cached_bytes -= r->size;
+        region_free(r);
+    }
+    return entry->cached_bytes + size <= entry->capacity;
+}
+
+/* inserts a new copy of a region unless there already is one or there is
+ * no room; returns the copy in the table, with a reference, or NULL.  If
+ * load_gen is not NULL, the copy was read from the inner target when
+ * entry->direct_writes was *load_gen, and is only inserted if no write to
+ * the inner target started since
+ */
+static tier_region_t* region_insert(bake_tier_entry_t* entry,
+                                    tier_region_t*     r,
+                                    const uint64_t*    load_gen)
+{
+    tier_region_t* found = NULL;
+    int            stale;
+
+    ABT_mutex_lock(entry->mutex);
+    stale = load_gen
+         && (entry->direct_writers || entry->direct_writes != *load_gen);
+    HASH_FIND(hh, entry->table, &r->rid, sizeof(r->rid), found);
+    if (!found && !stale && make_room(entry, r->size)) {
+        HASH_ADD(hh, entry->table, rid, sizeof(r->rid), r);
+        lru_push(entry, r);
+        entry->cached_bytes += r->size;
+        found = r;
+        r     = NULL;
+    }
+    if (found) found->refs++;
+    ABT_mutex_unlock(entry->mutex);
+
+    if (r) region_free(r);
+    return found;
+}
+
+/* returns the copy of a region, with a reference, or NULL */
+static tier_region_t* region_get(bake_tier_entry_t* entry,
+                                 bake_region_id_t   rid)
+{
+    tier_region_t* r = NULL;
+
+    ABT_mutex_lock(entry->mutex);
+    HASH_FIND(hh, entry->table, &rid, sizeof(rid), r);
+    if (r) {
+        r->refs++;
+        lru_unlink(entry, r);
+        lru_push(entry, r);
+    }
+    ABT_mutex_unlock(entry->mutex);
+    return r;
+}
+
+/* same as region_get, but if there is no copy, counts a write to the inner
+ * target, which the caller must end with direct_write_done() */
+static tier_region_t* region_get_for_write(bake_tier_entry_t* entry,
+                                           bake_region_id_t   rid)
+{
+    tier_region_t* r = NULL;
+
+    ABT_mutex_lock(entry->mutex);
+    HASH_FIND(hh, entry->table, &rid, sizeof(rid), r);
+    if (r) {
+        r->refs++;
+        lru_unlink(entry, r);
+        lru_push(entry, r);
+    } else {
+        entry->direct_writes++;
+        entry->direct_writers++;
+    }
+    ABT_mutex_unlock(entry->mutex);
+    return r;
+}
+
+static void direct_write_done(bake_tier_entry_t* entry)
+{
+    ABT_mutex_lock(entry->mutex);
+    entry->direct_writers--;
+    ABT_mutex_unlock(entry->mutex);
+}
+
+/* drops a reference; returns non-zero if the caller must free the region,
+ * which was dropped from the table while in use
+ */
+static int region_release(tier_region_t* r)
+{
+    return --r->refs == 0 && r->dropped && !r->queued;
+}
+
+static void region_put(bake_tier_entry_t* entry, tier_region_t* r)
+{
+    int last;
+
+    ABT_mutex_lock(entry->mutex);
+    last = region_release(r);
+    ABT_mutex_unlock(entry->mutex);
+    if (last) region_free(r);
+}
+
+/* reads a region of the inner target into a new copy; no copy is made if
+ * the region is written to in the meantime, since the write goes to the
+ * inner target and may not be in what was read */
+static tier_region_t* region_load(bake_tier_entry_t* entry,
+                                  bake_region_id_t   rid)
+{
+    tier_region_t* r;
+    size_t         size;
+    void*          data;
+    uint64_t       data_size;
+    uint64_t       gen;
+    free_fn        free_data = NULL;
+
+    ABT_mutex_lock(entry->mutex);
+    gen = entry->direct_writes;
+    ABT_mutex_unlock(entry->mutex);
+    if (entry->inner->_get_region_size(entry->inner_context, rid, &size)
+            != BAKE_SUCCESS
+        || size > entry->capacity / 4)
+        return NULL;
+    r = region_alloc(entry, rid, size);
+    if (!r) return NULL;
+    if (entry->inner->_read_raw(entry->inner_context, rid, 0, size, &data,
+                                &data_size, &free_data)
+            != BAKE_SUCCESS
+        || data_size != size) {
+        if (free_data) free_data(data);
+        region_free(r);
+        return NULL;
+    }
+    memcpy(r->data, data, size);
+    if (free_data) free_data(data);
+    return region_insert(entry, r, &gen);
+}
+
+/* writes the dirty range of a region to the inner target and persists it;
+ * called with r->flush_mutex held
+ */
+static int region_flush_locked(bake_tier_entry_t* entry, tier_region_t* r)
+{
+    size_t start, end;
+    int    ret = BAKE_SUCCESS;
+
+    ABT_mutex_lock(r->mutex);
+    start          = r->dirty_start;
+    end            = r->dirty_end;
+    r->dirty_start = r->dirty_end = 0;
+    ABT_mutex_unlock(r->mutex);
+
+    if (start < end) {
+        ret = entry->inner->_write_raw(entry->inner_context, r->rid, start,
+                                       end - start, r->data + start);
+        if (ret == BAKE_SUCCESS)
+            ret = entry->inner->_persist(entry->inner_context, r->rid, start,
+                                         end - start);
+        ABT_mutex_lock(r->mutex);
+        if (ret != BAKE_SUCCESS) {
+            /* keep the range dirty so that it is tried again */
+            if (r->dirty_start >= r->dirty_end) {
+                r->dirty_start = start;
+                r->dirty_end   = end;
+            } else {
+                if (start < r->dirty_start) r->dirty_start = start;
+                if (end > r->dirty_end) r->dirty_end = end;
+            }
+        }
+        ABT_mutex_unlock(r->mutex);
+        __atomic_add_fetch(&entry->flushes, 1, __ATOMIC_RELAXED);
+    }
+    return ret;
+}
+
+/* same as region_flush_locked; does nothing if the copy was dropped, since
+ * its inner region may be gone
+ */
+static int region_flush(bake_tier_entry_t* entry, tier_region_t* r)
+{
+    int ret = BAKE_SUCCESS;
+
+    ABT_mutex_lock(r->flush_mutex);
+    if (!r->dropped) ret = region_flush_locked(entry, r);
+    ABT_mutex_unlock(r->flush_mutex);
+    return ret;
+}
+
+/* drops the copy of a region, after flushing it if flush is set; a flush in
+ * progress completes first, and none starts afterwards, so that the inner
+ * region can be removed once this returns; the copy is kept if the flush
+ * fails
+ */
+static int region_drop(bake_tier_entry_t* entry, bake_region_id_t rid, int flush)
+{
+    tier_region_t* r = region_get(entry, rid);
+    int            ret = BAKE_SUCCESS;
+
+    if (!r) return BAKE_SUCCESS;
+    ABT_mutex_lock(r->flush_mutex);
+    if (flush && !r->dropped) ret = region_flush_locked(entry, r);
+    if (ret == BAKE_SUCCESS) {
+        ABT_mutex_lock(entry->mutex);
+        if (!r->dropped) {
+            HASH_DEL(entry->table, r);
+            lru_unlink(entry, r);
+            entry->cached_bytes -= r->size;
+            /* freed by its last user (possibly us, below) */
+            r->dropped = 1;
+        }
+        ABT_mutex_unlock(entry->mutex);
+    }
+    ABT_mutex_unlock(r->flush_mutex);
+    region_put(entry, r);
+    return ret;
+}
+
+/* records that [start, end) of a region was written */
+static void region_written(bake_tier_entry_t* entry,
+                           tier_region_t*     r,
+                           size_t             start,
+                           size_t             end)
+{
+    ABT_mutex_lock(r->mutex);
+    if (r->dirty_start >= r->dirty_end) {
+        r->dirty_start = start;
+        r->dirty_end   = end;
+    } else {
+        if (start < r->dirty_start) r->dirty_start = start;
+        if (end > r->dirty_end) r->dirty_end = end;
+    }
+    ABT_mutex_unlock(r->mutex);
+
+    ABT_mutex_lock(entry->mutex);
+    if (!r->queued) {
+        r->queued     = 1;
+        r->dirty_next = NULL;
+        if (entry->dirty_tail)
+            entry->dirty_tail->dirty_next = r;
+        else
+            entry->dirty_head = r;
+        entry->dirty_tail = r;
+        ABT_cond_signal(entry->dirty_cond);
+    }
+    ABT_mutex_unlock(entry->mutex);
+}
+
+static void flush_ult(void* arg)
+{
+    bake_tier_entry_t* entry = arg;
+    tier_region_t*     r;
+    int                last;
+
+    ABT_mutex_lock(entry->mutex);
+    for (;;) {
+        while (!entry->dirty_head && !entry->stopping)
+            ABT_cond_wait(entry->dirty_cond, entry->mutex);
+        if (!entry->dirty_head) break;
+
+        r                 = entry->dirty_head;
+        entry->dirty_head = r->dirty_next;
+        if (!entry->dirty_head) entry->dirty_tail = NULL;
+        r->queued = 0;
+        r->refs++;
+        ABT_mutex_unlock(entry->mutex);
+
+        region_flush(entry, r);
+
+        ABT_mutex_lock(entry->mutex);
+        last = region_release(r);
+        if (last) {
+            ABT_mutex_unlock(entry->mutex);
+            region_free(r);
+            ABT_mutex_lock(entry->mutex);
+        }
+    }
+    ABT_mutex_unlock(entry->mutex);
+}
+
+/* stops the flush threads, which flush every queued region first */
+static void stop_flush_threads(bake_tier_entry_t* entry)
+{
+    unsigned i;
+
+    ABT_mutex_lock(entry->mutex);
+    entry->stopping = 1;
+    ABT_cond_broadcast(entry->dirty_cond);
+    ABT_mutex_unlock(entry->mutex);
+    for (i = 0; i < entry->num_flush_threads; i++) {
+        ABT_thread_join(entry->flush_threads[i]);
+        ABT_thread_free(&entry->flush_threads[i]);
+    }
+    free(entry->flush_threads);
+    entry->flush_threads     = NULL;
+    entry->num_flush_threads = 0;
+    entry->stopping          = 0;
+}
+
+static int start_flush_threads(bake_tier_entry_t* entry, unsigned n)
+{
+    unsigned i;
+
+    entry->flush_threads = calloc(n, sizeof(ABT_thread));
+    if (n && !entry->flush_threads) return BAKE_ERR_ALLOCATION;
+    for (i = 0; i < n; i++) {
+        if (ABT_thread_create(entry->provider->handler_pool, flush_ult, entry,
+                              ABT_THREAD_ATTR_NULL, &entry->flush_threads[i])
+            != ABT_SUCCESS)
+            break;
+        entry->num_flush_threads++;
+    }
+    return i == n ? BAKE_SUCCESS : BAKE_ERR_ARGOBOTS;
+}
+
+/* flushes every region now */
+static void flush_all(bake_tier_entry_t* entry)
+{
+    tier_region_t *r, *tmp, **regions;
+    unsigned       i, n = 0;
+
+    ABT_mutex_lock(entry->mutex);
+    regions = malloc(HASH_COUNT(entry->table) * sizeof(*regions) + 1);
+    if (regions) {
+        HASH_ITER(hh, entry->table, r, tmp)
+        {
+            r->refs++;
+            regions[n++] = r;
+        }
+    }
+    ABT_mutex_unlock(entry->mutex);
+
+    for (i = 0; i < n; i++) {
+        region_flush(entry, regions[i]);
+        region_put(entry, regions[i]);
+    }
+    free(regions);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+/* path is the inner target, prefixed with its backend type */
+static int bake_tier_backend_initialize(bake_provider_t    provider,
+                                        const char*        path,
+                                        bake_target_id_t*  target,
+                                        backend_context_t* context)
+{
+    bake_tier_entry_t* new_entry = calloc(1, sizeof(*new_entry));
+    const char*        tmp       = strchr(path, ':');
+    char*              type;
+    int                ret;
+
+    if (!new_entry) return BAKE_ERR_ALLOCATION;
+    type = tmp ? strndup(path, tmp - path) : strdup("pmem");
+    if (tmp) path = tmp + 1;
+    new_entry->inner = bake_backend_lookup(type);
+    free(type);
+    if (!new_entry->inner || new_entry->inner->_initialize == NULL
+        || strcmp(new_entry->inner->name, "tier") == 0) {
+        free(new_entry);
+        return BAKE_ERR_BACKEND_TYPE;
+    }
+
+    ret = new_entry->inner->_initialize(provider, path, target,
+                                        &new_entry->inner_context);
+    if (ret != BAKE_SUCCESS) {
+        free(new_entry);
+        return ret;
+    }
+
+    new_entry->provider = provider;
+    new_entry->policy   = BAKE_TIER_WRITE_BACK;
+    new_entry->capacity = BAKE_TIER_DEFAULT_CAPACITY;
+    ABT_mutex_create(&new_entry->conf_mutex);
+    ABT_mutex_create(&new_entry->mutex);
+    ABT_cond_create(&new_entry->dirty_cond);
+
+    ret = start_flush_threads(new_entry, BAKE_TIER_DEFAULT_FLUSH_THREADS);
+    if (ret != BAKE_SUCCESS) {
+        stop_flush_threads(new_entry);
+        ABT_cond_free(&new_entry->dirty_cond);
+        ABT_mutex_free(&new_entry->mutex);
+        ABT_mutex_free(&new_entry->conf_mutex);
+        new_entry->inner->_finalize(new_entry->inner_context);
+        free(new_entry);
+        return ret;
+    }
+
+    *context = new_entry;
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_tier_backend_finalize(backend_context_t context)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t *    r, *tmp;
+
+    stop_flush_threads(entry);
+    flush_all(entry);
+    HASH_ITER(hh, entry->table, r, tmp)
+    {
+        HASH_DEL(entry->table, r);
+        region_free(r);
+    }
+    ABT_cond_free(&entry->dirty_cond);
+    ABT_mutex_free(&entry->mutex);
+    ABT_mutex_free(&entry->conf_mutex);
+    entry->inner->_finalize(entry->inner_context);
+    free(entry);
+
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int
+bake_tier_create(backend_context_t context, size_t size, bake_region_id_t* rid)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r;
+    int                ret;
+
+    /* the copy is looked up by the whole region id, type included */
+    memset(rid, 0, sizeof(*rid));
+    ret = entry->inner->_create(entry->inner_context, size, rid);
+    if (ret != BAKE_SUCCESS) return ret;
+
+    /* a new region is all zeros, as is a new copy */
+    if (size <= entry->capacity / 4) {
+        r = region_alloc(entry, *rid, size);
+        if (r) r = region_insert(entry, r, NULL);
+        if (r) region_put(entry, r);
+    }
+    return BAKE_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_tier_write_raw(backend_context_t context,
+                               bake_region_id_t  rid,
+                               size_t            offset,
+                               size_t            size,
+                               const void*       data)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r     = region_get_for_write(entry, rid);
+    int                ret   = BAKE_SUCCESS;
+
+    if (!r) {
+        ret = entry->inner->_write_raw(entry->inner_context, rid, offset, size,
+                                       data);
+        direct_write_done(entry);
+        return ret;
+    }
+
+    if (size + offset > r->size) {
+        ret = BAKE_ERR_OUT_OF_BOUNDS;
+        goto finish;
+    }
+    memcpy(r->data + offset, data, size);
+    if (entry->policy == BAKE_TIER_WRITE_THROUGH)
+        ret = entry->inner->_write_raw(entry->inner_context, rid, offset, size,
+                                       data);
+    else
+        region_written(entry, r, offset, offset + size);
+
+finish:
+    region_put(entry, r);
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+static int bake_tier_write_bulk(backend_context_t context,
+                                bake_region_id_t  rid,
+                                size_t            region_offset,
+                                size_t            size,
+                                hg_bulk_t         bulk,
+                                hg_addr_t         source,
+                                size_t            bulk_offset)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r     = region_get_for_write(entry, rid);
+    hg_return_t        hret;
+    int                ret = BAKE_SUCCESS;
+
+    if (!r) {
+        ret = entry->inner->_write_bulk(entry->inner_context, rid,
+                                        region_offset, size, bulk, source,
+                                        bulk_offset);
+        direct_write_done(entry);
+        return ret;
+    }
+
+    if (size + region_offset > r->size) {
+        ret = BAKE_ERR_OUT_OF_BOUNDS;
+        goto finish;
+    }
+    hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PULL, source,
+                              bulk, bulk_offset, r->bulk, region_offset, size);
+    if (hret != HG_SUCCESS) {
+        ret = BAKE_ERR_MERCURY;
+        goto finish;
+    }
+    if (entry->policy == BAKE_TIER_WRITE_THROUGH)
+        ret = entry->inner->_write_raw(entry->inner_context, rid,
+                                       region_offset, size,
+                                       r->data + region_offset);
+    else
+        region_written(entry, r, region_offset, region_offset + size);
+
+finish:
+    region_put(entry, r);
+    return ret;
+}
+
+static int bake_tier_read_raw(backend_context_t context,
+                              bake_region_id_t  rid,
+                              size_t            offset,
+                              size_t            size,
+                              void**            data,
+                              uint64_t*         data_size,
+                              free_fn*          free_data)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r     = region_get(entry, rid);
+    int                ret   = BAKE_SUCCESS;
+
+    __atomic_add_fetch(r ? &entry->hits : &entry->misses, 1, __ATOMIC_RELAXED);
+    if (!r) r = region_load(entry, rid);
+    if (!r)
+        return entry->inner->_read_raw(entry->inner_context, rid, offset, size,
+                                       data, data_size, free_data);
+
+    *free_data = NULL;
+    *data      = NULL;
+    *data_size = 0;
+
+    if (offset > r->size) {
+        ret = BAKE_ERR_OUT_OF_BOUNDS;
+        goto finish;
+    }
+    if (offset + size > r->size) size = r->size - offset;
+
+    /* the copy may be dropped before the response is sent */
+    *data = malloc(size ? size : 1);
+    if (!*data) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto finish;
+    }
+    memcpy(*data, r->data + offset, size);
+    *data_size = size;
+    *free_data = free;
+
+finish:
+    region_put(entry, r);
+    return ret;
+}
+
+static int bake_tier_read_bulk(backend_context_t context,
+                               bake_region_id_t  rid,
+                               size_t            region_offset,
+                               size_t            size,
+                               hg_bulk_t         bulk,
+                               hg_addr_t         source,
+                               size_t            bulk_offset,
+                               size_t*           bytes_read)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r     = region_get(entry, rid);
+    hg_return_t        hret;
+    int                ret = BAKE_SUCCESS;
+
+    __atomic_add_fetch(r ? &entry->hits : &entry->misses, 1, __ATOMIC_RELAXED);
+    if (!r) r = region_load(entry, rid);
+    if (!r)
+        return entry->inner->_read_bulk(entry->inner_context, rid,
+                                        region_offset, size, bulk, source,
+                                        bulk_offset, bytes_read);
+
+    *bytes_read = 0;
+
+    if (region_offset > r->size) {
+        ret = BAKE_ERR_OUT_OF_BOUNDS;
+        goto finish;
+    }
+    if (region_offset + size > r->size) size = r->size - region_offset;
+
+    hret = bake_bulk_transfer(entry->provider->mid, HG_BULK_PUSH, source,
+                              bulk, bulk_offset, r->bulk, region_offset, size);
+    if (hret != HG_SUCCESS) {
+        ret = BAKE_ERR_MERCURY;
+        goto finish;
+    }
+    *bytes_read = size;
+
+finish:
+    region_put(entry, r);
+    return ret;
+}
+
+static int bake_tier_persist(backend_context_t context,
+                             bake_region_id_t  rid,
+                             size_t            offset,
+                             size_t            size)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r;
+    int                ret;
+
+    /* waits for a flush thread working on the region, if any */
+    r = region_get(entry, rid);
+    if (r) {
+        ret = region_flush(entry, r);
+        region_put(entry, r);
+        if (ret != BAKE_SUCCESS) return ret;
+    }
+    return entry->inner->_persist(entry->inner_context, rid, offset, size);
+}
+
+static int bake_tier_get_region_size(backend_context_t context,
+                                     bake_region_id_t  rid,
+                                     size_t*           size)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r     = region_get(entry, rid);
+
+    if (!r)
+        return entry->inner->_get_region_size(entry->inner_context, rid, size);
+    *size = r->size;
+    region_put(entry, r);
+    return BAKE_SUCCESS;
+}
+
+static int bake_tier_get_region_data(backend_context_t context,
+                                     bake_region_id_t  rid,
+                                     void**            data)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    int                ret;
+
+    /* the data may be modified in place, so the copy has to go */
+    ret = region_drop(entry, rid, 1);
+    if (ret != BAKE_SUCCESS) return ret;
+    return entry->inner->_get_region_data(entry->inner_context, rid, data);
+}
+
+static int bake_tier_remove(backend_context_t context, bake_region_id_t rid)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+
+    region_drop(entry, rid, 0);
+    return entry->inner->_remove(entry->inner_context, rid);
+}
+
+static int bake_tier_migrate_region(backend_context_t context,
+                                    bake_region_id_t  source_rid,
+                                    size_t            region_size,
+                                    int               remove_source,
+                                    const char*       dest_addr_str,
+                                    uint16_t          dest_provider_id,
+                                    bake_target_id_t  dest_target_id,
+                                    bake_region_id_t* dest_rid)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    tier_region_t*     r;
+    int                ret;
+
+    /* the source may be removed by the inner migration, so its copy is
+     * dropped (once flushed) beforehand */
+    if (remove_source) {
+        ret = region_drop(entry, source_rid, 1);
+        if (ret != BAKE_SUCCESS) return ret;
+    } else if ((r = region_get(entry, source_rid)) != NULL) {
+        ret = region_flush(entry, r);
+        region_put(entry, r);
+        if (ret != BAKE_SUCCESS) return ret;
+    }
+    return entry->inner->_migrate_region(
+        entry->inner_context, source_rid, region_size, remove_source,
+        dest_addr_str, dest_provider_id, dest_target_id, dest_rid);
+}
+
+#ifdef USE_REMI
+static int bake_tier_create_fileset(backend_context_t context,
+                                    remi_fileset_t*   fileset)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+
+    if (!entry->inner->_create_fileset) return BAKE_ERR_OP_UNSUPPORTED;
+    flush_all(entry);
+    return entry->inner->_create_fileset(entry->inner_context, fileset);
+}
+#endif
+
+static int bake_tier_set_conf(backend_context_t context,
+                              const char*       key,
+                              const char*       value)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    unsigned           n;
+    int                ret;
+
+    if (strcmp(key, "tier_policy") == 0) {
+        if (strcmp(value, "write-back") == 0)
+            entry->policy = BAKE_TIER_WRITE_BACK;
+        else if (strcmp(value, "write-through") == 0) {
+            entry->policy = BAKE_TIER_WRITE_THROUGH;
+            /* nothing is left dirty once the policy changes */
+            flush_all(entry);
+        } else
+            return BAKE_ERR_INVALID_ARG;
+        return BAKE_SUCCESS;
+    }
+    if (strcmp(key, "tier_capacity") == 0) {
+        size_t capacity;
+        if (sscanf(value, "%zu", &capacity) != 1) return BAKE_ERR_INVALID_ARG;
+        ABT_mutex_lock(entry->mutex);
+        entry->capacity = capacity;
+        make_room(entry, 0);
+        ABT_mutex_unlock(entry->mutex);
+        return BAKE_SUCCESS;
+    }
+    if (strcmp(key, "tier_flush_threads") == 0) {
+        if (sscanf(value, "%u", &n) != 1 || n == 0)
+            return BAKE_ERR_INVALID_ARG;
+        ABT_mutex_lock(entry->conf_mutex);
+        stop_flush_threads(entry);
+        ret = start_flush_threads(entry, n);
+        ABT_mutex_unlock(entry->conf_mutex);
+        return ret;
+    }
+    if (!entry->inner->_set_conf) return BAKE_ERR_OP_UNSUPPORTED;
+    return entry->inner->_set_conf(entry->inner_context, key, value);
+}
+
+static int bake_tier_get_stats(backend_context_t context, FILE* out)
+{
+    bake_tier_entry_t* entry = (bake_tier_entry_t*)context;
+    char *             buf   = NULL, *line, *saveptr;
+    size_t             size  = 0;
+    FILE*              inner_out;
+
+    ABT_mutex_lock(entry->mutex);
+    fprintf(out, "tier_policy = %s\n",
+            entry->policy == BAKE_TIER_WRITE_BACK ? "write-back"
+                                                  : "write-through");
+    fprintf(out, "tier_capacity = %zu\n", entry->capacity);
+    fprintf(out, "tier_flush_threads = %u\n", entry->num_flush_threads);
+    fprintf(out, "tier.cached_regions = %u\n", HASH_COUNT(entry->table));
+    fprintf(out, "tier.cached_bytes = %zu\n", entry->cached_bytes);
+    ABT_mutex_unlock(entry->mutex);
+    fprintf(out, "tier.read_hits = %" PRIu64 "\n",
+            __atomic_load_n(&entry->hits, __ATOMIC_RELAXED));
+    fprintf(out, "tier.read_misses = %" PRIu64 "\n",
+            __atomic_load_n(&entry->misses, __ATOMIC_RELAXED));
+    fprintf(out, "tier.flushes = %" PRIu64 "\n",
+            __atomic_load_n(&entry->flushes, __ATOMIC_RELAXED));
+
+    /* the inner target's statistics, prefixed with "inner." */
+    if (!entry->inner->_get_stats) return BAKE_SUCCESS;
+    inner_out = open_memstream(&buf, &size);
+    if (!inner_out) return BAKE_ERR_ALLOCATION;
+    entry->inner->_get_stats(entry->inner_context, inner_out);
+    fclose(inner_out);
+    for (line = strtok_r(buf, "\n", &saveptr); line;
+         line = strtok_r(NULL, "\n", &saveptr))
+        fprintf(out, "inner.%s\n", line);
+    free(buf);
+    return BAKE_SUCCESS;
+}
+
+bake_backend g_bake_tier_backend
+    = {.name                       = "tier",
+       ._initialize                = bake_tier_backend_initialize,
+       ._finalize                  = bake_tier_backend_finalize,
+       ._create                    = bake_tier_create,
+       ._write_raw                 = bake_tier_write_raw,
+       ._write_bulk                = bake_tier_write_bulk,
+       ._read_raw                  = bake_tier_read_raw,
+       ._read_bulk                 = bake_tier_read_bulk,
+       ._persist                   = bake_tier_persist,
+       ._create_write_persist_raw  = NULL, /* use default implementation */
+       ._create_write_persist_bulk = NULL, /* use default implementation */
+       ._get_region_size           = bake_tier_get_region_size,
+       ._get_region_data           = bake_tier_get_region_data,
+       ._remove                    = bake_tier_remove,
+       ._migrate_region            = bake_tier_migrate_region,
+#ifdef USE_REMI
+       ._create_fileset = bake_tier_create_fileset,
+#endif
+       ._set_conf  = bake_tier_set_conf,
+       ._get_stats = bake_tier_get_stats};
@@ -0,0 +1,868 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bake.h"
+#include "bake-tiering.h"
+#include "uthash.h"
+
+/* bound on the number of ids tried before giving up on creating a region
+ * whose id does not shadow a forwarding entry */
+#define BAKE_TIERING_CREATE_ATTEMPTS 16
+
+/* heat records of regions colder than this on the slow target are dropped */
+#define BAKE_TIERING_FORGET_SCORE 0.01
+
+/* marks every journal record, so that a torn last record is recognized */
+#define BAKE_TIERING_JOURNAL_MAGIC 0x6b62746aU
+
+#define JOURNAL_FORWARD 1
+#define JOURNAL_FORGET  2
+
+typedef struct {
+    bake_target_id_t tid;
+    bake_region_id_t rid;
+} region_key_t;
+
+/* heat of a region, keyed by its current location */
+typedef struct {
+    region_key_t   key;
+    region_key_t   origin; /* id known by the client */
+    double         score;  /* decayed number of accesses at last_update */
+    double         last_update;
+    uint64_t       size;   /* largest size created or written, 0 if unknown */
+    uint64_t       writes; /* tells a move whether the region changed */
+    UT_hash_handle hh;
+} heat_record_t;
+
+/* where a region known by the client as key now lives */
+typedef struct {
+    region_key_t   key;
+    region_key_t   dest;
+    UT_hash_handle hh;
+} forward_entry_t;
+
+/* one entry of the forwarding journal; dest is unused by JOURNAL_FORGET */
+typedef struct {
+    uint32_t     magic;
+    uint32_t     type;
+    region_key_t key;
+    region_key_t dest;
+} journal_record_t;
+
+/* a region picked by the policy, copied out of the table */
+typedef struct {
+    region_key_t key;
+    double       score;
+} candidate_t;
+
+struct bake_tiering {
+    bake_provider_t  provider;
+    ABT_mutex        mutex; /* protects everything below */
+    ABT_cond         cond;  /* wakes up the policy ULT */
+    ABT_thread       policy_thread;
+    int              enabled;
+    int              stopping;
+    int              fast_set, slow_set; /* otherwise picked by backend */
+    bake_target_id_t fast_tid, slow_tid;
+    unsigned         period_ms;
+    unsigned         half_life_ms;
+    size_t           bandwidth; /* bytes per second, 0 for unlimited */
+    double           promote_threshold;
+    double           demote_threshold;
+    heat_record_t*   records;
+    forward_entry_t* forwards;
+    int              journal_fd; /* forwarding journal, -1 if not set */
+    uint64_t         accesses;
+    uint64_t         promotions, demotions;
+    uint64_t         bytes_moved;
+    uint64_t         failed_moves;
+    uint64_t         rounds;
+    int              size_warned; /* a backend could not report a size */
+};
+
+static void make_key(region_key_t*           key,
+                     const bake_target_id_t* tid,
+                     const bake_region_id_t* rid)
+{
+    memset(key, 0, sizeof(*key));
+    key->tid = *tid;
+    key->rid = *rid;
+}
+
+/* 2^(-dt/half_life), halving once per elapsed half-life and interpolating
+ * linearly within the last one so as not to depend on libm */
+static double decay_factor(double dt, double half_life)
+{
+    double x = dt / half_life, f = 1.0;
+
+    if (dt <= 0.0) return 1.0;
+    if (x >= 64.0) return 0.0;
+    while (x >= 1.0) {
+        f *= 0.5;
+        x -= 1.0;
+    }
+    return f * (1.0 - x / 2.0);
+}
+
+/* brings a record's score up to now; called with the mutex held */
+static double decay(bake_tiering_t t, heat_record_t* r, double now)
+{
+    r->score *= decay_factor(now - r->last_update, t->half_life_ms / 1000.0);
+    r->last_update = now;
+    return r->score;
+}
+
+int bake_tiering_create(bake_provider_t provider, bake_tiering_t* tiering)
+{
+    bake_tiering_t t = calloc(1, sizeof(*t));
+    if (!t) return BAKE_ERR_ALLOCATION;
+
+    t->provider          = provider;
+    t->policy_thread     = ABT_THREAD_NULL;
+    t->journal_fd        = -1;
+    t->period_ms         = BAKE_TIERING_DEFAULT_PERIOD_MS;
+    t->half_life_ms      = BAKE_TIERING_DEFAULT_HALF_LIFE_MS;
+    t->bandwidth         = BAKE_TIERING_DEFAULT_BANDWIDTH;
+    t->promote_threshold = BAKE_TIERING_DEFAULT_PROMOTE_THRESHOLD;
+    t->demote_threshold  = BAKE_TIERING_DEFAULT_DEMOTE_THRESHOLD;
+    if (ABT_mutex_create(&t->mutex) != ABT_SUCCESS) {
+        free(t);
+        return BAKE_ERR_ARGOBOTS;
+    }
+    if (ABT_cond_create(&t->cond) != ABT_SUCCESS) {
+        ABT_mutex_free(&t->mutex);
+        free(t);
+        return BAKE_ERR_ARGOBOTS;
+    }
+    *tiering = t;
+    return BAKE_SUCCESS;
+}
+
+static void stop_policy_thread(bake_tiering_t t)
+{
+    if (t->policy_thread == ABT_THREAD_NULL) return;
+    ABT_mutex_lock(t->mutex);
+    t->stopping = 1;
+    ABT_cond_signal(t->cond);
+    ABT_mutex_unlock(t->mutex);
+    ABT_thread_join(t->policy_thread);
+    ABT_thread_free(&t->policy_thread);
+    t->policy_thread = ABT_THREAD_NULL;
+    t->stopping      = 0;
+}
+
+void bake_tiering_destroy(bake_tiering_t t)
+{
+    heat_record_t *  r, *rtmp;
+    forward_entry_t *f, *ftmp;
+
+    if (!t) return;
+    stop_policy_thread(t);
+    HASH_ITER(hh, t->records, r, rtmp)
+    {
+        HASH_DEL(t->records, r);
+        free(r);
+    }
+    HASH_ITER(hh, t->forwards, f, ftmp)
+    {
+        HASH_DEL(t->forwards, f);
+        free(f);
+    }
+    if (t->journal_fd >= 0) close(t->journal_fd);
+    ABT_cond_free(&t->cond);
+    ABT_mutex_free(&t->mutex);
+    free(t);
+}
+
+/* appends a record to the journal and waits for it to be durable; called
+ * with the mutex held */
+static int journal_append(bake_tiering_t      t,
+                          uint32_t            type,
+                          const region_key_t* key,
+                          const region_key_t* dest)
+{
+    journal_record_t rec;
+
+    if (t->journal_fd < 0) return BAKE_SUCCESS;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = BAKE_TIERING_JOURNAL_MAGIC;
+    rec.type  = type;
+    rec.key   = *key;
+    if (dest) rec.dest = *dest;
+    if (write(t->journal_fd, &rec, sizeof(rec)) != sizeof(rec)) {
+        perror("bake-tiering journal write");
+        return BAKE_ERR_IO;
+    }
+    if (fdatasync(t->journal_fd) != 0) {
+        perror("bake-tiering journal fdatasync");
+        return BAKE_ERR_IO;
+    }
+    return BAKE_SUCCESS;
+}
+
+/* replays a journal into the forwarding table, stopping at the first record
+ * that is torn or was never completely written */
+static int journal_replay(bake_tiering_t t, const char* path)
+{
+    journal_record_t rec;
+    forward_entry_t* f;
+    FILE*            in = fopen(path, "r");
+
+    if (!in) return errno == ENOENT ? BAKE_SUCCESS : BAKE_ERR_IO;
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        if (rec.magic != BAKE_TIERING_JOURNAL_MAGIC) break;
+        f = NULL;
+        HASH_FIND(hh, t->forwards, &rec.key, sizeof(region_key_t), f);
+        if (rec.type == JOURNAL_FORWARD) {
+            if (!f) {
+                f = calloc(1, sizeof(*f));
+                if (!f) {
+                    fclose(in);
+                    return BAKE_ERR_ALLOCATION;
+                }
+                f->key = rec.key;
+                HASH_ADD(hh, t->forwards, key, sizeof(region_key_t), f);
+            }
+            f->dest = rec.dest;
+        } else if (rec.type == JOURNAL_FORGET && f) {
+            HASH_DEL(t->forwards, f);
+            free(f);
+        }
+    }
+    fclose(in);
+    return BAKE_SUCCESS;
+}
+
+/* loads the forwarding entries of a journal, then replaces it with one
+ * that only holds the live entries and opens it for appending; called with
+ * the mutex held */
+static int journal_open(bake_tiering_t t, const char* path)
+{
+    forward_entry_t *f, *ftmp;
+    journal_record_t rec;
+    char*            tmp_path = NULL;
+    int              fd       = -1;
+    int              ret;
+
+    ret = journal_replay(t, path);
+    if (ret != BAKE_SUCCESS) goto error;
+
+    ret      = BAKE_ERR_IO;
+    tmp_path = malloc(strlen(path) + 5);
+    if (!tmp_path) {
+        ret = BAKE_ERR_ALLOCATION;
+        goto error;
+    }
+    sprintf(tmp_path, "%s.tmp", path);
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) goto error;
+    HASH_ITER(hh, t->forwards, f, ftmp)
+    {
+        memset(&rec, 0, sizeof(rec));
+        rec.magic = BAKE_TIERING_JOURNAL_MAGIC;
+        rec.type  = JOURNAL_FORWARD;
+        rec.key   = f->key;
+        rec.dest  = f->dest;
+        if (write(fd, &rec, sizeof(rec)) != sizeof(rec)) goto error;
+    }
+    if (fdatasync(fd) != 0) goto error;
+    close(fd);
+    fd = -1;
+    if (rename(tmp_path, path) != 0) goto error;
+    free(tmp_path);
+    tmp_path = NULL;
+
+    t->journal_fd = open(path, O_WRONLY | O_APPEND);
+    if (t->journal_fd < 0) goto error;
+    return BAKE_SUCCESS;
+
+error:
+    if (ret == BAKE_ERR_IO) perror("bake-tiering journal");
+    if (fd >= 0) close(fd);
+    if (tmp_path) {
+        unlink(tmp_path);
+        free(tmp_path);
+    }
+    HASH_ITER(hh, t->forwards, f, ftmp)
+    {
+        HASH_DEL(t->forwards, f);
+        free(f);
+    }
+    return ret;
+}
+
+int bake_tiering_resolve(bake_tiering_t    t,
+                         bake_target_id_t* tid,
+                         bake_region_id_t* rid)
+{
+    region_key_t     key;
+    forward_entry_t* f = NULL;
+
+    make_key(&key, tid, rid);
+    ABT_mutex_lock(t->mutex);
+    if (t->forwards) HASH_FIND(hh, t->forwards, &key, sizeof(key), f);
+    if (f) {
+        *tid = f->dest.tid;
+        *rid = f->dest.rid;
+    }
+    ABT_mutex_unlock(t->mutex);
+    return f != NULL;
+}
+
+void bake_tiering_record_access(bake_tiering_t          t,
+                                const bake_target_id_t* origin_tid,
+                                const bake_region_id_t* origin_rid,
+                                const bake_target_id_t* tid,
+                                const bake_region_id_t* rid,
+                                uint64_t                write_end)
+{
+    region_key_t   key;
+    heat_record_t* r = NULL;
+    double         now;
+
+    if (!t->enabled) return;
+    make_key(&key, tid, rid);
+    now = ABT_get_wtime();
+
+    ABT_mutex_lock(t->mutex);
+    HASH_FIND(hh, t->records, &key, sizeof(key), r);
+    if (!r) {
+        r = calloc(1, sizeof(*r));
+        if (!r) goto finish;
+        r->key = key;
+        make_key(&r->origin, origin_tid, origin_rid);
+        r->last_update = now;
+        HASH_ADD(hh, t->records, key, sizeof(region_key_t), r);
+    }
+    decay(t, r, now);
+    r->score += 1.0;
+    if (write_end) {
+        if (write_end > r->size) r->size = write_end;
+        r->writes++;
+    }
+    t->accesses++;
+finish:
+    ABT_mutex_unlock(t->mutex);
+}
+
+void bake_tiering_forget(bake_tiering_t          t,
+                         const bake_target_id_t* origin_tid,
+                         const bake_region_id_t* origin_rid)
+{
+    region_key_t     key;
+    forward_entry_t* f = NULL;
+    heat_record_t*   r = NULL;
+
+    make_key(&key, origin_tid, origin_rid);
+    ABT_mutex_lock(t->mutex);
+    HASH_FIND(hh, t->forwards, &key, sizeof(key), f);
+    if (f) {
+        /* if this does not make it to the journal, the id comes back
+         * after a restart, dangling like any removed region id */
+        journal_append(t, JOURNAL_FORGET, &f->key, NULL);
+        HASH_DEL(t->forwards, f);
+        key = f->dest;
+        free(f);
+    }
+    HASH_FIND(hh, t->records, &key, sizeof(key), r);
+    if (r) {
+        HASH_DEL(t->records, r);
+        free(r);
+    }
+    ABT_mutex_unlock(t->mutex);
+}
+
+int bake_tiering_has_forwards(bake_tiering_t t)
+{
+    int ret;
+    ABT_mutex_lock(t->mutex);
+    ret = t->forwards != NULL;
+    ABT_mutex_unlock(t->mutex);
+    return ret;
+}
+
+static int is_forwarded(bake_tiering_t          t,
+                        const bake_target_id_t* tid,
+                        const bake_region_id_t* rid)
+{
+    region_key_t     key;
+    forward_entry_t* f = NULL;
+
+    make_key(&key, tid, rid);
+    ABT_mutex_lock(t->mutex);
+    HASH_FIND(hh, t->forwards, &key, sizeof(key), f);
+    ABT_mutex_unlock(t->mutex);
+    return f != NULL;
+}
+
+int bake_tiering_create_region(bake_tiering_t    t,
+                               bake_target_t*    target,
+                               size_t            size,
+                               bake_region_id_t* rid)
+{
+    bake_region_id_t shadowing[BAKE_TIERING_CREATE_ATTEMPTS];
+    unsigned         i, n = 0;
+    int              ret;
+
+    /* a region moved away from this target may have left behind an id
+     * that the backend hands out again; keep such ids allocated until we
+     * get one that no client knows, then give them back */
+    for (;;) {
+        memset(rid, 0, sizeof(*rid));
+        ret = target->backend->_create(target->context, size, rid);
+        if (ret != BAKE_SUCCESS) break;
+        if (!is_forwarded(t, &target->target_id, rid)) break;
+        if (n == BAKE_TIERING_CREATE_ATTEMPTS) {
+            target->backend->_remove(target->context, *rid);
+            ret = BAKE_ERR_ALLOCATION;
+            break;
+        }
+        shadowing[n++] = *rid;
+    }
+    for (i = 0; i < n; i++)
+        target->backend->_remove(target->context, shadowing[i]);
+    return ret;
+}
+
+/* returns the target to move regions to or from, as configured or else the
+ * first target of the given backend; called with the provider and the
+ * mutex locked */
+static bake_target_t* pick_target(bake_tiering_t          t,
+                                  int                     set,
+                                  const bake_target_id_t* tid,
+                                  const char*             backend_name)
+{
+    bake_target_t *p, *tmp, *found = NULL;
+
+    if (set) {
+        HASH_FIND(hh, t->provider->targets, tid, sizeof(bake_target_id_t),
+                  found);
+        return found;
+    }
+    HASH_ITER(hh, t->provider->targets, p, tmp)
+    {
+        if (strcmp(p->backend->name, backend_name) == 0) return p;
+    }
+    return NULL;
+}
+
+/* looks up the targets of a move and the heat record of the region, which
+ * may have been removed since it was picked; called with the provider
+ * locked */
+static int find_move(bake_tiering_t          t,
+                     const region_key_t*     from,
+                     const bake_target_id_t* dest_tid,
+                     bake_target_t**         src,
+                     bake_target_t**         dest,
+                     heat_record_t**         r)
+{
+    bake_provider_t provider = t->provider;
+
+    *src  = NULL;
+    *dest = NULL;
+    *r    = NULL;
+    HASH_FIND(hh, provider->targets, dest_tid, sizeof(bake_target_id_t),
+              *dest);
+    HASH_FIND(hh, provider->targets, &from->tid, sizeof(bake_target_id_t),
+              *src);
+    if (!*src || !*dest) return BAKE_ERR_UNKNOWN_TARGET;
+    HASH_FIND(hh, t->records, from, sizeof(*from), *r);
+    return BAKE_SUCCESS;
+}
+
+/* moves a region to another target and points its forwarding entry at the
+ * new location, unless it is larger than a non-zero budget; the number of
+ * bytes moved is returned in moved.  The copy is made with the provider
+ * read-locked so that requests keep flowing; the write lock is only taken
+ * to snapshot the region and to switch it over, and the copy is dropped if
+ * the region was written or removed in between. */
+static int move_region(bake_tiering_t          t,
+                       const region_key_t*     from,
+                       const bake_target_id_t* dest_tid,
+                       int                     promote,
+                       size_t                  budget,
+                       size_t*                 moved)
+{
+    bake_provider_t  provider = t->provider;
+    bake_target_t *  src = NULL, *dest = NULL;
+    heat_record_t*   r = NULL;
+    forward_entry_t *f = NULL, *new_f = NULL;
+    region_key_t     dest_key;
+    bake_region_id_t new_rid;
+    int              copied = 0;
+    uint64_t         size = 0, writes = 0;
+    void*            data      = NULL;
+    uint64_t         data_size = 0;
+    free_fn          free_data = NULL;
+    char             tid_str[37];
+    int              ret;
+
+    *moved = 0;
+    /* no write may be in flight on the region when its writes are counted */
+    ABT_rwlock_wrlock(provider->lock);
+    ABT_mutex_lock(t->mutex);
+    ret = find_move(t, from, dest_tid, &src, &dest, &r);
+    if (r) {
+        size   = r->size;
+        writes = r->writes;
+    }
+    ABT_mutex_unlock(t->mutex);
+    ABT_rwlock_unlock(provider->lock);
+    if (ret != BAKE_SUCCESS || !r || src == dest) goto finish;
+
+    ABT_rwlock_rdlock(provider->lock);
+    ABT_mutex_lock(t->mutex);
+    ret = find_move(t, from, dest_tid, &src, &dest, &r);
+    ABT_mutex_unlock(t->mutex);
+    if (ret != BAKE_SUCCESS || !r) goto unlock;
+
+    if (size == 0) {
+        /* the region was created before tiering was enabled */
+        ret = src->backend->_get_region_size(src->context, from->rid, &size);
+        if (ret != BAKE_SUCCESS) {
+            ABT_mutex_lock(t->mutex);
+            if (!t->size_warned) {
+                bake_target_id_to_string(from->tid, tid_str,
+                                         sizeof(tid_str));
+                fprintf(stderr,
+                        "WARNING: bake-tiering cannot get the size of "
+                        "regions of target %s; only regions created or "
+                        "written while tiering is enabled can move\n",
+                        tid_str);
+                t->size_warned = 1;
+            }
+            ABT_mutex_unlock(t->mutex);
+            goto unlock;
+        }
+    }
+    if (budget && size > budget) goto unlock;
+
+    ret = src->backend->_read_raw(src->context, from->rid, 0, size, &data,
+                                  &data_size, &free_data);
+    if (ret != BAKE_SUCCESS) goto unlock;
+    if (data_size != size) {
+        ret = BAKE_ERR_OUT_OF_BOUNDS;
+        goto unlock;
+    }
+
+    ret = bake_tiering_create_region(t, dest, size, &new_rid);
+    if (ret != BAKE_SUCCESS) goto unlock;
+    ret = dest->backend->_write_raw(dest->context, new_rid, 0, size, data);
+    if (ret == BAKE_SUCCESS)
+        ret = dest->backend->_persist(dest->context, new_rid, 0, size);
+    if (ret != BAKE_SUCCESS)
+        dest->backend->_remove(dest->context, new_rid);
+    else
+        copied = 1;
+
+unlock:
+    ABT_rwlock_unlock(provider->lock);
+    if (free_data) free_data(data);
+    if (!copied) goto finish;
+
+    /* switch over, unless the region changed while it was being copied */
+    ABT_rwlock_wrlock(provider->lock);
+    ABT_mutex_lock(t->mutex);
+    ret = find_move(t, from, dest_tid, &src, &dest, &r);
+    if (ret != BAKE_SUCCESS || !r || r->writes != writes) {
+        ABT_mutex_unlock(t->mutex);
+        if (dest) dest->backend->_remove(dest->context, new_rid);
+        ABT_rwlock_unlock(provider->lock);
+        goto finish;
+    }
+    /* the forwarding entry must be durable before the source goes away,
+     * or the client's id would dangle after a restart */
+    make_key(&dest_key, &dest->target_id, &new_rid);
+    HASH_FIND(hh, t->forwards, &r->origin, sizeof(region_key_t), f);
+    if (!f) {
+        new_f = calloc(1, sizeof(*new_f));
+        if (!new_f) ret = BAKE_ERR_ALLOCATION;
+    }
+    if (ret == BAKE_SUCCESS)
+        ret = journal_append(t, JOURNAL_FORWARD, &r->origin, &dest_key);
+    if (ret != BAKE_SUCCESS) {
+        ABT_mutex_unlock(t->mutex);
+        free(new_f);
+        dest->backend->_remove(dest->context, new_rid);
+        ABT_rwlock_unlock(provider->lock);
+        goto finish;
+    }
+    if (new_f) {
+        f      = new_f;
+        f->key = r->origin;
+        HASH_ADD(hh, t->forwards, key, sizeof(region_key_t), f);
+    }
+    f->dest = dest_key;
+    /* rekey the heat record */
+    HASH_DEL(t->records, r);
+    r->key  = dest_key;
+    r->size = size;
+    HASH_ADD(hh, t->records, key, sizeof(region_key_t), r);
+    if (promote)
+        t->promotions++;
+    else
+        t->demotions++;
+    t->bytes_moved += size;
+    ABT_mutex_unlock(t->mutex);
+    src->backend->_remove(src->context, from->rid);
+    ABT_rwlock_unlock(provider->lock);
+    *moved = size;
+
+finish:
+    if (ret != BAKE_SUCCESS) {
+        ABT_mutex_lock(t->mutex);
+        t->failed_moves++;
+        ABT_mutex_unlock(t->mutex);
+    }
+    return ret;
+}
+
+static int hotter_first(const void* a, const void* b)
+{
+    double sa = ((const candidate_t*)a)->score;
+    double sb = ((const candidate_t*)b)->score;
+    return sa < sb ? 1 : (sa > sb ? -1 : 0);
+}
+
+static int colder_first(const void* a, const void* b)
+{
+    return hotter_first(b, a);
+}
+
+/* one round of the policy: decay every score, then demote the coldest
+ * regions of the fast target and promote the hottest regions of the slow
+ * target within the bandwidth budget of one period */
+static void policy_round(bake_tiering_t t)
+{
+    bake_provider_t  provider = t->provider;
+    bake_target_t *  fast, *slow;
+    bake_target_id_t fast_tid, slow_tid;
+    heat_record_t *  r, *tmp;
+    candidate_t *    promote = NULL, *demote = NULL;
+    unsigned         i, np = 0, nd = 0, count;
+    size_t           budget, moved;
+    int              unlimited;
+    double           now = ABT_get_wtime();
+
+    ABT_rwlock_rdlock(provider->lock);
+    ABT_mutex_lock(t->mutex);
+    fast = pick_target(t, t->fast_set, &t->fast_tid, "pmem");
+    slow = pick_target(t, t->slow_set, &t->slow_tid, "file");
+    ABT_mutex_unlock(t->mutex);
+    if (fast) fast_tid = fast->target_id;
+    if (slow) slow_tid = slow->target_id;
+    ABT_rwlock_unlock(provider->lock);
+    if (!fast || !slow || fast == slow) return;
+
+    ABT_mutex_lock(t->mutex);
+    t->rounds++;
+    count   = HASH_COUNT(t->records);
+    promote = malloc(count * sizeof(*promote) + 1);
+    demote  = malloc(count * sizeof(*demote) + 1);
+    if (!promote || !demote) {
+        ABT_mutex_unlock(t->mutex);
+        goto finish;
+    }
+    HASH_ITER(hh, t->records, r, tmp)
+    {
+        double score = decay(t, r, now);
+        int    on_fast
+            = memcmp(&r->key.tid, &fast_tid, sizeof(bake_target_id_t)) == 0;
+        int on_slow
+            = memcmp(&r->key.tid, &slow_tid, sizeof(bake_target_id_t)) == 0;
+
+        if (on_fast && score <= t->demote_threshold) {
+            demote[nd].key     = r->key;
+            demote[nd++].score = score;
+        } else if (on_slow && score >= t->promote_threshold) {
+            promote[np].key     = r->key;
+            promote[np++].score = score;
+        } else if (!on_fast && score < BAKE_TIERING_FORGET_SCORE
+                   && memcmp(&r->key, &r->origin, sizeof(region_key_t))
+                          == 0) {
+            /* never moved and cold: nothing to remember */
+            HASH_DEL(t->records, r);
+            free(r);
+        }
+    }
+    unlimited = t->bandwidth == 0;
+    budget    = (size_t)((double)t->bandwidth * t->period_ms / 1000.0);
+    ABT_mutex_unlock(t->mutex);
+
+    /* make room on the fast target before filling it */
+    qsort(demote, nd, sizeof(*demote), colder_first);
+    for (i = 0; i < nd && (unlimited || budget > 0); i++) {
+        move_region(t, &demote[i].key, &slow_tid, 0, unlimited ? 0 : budget,
+                    &moved);
+        if (!unlimited) budget -= moved;
+    }
+    qsort(promote, np, sizeof(*promote), hotter_first);
+    for (i = 0; i < np && (unlimited || budget > 0); i++) {
+        /* the fast target is probably full; try again next round */
+        if (move_region(t, &promote[i].key, &fast_tid, 1,
+                        unlimited ? 0 : budget, &moved)
+            == BAKE_ERR_ALLOCATION)
+            break;
+        if (!unlimited) budget -= moved;
+    }
+
+finish:
+    free(promote);
+    free(demote);
+}
+
+static void policy_ult(void* arg)
+{
+    bake_tiering_t  t = (bake_tiering_t)arg;
+    struct timespec deadline;
+
+    ABT_mutex_lock(t->mutex);
+    while (!t->stopping) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += t->period_ms / 1000;
+        deadline.tv_nsec += (t->period_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        ABT_cond_timedwait(t->cond, t->mutex, &deadline);
+        if (t->stopping) break;
+        ABT_mutex_unlock(t->mutex);
+        policy_round(t);
+        ABT_mutex_lock(t->mutex);
+    }
+    ABT_mutex_unlock(t->mutex);
+}
+
+static int parse_target(const char*       value,
+                        int*              set,
+                        bake_target_id_t* tid)
+{
+    if (strlen(value) == 0) {
+        *set = 0;
+        return BAKE_SUCCESS;
+    }
+    if (bake_target_id_from_string(value, tid) != BAKE_SUCCESS)
+        return BAKE_ERR_INVALID_ARG;
+    *set = 1;
+    return BAKE_SUCCESS;
+}
+
+int bake_tiering_set_conf(bake_tiering_t t, const char* key, const char* value)
+{
+    unsigned u;
+    size_t   z;
+    double   d;
+    int      ret = BAKE_SUCCESS;
+
+    if (strcmp(key, "tiering_enabled") == 0) {
+        if (sscanf(value, "%u", &u) != 1) return BAKE_ERR_INVALID_ARG;
+        if (u && t->policy_thread == ABT_THREAD_NULL) {
+            if (t->journal_fd < 0) {
+                fprintf(stderr,
+                        "ERROR: tiering_journal must be set before "
+                        "tiering_enabled\n");
+                return BAKE_ERR_INVALID_ARG;
+            }
+            t->enabled = 1;
+            if (ABT_thread_create(t->provider->handler_pool, policy_ult, t,
+                                  ABT_THREAD_ATTR_NULL, &t->policy_thread)
+                != ABT_SUCCESS) {
+                t->policy_thread = ABT_THREAD_NULL;
+                t->enabled       = 0;
+                return BAKE_ERR_ARGOBOTS;
+            }
+        } else if (!u) {
+            /* regions already moved stay reachable through their
+             * forwarding entries */
+            t->enabled = 0;
+            stop_policy_thread(t);
+        }
+        return BAKE_SUCCESS;
+    }
+
+    ABT_mutex_lock(t->mutex);
+    if (strcmp(key, "tiering_journal") == 0) {
+        /* the forwarding entries it holds are in use as soon as it is
+         * loaded, so it cannot be swapped for another one */
+        if (t->journal_fd >= 0 || strlen(value) == 0)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            ret = journal_open(t, value);
+    } else if (strcmp(key, "tiering_fast_target") == 0)
+        ret = parse_target(value, &t->fast_set, &t->fast_tid);
+    else if (strcmp(key, "tiering_slow_target") == 0)
+        ret = parse_target(value, &t->slow_set, &t->slow_tid);
+    else if (strcmp(key, "tiering_period_ms") == 0) {
+        if (sscanf(value, "%u", &u) != 1 || u == 0)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            t->period_ms = u;
+    } else if (strcmp(key, "tiering_half_life_ms") == 0) {
+        if (sscanf(value, "%u", &u) != 1 || u == 0)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            t->half_life_ms = u;
+    } else if (strcmp(key, "tiering_bandwidth") == 0) {
+        if (sscanf(value, "%zu", &z) != 1)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            t->bandwidth = z;
+    } else if (strcmp(key, "tiering_promote_threshold") == 0) {
+        if (sscanf(value, "%lf", &d) != 1 || d <= 0.0)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            t->promote_threshold = d;
+    } else if (strcmp(key, "tiering_demote_threshold") == 0) {
+        if (sscanf(value, "%lf", &d) != 1 || d < 0.0)
+            ret = BAKE_ERR_INVALID_ARG;
+        else
+            t->demote_threshold = d;
+    } else
+        ret = BAKE_ERR_INVALID_ARG;
+    ABT_mutex_unlock(t->mutex);
+    return ret;
+}
+
+void bake_tiering_print_stats(bake_tiering_t t, FILE* out)
+{
+    char tid_str[37];
+
+    ABT_mutex_lock(t->mutex);
+    fprintf(out, "tiering_enabled = %d\n", t->enabled);
+    if (t->fast_set) {
+        bake_target_id_to_string(t->fast_tid, tid_str, sizeof(tid_str));
+        fprintf(out, "tiering_fast_target = %s\n", tid_str);
+    }
+    if (t->slow_set) {
+        bake_target_id_to_string(t->slow_tid, tid_str, sizeof(tid_str));
+        fprintf(out, "tiering_slow_target = %s\n", tid_str);
+    }
+    fprintf(out, "tiering_period_ms = %u\n", t->period_ms);
+    fprintf(out, "tiering_half_life_ms = %u\n", t->half_life_ms);
+    fprintf(out, "tiering_bandwidth = %zu\n", t->bandwidth);
+    fprintf(out, "tiering_promote_threshold = %g\n", t->promote_threshold);
+    fprintf(out, "tiering_demote_threshold = %g\n", t->demote_threshold);
+    fprintf(out, "tiering.tracked_regions = %u\n", HASH_COUNT(t->records));
+    fprintf(out, "tiering.forwarded_regions = %u\n", HASH_COUNT(t->forwards));
+    fprintf(out, "tiering.accesses = %" PRIu64 "\n", t->accesses);
+    fprintf(out, "tiering.rounds = %" PRIu64 "\n", t->rounds);
+    fprintf(out, "tiering.promotions = %" PRIu64 "\n", t->promotions);
+    fprintf(out, "tiering.demotions = %" PRIu64 "\n", t->demotions);
+    fprintf(out, "tiering.bytes_moved = %" PRIu64 "\n", t->bytes_moved);
+    fprintf(out, "tiering.failed_moves = %" PRIu64 "\n", t->failed_moves);
+    ABT_mutex_unlock(t->mutex);
+}
@@ -0,0 +1,115 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_TIERING_H
+#define __BAKE_TIERING_H
+
+#include <stdio.h>
+#include "bake-provider.h"
+
+/* bake-tiering
+ *
+ * Heat-tracked automatic tiering between the targets of a provider.  Every
+ * read and write counts as an access to its region, and each region keeps a
+ * frequency score that decays exponentially with a configurable half-life.
+ * A background ULT periodically promotes the hottest regions of the slow
+ * target (by default the first "file" target) to the fast target (by
+ * default the first "pmem" target) and demotes the coldest regions of the
+ * fast target, without moving more than a configurable number of bytes per
+ * second.  A moved region gets a new region id on its new target; the
+ * provider keeps a forwarding entry from the id the client knows to the
+ * current location so that old region ids stay valid.  Forwarding entries
+ * are appended to a journal file, and synced, before the region is removed
+ * from its old location, and are reloaded when the journal is set again
+ * after a restart.
+ */
+
+#define BAKE_TIERING_DEFAULT_PERIOD_MS         1000
+#define BAKE_TIERING_DEFAULT_HALF_LIFE_MS      10000
+#define BAKE_TIERING_DEFAULT_BANDWIDTH         (64 * 1024 * 1024)
+#define BAKE_TIERING_DEFAULT_PROMOTE_THRESHOLD 8.0
+#define BAKE_TIERING_DEFAULT_DEMOTE_THRESHOLD  1.0
+
+typedef struct bake_tiering* bake_tiering_t;
+
+/**
+ * Creates the tiering state of a provider.  The policy ULT is not started
+ * until "tiering_enabled" is set to 1.
+ */
+int bake_tiering_create(bake_provider_t provider, bake_tiering_t* tiering);
+
+/**
+ * Stops the policy ULT and frees the tiering state.  Forwarding entries
+ * survive in the journal.
+ */
+void bake_tiering_destroy(bake_tiering_t tiering);
+
+/**
+ * Sets a configuration parameter.  Recognized keys are "tiering_journal"
+ * (path of the forwarding journal, loaded when set; required before
+ * tiering is enabled and cannot be changed), "tiering_enabled" (0 or 1),
+ * "tiering_fast_target" and "tiering_slow_target" (target ids,
+ * empty to pick the first pmem and file targets), "tiering_period_ms",
+ * "tiering_half_life_ms", "tiering_bandwidth" (bytes per second, 0 for
+ * unlimited), "tiering_promote_threshold" and "tiering_demote_threshold"
+ * (decayed number of accesses).
+ */
+int bake_tiering_set_conf(bake_tiering_t tiering,
+                          const char*    key,
+                          const char*    value);
+
+/**
+ * Rewrites a target id and region id known by a client into the current
+ * location of the region.  Returns 1 if the region was moved, 0 otherwise.
+ * Must be called with the provider's lock held.
+ */
+int bake_tiering_resolve(bake_tiering_t    tiering,
+                         bake_target_id_t* tid,
+                         bake_region_id_t* rid);
+
+/**
+ * Records an access to a region.  origin is the region id known by the
+ * client and rid its current location.  write_end is the offset right after
+ * the last byte written (the size of the region for a creation), or 0 for a
+ * read; the policy moves regions by that size, since not every backend can
+ * report the size of its regions.
+ */
+void bake_tiering_record_access(bake_tiering_t          tiering,
+                                const bake_target_id_t* origin_tid,
+                                const bake_region_id_t* origin_rid,
+                                const bake_target_id_t* tid,
+                                const bake_region_id_t* rid,
+                                uint64_t                write_end);
+
+/**
+ * Forgets the heat and forwarding entry of a region that has been removed,
+ * given the region id known by the client.
+ */
+void bake_tiering_forget(bake_tiering_t          tiering,
+                         const bake_target_id_t* origin_tid,
+                         const bake_region_id_t* origin_rid);
+
+/**
+ * Creates a region on a target, making sure that its id does not shadow
+ * the id of a region that has been moved away from that target.  Must be
+ * called with the provider's lock held.
+ */
+int bake_tiering_create_region(bake_tiering_t    tiering,
+                               bake_target_t*    target,
+                               size_t            size,
+                               bake_region_id_t* rid);
+
+/**
+ * Returns 1 if newly created regions need to go through
+ * bake_tiering_create_region().
+ */
+int bake_tiering_has_forwards(bake_tiering_t tiering);
+
+/**
+ * Prints settings and counters, one "key = value" pair per line.
+ */
+void bake_tiering_print_stats(bake_tiering_t tiering, FILE* out);
+
+#endif
@@ -0,0 +1,321 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <abt.h>
+#include "bake.h"
+#include "bake-metrics.h"
+#include "bake-trace.h"
+
+/* the sampling rate is kept in parts per million so that it can be read
+ * atomically; sampling is deterministic within each cycle of a million
+ * requests */
+#define TRACE_RATE_SCALE 1000000ULL
+#define TRACE_ID_BITS    40
+#define TRACE_ID_MASK    ((1ULL << TRACE_ID_BITS) - 1)
+
+static const char* g_stage_names[BAKE_TRACE_NUM_STAGES] = {
+    "request",
+    "decode",
+    "qos_wait",
+    "lock_wait",
+    "target_lookup",
+    "backend",
+    "poolset_wait",
+    "rdma",
+    "disk_read",
+    "disk_write",
+    "disk_sync",
+    "respond",
+    "forward",
+};
+
+static const char* g_op_names[BAKE_METRICS_NUM] = {
+#define X(name) #name,
+    BAKE_METRICS_RPCS(X)
+#undef X
+#define X(name) "backend." #name,
+    BAKE_METRICS_BACKEND_CALLS(X)
+#undef X
+};
+
+typedef struct {
+    uint64_t seq; /* 0 while being written, position in the ring + 1 after */
+    uint64_t req_id;
+    uint64_t start;
+    uint64_t end;
+    uint64_t arg;
+    int32_t  op;
+    uint16_t stage;
+    uint16_t rank;
+} trace_span_t;
+
+typedef struct {
+    uint64_t     head;
+    uint64_t     size;
+    trace_span_t spans[];
+} trace_ring_t;
+
+struct bake_tracer {
+    char          name[64];
+    uint64_t      rate_ppm;
+    uint64_t      ring_size;
+    uint64_t      requests;
+    uint64_t      id_base;
+    trace_ring_t* rings[BAKE_TRACE_MAX_XSTREAMS];
+};
+
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static ABT_key        g_key      = ABT_KEY_NULL;
+
+static void create_key(void) { ABT_key_create(NULL, &g_key); }
+
+bake_tracer_t bake_tracer_create(const char* name)
+{
+    struct bake_tracer* t = calloc(1, sizeof(*t));
+    uint64_t            seed;
+
+    if (!t) return NULL;
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->ring_size = BAKE_TRACE_DEFAULT_RING_SIZE;
+    /* high bits that keep the ids of different processes apart */
+    seed       = bake_trace_now() ^ ((uint64_t)getpid() << 20) ^ (uintptr_t)t;
+    seed       = (seed ^ (seed >> 29)) * 0xbf58476d1ce4e5b9ULL;
+    t->id_base = (seed ^ (seed >> 32)) << TRACE_ID_BITS & ~BAKE_TRACE_SAMPLED;
+    return t;
+}
+
+void bake_tracer_destroy(bake_tracer_t t)
+{
+    unsigned i;
+
+    if (!t) return;
+    for (i = 0; i < BAKE_TRACE_MAX_XSTREAMS; i++) free(t->rings[i]);
+    free(t);
+}
+
+int bake_tracer_set_conf(bake_tracer_t t, const char* key, const char* value)
+{
+    char*  end;
+    double d = strtod(value, &end);
+
+    if (end == value || *end != '\0') return BAKE_ERR_INVALID_ARG;
+    if (strcmp(key, "trace_rate") == 0) {
+        if (d < 0.0 || d > 1.0) return BAKE_ERR_INVALID_ARG;
+        __atomic_store_n(&t->rate_ppm, (uint64_t)(d * TRACE_RATE_SCALE + 0.5),
+                         __ATOMIC_RELAXED);
+    } else if (strcmp(key, "trace_ring_size") == 0) {
+        if (d < 1.0) return BAKE_ERR_INVALID_ARG;
+        __atomic_store_n(&t->ring_size, (uint64_t)d, __ATOMIC_RELAXED);
+    } else
+        return BAKE_ERR_INVALID_ARG;
+    return BAKE_SUCCESS;
+}
+
+uint64_t bake_tracer_new_request(bake_tracer_t t)
+{
+    uint64_t n, k, rate;
+
+    if (!t) return 0;
+    n    = __atomic_fetch_add(&t->requests, 1, __ATOMIC_RELAXED);
+    rate = __atomic_load_n(&t->rate_ppm, __ATOMIC_RELAXED);
+    k    = n % TRACE_RATE_SCALE;
+    if ((k + 1) * rate / TRACE_RATE_SCALE != k * rate / TRACE_RATE_SCALE)
+        return t->id_base | (n & TRACE_ID_MASK) | BAKE_TRACE_SAMPLED;
+    return t->id_base | (n & TRACE_ID_MASK);
+}
+
+uint64_t bake_tracer_adopt_request(bake_tracer_t t, uint64_t req_id)
+{
+    uint64_t id;
+
+    if (!t || (req_id & BAKE_TRACE_SAMPLED)
+        || !__atomic_load_n(&t->rate_ppm, __ATOMIC_RELAXED))
+        return req_id;
+    id = bake_tracer_new_request(t);
+    return req_id ? req_id | (id & BAKE_TRACE_SAMPLED) : id;
+}
+
+/* finds (and allocates on first use) the ring of the calling xstream */
+static trace_ring_t* get_ring(struct bake_tracer* t, int* rank)
+{
+    trace_ring_t* ring;
+    trace_ring_t* expected = NULL;
+    uint64_t      size;
+
+    *rank = 0;
+    ABT_xstream_self_rank(rank);
+    ring = __atomic_load_n(&t->rings[*rank % BAKE_TRACE_MAX_XSTREAMS],
+                           __ATOMIC_ACQUIRE);
+    if (ring) return ring;
+
+    size = __atomic_load_n(&t->ring_size, __ATOMIC_RELAXED);
+    ring = calloc(1, sizeof(*ring) + size * sizeof(trace_span_t));
+    if (!ring) return NULL;
+    ring->size = size;
+    if (!__atomic_compare_exchange_n(
+            &t->rings[*rank % BAKE_TRACE_MAX_XSTREAMS], &expected, ring, 0,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        /* another ULT on this xstream allocated it first */
+        free(ring);
+        return expected;
+    }
+    return ring;
+}
+
+void bake_tracer_record(bake_tracer_t t,
+                        uint64_t      req_id,
+                        int           stage,
+                        int           op,
+                        uint64_t      start,
+                        uint64_t      end,
+                        uint64_t      arg)
+{
+    trace_ring_t* ring;
+    trace_span_t* span;
+    uint64_t      pos;
+    int           rank;
+
+    if (!t || !(req_id & BAKE_TRACE_SAMPLED) || !(ring = get_ring(t, &rank)))
+        return;
+    pos  = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    span = &ring->spans[pos % ring->size];
+    __atomic_store_n(&span->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    span->req_id = req_id;
+    span->start  = start;
+    span->end    = end;
+    span->arg    = arg;
+    span->op     = op;
+    span->stage  = stage;
+    span->rank   = rank;
+    __atomic_store_n(&span->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+/* prints a timestamp in nanoseconds as microseconds */
+static void print_us(FILE* out, const char* key, uint64_t ns)
+{
+    fprintf(out, ",\"%s\":%" PRIu64 ".%03u", key, ns / 1000,
+            (unsigned)(ns % 1000));
+}
+
+static void print_span(FILE* out, int pid, const trace_span_t* s)
+{
+    const char* name = g_stage_names[s->stage];
+
+    if (s->op >= 0 && s->op < BAKE_METRICS_NUM
+        && (s->stage == BAKE_TRACE_REQUEST || s->stage == BAKE_TRACE_FORWARD
+            || s->stage == BAKE_TRACE_BACKEND))
+        name = g_op_names[s->op];
+
+    fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\"", name,
+            g_stage_names[s->stage]);
+    print_us(out, "ts", s->start);
+    print_us(out, "dur", s->end > s->start ? s->end - s->start : 0);
+    fprintf(out,
+            ",\"pid\":%d,\"tid\":%u,\"args\":{\"req\":\"0x%016" PRIx64
+            "\",\"arg\":%" PRIu64 "}}",
+            pid, (unsigned)s->rank, s->req_id, s->arg);
+
+    /* flow arrow from the client's forward to the server's handler */
+    if (s->stage == BAKE_TRACE_FORWARD || s->stage == BAKE_TRACE_REQUEST) {
+        fprintf(out,
+                ",\n{\"name\":\"rpc\",\"cat\":\"rpc\",\"ph\":\"%s\",%s"
+                "\"id\":\"0x%016" PRIx64 "\"",
+                s->stage == BAKE_TRACE_FORWARD ? "s" : "f",
+                s->stage == BAKE_TRACE_FORWARD ? "" : "\"bp\":\"e\",",
+                s->req_id);
+        print_us(out, "ts", s->start);
+        fprintf(out, ",\"pid\":%d,\"tid\":%u}", pid, (unsigned)s->rank);
+    }
+}
+
+void bake_tracer_dump(bake_tracer_t t, FILE* out)
+{
+    trace_ring_t* ring;
+    trace_span_t  span;
+    uint64_t      i, seq, head;
+    unsigned      r;
+    int           pid = getpid();
+
+    fprintf(out,
+            "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+            "\"args\":{\"name\":\"%s\"}}",
+            pid, t->name);
+    for (r = 0; r < BAKE_TRACE_MAX_XSTREAMS; r++) {
+        ring = __atomic_load_n(&t->rings[r], __ATOMIC_ACQUIRE);
+        if (!ring) continue;
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        for (i = head > ring->size ? head - ring->size : 0; i < head; i++) {
+            trace_span_t* s = &ring->spans[i % ring->size];
+
+            seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+            if (seq != i + 1) continue;
+            memcpy(&span, s, sizeof(span));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            /* skip spans overwritten while they were copied */
+            if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq) continue;
+            print_span(out, pid, &span);
+        }
+    }
+    fprintf(out, "\n]}\n");
+}
+
+int bake_tracer_dump_file(bake_tracer_t t, const char* filename)
+{
+    FILE* out = fopen(filename, "w");
+
+    if (!out) return BAKE_ERR_IO;
+    bake_tracer_dump(t, out);
+    if (fclose(out) != 0) return BAKE_ERR_IO;
+    return BAKE_SUCCESS;
+}
+
+void bake_trace_set_current(bake_trace_ctx_t* ctx)
+{
+    pthread_once(&g_key_once, create_key);
+    ABT_key_set(g_key, ctx);
+}
+
+bake_trace_ctx_t* bake_trace_get_current(void)
+{
+    void* ctx = NULL;
+
+    pthread_once(&g_key_once, create_key);
+    if (ABT_key_get(g_key, &ctx) != ABT_SUCCESS) return NULL;
+    return ctx;
+}
+
+uint64_t bake_trace_current_request(void)
+{
+    bake_trace_ctx_t* ctx = bake_trace_get_current();
+
+    return ctx ? ctx->req_id : 0;
+}
+
+uint64_t bake_trace_start(void)
+{
+    bake_trace_ctx_t* ctx = bake_trace_get_current();
+
+    if (!ctx || !(ctx->req_id & BAKE_TRACE_SAMPLED)) return 0;
+    return bake_trace_now();
+}
+
+void bake_trace_stage(int stage, uint64_t start, uint64_t arg)
+{
+    bake_trace_ctx_t* ctx;
+
+    if (!start || !(ctx = bake_trace_get_current())) return;
+    bake_tracer_record(ctx->tracer, ctx->req_id, stage, ctx->op, start,
+                       bake_trace_now(), arg);
+}
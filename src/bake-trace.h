@@ -0,0 +1,153 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_TRACE_H
+#define __BAKE_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/* bake-trace
+ *
+ * Sampled request tracing.  The client picks a request id for every RPC it
+ * forwards and carries it in the RPC input; the high bit of the id tells
+ * whether the request is sampled.  Sampled requests record one span per
+ * stage they go through (decode, lock wait, RDMA chunk, disk I/O, ...) in a
+ * ring buffer of the execution stream they run on, overwriting the oldest
+ * spans once the ring is full.  Unsampled requests record nothing.  The
+ * rings are dumped in the Chrome trace event format (readable by
+ * chrome://tracing and Perfetto).  Once the traceEvents arrays of client
+ * and server dumps are merged, flow events keyed by the request id link
+ * each client span to the matching server span.  Timestamps use the
+ * realtime clock so that traces of different processes line up.
+ */
+
+#define BAKE_TRACE_SAMPLED            (1ULL << 63)
+#define BAKE_TRACE_MAX_XSTREAMS       64
+#define BAKE_TRACE_DEFAULT_RING_SIZE  4096
+
+enum {
+    BAKE_TRACE_REQUEST,       /* whole server handler */
+    BAKE_TRACE_DECODE,        /* RPC input decoding */
+    BAKE_TRACE_QOS_WAIT,      /* wait for a QoS slot */
+    BAKE_TRACE_LOCK_WAIT,     /* wait for the provider lock */
+    BAKE_TRACE_TARGET_LOOKUP, /* target lookup */
+    BAKE_TRACE_BACKEND,       /* backend call */
+    BAKE_TRACE_POOLSET_WAIT,  /* wait for a pipeline buffer */
+    BAKE_TRACE_RDMA,          /* one bulk transfer */
+    BAKE_TRACE_DISK_READ,     /* one read from a file */
+    BAKE_TRACE_DISK_WRITE,    /* one write to a file */
+    BAKE_TRACE_DISK_SYNC,     /* one file sync */
+    BAKE_TRACE_RESPOND,       /* sending the response */
+    BAKE_TRACE_FORWARD,       /* whole RPC, seen by the client */
+    BAKE_TRACE_NUM_STAGES
+};
+
+typedef struct bake_tracer* bake_tracer_t;
+
+/* request being served by the calling ULT */
+typedef struct {
+    bake_tracer_t tracer;
+    uint64_t      req_id;
+    int           op;
+} bake_trace_ctx_t;
+
+/* realtime clock in nanoseconds */
+static inline uint64_t bake_trace_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Creates a tracer whose dumps are labelled with the given process name.
+ * The tracer samples no request until a rate is set.
+ */
+bake_tracer_t bake_tracer_create(const char* name);
+
+void bake_tracer_destroy(bake_tracer_t tracer);
+
+/**
+ * Sets a configuration parameter.  Recognized keys are "trace_rate"
+ * (fraction of the requests to sample, between 0 and 1) and
+ * "trace_ring_size" (spans kept per execution stream; only applies to
+ * rings allocated afterwards).
+ */
+int bake_tracer_set_conf(bake_tracer_t tracer,
+                         const char*   key,
+                         const char*   value);
+
+/**
+ * Returns a new request id, with BAKE_TRACE_SAMPLED set for the requested
+ * fraction of the calls.  Returns 0 if tracer is NULL.
+ */
+uint64_t bake_tracer_new_request(bake_tracer_t tracer);
+
+/**
+ * Returns the id under which a server traces a request received with the
+ * given id (0 if the client did not pick one).  The request is sampled if
+ * the client sampled it, or else at the rate of the server's tracer; the
+ * client's id is kept either way.
+ */
+uint64_t bake_tracer_adopt_request(bake_tracer_t tracer, uint64_t req_id);
+
+/**
+ * Records a span of a request in the ring of the calling execution stream.
+ * op is a BAKE_METRIC_* identifier naming the RPC or backend call (or -1),
+ * and arg a stage-specific value (usually a size in bytes).  Does nothing
+ * if tracer is NULL or the request is not sampled.
+ */
+void bake_tracer_record(bake_tracer_t tracer,
+                        uint64_t      req_id,
+                        int           stage,
+                        int           op,
+                        uint64_t      start,
+                        uint64_t      end,
+                        uint64_t      arg);
+
+/**
+ * Writes the spans currently held in the rings as a Chrome trace JSON
+ * object.
+ */
+void bake_tracer_dump(bake_tracer_t tracer, FILE* out);
+
+/**
+ * Same as bake_tracer_dump, to a file created (or truncated) at the given
+ * path.
+ */
+int bake_tracer_dump_file(bake_tracer_t tracer, const char* filename);
+
+/**
+ * Sets (or clears, if ctx is NULL) the request served by the calling ULT,
+ * which must stay valid until it is cleared.  ULTs that work on behalf of
+ * a request (e.g. pipeline helpers) set the context of their parent.
+ */
+void bake_trace_set_current(bake_trace_ctx_t* ctx);
+
+bake_trace_ctx_t* bake_trace_get_current(void);
+
+/**
+ * Returns the id of the request served by the calling ULT, or 0.  RPCs
+ * forwarded on behalf of a request carry this id so that the provider
+ * they reach traces them as part of the same request.
+ */
+uint64_t bake_trace_current_request(void);
+
+/**
+ * Returns the start time of a stage of the request served by the calling
+ * ULT, or 0 if that request is not sampled (sparing the clock read).
+ */
+uint64_t bake_trace_start(void);
+
+/**
+ * Records a span of the request served by the calling ULT, from start (from
+ * bake_trace_start) to now.  Does nothing if start is 0.
+ */
+void bake_trace_stage(int stage, uint64_t start, uint64_t arg);
+
+#endif
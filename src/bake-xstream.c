@@ -0,0 +1,102 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include "bake-config.h"
+
+#include <stdlib.h>
+#include "bake.h"
+#include "bake-xstream.h"
+
+/* how long an idle scheduler sleeps on the pool before checking whether it
+ * has been asked to stop, in seconds */
+#define BAKE_XSTREAM_POLL 0.01
+
+#define XSTREAM_RUN   0
+#define XSTREAM_STOP  1
+#define XSTREAM_DRAIN 2
+
+struct bake_xstream {
+    ABT_xstream xstream;
+    ABT_sched   sched;
+    int         state; /* XSTREAM_*, set by bake_xstream_stop() */
+};
+
+static void sched_run(ABT_sched sched)
+{
+    struct bake_xstream* xs;
+    ABT_pool             pool;
+    ABT_unit             unit;
+    size_t               size;
+    int                  state;
+
+    ABT_sched_get_data(sched, (void**)&xs);
+    ABT_sched_get_pools(sched, 1, 0, &pool);
+    for (;;) {
+        state = __atomic_load_n(&xs->state, __ATOMIC_ACQUIRE);
+        if (state == XSTREAM_STOP) break;
+        /* a FIFO_WAIT pool wakes us up as soon as a ULT is pushed */
+        unit = ABT_pool_pop_timedwait(pool,
+                                      ABT_get_wtime() + BAKE_XSTREAM_POLL);
+        if (unit != ABT_UNIT_NULL)
+            ABT_xstream_run_unit(unit, pool);
+        else if (state == XSTREAM_DRAIN) {
+            ABT_pool_get_total_size(pool, &size);
+            if (size == 0) break;
+        }
+        ABT_xstream_check_events(sched);
+    }
+}
+
+static ABT_sched_def g_sched_def = {.type          = ABT_SCHED_TYPE_ULT,
+                                    .init          = NULL,
+                                    .run           = sched_run,
+                                    .free          = NULL,
+                                    .get_migr_pool = NULL};
+
+int bake_xstream_create(ABT_pool pool, bake_xstream_t* xstream)
+{
+    struct bake_xstream* xs = calloc(1, sizeof(*xs));
+    int                  ret;
+
+    if (!xs) return BAKE_ERR_ALLOCATION;
+    xs->state = XSTREAM_RUN;
+    ret = ABT_sched_create(&g_sched_def, 1, &pool, ABT_SCHED_CONFIG_NULL,
+                           &xs->sched);
+    if (ret != ABT_SUCCESS) goto error;
+    ABT_sched_set_data(xs->sched, xs);
+    ret = ABT_xstream_create(xs->sched, &xs->xstream);
+    if (ret != ABT_SUCCESS) {
+        ABT_sched_free(&xs->sched);
+        goto error;
+    }
+    *xstream = xs;
+    return BAKE_SUCCESS;
+
+error:
+    free(xs);
+    return BAKE_ERR_ARGOBOTS;
+}
+
+ABT_xstream bake_xstream_get_abt_xstream(bake_xstream_t xs)
+{
+    return xs->xstream;
+}
+
+void bake_xstream_stop(bake_xstream_t xs, int drain)
+{
+    __atomic_store_n(&xs->state, drain ? XSTREAM_DRAIN : XSTREAM_STOP,
+                     __ATOMIC_RELEASE);
+}
+
+void bake_xstream_join(bake_xstream_t xs)
+{
+    ABT_xstream_join(xs->xstream);
+    ABT_xstream_free(&xs->xstream);
+    /* not freed with the execution stream, since it was created with
+     * ABT_sched_create() */
+    ABT_sched_free(&xs->sched);
+    free(xs);
+}
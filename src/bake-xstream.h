@@ -0,0 +1,45 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __BAKE_XSTREAM_H
+#define __BAKE_XSTREAM_H
+
+#include <abt.h>
+
+/* bake-xstream
+ *
+ * Execution streams serving a pool that other execution streams may share.
+ * Joining an execution stream driven by one of the predefined schedulers
+ * only returns once its pools are empty, which never happens while the
+ * other execution streams keep them busy.  These execution streams run a
+ * scheduler that can instead be told to stop after the ULT it is running,
+ * leaving the rest of the pool to the others.
+ */
+
+typedef struct bake_xstream* bake_xstream_t;
+
+/**
+ * Creates an execution stream serving the given pool.
+ */
+int bake_xstream_create(ABT_pool pool, bake_xstream_t* xstream);
+
+/**
+ * Returns the Argobots execution stream, e.g. to set its affinity.
+ */
+ABT_xstream bake_xstream_get_abt_xstream(bake_xstream_t xstream);
+
+/**
+ * Asks the execution stream to stop, right after the ULT it is running, or
+ * once the pool is empty if drain is set.  Does not wait; several
+ * execution streams can be asked to stop before joining them.
+ */
+void bake_xstream_stop(bake_xstream_t xstream, int drain);
+
+/**
+ * Waits for an execution stream that was asked to stop, and frees it.
+ */
+void bake_xstream_join(bake_xstream_t xstream);
+
+#endif
@@ -0,0 +1,40 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# actual test case
+#####################
+
+for backend in pmem: file:; do
+    src/bake-mkpool -s 100M ${backend}$TMPBASE/bench.dat
+    if [ $? -ne 0 ]; then
+        exit 1
+    fi
+
+    BENCHOUT=`run_to 60 src/bake-backend-bench -s 1K:64K -n 100 -u 4 -x 2 -r ${backend}$TMPBASE/bench.dat`
+    if [ $? -ne 0 ]; then
+        echo "$BENCHOUT"
+        exit 1
+    fi
+    echo "$BENCHOUT"
+
+    for call in create write_raw persist read_raw create_write_persist_raw remove; do
+        echo "$BENCHOUT" | grep -q "^$call "
+        if [ $? -ne 0 ]; then
+            echo "missing $call in bake-backend-bench output for $backend"
+            exit 1
+        fi
+    done
+    rm -f $TMPBASE/bench.dat
+done
+
+#####################
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
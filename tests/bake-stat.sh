@@ -0,0 +1,64 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout
+test_start_servers 1 2 20
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+# the provider must have counted the RPCs and backend calls of the copy
+STATOUT=`run_to 10 src/bake-stat -i 0 $svr1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+echo "$STATOUT"
+
+for call in rpc.probe rpc.create backend.create backend.persist; do
+    echo "$STATOUT" | grep -q "^$call "
+    if [ $? -ne 0 ]; then
+        echo "missing $call in bake-stat output"
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+# rates over an interval
+run_to 10 src/bake-stat -i 1 -n 1 $svr1 1
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
@@ -0,0 +1,50 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout, sampling every request and
+# writing its trace at shutdown
+test_start_servers 1 2 20 pmem: "-C trace_rate=1 -t $TMPBASE/trace"
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+# the trace must hold the spans of the copy's requests
+TRACE=$TMPBASE/trace.1.json
+cat $TRACE
+for span in traceEvents '"name":"create"' '"name":"decode"' \
+    '"name":"backend.create"' '"name":"respond"'; do
+    grep -q "$span" $TRACE
+    if [ $? -ne 0 ]; then
+        echo "missing $span in $TRACE"
+        exit 1
+    fi
+done
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
@@ -0,0 +1,224 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mercury.h>
+#include <abt.h>
+#include <margo.h>
+
+#include "bake-client.h"
+
+/* creates a region larger than the data written to it and checks that the
+ * rest reads as zeros, through both the bulk and the eager read paths; run
+ * against a provider that chunks its regions, the tail spans chunks that
+ * were never written */
+
+#define REGION_SIZE 16384
+
+static char* read_input_file(const char* filename, size_t* size);
+
+/* checks buf against len bytes at offset of the region: the input data,
+ * then zeros */
+static int check_range(const char* buf,
+                       const char* data,
+                       size_t      data_size,
+                       size_t      offset,
+                       size_t      len)
+{
+    size_t i;
+    char   expected;
+
+    for (i = 0; i < len; i++) {
+        expected = offset + i < data_size ? data[offset + i] : 0;
+        if (buf[i] != expected) {
+            fprintf(stderr,
+                    "Error: unexpected byte at offset %zu of the region\n",
+                    offset + i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* reads len bytes at offset of the region, eagerly if len is below the
+ * eager limit of the handle, and checks them */
+static int read_and_check(bake_provider_handle_t bph,
+                          bake_target_id_t       bti,
+                          bake_region_id_t       rid,
+                          const char*            data,
+                          size_t                 data_size,
+                          size_t                 offset,
+                          size_t                 len)
+{
+    char*    buf = malloc(len);
+    uint64_t bytes_read;
+    int      ret;
+
+    if (!buf) return -1;
+    /* anything but zeros, so that bytes that are not filled in stand out */
+    memset(buf, 0xff, len);
+    ret = bake_read(bph, bti, rid, offset, buf, len, &bytes_read);
+    if (ret != 0) {
+        bake_perror("Error: bake_read()", ret);
+        free(buf);
+        return -1;
+    }
+    if (bytes_read != len) {
+        fprintf(stderr, "Error: read %llu bytes instead of %zu\n",
+                (unsigned long long)bytes_read, len);
+        free(buf);
+        return -1;
+    }
+    ret = check_range(buf, data, data_size, offset, len);
+    free(buf);
+    return ret;
+}
+
+int main(int argc, char* argv[])
+{
+    int                    i;
+    char                   cli_addr_prefix[64] = {0};
+    char*                  bake_svr_addr_str;
+    margo_instance_id      mid;
+    hg_addr_t              svr_addr = HG_ADDR_NULL;
+    uint8_t                mplex_id;
+    bake_client_t          bcl = BAKE_CLIENT_NULL;
+    bake_provider_handle_t bph = BAKE_PROVIDER_HANDLE_NULL;
+    uint64_t               num_targets;
+    bake_target_id_t       bti;
+    bake_region_id_t       rid;
+    char*                  data = NULL;
+    size_t                 data_size;
+    hg_return_t            hret;
+    int                    ret = -1;
+
+    if (argc != 4) {
+        fprintf(stderr,
+                "Usage: chunked-zero-fill-test <input file> <bake server "
+                "addr> <mplex id>\n");
+        return (-1);
+    }
+    bake_svr_addr_str = argv[2];
+    mplex_id          = atoi(argv[3]);
+
+    data = read_input_file(argv[1], &data_size);
+    if (!data) return (-1);
+    if (data_size < 512 || data_size + 1024 > REGION_SIZE) {
+        fprintf(stderr,
+                "Error: the input file must hold between 512 and %d bytes\n",
+                REGION_SIZE - 1024);
+        free(data);
+        return (-1);
+    }
+
+    /* initialize Margo using the transport portion of the server
+     * address (i.e., the part before the first : character if present)
+     */
+    for (i = 0; (i < 63 && bake_svr_addr_str[i] != '\0'
+                 && bake_svr_addr_str[i] != ':');
+         i++)
+        cli_addr_prefix[i] = bake_svr_addr_str[i];
+
+    mid = margo_init(cli_addr_prefix, MARGO_CLIENT_MODE, 0, 0);
+    if (mid == MARGO_INSTANCE_NULL) {
+        fprintf(stderr, "Error: margo_init()\n");
+        free(data);
+        return (-1);
+    }
+
+    ret = bake_client_init(mid, &bcl);
+    if (ret != 0) {
+        bake_perror("Error: bake_client_init()", ret);
+        goto finish;
+    }
+
+    hret = margo_addr_lookup(mid, bake_svr_addr_str, &svr_addr);
+    if (hret != HG_SUCCESS) {
+        fprintf(stderr, "Error: margo_addr_lookup()\n");
+        ret = -1;
+        goto finish;
+    }
+
+    ret = bake_provider_handle_create(bcl, svr_addr, mplex_id, &bph);
+    if (ret != 0) {
+        bake_perror("Error: bake_provider_handle_create()", ret);
+        goto finish;
+    }
+
+    ret = bake_probe(bph, 1, &bti, &num_targets);
+    if (ret != 0) {
+        bake_perror("Error: bake_probe()", ret);
+        goto finish;
+    }
+
+    /**** write phase: only the head of the region ****/
+
+    ret = bake_create(bph, bti, REGION_SIZE, &rid);
+    if (ret != 0) {
+        bake_perror("Error: bake_create()", ret);
+        goto finish;
+    }
+    ret = bake_write(bph, bti, rid, 0, data, data_size);
+    if (ret != 0) {
+        bake_perror("Error: bake_write()", ret);
+        goto finish;
+    }
+    ret = bake_persist(bph, bti, rid, 0, data_size);
+    if (ret != 0) {
+        bake_perror("Error: bake_persist()", ret);
+        goto finish;
+    }
+
+    /**** read-back phase ****/
+
+    /* the whole region, in bulk mode */
+    ret = read_and_check(bph, bti, rid, data, data_size, 0, REGION_SIZE);
+    if (ret != 0) goto finish;
+
+    /* in eager mode, across the end of the data, then past it */
+    ret = read_and_check(bph, bti, rid, data, data_size, data_size - 512,
+                         1024);
+    if (ret != 0) goto finish;
+    ret = read_and_check(bph, bti, rid, data, data_size, REGION_SIZE - 1024,
+                         1024);
+    if (ret != 0) goto finish;
+
+    ret = bake_remove(bph, bti, rid);
+    if (ret != 0) bake_perror("Error: bake_remove()", ret);
+
+finish:
+    if (bph != BAKE_PROVIDER_HANDLE_NULL) bake_provider_handle_release(bph);
+    if (svr_addr != HG_ADDR_NULL) margo_addr_free(mid, svr_addr);
+    if (bcl != BAKE_CLIENT_NULL) bake_client_finalize(bcl);
+    margo_finalize(mid);
+    free(data);
+    return ret == 0 ? 0 : -1;
+}
+
+static char* read_input_file(const char* filename, size_t* size)
+{
+    size_t ret;
+    FILE*  fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    size_t sz = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* buf = calloc(1, sz + 1);
+    ret       = fread(buf, 1, sz, fp);
+    if (ret != sz && ferror(fp)) {
+        free(buf);
+        perror("read_input_file");
+        buf = NULL;
+    }
+    fclose(fp);
+    *size = sz;
+    return buf;
+}
@@ -0,0 +1,120 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+# File backend uses directio, which does not work on tmpfs. Put targets in
+# local dir instead.
+export TMPDIR="."
+source $srcdir/tests/test-util.sh
+
+# one provider with a fast pmem target (1) and a slow file target (2), with
+# a short half-life so that a region that is not accessed goes cold quickly
+src/bake-mkpool -s 100M pmem:$TMPBASE/svr-1-fast.dat
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+src/bake-mkpool -s 100M file:$TMPBASE/svr-1-slow.dat
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+run_to 20 src/bake-server-daemon -p -m targets \
+    -C tiering_journal=$TMPBASE/svr-1-tiering.journal \
+    -C tiering_period_ms=100 -C tiering_half_life_ms=200 \
+    -C tiering_enabled=1 -f $TMPBASE/svr-1.addr na+sm \
+    pmem:$TMPBASE/svr-1-fast.dat file:$TMPBASE/svr-1-slow.dat &
+sleep 2
+svr1=`cat $TMPBASE/svr-1.addr`
+
+# actual test case
+#####################
+
+# the region is created on the pmem target, which cannot report the size of
+# its regions unless built with --enable-sizecheck
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+SIZE=`stat -c %s $TMPBASE/foo.dat`
+CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+
+# let it cool down and move to the file target
+sleep 2
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+echo "$STATOUT"
+DEMOTIONS=`echo "$STATOUT" | grep '^tiering.demotions = ' | cut -d ' ' -f 3`
+if [ -z "$DEMOTIONS" ] || [ "$DEMOTIONS" -lt 1 ]; then
+    echo "region was not demoted"
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+# it must still be readable through the region id it was created with
+run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out.dat $SIZE
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+cmp $TMPBASE/foo.dat $TMPBASE/foo-out.dat
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+# restart the provider without tiering: the forwarding entry must come
+# back from the journal
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+wait
+rm -f $TMPBASE/svr-1.addr $TMPBASE/foo-out.dat
+run_to 20 src/bake-server-daemon -p -m targets \
+    -C tiering_journal=$TMPBASE/svr-1-tiering.journal \
+    -f $TMPBASE/svr-1.addr na+sm \
+    pmem:$TMPBASE/svr-1-fast.dat file:$TMPBASE/svr-1-slow.dat &
+sleep 2
+svr1=`cat $TMPBASE/svr-1.addr`
+
+run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out.dat $SIZE
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+cmp $TMPBASE/foo.dat $TMPBASE/foo-out.dat
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
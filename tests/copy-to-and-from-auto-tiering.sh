@@ -0,0 +1,92 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+# File backend uses directio, which does not work on tmpfs. Put targets in
+# local dir instead.
+export TMPDIR="."
+source $srcdir/tests/test-util.sh
+
+# one provider with a fast pmem target (1) and a slow file target (2), that
+# promotes a region once it has been accessed twice
+src/bake-mkpool -s 100M pmem:$TMPBASE/svr-1-fast.dat
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+src/bake-mkpool -s 100M file:$TMPBASE/svr-1-slow.dat
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+run_to 20 src/bake-server-daemon -p -m targets \
+    -C tiering_journal=$TMPBASE/svr-1-tiering.journal \
+    -C tiering_period_ms=100 -C tiering_promote_threshold=2 \
+    -C tiering_enabled=1 -f $TMPBASE/svr-1.addr na+sm \
+    pmem:$TMPBASE/svr-1-fast.dat file:$TMPBASE/svr-1-slow.dat &
+sleep 2
+svr1=`cat $TMPBASE/svr-1.addr`
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+SIZE=`stat -c %s $TMPBASE/foo.dat`
+CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 2`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+
+# heat the region up, let it move to the pmem target, and read it again
+# through the region id it was created with
+for i in 1 2 3 4; do
+    run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out.dat $SIZE
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+    cmp $TMPBASE/foo.dat $TMPBASE/foo-out.dat
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+    sleep 1
+done
+
+# the reads must have come from the pmem target
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+echo "$STATOUT"
+PROMOTIONS=`echo "$STATOUT" | grep '^tiering.promotions = ' | cut -d ' ' -f 3`
+if [ -z "$PROMOTIONS" ] || [ "$PROMOTIONS" -lt 1 ]; then
+    echo "region was not promoted"
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
@@ -0,0 +1,70 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout, persisting written data
+# with non-temporal stores
+test_start_servers 1 2 20 pmem: "-c durable_writes=1"
+
+# actual test case
+#####################
+
+# a pipelined bulk copy and an eager one
+cp $srcdir/tests/lorem.txt $TMPBASE/bulk.dat
+head -c 1024 $srcdir/tests/lorem.txt > $TMPBASE/eager.dat
+for f in bulk eager
+do
+    SIZE=`stat -c %s $TMPBASE/$f.dat`
+    CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/$f.dat $svr1 1 1`
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+
+    RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+    run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/$f-out.dat $SIZE
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+
+    cmp $TMPBASE/$f.dat $TMPBASE/$f-out.dat
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+# the target took the setting
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+DURABLE=`echo "$STATOUT" | grep '^target\..*\.durable_writes = ' | cut -d ' ' -f 3`
+if [ "$DURABLE" != "1" ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+sleep 1
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
@@ -0,0 +1,94 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout, running the handlers on
+# 0 to 4 execution streams that are retired after 100 ms of idleness
+test_start_servers 1 2 20 pmem: "-e 0:4 -C elastic_idle_ms=100"
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+SIZE=`stat -c %s $TMPBASE/foo.dat`
+
+# concurrent copies, so that requests queue up in the handler pool
+PIDS=""
+for i in `seq 8`
+do
+    run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1 > $TMPBASE/foo-$i.out &
+    PIDS="$PIDS $!"
+done
+FAILED=0
+for pid in $PIDS
+do
+    wait $pid || FAILED=1
+done
+if [ $FAILED -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+PIDS=""
+for i in `seq 8`
+do
+    RID=`grep -o -P '/tmp.*$' $TMPBASE/foo-$i.out`
+    run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out-$i.dat $SIZE &
+    PIDS="$PIDS $!"
+done
+for pid in $PIDS
+do
+    wait $pid || FAILED=1
+done
+if [ $FAILED -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+for i in `seq 8`
+do
+    cmp $TMPBASE/foo.dat $TMPBASE/foo-out-$i.dat
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+# starting from no execution stream, the pool grew to serve the requests,
+# and shrank again once idle for longer than elastic_idle_ms
+sleep 1
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+for k in grows shrinks
+do
+    COUNT=`echo "$STATOUT" | grep "^elastic\.$k = " | cut -d ' ' -f 3`
+    if [ -z "$COUNT" ] || [ "$COUNT" -lt 1 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+sleep 1
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
@@ -0,0 +1,103 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+# File backend uses directio, which does not work on tmpfs. Put targets in
+# local dir instead.
+export TMPDIR="."
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout, and a 4 MiB block cache
+test_start_servers 1 2 20 file: "-c cache_size=4194304"
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+SIZE=`stat -c %s $TMPBASE/foo.dat`
+CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+
+# read the region twice; the second read is served from the cache
+for i in 1 2
+do
+    run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out-$i.dat $SIZE
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+    cmp $TMPBASE/foo.dat $TMPBASE/foo-out-$i.dat
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+# the second read hit the cache
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+HITS=`echo "$STATOUT" | grep '^target\..*\.cache_hits = ' | cut -d ' ' -f 3`
+if [ -z "$HITS" ] || [ "$HITS" -lt 1 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+sleep 1
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+# a cache setting given to a pmem and a file target only applies to the
+# file one, and the pmem target does not keep the daemon from starting
+src/bake-mkpool -s 100M pmem:$TMPBASE/svr-2.dat
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+src/bake-mkpool -s 100M file:$TMPBASE/svr-3.dat
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+run_to 20 src/bake-server-daemon -p -c cache_size=4194304 \
+    -f $TMPBASE/svr-2.addr na+sm pmem:$TMPBASE/svr-2.dat \
+    file:$TMPBASE/svr-3.dat &
+sleep 2
+svr2=`cat $TMPBASE/svr-2.addr`
+
+STATOUT=`run_to 10 src/bake-stat -r $svr2 1`
+SIZES=`echo "$STATOUT" | grep -c '^target\..*\.cache_size = 4194304$'`
+if [ "$SIZES" -ne 1 ]; then
+    run_to 10 src/bake-shutdown $svr2
+    wait
+    exit 1
+fi
+
+run_to 10 src/bake-shutdown $svr2
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
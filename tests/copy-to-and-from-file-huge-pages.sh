@@ -0,0 +1,60 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+# File backend uses directio, which does not work on tmpfs. Put targets in
+# local dir instead.
+export TMPDIR="."
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout, with pipelining buffers on
+# node 0 and bounce buffers on the node of the target's device, all backed by
+# huge pages (transparent ones if none are reserved)
+test_start_servers 1 2 20 file: "-C pipeline_huge_pages=1 -C pipeline_numa_node=0 -C pipeline_min_buffers_per_pool=1 -c arena_huge_pages=1 -c numa_node=auto"
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+SIZE=`stat -c %s $TMPBASE/foo.dat`
+CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out.dat $SIZE
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+cmp $TMPBASE/foo.dat $TMPBASE/foo-out.dat
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+sleep 1
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
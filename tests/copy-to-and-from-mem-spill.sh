@@ -0,0 +1,77 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+# The spill target uses directio, which does not work on tmpfs. Put targets
+# in local dir instead.
+export TMPDIR="."
+source $srcdir/tests/test-util.sh
+
+# every region is over the DRAM capacity of 1 byte and goes to a file target
+src/bake-mkpool -s 100M file:$TMPBASE/spill.dat
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+# start 1 server with 2 second wait, 20s timeout
+test_start_servers 1 2 20 mem: "-c capacity=1 -c spill_target=$TMPBASE/spill.dat"
+
+# actual test case
+#####################
+
+echo "Hello world." > $TMPBASE/foo.dat
+CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out.dat 13
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+cmp $TMPBASE/foo.dat $TMPBASE/foo-out.dat
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+# the region must have gone to the spill target
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+echo "$STATOUT"
+SPILLED=`echo "$STATOUT" | grep '^target\..*\.spilled_regions = ' | cut -d ' ' -f 3`
+if [ -z "$SPILLED" ] || [ "$SPILLED" -lt 1 ]; then
+    echo "the region was not spilled"
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
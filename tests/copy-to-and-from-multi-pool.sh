@@ -0,0 +1,81 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# create one target made of 2 pools
+POOLS=$TMPBASE/svr-1-pool-1.dat,$TMPBASE/svr-1-pool-2.dat
+src/bake-mkpool -s 100M pmem:$POOLS
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+# start 1 server with 2 second wait, 20s timeout
+run_to 20 src/bake-server-daemon -p -f $TMPBASE/svr-1.addr na+sm pmem:$POOLS &
+sleep 2
+svr1=`cat $TMPBASE/svr-1.addr`
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+SIZE=`stat -c %s $TMPBASE/foo.dat`
+
+# regions are created round-robin, so two copies land in different pools
+for i in 1 2
+do
+    CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1`
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+
+    RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+    run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out-$i.dat $SIZE
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+
+    cmp $TMPBASE/foo.dat $TMPBASE/foo-out-$i.dat
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+# each pool holds one of the copies
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+for p in 0 1
+do
+    ALLOCATED=`echo "$STATOUT" | grep "^target\..*\.pool\.$p\.allocated = " | cut -d ' ' -f 3`
+    if [ -z "$ALLOCATED" ] || [ "$ALLOCATED" -lt $SIZE ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+sleep 1
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
@@ -0,0 +1,102 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout, running one request at a
+# time through the weighted fair scheduler, with bulk requests from 1 KiB
+test_start_servers 1 2 20 pmem: "-C qos_enabled=1 -C qos_policy=weighted -C qos_max_concurrency=1 -C qos_bulk_limit=1 -C qos_small_threshold=1024"
+
+# actual test case
+#####################
+
+# bulk and small copies at once, so that requests of both classes have to
+# queue for the single slot
+cp $srcdir/tests/lorem.txt $TMPBASE/bulk.dat
+head -c 512 $srcdir/tests/lorem.txt > $TMPBASE/small.dat
+PIDS=""
+for i in `seq 4`
+do
+    run_to 10 src/bake-copy-to $TMPBASE/bulk.dat $svr1 1 1 > $TMPBASE/bulk-$i.out &
+    PIDS="$PIDS $!"
+    run_to 10 src/bake-copy-to $TMPBASE/small.dat $svr1 1 1 > $TMPBASE/small-$i.out &
+    PIDS="$PIDS $!"
+done
+FAILED=0
+for pid in $PIDS
+do
+    wait $pid || FAILED=1
+done
+if [ $FAILED -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+for f in bulk small
+do
+    SIZE=`stat -c %s $TMPBASE/$f.dat`
+    for i in `seq 4`
+    do
+        RID=`grep -o -P '/tmp.*$' $TMPBASE/$f-$i.out`
+        run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/$f-$i-out.dat $SIZE
+        if [ $? -ne 0 ]; then
+            run_to 10 src/bake-shutdown $svr1
+            wait
+            exit 1
+        fi
+
+        cmp $TMPBASE/$f.dat $TMPBASE/$f-$i-out.dat
+        if [ $? -ne 0 ]; then
+            run_to 10 src/bake-shutdown $svr1
+            wait
+            exit 1
+        fi
+    done
+done
+
+# both classes went through the scheduler, which reports their queues and
+# latencies
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+for c in small bulk
+do
+    REQUESTS=`echo "$STATOUT" | grep "^qos\.$c = " | cut -d ' ' -f 4`
+    if [ -z "$REQUESTS" ] || [ "$REQUESTS" -lt 4 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+    echo "$STATOUT" | grep "^qos\.$c = requests .* queued [0-9]* .* latency [0-9.]* max_latency [0-9.]*$"
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+    echo "$STATOUT" | grep "^qos\.$c\.latency_histogram = "
+    if [ $? -ne 0 ]; then
+        run_to 10 src/bake-shutdown $svr1
+        wait
+        exit 1
+    fi
+done
+
+sleep 1
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
@@ -0,0 +1,98 @@
+#!/bin/bash -x
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout, with a write-back DRAM tier
+test_start_servers 1 2 20 tier:pmem:
+
+# actual test case
+#####################
+
+cp $srcdir/tests/lorem.txt $TMPBASE/foo.dat
+SIZE=`stat -c %s $TMPBASE/foo.dat`
+CPOUT=`run_to 10 src/bake-copy-to $TMPBASE/foo.dat $svr1 1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+RID=`echo "$CPOUT" | grep -o -P '/tmp.*$'`
+run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out.dat $SIZE
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+cmp $TMPBASE/foo.dat $TMPBASE/foo-out.dat
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+# the persist done by bake-copy-to flushes the copy to the pmem target
+STATOUT=`run_to 10 src/bake-stat -r $svr1 1`
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+echo "$STATOUT"
+FLUSHES=`echo "$STATOUT" | grep '^target\..*\.tier\.flushes = ' | cut -d ' ' -f 3`
+if [ -z "$FLUSHES" ] || [ "$FLUSHES" -lt 1 ]; then
+    echo "the written data was not flushed"
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+wait
+
+# read the region back from the pmem target alone, without the tier; region
+# ids are those of the inner target
+rm -f $TMPBASE/svr-1.addr $TMPBASE/foo-out.dat
+run_to 20 src/bake-server-daemon -p -f $TMPBASE/svr-1.addr na+sm \
+    pmem:$TMPBASE/svr-1.dat &
+sleep 2
+svr1=`cat $TMPBASE/svr-1.addr`
+
+run_to 10 src/bake-copy-from $svr1 1 $RID $TMPBASE/foo-out.dat $SIZE
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+cmp $TMPBASE/foo.dat $TMPBASE/foo-out.dat
+if [ $? -ne 0 ]; then
+    run_to 10 src/bake-shutdown $svr1
+    wait
+    exit 1
+fi
+
+#####################
+
+# tear down
+run_to 10 src/bake-shutdown $svr1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
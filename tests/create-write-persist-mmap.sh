@@ -0,0 +1,31 @@
+#!/bin/bash -x
+
+set -e
+set -o pipefail
+
+if [ -z $srcdir ]; then
+    echo srcdir variable not set.
+    exit 1
+fi
+source $srcdir/tests/test-util.sh
+
+# start 1 server with 2 second wait, 20s timeout
+test_start_servers 1 2 20 mmap:
+
+sleep 1
+
+#####################
+
+# run test
+run_to 10 tests/create-write-persist-test $srcdir/tests/lorem.txt $svr1 1
+if [ $? -ne 0 ]; then
+    wait
+    exit 1
+fi
+
+wait
+
+echo cleaning up $TMPBASE
+rm -rf $TMPBASE
+
+exit 0
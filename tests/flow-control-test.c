@@ -0,0 +1,242 @@
+/*
+ * (C) 2020 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mercury.h>
+#include <abt.h>
+#include <margo.h>
+
+#include "bake-client.h"
+
+/* writes and reads back the chunks of a region from concurrent ULTs, more
+ * of them than the provider grants credits for, and checks that the data
+ * survives and that the handle had to queue operations; run against a
+ * provider granting credits for a single operation */
+
+#define NUM_ULTS 8
+
+static char* read_input_file(const char* filename, size_t* size);
+
+struct chunk_arg {
+    bake_provider_handle_t bph;
+    bake_target_id_t       bti;
+    bake_region_id_t       rid;
+    const char*            data;
+    size_t                 offset;
+    size_t                 len;
+    int                    ret;
+};
+
+static void chunk_ult(void* arg)
+{
+    struct chunk_arg* a = arg;
+    char*             buf;
+    uint64_t          bytes_read;
+
+    a->ret = bake_write(a->bph, a->bti, a->rid, a->offset, a->data + a->offset,
+                        a->len);
+    if (a->ret != 0) {
+        bake_perror("Error: bake_write()", a->ret);
+        return;
+    }
+    buf = malloc(a->len);
+    if (!buf) {
+        a->ret = -1;
+        return;
+    }
+    a->ret = bake_read(a->bph, a->bti, a->rid, a->offset, buf, a->len,
+                       &bytes_read);
+    if (a->ret != 0)
+        bake_perror("Error: bake_read()", a->ret);
+    else if (bytes_read != a->len
+             || memcmp(buf, a->data + a->offset, a->len) != 0) {
+        fprintf(stderr, "Error: unexpected data at offset %zu\n", a->offset);
+        a->ret = -1;
+    }
+    free(buf);
+}
+
+int main(int argc, char* argv[])
+{
+    int                    i;
+    char                   cli_addr_prefix[64] = {0};
+    char*                  bake_svr_addr_str;
+    margo_instance_id      mid;
+    hg_addr_t              svr_addr = HG_ADDR_NULL;
+    uint8_t                mplex_id;
+    bake_client_t          bcl = BAKE_CLIENT_NULL;
+    bake_provider_handle_t bph = BAKE_PROVIDER_HANDLE_NULL;
+    uint64_t               num_targets;
+    bake_target_id_t       bti;
+    bake_region_id_t       rid;
+    char*                  data = NULL;
+    size_t                 data_size, chunk_size;
+    struct chunk_arg       args[NUM_ULTS];
+    ABT_thread             ults[NUM_ULTS];
+    int                    num_ults = 0;
+    ABT_xstream            xstream;
+    ABT_pool               pool;
+    uint64_t               credit_ops, credit_bytes, queued;
+    double                 queued_time;
+    hg_return_t            hret;
+    int                    ret = -1;
+
+    if (argc != 4) {
+        fprintf(stderr,
+                "Usage: flow-control-test <input file> <bake server "
+                "addr> <mplex id>\n");
+        return (-1);
+    }
+    bake_svr_addr_str = argv[2];
+    mplex_id          = atoi(argv[3]);
+
+    data = read_input_file(argv[1], &data_size);
+    if (!data) return (-1);
+    chunk_size = data_size / NUM_ULTS;
+    if (chunk_size == 0) {
+        fprintf(stderr, "Error: the input file must hold at least %d bytes\n",
+                NUM_ULTS);
+        free(data);
+        return (-1);
+    }
+
+    /* initialize Margo using the transport portion of the server
+     * address (i.e., the part before the first : character if present)
+     */
+    for (i = 0; (i < 63 && bake_svr_addr_str[i] != '\0'
+                 && bake_svr_addr_str[i] != ':');
+         i++)
+        cli_addr_prefix[i] = bake_svr_addr_str[i];
+
+    mid = margo_init(cli_addr_prefix, MARGO_CLIENT_MODE, 0, 0);
+    if (mid == MARGO_INSTANCE_NULL) {
+        fprintf(stderr, "Error: margo_init()\n");
+        free(data);
+        return (-1);
+    }
+
+    ret = bake_client_init(mid, &bcl);
+    if (ret != 0) {
+        bake_perror("Error: bake_client_init()", ret);
+        goto finish;
+    }
+
+    hret = margo_addr_lookup(mid, bake_svr_addr_str, &svr_addr);
+    if (hret != HG_SUCCESS) {
+        fprintf(stderr, "Error: margo_addr_lookup()\n");
+        ret = -1;
+        goto finish;
+    }
+
+    ret = bake_provider_handle_create(bcl, svr_addr, mplex_id, &bph);
+    if (ret != 0) {
+        bake_perror("Error: bake_provider_handle_create()", ret);
+        goto finish;
+    }
+
+    ret = bake_probe(bph, 1, &bti, &num_targets);
+    if (ret != 0) {
+        bake_perror("Error: bake_probe()", ret);
+        goto finish;
+    }
+
+    ret = bake_create(bph, bti, chunk_size * NUM_ULTS, &rid);
+    if (ret != 0) {
+        bake_perror("Error: bake_create()", ret);
+        goto finish;
+    }
+
+    /**** concurrent write and read-back phase ****/
+
+    ABT_xstream_self(&xstream);
+    ABT_xstream_get_main_pools(xstream, 1, &pool);
+    for (i = 0; i < NUM_ULTS; i++) {
+        args[i].bph    = bph;
+        args[i].bti    = bti;
+        args[i].rid    = rid;
+        args[i].data   = data;
+        args[i].offset = i * chunk_size;
+        args[i].len    = chunk_size;
+        args[i].ret    = -1;
+        ret = ABT_thread_create(pool, chunk_ult, &args[i], ABT_THREAD_ATTR_NULL,
+                                &ults[i]);
+        if (ret != ABT_SUCCESS) {
+            fprintf(stderr, "Error: ABT_thread_create()\n");
+            ret = -1;
+            break;
+        }
+        num_ults++;
+    }
+    for (i = 0; i < num_ults; i++) {
+        ABT_thread_join(ults[i]);
+        ABT_thread_free(&ults[i]);
+        if (args[i].ret != 0) ret = -1;
+    }
+    if (ret != 0) goto finish;
+
+    /**** flow control checks ****/
+
+    ret = bake_provider_handle_get_credits(bph, &credit_ops, &credit_bytes);
+    if (ret != 0) {
+        bake_perror("Error: bake_provider_handle_get_credits()", ret);
+        goto finish;
+    }
+    if (credit_ops != 1) {
+        fprintf(stderr, "Error: granted %llu operation credits instead of 1\n",
+                (unsigned long long)credit_ops);
+        ret = -1;
+        goto finish;
+    }
+
+    ret = bake_provider_handle_get_flow_stats(bph, &queued, &queued_time);
+    if (ret != 0) {
+        bake_perror("Error: bake_provider_handle_get_flow_stats()", ret);
+        goto finish;
+    }
+    printf("queued %llu operations for %f seconds\n",
+           (unsigned long long)queued, queued_time);
+    if (queued == 0) {
+        fprintf(stderr, "Error: no operation was queued\n");
+        ret = -1;
+        goto finish;
+    }
+
+    ret = bake_remove(bph, bti, rid);
+    if (ret != 0) bake_perror("Error: bake_remove()", ret);
+
+finish:
+    if (bph != BAKE_PROVIDER_HANDLE_NULL) bake_provider_handle_release(bph);
+    if (svr_addr != HG_ADDR_NULL) margo_addr_free(mid, svr_addr);
+    if (bcl != BAKE_CLIENT_NULL) bake_client_finalize(bcl);
+    margo_finalize(mid);
+    free(data);
+    return ret == 0 ? 0 : -1;
+}
+
+static char* read_input_file(const char* filename, size_t* size)
+{
+    size_t ret;
+    FILE*  fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    size_t sz = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* buf = calloc(1, sz + 1);
+    ret       = fread(buf, 1, sz, fp);
+    if (ret != sz && ferror(fp)) {
+        free(buf);
+        perror("read_input_file");
+        buf = NULL;
+    }
+    fclose(fp);
+    *size = sz;
+    return buf;
+}